@@ -0,0 +1,134 @@
+#include "benchCorpus.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace Bench {
+
+const TreeShape TINY_FILES = {"tiny", 20'000, 0, 4 * 1024, 16, 2, 49};
+const TreeShape HUGE_FILES = {"huge", 4, 256ull << 20, 256ull << 20, 1, 1, 50};
+const TreeShape DEEP_TREE = {"deep", 12'288, 1024, 8 * 1024, 64, 48, 51};
+const TreeShape UNIFORM_FILES = {"uniform", 2'000, 32 * 1024, 32 * 1024, 8, 2, 52};
+
+namespace {
+
+// splitmix64: cheap enough that generating a gigabyte costs less than writing it
+uint64_t Next(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+fs::path BaseDirectory() {
+    const char* configured = std::getenv("SCANNER_BENCH_DIR");
+    const fs::path parent = configured != nullptr && *configured != '\0' ? fs::path(configured)
+                                                                         : fs::temp_directory_path();
+    return parent / "scanner_bench_corpus";
+}
+
+// Owns everything generated and removes it at exit
+struct Store {
+    std::mutex mutex;
+    std::map<const TreeShape*, std::unique_ptr<Tree>> trees;
+    std::map<size_t, std::unique_ptr<fs::path>> bases;
+
+    ~Store() {
+        std::error_code ec;
+        fs::remove_all(BaseDirectory(), ec);
+    }
+};
+
+Store& GetStore() {
+    static Store store;
+    return store;
+}
+
+void WriteFile(const fs::path& path, uint64_t size, uint64_t& state) {
+    std::ofstream out(path, std::ios::binary);
+    std::vector<uint64_t> block(8192);
+    while (size > 0) {
+        for (auto& word : block) {
+            word = Next(state);
+        }
+        const uint64_t chunk = std::min<uint64_t>(size, block.size() * sizeof(uint64_t));
+        out.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(chunk));
+        size -= chunk;
+    }
+}
+
+std::string RandomMd5(uint64_t& state) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hash(32, '0');
+    const uint64_t high = Next(state);
+    const uint64_t low = Next(state);
+    for (size_t i = 0; i < 16; ++i) {
+        hash[i] = digits[(high >> (i * 4)) & 0xF];
+        hash[16 + i] = digits[(low >> (i * 4)) & 0xF];
+    }
+    return hash;
+}
+
+} // namespace
+
+const Tree& GetTree(const TreeShape& shape) {
+    Store& store = GetStore();
+    std::lock_guard<std::mutex> lock(store.mutex);
+    auto& tree = store.trees[&shape];
+    if (tree) {
+        return *tree;
+    }
+
+    tree = std::make_unique<Tree>();
+    tree->root = BaseDirectory() / shape.name;
+    fs::remove_all(tree->root);
+
+    std::vector<fs::path> directories;
+    for (size_t chain = 0; chain < shape.chains; ++chain) {
+        fs::path directory = tree->root;
+        for (size_t level = 0; level < shape.depth; ++level) {
+            directory /= "d" + std::to_string(chain) + "_" + std::to_string(level);
+            directories.push_back(directory);
+        }
+        fs::create_directories(directory);
+    }
+
+    uint64_t state = shape.seed;
+    for (size_t i = 0; i < shape.files; ++i) {
+        const uint64_t spread = shape.maxSize - shape.minSize;
+        const uint64_t size = shape.minSize + (spread != 0 ? Next(state) % (spread + 1) : 0);
+        WriteFile(directories[i % directories.size()] / ("file" + std::to_string(i) + ".bin"), size, state);
+        tree->bytes += size;
+    }
+    tree->files = shape.files;
+    return *tree;
+}
+
+const fs::path& GetSignatureBase(size_t signatures) {
+    Store& store = GetStore();
+    std::lock_guard<std::mutex> lock(store.mutex);
+    auto& base = store.bases[signatures];
+    if (base) {
+        return *base;
+    }
+
+    fs::create_directories(BaseDirectory());
+    base = std::make_unique<fs::path>(BaseDirectory() / ("signatures_" + std::to_string(signatures) + ".csv"));
+    std::ofstream csv(*base);
+    uint64_t state = signatures;
+    for (size_t i = 0; i < signatures; ++i) {
+        csv << RandomMd5(state) << ";Bench.Malware." << (i % 1000) << '\n';
+    }
+    return *base;
+}
+
+} // namespace Bench
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace Bench {
+
+// A generated tree: files spread round-robin over chains of nested
+// directories, sizes drawn between minSize and maxSize. Everything comes
+// from the seed, so every run and every machine gets the same bytes and
+// the results of two builds can be compared.
+struct TreeShape {
+    const char* name;
+    size_t files;
+    uint64_t minSize;
+    uint64_t maxSize;
+    size_t chains;  // Directory chains under the root
+    size_t depth;   // Directories in each chain; files go into all of them
+    uint64_t seed;
+};
+
+// Many small files in a shallow tree
+extern const TreeShape TINY_FILES;
+// A few large files, where reading and hashing dominate
+extern const TreeShape HUGE_FILES;
+// Directories 48 levels deep, where traversal dominates
+extern const TreeShape DEEP_TREE;
+// Same-size files of moderate size
+extern const TreeShape UNIFORM_FILES;
+
+struct Tree {
+    std::filesystem::path root;
+    size_t files = 0;
+    uint64_t bytes = 0;
+};
+
+// Built on first use and removed when the process exits. The directory is
+// SCANNER_BENCH_DIR when set, the system temporary directory otherwise.
+const Tree& GetTree(const TreeShape& shape);
+
+// An MD5 base of random signatures without size= columns, so none of them
+// match and every file is looked up. Built once per count, like the trees.
+const std::filesystem::path& GetSignatureBase(size_t signatures);
+
+} // namespace Bench
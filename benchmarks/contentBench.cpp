@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+#include "contentMatcher.h"
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t SCAN_SIZE = 16 << 20;
+constexpr size_t READ_SIZE = 64 << 10;  // Buffers arrive the way FileHasher reads them
+
+std::string RandomBytes(std::mt19937& rng, size_t size) {
+    std::string data(size, '\0');
+    for (auto& c : data) {
+        c = static_cast<char>(rng() & 0xFF);
+    }
+    return data;
+}
+
+const Scanner::ContentMatcher& GetMatcher(size_t patterns) {
+    static std::map<size_t, std::unique_ptr<Scanner::ContentMatcher>> cache;
+    auto& matcher = cache[patterns];
+    if (!matcher) {
+        std::mt19937 rng(static_cast<unsigned>(patterns));
+        std::vector<Scanner::ContentMatcher::Pattern> entries;
+        for (uint32_t id = 1; id <= patterns; ++id) {
+            entries.push_back({RandomBytes(rng, 8 + rng() % 25), id});
+        }
+        matcher = std::make_unique<Scanner::ContentMatcher>();
+        matcher->Build(entries);
+    }
+    return *matcher;
+}
+
+// Random data matches nothing, so every byte goes through the prefilter and
+// the automaton; this is the cost of scanning a clean file
+void BM_ContentScan(benchmark::State& state) {
+    const auto& matcher = GetMatcher(static_cast<size_t>(state.range(0)));
+    std::mt19937 rng(1);
+    const std::string data = RandomBytes(rng, SCAN_SIZE);
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+
+    for (auto _ : state) {
+        Scanner::ContentMatcher::State scan;
+        for (size_t offset = 0; offset < data.size(); offset += READ_SIZE) {
+            matcher.Scan(scan, bytes + offset, READ_SIZE);
+        }
+        benchmark::DoNotOptimize(scan.match);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(data.size()));
+    state.SetLabel(Scanner::ContentMatcher::HasSimdPrefilter() ? "ssse3" : "scalar");
+}
+BENCHMARK(BM_ContentScan)->Arg(100)->Arg(1'000)->Arg(10'000)->Arg(100'000)->Unit(benchmark::kMillisecond);
+
+} // namespace
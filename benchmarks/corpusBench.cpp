@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+#include "benchCorpus.h"
+#include "scannerApi.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <thread>
+
+namespace {
+
+constexpr size_t SMALL_BASE = 1'000;  // Loads in well under a millisecond
+
+// Indexed by the benchmark argument
+const Bench::TreeShape* const SHAPES[] = {&Bench::TINY_FILES, &Bench::HUGE_FILES, &Bench::DEEP_TREE};
+
+enum Corpus : int64_t { CORPUS_TINY = 0, CORPUS_HUGE = 1, CORPUS_DEEP = 2 };
+
+Scanner::ScanSettings SettingsFor(const Bench::Tree& tree, size_t signatures) {
+    Scanner::ScanSettings settings;
+    settings.rootPath = tree.root.string();
+    settings.databasePath = Bench::GetSignatureBase(signatures).string();
+    settings.logPath = (tree.root.parent_path() / "scan.log").string();
+    settings.threadCount = std::thread::hardware_concurrency();
+    return settings;
+}
+
+void RunScans(benchmark::State& state, const Bench::Tree& tree, const Scanner::ScanSettings& settings) {
+    std::unique_ptr<Scanner::IScanner> scanner(CreateScanner());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scanner->Scan(settings).totalFilesProcessed);
+    }
+    DestroyScanner(scanner.release());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tree.files));
+    state.counters["files"] = static_cast<double>(tree.files);
+}
+
+// End-to-end scans of each generated tree against a small base, so the
+// numbers are traversal, reading, hashing and lookups. The tree is cached
+// after the first iteration; SCANNER_BENCH_DIR puts it on the disk to test.
+void BM_ScanCorpus(benchmark::State& state) {
+    const Bench::TreeShape& shape = *SHAPES[state.range(0)];
+    state.SetLabel(shape.name);
+    const Bench::Tree& tree = Bench::GetTree(shape);
+    RunScans(state, tree, SettingsFor(tree, SMALL_BASE));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(tree.bytes));
+}
+
+// The same scan of the uniform tree with a base of up to 10M signatures,
+// whose loading is part of every scan
+void BM_ScanLargeBase(benchmark::State& state) {
+    const Bench::Tree& tree = Bench::GetTree(Bench::UNIFORM_FILES);
+    RunScans(state, tree, SettingsFor(tree, static_cast<size_t>(state.range(0))));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(tree.bytes));
+}
+
+// Collection alone: every file is found and its size taken, then left out
+// by ScanSettings::minFileSize, so nothing is read
+void BM_Traversal(benchmark::State& state) {
+    const Bench::TreeShape& shape = *SHAPES[state.range(0)];
+    state.SetLabel(shape.name);
+    const Bench::Tree& tree = Bench::GetTree(shape);
+    Scanner::ScanSettings settings = SettingsFor(tree, SMALL_BASE);
+    settings.minFileSize = std::numeric_limits<uint64_t>::max();
+    RunScans(state, tree, settings);
+}
+
+} // namespace
+
+BENCHMARK(BM_ScanCorpus)
+    ->ArgName("corpus")
+    ->Arg(CORPUS_TINY)
+    ->Arg(CORPUS_HUGE)
+    ->Arg(CORPUS_DEEP)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ScanLargeBase)
+    ->ArgName("signatures")
+    ->Arg(1'000'000)
+    ->Arg(10'000'000)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Traversal)
+    ->ArgName("corpus")
+    ->Arg(CORPUS_TINY)
+    ->Arg(CORPUS_DEEP)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
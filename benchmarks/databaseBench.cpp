@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+#include "benchCorpus.h"
+#include "hashDatabase.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t INDEX_BATCH = 64;
+constexpr size_t INDEX_QUERIES = 1 << 16;
+
+// Parsing the CSV and building the lookup tables, which every scan starts with
+void BM_DatabaseLoad(benchmark::State& state) {
+    const size_t signatures = static_cast<size_t>(state.range(0));
+    const auto& base = Bench::GetSignatureBase(signatures);
+    for (auto _ : state) {
+        Scanner::HashDatabase database;
+        database.LoadFromCSV(base.string());
+        benchmark::DoNotOptimize(database.GetSize());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(signatures));
+}
+
+std::string IndexPath(size_t signatures) {
+    return Bench::GetSignatureBase(signatures).string() + ".idx";
+}
+
+// Sorting a base into an on-disk index, which the first indexed scan pays
+void BM_IndexBuild(benchmark::State& state) {
+    const size_t signatures = static_cast<size_t>(state.range(0));
+    const auto& base = Bench::GetSignatureBase(signatures);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Scanner::HashDatabase::BuildIndex(base.string(), IndexPath(signatures)));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(signatures));
+}
+
+// Groups of random digests, nearly all misses, resolved against the index
+// with a page cache of range(1) MB; a cache smaller than the index sends
+// most groups to the disk, or to the OS page cache after the first pass
+void BM_LookupIndexed(benchmark::State& state) {
+    const size_t signatures = static_cast<size_t>(state.range(0));
+    Scanner::HashDatabase database;
+    if (!database.LoadIndexed(Bench::GetSignatureBase(signatures).string(), IndexPath(signatures),
+                              static_cast<size_t>(state.range(1)) * 1024 * 1024)) {
+        state.SkipWithError("Cannot load the indexed base");
+        return;
+    }
+
+    std::mt19937_64 rng(signatures);
+    std::vector<Scanner::HashDatabase::DigestKey> queries(INDEX_QUERIES);
+    for (auto& query : queries) {
+        query.algorithm = Scanner::HashAlgorithm::MD5;
+        for (size_t i = 0; i < Scanner::DigestSize(Scanner::HashAlgorithm::MD5); ++i) {
+            query.digest[i] = static_cast<unsigned char>(rng());
+        }
+    }
+    std::vector<Scanner::HashDatabase::DigestKey> group(INDEX_BATCH);
+    std::vector<std::string> verdicts;
+    size_t next = 0;
+    for (auto _ : state) {
+        std::copy(queries.begin() + next, queries.begin() + next + INDEX_BATCH, group.begin());
+        benchmark::DoNotOptimize(database.IsMaliciousBatch(group, verdicts));
+        next = (next + INDEX_BATCH) % INDEX_QUERIES;
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(INDEX_BATCH));
+}
+
+} // namespace
+
+BENCHMARK(BM_DatabaseLoad)
+    ->ArgName("signatures")
+    ->Arg(100'000)
+    ->Arg(1'000'000)
+    ->Arg(10'000'000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_IndexBuild)
+    ->ArgName("signatures")
+    ->Arg(1'000'000)
+    ->Arg(10'000'000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LookupIndexed)
+    ->ArgNames({"signatures", "cacheMB"})
+    ->Args({10'000'000, 1})
+    ->Args({10'000'000, 256})
+    ->Unit(benchmark::kMicrosecond);
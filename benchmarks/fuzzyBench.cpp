@@ -0,0 +1,101 @@
+#include <benchmark/benchmark.h>
+#include "fuzzyHash.h"
+#include "fuzzyIndex.h"
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t QUERY_COUNT = 1 << 12;
+constexpr size_t VARIANT_EVERY = 4;  // Every fourth query is an edited copy of an indexed digest
+
+const char BASE64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string RandomPart(std::mt19937& rng, size_t length) {
+    std::string part(length, 'A');
+    for (auto& c : part) {
+        c = BASE64[rng() % 64];
+    }
+    return part;
+}
+
+// Synthetic digests: hashing millions of real samples would dominate the run
+Scanner::FuzzyDigest RandomDigest(std::mt19937& rng) {
+    Scanner::FuzzyDigest digest;
+    digest.blockSize = Scanner::FuzzyHasher::MIN_BLOCKSIZE << (rng() % 16);
+    digest.part1 = RandomPart(rng, 48 + rng() % 17);
+    digest.part2 = RandomPart(rng, 24 + rng() % 9);
+    return digest;
+}
+
+struct Corpus {
+    Scanner::FuzzyIndex index;
+    std::vector<Scanner::FuzzyDigest> queries;
+};
+
+const Corpus& GetCorpus(size_t entries) {
+    static std::map<size_t, std::unique_ptr<Corpus>> cache;
+    auto& corpus = cache[entries];
+    if (corpus) {
+        return *corpus;
+    }
+
+    corpus = std::make_unique<Corpus>();
+    std::mt19937 rng(static_cast<unsigned>(entries));
+    std::vector<Scanner::FuzzyIndex::Entry> indexed;
+    indexed.reserve(entries);
+    for (uint32_t id = 1; id <= entries; ++id) {
+        indexed.push_back({RandomDigest(rng), id});
+    }
+
+    for (size_t i = 0; i < QUERY_COUNT; ++i) {
+        if (i % VARIANT_EVERY == 0) {
+            auto variant = indexed[rng() % indexed.size()].digest;
+            for (int edit = 0; edit < 3; ++edit) {
+                variant.part1[rng() % variant.part1.size()] = BASE64[rng() % 64];
+            }
+            corpus->queries.push_back(std::move(variant));
+        } else {
+            corpus->queries.push_back(RandomDigest(rng));
+        }
+    }
+    corpus->index.Build(std::move(indexed));
+    return *corpus;
+}
+
+void BM_FuzzyHash(benchmark::State& state) {
+    std::mt19937 rng(1);
+    std::string data(4 << 20, '\0');
+    for (auto& c : data) {
+        c = static_cast<char>(rng() & 0xFF);
+    }
+
+    // Sized like FileHasher does it, so small block sizes are dropped early
+    for (auto _ : state) {
+        Scanner::FuzzyHasher hasher(data.size());
+        hasher.Update(data.data(), data.size());
+        benchmark::DoNotOptimize(hasher.Final());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(data.size()));
+}
+BENCHMARK(BM_FuzzyHash)->Unit(benchmark::kMillisecond);
+
+void BM_FuzzyLookup(benchmark::State& state) {
+    const auto& corpus = GetCorpus(static_cast<size_t>(state.range(0)));
+    size_t next = 0;
+    size_t matches = 0;
+
+    for (auto _ : state) {
+        auto match = corpus.index.FindBest(corpus.queries[next], 80);
+        matches += match.id != 0;
+        next = (next + 1) % corpus.queries.size();
+    }
+    state.counters["matched"] = benchmark::Counter(static_cast<double>(matches) / state.iterations());
+}
+BENCHMARK(BM_FuzzyLookup)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMicrosecond);
+
+} // namespace
@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+#include "fileHasher.h"
+#include "scannerConstants.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using Scanner::HashAlgorithm;
+using Scanner::HashAlgorithmMask;
+using Scanner::MaskOf;
+
+constexpr size_t INPUT_SIZE = 16 * 1024 * 1024;
+
+const std::vector<unsigned char>& Input() {
+    static const std::vector<unsigned char> input = [] {
+        std::vector<unsigned char> data(INPUT_SIZE);
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<unsigned char>((i * 2654435761u) >> 13);
+        }
+        return data;
+    }();
+    return input;
+}
+
+std::string MaskName(HashAlgorithmMask algorithms) {
+    std::string name;
+    for (size_t i = 0; i < Scanner::HASH_ALGORITHM_COUNT; ++i) {
+        if (algorithms & (1u << i)) {
+            name += (name.empty() ? "" : "+") + std::string(Scanner::AlgorithmName(static_cast<HashAlgorithm>(i)));
+        }
+    }
+    return name;
+}
+
+// The per-buffer work of a scan: every requested hasher over buffers of
+// HASH_BUFFER_SIZE, as FileHasher feeds them
+void BM_HashKernel(benchmark::State& state) {
+    const auto algorithms = static_cast<HashAlgorithmMask>(state.range(0));
+    state.SetLabel(MaskName(algorithms));
+    const auto& input = Input();
+    Scanner::MultiHasher hasher(algorithms);
+    for (auto _ : state) {
+        hasher.Reset();
+        for (size_t offset = 0; offset < input.size(); offset += Scanner::Constants::HASH_BUFFER_SIZE) {
+            hasher.Update(input.data() + offset, Scanner::Constants::HASH_BUFFER_SIZE);
+        }
+        benchmark::DoNotOptimize(hasher.Final());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(INPUT_SIZE));
+}
+
+} // namespace
+
+// Single-threaded, so bytes_per_second is the per-core rate
+BENCHMARK(BM_HashKernel)
+    ->Arg(MaskOf(HashAlgorithm::MD5))
+    ->Arg(MaskOf(HashAlgorithm::SHA1))
+    ->Arg(MaskOf(HashAlgorithm::SHA256))
+    ->Arg(MaskOf(HashAlgorithm::SSDEEP))
+    ->Arg(MaskOf(HashAlgorithm::MD5) | MaskOf(HashAlgorithm::SHA1) | MaskOf(HashAlgorithm::SHA256))
+    ->Unit(benchmark::kMillisecond);
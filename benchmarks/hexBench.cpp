@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+#include "hexCodec.h"
+
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Enough digests that the loop is not one cache line hammered over and over
+constexpr size_t DIGESTS = 1024;
+
+std::vector<unsigned char> Digests(size_t size) {
+    std::vector<unsigned char> bytes(DIGESTS * size);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<unsigned char>((i * 2654435761u) >> 13);
+    }
+    return bytes;
+}
+
+// What digests were formatted with before the codec
+std::string StreamHex(const unsigned char* data, size_t size) {
+    std::stringstream ss;
+    ss << std::hex << std::setfill('0');
+    for (size_t i = 0; i < size; ++i) {
+        ss << std::setw(2) << static_cast<unsigned>(data[i]);
+    }
+    return ss.str();
+}
+
+void BM_HexEncodeStream(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    const auto bytes = Digests(size);
+    for (auto _ : state) {
+        for (size_t i = 0; i < DIGESTS; ++i) {
+            benchmark::DoNotOptimize(StreamHex(bytes.data() + i * size, size));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(DIGESTS));
+}
+
+void BM_HexEncode(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    const auto bytes = Digests(size);
+    std::string hex(2 * size, '\0');
+    for (auto _ : state) {
+        for (size_t i = 0; i < DIGESTS; ++i) {
+            Scanner::Hex::Encode(bytes.data() + i * size, size, &hex[0]);
+            benchmark::DoNotOptimize(hex.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(DIGESTS));
+}
+
+void BM_HexDecode(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    const auto bytes = Digests(size);
+    const std::string hex = Scanner::Hex::Encode(bytes.data(), bytes.size());
+    std::vector<unsigned char> decoded(size);
+    for (auto _ : state) {
+        for (size_t i = 0; i < DIGESTS; ++i) {
+            benchmark::DoNotOptimize(Scanner::Hex::Decode(hex.data() + 2 * i * size, size, decoded.data()));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(DIGESTS));
+}
+
+} // namespace
+
+// MD5 and SHA-256 digest sizes; items_per_second is digests per second
+BENCHMARK(BM_HexEncodeStream)->Arg(16)->Arg(32);
+BENCHMARK(BM_HexEncode)->Arg(16)->Arg(32);
+BENCHMARK(BM_HexDecode)->Arg(16)->Arg(32);
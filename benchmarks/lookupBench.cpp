@@ -0,0 +1,160 @@
+#include <benchmark/benchmark.h>
+#include "hashDatabase.h"
+#include "numaTopology.h"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t QUERY_COUNT = 1 << 16;
+constexpr size_t HIT_EVERY = 64;  // Real scans are dominated by misses
+
+std::string RandomHash(std::mt19937_64& rng) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hash(32, '0');
+    uint64_t high = rng();
+    uint64_t low = rng();
+    for (size_t i = 0; i < 16; ++i) {
+        hash[i] = digits[(high >> (i * 4)) & 0xF];
+        hash[16 + i] = digits[(low >> (i * 4)) & 0xF];
+    }
+    return hash;
+}
+
+struct Corpus {
+    Scanner::HashDatabase database;
+    std::vector<std::string> queries;
+};
+
+// Databases are expensive to build, keep one per size for the whole run
+const Corpus& GetCorpus(size_t entries) {
+    static std::map<size_t, std::unique_ptr<Corpus>> cache;
+    auto& corpus = cache[entries];
+    if (corpus) {
+        return *corpus;
+    }
+
+    corpus = std::make_unique<Corpus>();
+    std::mt19937_64 rng(entries);
+    auto csvPath = fs::temp_directory_path() / ("lookup_bench_" + std::to_string(entries) + ".csv");
+
+    std::vector<std::string> sample;
+    {
+        std::ofstream csv(csvPath);
+        for (size_t i = 0; i < entries; ++i) {
+            std::string hash = RandomHash(rng);
+            if (sample.size() < QUERY_COUNT / HIT_EVERY && i % (entries / (QUERY_COUNT / HIT_EVERY) + 1) == 0) {
+                sample.push_back(hash);
+            }
+            csv << hash << ";Bench.Malware." << (i % 1000) << '\n';
+        }
+    }
+    corpus->database.LoadFromCSV(csvPath.string());
+    std::error_code ec;
+    fs::remove(csvPath, ec);
+
+    corpus->queries.reserve(QUERY_COUNT);
+    for (size_t i = 0; i < QUERY_COUNT; ++i) {
+        if (i % HIT_EVERY == 0 && !sample.empty()) {
+            corpus->queries.push_back(sample[(i / HIT_EVERY) % sample.size()]);
+        } else {
+            corpus->queries.push_back(RandomHash(rng));
+        }
+    }
+    return *corpus;
+}
+
+void BM_LookupSingle(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus(static_cast<size_t>(state.range(0)));
+    std::string verdict;
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(corpus.database.IsMalicious(corpus.queries[next], verdict));
+        next = (next + 1) % QUERY_COUNT;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_LookupBatch(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus(static_cast<size_t>(state.range(0)));
+    const size_t batchSize = static_cast<size_t>(state.range(1));
+    std::vector<std::vector<std::string>> groups;
+    for (size_t i = 0; i + batchSize <= QUERY_COUNT; i += batchSize) {
+        groups.emplace_back(corpus.queries.begin() + i, corpus.queries.begin() + i + batchSize);
+    }
+    std::vector<std::string> verdicts;
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(corpus.database.IsMaliciousBatch(groups[next], verdicts));
+        next = (next + 1) % groups.size();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batchSize));
+}
+
+// Lookups from every CPU at once, each thread pinned to a NUMA node, against
+// the table loaded on one node (replicate = 0) or a copy made on each node
+// (replicate = 1), as ScanSettings::numaAware does. On a single-node machine
+// the two are the same table.
+void BM_LookupNuma(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus(static_cast<size_t>(state.range(0)));
+    static const auto topology = Scanner::NumaTopology::Detect();
+    static std::map<size_t, std::vector<std::unique_ptr<Scanner::HashDatabase>>> replicas;
+    static std::mutex replicasMutex;
+    
+    const size_t node = static_cast<size_t>(state.thread_index()) % topology.NodeCount();
+    topology.PinCurrentThread(node);
+    const Scanner::HashDatabase* database = &corpus.database;
+    if (state.range(1) != 0) {
+        std::lock_guard<std::mutex> lock(replicasMutex);
+        auto& copies = replicas[static_cast<size_t>(state.range(0))];
+        if (copies.empty()) {
+            copies.resize(topology.NodeCount());
+            for (size_t i = 0; i < copies.size(); ++i) {
+                std::thread([&, i] {
+                    topology.PinCurrentThread(i);
+                    copies[i] = std::make_unique<Scanner::HashDatabase>(corpus.database);
+                }).join();
+            }
+        }
+        database = copies[node].get();
+    }
+    
+    constexpr size_t batchSize = 64;
+    std::vector<std::vector<std::string>> groups;
+    for (size_t i = 0; i + batchSize <= QUERY_COUNT; i += batchSize) {
+        groups.emplace_back(corpus.queries.begin() + i, corpus.queries.begin() + i + batchSize);
+    }
+    std::vector<std::string> verdicts;
+    size_t next = static_cast<size_t>(state.thread_index()) * 97 % groups.size();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(database->IsMaliciousBatch(groups[next], verdicts));
+        next = (next + 1) % groups.size();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batchSize));
+}
+
+} // namespace
+
+// 100M entries is above Constants::MAX_DATABASE_ENTRIES, which the loader enforces
+BENCHMARK(BM_LookupSingle)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kNanosecond);
+BENCHMARK(BM_LookupBatch)
+    ->Args({1'000'000, 64})
+    ->Args({10'000'000, 64})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_LookupNuma)
+    ->ArgNames({"entries", "replicate"})
+    ->Args({10'000'000, 0})
+    ->Args({10'000'000, 1})
+    ->ThreadPerCpu()
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
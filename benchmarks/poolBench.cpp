@@ -0,0 +1,28 @@
+#include <benchmark/benchmark.h>
+#include "threadPool.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace {
+
+constexpr size_t TASKS = 10'000;
+
+// Dispatch overhead alone: tasks that do next to nothing, enqueued from one
+// thread and waited for, as ProcessBatch hands out groups of files
+void BM_ThreadPoolTasks(benchmark::State& state) {
+    Scanner::ThreadPool pool(static_cast<size_t>(state.range(0)));
+    std::atomic<uint64_t> done{0};
+    for (auto _ : state) {
+        for (size_t i = 0; i < TASKS; ++i) {
+            pool.Enqueue([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+        }
+        pool.Wait();
+    }
+    benchmark::DoNotOptimize(done.load());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(TASKS));
+}
+
+} // namespace
+
+BENCHMARK(BM_ThreadPoolTasks)->ArgName("threads")->Arg(1)->Arg(4)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,70 @@
+#include <benchmark/benchmark.h>
+#include "benchCorpus.h"
+#include "scannerApi.h"
+
+#include <memory>
+#include <thread>
+
+namespace {
+
+constexpr size_t SIGNATURES = 1'000'000;
+
+// Same-size files and an MD5 base without size= columns, so every file is
+// read, hashed and looked up
+Scanner::ScanSettings CorpusSettings() {
+    const Bench::Tree& tree = Bench::GetTree(Bench::UNIFORM_FILES);
+    Scanner::ScanSettings settings;
+    settings.rootPath = tree.root.string();
+    settings.databasePath = Bench::GetSignatureBase(SIGNATURES).string();
+    settings.logPath = (tree.root.parent_path() / "scan.log").string();
+    return settings;
+}
+
+// Whole scans of a cached tree with ScanSettings::numaAware off (0) and on (1).
+// Loading the base is part of every scan, so both include it.
+void BM_ScanNuma(benchmark::State& state) {
+    const Bench::Tree& tree = Bench::GetTree(Bench::UNIFORM_FILES);
+    std::unique_ptr<Scanner::IScanner> scanner(CreateScanner());
+
+    Scanner::ScanSettings settings = CorpusSettings();
+    settings.threadCount = std::thread::hardware_concurrency();
+    settings.numaAware = state.range(0) != 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scanner->Scan(settings).totalFilesProcessed);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tree.files));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(tree.bytes));
+    DestroyScanner(scanner.release());
+}
+
+// Blocking reads with a thread per file in flight against a few threads with
+// ScanSettings::asyncDepth files each in flight. The tree is cached, so this
+// shows what the ring costs; the gain needs reads that wait (network, disks).
+void BM_ScanAsync(benchmark::State& state) {
+    const Bench::Tree& tree = Bench::GetTree(Bench::UNIFORM_FILES);
+    std::unique_ptr<Scanner::IScanner> scanner(CreateScanner());
+
+    Scanner::ScanSettings settings = CorpusSettings();
+    settings.threadCount = static_cast<size_t>(state.range(0));
+    settings.asyncDepth = static_cast<size_t>(state.range(1));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scanner->Scan(settings).totalFilesProcessed);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tree.files));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(tree.bytes));
+    DestroyScanner(scanner.release());
+}
+
+} // namespace
+
+BENCHMARK(BM_ScanNuma)->ArgName("numa")->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ScanAsync)
+    ->ArgNames({"threads", "async"})
+    ->Args({1, 0})
+    ->Args({64, 0})
+    ->Args({1, 64})
+    ->Args({2, 256})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,100 @@
+#include <benchmark/benchmark.h>
+#include "scanSchedule.h"
+#include "scannerConstants.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t WORKERS = 8;
+constexpr double FILE_COST_S = 50e-6;        // Open, stat and lookup of one file
+constexpr double BYTES_PER_S = 1e9;          // Hashing throughput of one worker
+
+// Synthetic skewed tree: many small files, a few hundred medium ones and a
+// handful of multi-gigabyte images, the largest found last
+std::vector<uint64_t> SkewedTree() {
+    std::mt19937_64 rng(35);
+    std::lognormal_distribution<double> small(9.0, 1.5);  // Median around 8 KB
+    std::vector<uint64_t> sizes;
+    for (size_t i = 0; i < 50'000; ++i) {
+        sizes.push_back(static_cast<uint64_t>(small(rng)));
+        if (i % 250 == 0) {
+            sizes.push_back((8ull << 20) + rng() % (64ull << 20));
+        }
+        if (i % 12'000 == 11'999) {
+            sizes.push_back((1ull << 30) + rng() % (1ull << 30));
+        }
+    }
+    sizes.push_back(4ull << 30);
+    return sizes;
+}
+
+// The order the scanner used before size-aware planning: groups of
+// LOOKUP_BATCH_SIZE files in directory order
+std::vector<std::vector<size_t>> DirectoryOrder(const std::vector<uint64_t>& sizes) {
+    std::vector<std::vector<size_t>> batches;
+    for (size_t begin = 0; begin < sizes.size(); begin += Scanner::Constants::LOOKUP_BATCH_SIZE) {
+        batches.emplace_back();
+        for (size_t i = begin; i < std::min(begin + Scanner::Constants::LOOKUP_BATCH_SIZE, sizes.size()); ++i) {
+            batches.back().push_back(i);
+        }
+    }
+    return batches;
+}
+
+struct Simulation {
+    double makespan = 0;
+    double tail = 0;  // From the first worker running out of work to the end
+};
+
+// A FIFO pool: each task goes to the worker that frees up first
+Simulation Simulate(const std::vector<uint64_t>& sizes, const std::vector<std::vector<size_t>>& batches) {
+    std::priority_queue<double, std::vector<double>, std::greater<double>> freeAt;
+    for (size_t i = 0; i < WORKERS; ++i) {
+        freeAt.push(0);
+    }
+    for (const auto& batch : batches) {
+        double cost = 0;
+        for (size_t index : batch) {
+            cost += FILE_COST_S + static_cast<double>(sizes[index]) / BYTES_PER_S;
+        }
+        const double start = freeAt.top();
+        freeAt.pop();
+        freeAt.push(start + cost);
+    }
+
+    Simulation result;
+    const double firstIdle = freeAt.top();
+    while (!freeAt.empty()) {
+        result.makespan = freeAt.top();
+        freeAt.pop();
+    }
+    result.tail = result.makespan - firstIdle;
+    return result;
+}
+
+// Times the planning itself; the counters are the simulated scan of the tree
+// on WORKERS workers under each dispatch order
+void BM_ScheduleSkewedTree(benchmark::State& state) {
+    const bool planned = state.range(0) != 0;
+    const auto sizes = SkewedTree();
+
+    std::vector<std::vector<size_t>> batches;
+    for (auto _ : state) {
+        batches = planned ? Scanner::PlanBatches(sizes) : DirectoryOrder(sizes);
+        benchmark::DoNotOptimize(batches.data());
+    }
+
+    const auto simulation = Simulate(sizes, batches);
+    state.counters["makespan_s"] = simulation.makespan;
+    state.counters["tail_s"] = simulation.tail;
+    state.counters["tasks"] = static_cast<double>(batches.size());
+    state.SetLabel(planned ? "largest-first" : "directory order");
+}
+BENCHMARK(BM_ScheduleSkewedTree)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+} // namespace
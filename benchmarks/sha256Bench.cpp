@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+#include "sha256Calc.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Scanner::Sha256Backend;
+using Scanner::SHA256Calculator;
+
+constexpr size_t STREAM_SIZE = 4 * 1024 * 1024;
+constexpr size_t MESSAGE_SIZE = 256 * 1024;
+
+const std::string& Payload() {
+    static const std::string payload = [] {
+        std::string data(STREAM_SIZE, '\0');
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<char>((i * 2654435761u) >> 13);
+        }
+        return data;
+    }();
+    return payload;
+}
+
+std::vector<std::string_view> Messages() {
+    std::vector<std::string_view> messages;
+    for (size_t i = 0; i < SHA256Calculator::LANES; ++i) {
+        messages.emplace_back(Payload().data() + i * MESSAGE_SIZE, MESSAGE_SIZE);
+    }
+    return messages;
+}
+
+// Every backend has to agree with OpenSSL before its numbers mean anything
+bool CheckAgainstOpenSSL(benchmark::State& state, Sha256Backend backend) {
+    if (!SHA256Calculator::IsSupported(backend)) {
+        state.SkipWithError("backend not supported on this CPU");
+        return false;
+    }
+    auto messages = Messages();
+    auto expected = SHA256Calculator::HashMany(messages, Sha256Backend::OpenSSL);
+    if (SHA256Calculator::HashMany(messages, backend) != expected) {
+        state.SkipWithError("digest mismatch against OpenSSL");
+        return false;
+    }
+    return true;
+}
+
+void BM_Sha256Stream(benchmark::State& state) {
+    auto backend = static_cast<Sha256Backend>(state.range(0));
+    state.SetLabel(SHA256Calculator::BackendName(backend));
+    if (backend == Sha256Backend::Avx2MultiBuffer) {
+        state.SkipWithError("multi-buffer backend has no single stream");
+        return;
+    }
+    if (!CheckAgainstOpenSSL(state, backend)) {
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(SHA256Calculator::Hash(Payload().data(), Payload().size(), backend));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(STREAM_SIZE));
+}
+
+// Eight independent messages per call, as the chunks of one tree digest
+void BM_Sha256Many(benchmark::State& state) {
+    auto backend = static_cast<Sha256Backend>(state.range(0));
+    state.SetLabel(SHA256Calculator::BackendName(backend));
+    if (!CheckAgainstOpenSSL(state, backend)) {
+        return;
+    }
+    auto messages = Messages();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(SHA256Calculator::HashMany(messages, backend));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(MESSAGE_SIZE * messages.size()));
+}
+
+} // namespace
+
+// Single-threaded, so bytes_per_second is the per-core rate
+BENCHMARK(BM_Sha256Stream)
+    ->Arg(static_cast<int>(Sha256Backend::OpenSSL))
+    ->Arg(static_cast<int>(Sha256Backend::ShaNi))
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Sha256Many)
+    ->Arg(static_cast<int>(Sha256Backend::OpenSSL))
+    ->Arg(static_cast<int>(Sha256Backend::ShaNi))
+    ->Arg(static_cast<int>(Sha256Backend::Avx2MultiBuffer))
+    ->Unit(benchmark::kMillisecond);
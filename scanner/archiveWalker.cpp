@@ -0,0 +1,626 @@
+#include "archiveWalker.h"
+#include "scannerConstants.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(SCANNER_HAVE_ZLIB)
+    #include <zlib.h>
+#endif
+
+namespace Scanner {
+
+namespace {
+
+constexpr size_t TAR_BLOCK_SIZE = 512;
+constexpr size_t MAX_MEMBER_NAME = 4096;
+constexpr uint64_t UNKNOWN_SIZE = std::numeric_limits<uint64_t>::max();
+// Small archives of very compressible text still unpack in full
+constexpr uint64_t MIN_EXPANSION_BASE = 1024 * 1024;
+
+constexpr uint32_t ZIP_LOCAL_HEADER = 0x04034b50;
+constexpr uint32_t ZIP_DATA_DESCRIPTOR = 0x08074b50;
+constexpr size_t ZIP_LOCAL_HEADER_SIZE = 30;
+constexpr uint16_t ZIP_FLAG_ENCRYPTED = 0x0001;
+constexpr uint16_t ZIP_FLAG_DESCRIPTOR = 0x0008;
+constexpr uint16_t ZIP_STORED = 0;
+constexpr uint16_t ZIP_DEFLATED = 8;
+constexpr uint16_t ZIP64_EXTRA = 0x0001;
+
+constexpr unsigned char GZIP_FEXTRA = 0x04;
+constexpr unsigned char GZIP_FNAME = 0x08;
+constexpr unsigned char GZIP_FCOMMENT = 0x10;
+constexpr unsigned char GZIP_FHCRC = 0x02;
+
+uint16_t Load16(const unsigned char* data) {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+uint32_t Load32(const unsigned char* data) {
+    return static_cast<uint32_t>(Load16(data)) | (static_cast<uint32_t>(Load16(data + 2)) << 16);
+}
+
+uint64_t Load64(const unsigned char* data) {
+    return static_cast<uint64_t>(Load32(data)) | (static_cast<uint64_t>(Load32(data + 4)) << 32);
+}
+
+// Octal, NUL/space padded; GNU base-256 when the high bit is set
+bool ParseTarNumber(const unsigned char* field, size_t size, uint64_t& value) {
+    value = 0;
+    if (field[0] & 0x80) {
+        for (size_t i = 1; i < size; ++i) {
+            if (value >> 56) {
+                return false;
+            }
+            value = (value << 8) | field[i];
+        }
+        return true;
+    }
+
+    size_t i = 0;
+    while (i < size && field[i] == ' ') {
+        ++i;
+    }
+    for (; i < size && field[i] >= '0' && field[i] <= '7'; ++i) {
+        if (value >> 61) {
+            return false;
+        }
+        value = (value << 3) | static_cast<uint64_t>(field[i] - '0');
+    }
+    return i == size || field[i] == '\0' || field[i] == ' ';
+}
+
+bool TarChecksumValid(const unsigned char* header) {
+    uint64_t stored = 0;
+    if (!ParseTarNumber(header + 148, 8, stored)) {
+        return false;
+    }
+    uint64_t sum = 0;
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; ++i) {
+        sum += (i >= 148 && i < 156) ? ' ' : header[i];
+    }
+    return sum == stored;
+}
+
+std::string FieldString(const unsigned char* field, size_t size) {
+    const auto* end = static_cast<const unsigned char*>(std::memchr(field, '\0', size));
+    return std::string(reinterpret_cast<const char*>(field), end ? static_cast<size_t>(end - field) : size);
+}
+
+// "length key=value\n" records of a pax extended header
+std::string PaxPath(const std::string& records) {
+    size_t position = 0;
+    while (position < records.size()) {
+        const size_t space = records.find(' ', position);
+        if (space == std::string::npos) {
+            break;
+        }
+        size_t length = 0;
+        for (size_t i = position; i < space; ++i) {
+            if (records[i] < '0' || records[i] > '9') {
+                return {};
+            }
+            length = length * 10 + static_cast<size_t>(records[i] - '0');
+        }
+        if (length <= space - position || position + length > records.size()) {
+            break;
+        }
+        const std::string record = records.substr(space + 1, position + length - space - 2);
+        if (record.compare(0, 5, "path=") == 0) {
+            return record.substr(5);
+        }
+        position += length;
+    }
+    return {};
+}
+
+} // namespace
+
+size_t StreamSource::Read(unsigned char* data, size_t size) {
+    stream_.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+    return static_cast<size_t>(stream_.gcount());
+}
+
+// Buffered window over a source, so headers can be parsed in place and a
+// decompressor can hand back the input it did not use
+class ArchiveWalker::Reader {
+public:
+    Reader(ByteSource& source, std::vector<unsigned char>& buffer) : source_(source), buffer_(buffer) {}
+
+    const unsigned char* Data() const { return buffer_.data() + begin_; }
+    size_t Available() const { return end_ - begin_; }
+    void Consume(size_t count) { begin_ += count; }
+
+    // Buffers at least count bytes (at most the buffer size); false if the stream ends first
+    bool Fill(size_t count) {
+        count = std::min(count, buffer_.size());
+        if (Available() >= count) {
+            return true;
+        }
+        if (begin_ != 0) {
+            std::memmove(buffer_.data(), Data(), Available());
+            end_ -= begin_;
+            begin_ = 0;
+        }
+        while (end_ < count) {
+            const size_t read = source_.Read(buffer_.data() + end_, buffer_.size() - end_);
+            if (read == 0) {
+                return false;
+            }
+            end_ += read;
+        }
+        return true;
+    }
+
+    bool Skip(uint64_t count) {
+        while (count != 0) {
+            if (Available() == 0 && !Fill(1)) {
+                return false;
+            }
+            const size_t step = static_cast<size_t>(std::min<uint64_t>(count, Available()));
+            Consume(step);
+            count -= step;
+        }
+        return true;
+    }
+
+private:
+    ByteSource& source_;
+    std::vector<unsigned char>& buffer_;
+    size_t begin_ = 0;
+    size_t end_ = 0;
+};
+
+// One member's bytes, read straight out of its container
+class ArchiveWalker::MemberSource : public ByteSource {
+public:
+    bool Failed() const { return failed_; }
+
+protected:
+    bool failed_ = false;
+};
+
+// Stored data: the next size bytes of the container
+class ArchiveWalker::StoredSource : public MemberSource {
+public:
+    StoredSource(Reader& reader, uint64_t size) : reader_(reader), remaining_(size) {}
+
+    size_t Read(unsigned char* data, size_t size) override {
+        if (remaining_ == 0 || failed_) {
+            return 0;
+        }
+        if (reader_.Available() == 0 && !reader_.Fill(1)) {
+            failed_ = true;  // Container ends inside the member
+            return 0;
+        }
+        const size_t count = static_cast<size_t>(std::min<uint64_t>({remaining_, reader_.Available(), size}));
+        std::memcpy(data, reader_.Data(), count);
+        reader_.Consume(count);
+        remaining_ -= count;
+        return count;
+    }
+
+private:
+    Reader& reader_;
+    uint64_t remaining_;
+};
+
+#if defined(SCANNER_HAVE_ZLIB)
+// Raw deflate; reads no further than compressedSize (UNKNOWN_SIZE when the
+// stream's own end marker is all there is) and leaves the rest in the reader.
+// Inflated bytes count against the walk's expansion budget; running out
+// ends the stream early and stops the walk.
+class ArchiveWalker::InflateSource : public MemberSource {
+public:
+    InflateSource(ArchiveWalker& walker, Reader& reader, uint64_t compressedSize)
+        : walker_(walker), reader_(reader), remainingInput_(compressedSize) {
+        initialized_ = inflateInit2(&stream_, -MAX_WBITS) == Z_OK;
+        if (!initialized_) {
+            Fail();
+        }
+    }
+
+    ~InflateSource() override {
+        if (initialized_) {
+            inflateEnd(&stream_);
+        }
+    }
+
+    size_t Read(unsigned char* data, size_t size) override {
+        if (done_ || size == 0) {
+            return 0;
+        }
+
+        // One byte past the budget tells a stream that fits from one that does not
+        const uint64_t budget = walker_.inflateBudget_;
+        size = static_cast<size_t>(std::min<uint64_t>(size, budget == UNKNOWN_SIZE ? budget : budget + 1));
+        stream_.next_out = data;
+        stream_.avail_out = static_cast<uInt>(std::min<size_t>(size, std::numeric_limits<uInt>::max()));
+        const uInt requested = stream_.avail_out;
+
+        while (stream_.avail_out == requested) {
+            if (reader_.Available() == 0 && remainingInput_ != 0 && !reader_.Fill(1)) {
+                Fail();
+                break;
+            }
+            const size_t available = static_cast<size_t>(std::min<uint64_t>(reader_.Available(), remainingInput_));
+            stream_.next_in = const_cast<unsigned char*>(reader_.Data());
+            stream_.avail_in = static_cast<uInt>(std::min<size_t>(available, std::numeric_limits<uInt>::max()));
+            const uInt offered = stream_.avail_in;
+
+            const int result = inflate(&stream_, Z_NO_FLUSH);
+            const size_t consumed = offered - stream_.avail_in;
+            reader_.Consume(consumed);
+            if (remainingInput_ != UNKNOWN_SIZE) {
+                remainingInput_ -= consumed;
+            }
+
+            if (result == Z_STREAM_END) {
+                done_ = true;
+                break;
+            }
+            if ((result != Z_OK && result != Z_BUF_ERROR) || (offered == 0 && remainingInput_ == 0)) {
+                Fail();
+                break;
+            }
+        }
+
+        const size_t produced = requested - stream_.avail_out;
+        if (produced > walker_.inflateBudget_) {
+            walker_.limitHit_ = true;
+            walker_.stopped_ = true;
+            walker_.inflateBudget_ = 0;
+            done_ = true;
+            return 0;
+        }
+        walker_.inflateBudget_ -= produced;
+        return produced;
+    }
+
+    // Compressed bytes of a sized member that the deflate stream did not use
+    uint64_t UnusedInput() const { return remainingInput_ == UNKNOWN_SIZE ? 0 : remainingInput_; }
+
+private:
+    void Fail() {
+        failed_ = true;
+        done_ = true;
+    }
+
+    ArchiveWalker& walker_;
+    Reader& reader_;
+    z_stream stream_ = {};
+    uint64_t remainingInput_;
+    bool initialized_ = false;
+    bool done_ = false;
+};
+#endif
+
+namespace {
+
+// Forwards everything read through it to the member's sink
+class TeeSource : public ByteSource {
+public:
+    TeeSource(ByteSource& source, MemberSink* sink) : source_(source), sink_(sink) {}
+
+    size_t Read(unsigned char* data, size_t size) override {
+        const size_t count = source_.Read(data, size);
+        if (count != 0 && sink_ != nullptr) {
+            sink_->Update(data, count);
+        }
+        return count;
+    }
+
+private:
+    ByteSource& source_;
+    MemberSink* sink_;
+};
+
+} // namespace
+
+ArchiveWalker::ArchiveWalker(const Limits& limits, SinkFactory factory)
+    : limits_(limits), factory_(std::move(factory)) {}
+
+ArchiveWalker::~ArchiveWalker() = default;
+
+ArchiveWalker::Format ArchiveWalker::DetectFormat(const unsigned char* data, size_t size) {
+    if (size >= 4 && Load32(data) == ZIP_LOCAL_HEADER) {
+        return Format::Zip;
+    }
+    if (size >= 3 && data[0] == 0x1f && data[1] == 0x8b && data[2] == 8) {
+        return Format::Gzip;
+    }
+    if (size >= TAR_BLOCK_SIZE && std::memcmp(data + 257, "ustar", 5) == 0 && TarChecksumValid(data)) {
+        return Format::Tar;
+    }
+    return Format::None;
+}
+
+bool ArchiveWalker::HasDeflate() {
+#if defined(SCANNER_HAVE_ZLIB)
+    return true;
+#else
+    return false;
+#endif
+}
+
+ArchiveWalker::Status ArchiveWalker::Walk(ByteSource& source, uint64_t inputSize) {
+    members_ = 0;
+    limitHit_ = false;
+    stopped_ = false;
+    const uint64_t base = std::max(inputSize, MIN_EXPANSION_BASE);
+    inflateBudget_ = base > UNKNOWN_SIZE / limits_.maxExpansionRatio ? UNKNOWN_SIZE
+                                                                      : base * limits_.maxExpansionRatio;
+
+    const Status status = WalkLayer(source, std::string(), 0);
+    return status == Status::Complete && limitHit_ ? Status::LimitReached : status;
+}
+
+std::vector<unsigned char>& ArchiveWalker::BufferAt(size_t depth) {
+    while (buffers_.size() <= depth) {
+        buffers_.push_back(std::make_unique<std::vector<unsigned char>>(Constants::HASH_BUFFER_SIZE));
+    }
+    return *buffers_[depth];
+}
+
+ArchiveWalker::Status ArchiveWalker::WalkLayer(ByteSource& source, const std::string& prefix, size_t depth) {
+    Reader reader(source, BufferAt(depth));
+    reader.Fill(TAR_BLOCK_SIZE);
+
+    const Format format = DetectFormat(reader.Data(), reader.Available());
+    if (format == Format::None || (format == Format::Gzip && !HasDeflate())) {
+        return Status::NotArchive;
+    }
+    if (depth >= limits_.maxDepth) {
+        limitHit_ = true;
+        return Status::LimitReached;
+    }
+
+    switch (format) {
+        case Format::Zip: return WalkZip(reader, prefix, depth);
+        case Format::Tar: return WalkTar(reader, prefix, depth);
+        case Format::Gzip: return WalkGzip(reader, prefix, depth);
+        case Format::None: break;
+    }
+    return Status::NotArchive;
+}
+
+ArchiveWalker::Status ArchiveWalker::VisitMember(MemberSource& data, const std::string& path,
+                                                 std::optional<uint64_t> size, size_t depth) {
+    if (members_ >= limits_.maxMembers) {
+        limitHit_ = true;
+        stopped_ = true;
+        return Status::LimitReached;
+    }
+    ++members_;
+
+    auto sink = factory_ ? factory_(path, size) : nullptr;
+    TeeSource tee(data, sink.get());
+    // A nested archive that is corrupt or too deep is still hashed as a member
+    WalkLayer(tee, path + "!", depth + 1);
+
+    // Whatever the nested walk did not read still belongs to this member
+    auto& scratch = BufferAt(depth + 1);
+    while (!stopped_ && tee.Read(scratch.data(), scratch.size()) != 0) {
+    }
+
+    if (stopped_) {
+        return Status::LimitReached;  // The member may be incomplete
+    }
+    if (data.Failed()) {
+        return Status::Corrupt;
+    }
+    if (sink) {
+        sink->Final();
+    }
+    return Status::Complete;
+}
+
+// Follows local headers front to back, so it works on a stream and needs no
+// central directory; members flagged with a data descriptor are supported
+// when deflated, since the deflate stream marks its own end.
+ArchiveWalker::Status ArchiveWalker::WalkZip(Reader& reader, const std::string& prefix, size_t depth) {
+    for (;;) {
+        if (!reader.Fill(4) || Load32(reader.Data()) != ZIP_LOCAL_HEADER) {
+            return Status::Complete;  // Central directory, or the end
+        }
+        if (!reader.Fill(ZIP_LOCAL_HEADER_SIZE)) {
+            return Status::Corrupt;
+        }
+
+        const unsigned char* header = reader.Data();
+        const uint16_t flags = Load16(header + 6);
+        const uint16_t method = Load16(header + 8);
+        uint64_t compressedSize = Load32(header + 18);
+        uint64_t size = Load32(header + 22);
+        const size_t nameLength = Load16(header + 26);
+        const size_t extraLength = Load16(header + 28);
+        reader.Consume(ZIP_LOCAL_HEADER_SIZE);
+
+        if (!reader.Fill(nameLength)) {
+            return Status::Corrupt;
+        }
+        const std::string name(reinterpret_cast<const char*>(reader.Data()), nameLength);
+        reader.Consume(nameLength);
+
+        if (!reader.Fill(extraLength)) {
+            return Status::Corrupt;
+        }
+        bool zip64 = false;
+        for (size_t offset = 0; offset + 4 <= extraLength;) {
+            const uint16_t id = Load16(reader.Data() + offset);
+            const size_t length = Load16(reader.Data() + offset + 2);
+            if (id == ZIP64_EXTRA && length >= 16 && offset + 4 + length <= extraLength) {
+                size = Load64(reader.Data() + offset + 4);
+                compressedSize = Load64(reader.Data() + offset + 12);
+                zip64 = true;
+            }
+            offset += 4 + length;
+        }
+        reader.Consume(extraLength);
+
+        const bool descriptor = (flags & ZIP_FLAG_DESCRIPTOR) != 0;
+        const bool readable = (flags & ZIP_FLAG_ENCRYPTED) == 0 &&
+                              (method == ZIP_STORED || (method == ZIP_DEFLATED && HasDeflate()));
+        if (!readable || (descriptor && method == ZIP_STORED)) {
+            // Without a size the next header cannot be found
+            if (descriptor || !reader.Skip(compressedSize)) {
+                return Status::Corrupt;
+            }
+            continue;
+        }
+
+        const std::optional<uint64_t> knownSize = descriptor ? std::nullopt : std::optional<uint64_t>(size);
+        const bool directory = !name.empty() && name.back() == '/';
+        Status status = Status::Complete;
+        if (method == ZIP_STORED) {
+            StoredSource source(reader, compressedSize);
+            status = directory && compressedSize == 0 ? Status::Complete
+                                                      : VisitMember(source, prefix + name, knownSize, depth);
+        } else {
+#if defined(SCANNER_HAVE_ZLIB)
+            InflateSource source(*this, reader, descriptor ? UNKNOWN_SIZE : compressedSize);
+            status = VisitMember(source, prefix + name, knownSize, depth);
+            if (status == Status::Complete && !reader.Skip(source.UnusedInput())) {
+                return Status::Corrupt;
+            }
+#endif
+        }
+        if (status != Status::Complete) {
+            return status;
+        }
+
+        if (descriptor) {
+            if (reader.Fill(4) && Load32(reader.Data()) == ZIP_DATA_DESCRIPTOR) {
+                reader.Consume(4);
+            }
+            if (!reader.Skip(zip64 ? 20 : 12)) {
+                return Status::Corrupt;
+            }
+        }
+    }
+}
+
+ArchiveWalker::Status ArchiveWalker::WalkTar(Reader& reader, const std::string& prefix, size_t depth) {
+    std::string longName;  // From a GNU 'L' or pax 'x' entry, applies to the next member
+
+    // Reads a small metadata entry body, dropping anything past MAX_MEMBER_NAME
+    auto readText = [&reader](uint64_t size, std::string& text) {
+        text.clear();
+        StoredSource source(reader, size);
+        unsigned char chunk[256];
+        size_t count;
+        while ((count = source.Read(chunk, sizeof(chunk))) != 0) {
+            if (text.size() < MAX_MEMBER_NAME) {
+                text.append(reinterpret_cast<const char*>(chunk), count);
+            }
+        }
+        return !source.Failed();
+    };
+
+    for (;;) {
+        if (!reader.Fill(TAR_BLOCK_SIZE)) {
+            return reader.Available() == 0 ? Status::Complete : Status::Corrupt;
+        }
+        const unsigned char* header = reader.Data();
+        if (std::all_of(header, header + TAR_BLOCK_SIZE, [](unsigned char c) { return c == 0; })) {
+            return Status::Complete;  // End-of-archive marker
+        }
+
+        uint64_t size = 0;
+        if (!TarChecksumValid(header) || !ParseTarNumber(header + 124, 12, size)) {
+            return Status::Corrupt;
+        }
+        const char type = static_cast<char>(header[156]);
+        std::string name = FieldString(header, 100);
+        if (std::memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0') {
+            name = FieldString(header + 345, 155) + "/" + name;
+        }
+        reader.Consume(TAR_BLOCK_SIZE);
+        const uint64_t padding = (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+
+        Status status = Status::Complete;
+        if (type == 'L' || type == 'x') {
+            std::string text;
+            if (!readText(size, text)) {
+                return Status::Corrupt;
+            }
+            longName = type == 'L' ? FieldString(reinterpret_cast<const unsigned char*>(text.data()), text.size())
+                                   : PaxPath(text);
+        } else if (type == '0' || type == '\0' || type == '7') {
+            StoredSource source(reader, size);
+            status = VisitMember(source, prefix + (longName.empty() ? name : longName), size, depth);
+            longName.clear();
+        } else {
+            // Directories, links, devices and global headers carry no file data
+            if (!reader.Skip(size)) {
+                return Status::Corrupt;
+            }
+            longName.clear();
+        }
+
+        if (status != Status::Complete) {
+            return status;
+        }
+        if (!reader.Skip(padding)) {
+            return Status::Corrupt;
+        }
+    }
+}
+
+ArchiveWalker::Status ArchiveWalker::WalkGzip(Reader& reader, const std::string& prefix, size_t depth) {
+#if defined(SCANNER_HAVE_ZLIB)
+    if (!reader.Fill(10)) {
+        return Status::Corrupt;
+    }
+    const unsigned char flags = reader.Data()[3];
+    reader.Consume(10);
+
+    if (flags & GZIP_FEXTRA) {
+        if (!reader.Fill(2)) {
+            return Status::Corrupt;
+        }
+        const size_t length = Load16(reader.Data());
+        reader.Consume(2);
+        if (!reader.Skip(length)) {
+            return Status::Corrupt;
+        }
+    }
+
+    // Zero-terminated fields; the name is kept, the comment dropped
+    auto readString = [&reader](std::string* text) {
+        for (;;) {
+            if (reader.Available() == 0 && !reader.Fill(1)) {
+                return false;
+            }
+            const unsigned char c = *reader.Data();
+            reader.Consume(1);
+            if (c == '\0') {
+                return true;
+            }
+            if (text != nullptr && text->size() < MAX_MEMBER_NAME) {
+                *text += static_cast<char>(c);
+            }
+        }
+    };
+    std::string name;
+    if (((flags & GZIP_FNAME) && !readString(&name)) || ((flags & GZIP_FCOMMENT) && !readString(nullptr)) ||
+        ((flags & GZIP_FHCRC) && !reader.Skip(2))) {
+        return Status::Corrupt;
+    }
+    if (name.empty()) {
+        name = "data";
+    }
+
+    // Only the first gzip member is read; concatenated members are rare
+    InflateSource source(*this, reader, UNKNOWN_SIZE);
+    return VisitMember(source, prefix + name, std::nullopt, depth);
+#else
+    (void)reader;
+    (void)prefix;
+    (void)depth;
+    return Status::NotArchive;
+#endif
+}
+
+} // namespace Scanner
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Scanner {
+
+// Sequential byte stream; Read() returns 0 at the end
+class ByteSource {
+public:
+    virtual ~ByteSource() = default;
+    virtual size_t Read(unsigned char* data, size_t size) = 0;
+};
+
+// Receives one member's bytes in order
+class MemberSink {
+public:
+    virtual ~MemberSink() = default;
+    virtual void Update(const unsigned char* data, size_t size) = 0;
+    // Not called for members cut short by a limit or a corrupt stream
+    virtual void Final() = 0;
+};
+
+// Walks zip, tar and gzip containers as a stream: members are decompressed
+// chunk by chunk into buffers reused across members and handed to a sink,
+// nothing is extracted to disk. A member that is itself an archive is walked
+// while it streams to its own sink, so nested members cost no extra pass.
+// Deflate (zip method 8, gzip) needs zlib; without it only tar and stored zip
+// members are read.
+class ArchiveWalker {
+public:
+    enum class Format { None, Zip, Tar, Gzip };
+
+    enum class Status {
+        NotArchive,
+        Complete,
+        LimitReached,  // Some members were skipped or cut short
+        Corrupt,       // Walking stopped at malformed data or data it cannot follow
+    };
+
+    struct Limits {
+        size_t maxDepth;           // Container layers opened; a tar.gz takes two
+        size_t maxMembers;         // Over the whole walk, nested members included
+        uint64_t maxExpansionRatio;  // Inflated bytes per byte of the outer file
+    };
+
+    // memberPath joins the names of every layer with '!'. size is the member's
+    // length when the container records it. May return nullptr to skip hashing;
+    // a skipped member is still walked if it is an archive.
+    using SinkFactory = std::function<std::unique_ptr<MemberSink>(const std::string& memberPath,
+                                                                  std::optional<uint64_t> size)>;
+
+    ArchiveWalker(const Limits& limits, SinkFactory factory);
+    ~ArchiveWalker();
+
+    // From the first bytes of a stream; tar needs 512 of them
+    static Format DetectFormat(const unsigned char* data, size_t size);
+    static bool HasDeflate();
+
+    // inputSize is the length of the outer file, the base of the expansion limit
+    Status Walk(ByteSource& source, uint64_t inputSize);
+    size_t MembersVisited() const { return members_; }
+
+private:
+    class Reader;
+    class MemberSource;
+    class StoredSource;
+    class InflateSource;
+
+    Status WalkLayer(ByteSource& source, const std::string& prefix, size_t depth);
+    Status WalkZip(Reader& reader, const std::string& prefix, size_t depth);
+    Status WalkTar(Reader& reader, const std::string& prefix, size_t depth);
+    Status WalkGzip(Reader& reader, const std::string& prefix, size_t depth);
+    Status VisitMember(MemberSource& data, const std::string& path, std::optional<uint64_t> size, size_t depth);
+    std::vector<unsigned char>& BufferAt(size_t depth);
+
+    Limits limits_;
+    SinkFactory factory_;
+    size_t members_ = 0;
+    uint64_t inflateBudget_ = 0;
+    bool limitHit_ = false;  // Any limit, including a nested archive left unopened
+    bool stopped_ = false;   // Member count or expansion limit; nothing more is read
+    // Read buffers per nesting level, kept across members and walks
+    std::vector<std::unique_ptr<std::vector<unsigned char>>> buffers_;
+};
+
+// ByteSource over a std::istream, e.g. a std::ifstream opened in binary mode
+class StreamSource : public ByteSource {
+public:
+    explicit StreamSource(std::istream& stream) : stream_(stream) {}
+    size_t Read(unsigned char* data, size_t size) override;
+
+private:
+    std::istream& stream_;
+};
+
+} // namespace Scanner
@@ -0,0 +1,233 @@
+#include "asyncHasher.h"
+#include "scannerConstants.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Scanner {
+
+namespace {
+
+enum Request : uint64_t { OPEN = 0, READ = 1, CLOSE = 2 };
+
+uint64_t Tag(size_t slot, Request request) {
+    return (static_cast<uint64_t>(slot) << 2) | request;
+}
+
+} // namespace
+
+std::unique_ptr<AsyncHasher> AsyncHasher::Create(size_t depth) {
+    auto hasher = std::unique_ptr<AsyncHasher>(new AsyncHasher(depth));
+    // Each slot has one request out, and a finished file's close may be
+    // queued next to its successor's open
+    hasher->ring_ = IoRing::Create(static_cast<unsigned>(2 * depth));
+    if (!hasher->ring_) {
+        return nullptr;
+    }
+    return hasher;
+}
+
+void AsyncHasher::Run(std::vector<File>& files, HashAlgorithmMask algorithms, ReadThrottle throttle) {
+    free_.clear();
+    for (size_t i = slots_.size(); i > 0; --i) {
+        free_.push_back(i - 1);
+    }
+
+    auto submit = [this](bool prepared) {
+        if (!prepared) {
+            throw std::runtime_error("io_uring submission queue is full");
+        }
+        ++inFlight_;
+    };
+
+    size_t next = 0;
+    try {
+        while (true) {
+            while (!free_.empty() && next < files.size()) {
+                const size_t index = free_.back();
+                free_.pop_back();
+                slots_[index].file = next;
+                submit(ring_->PrepareOpen(files[next].path->c_str(), O_RDONLY | O_CLOEXEC, Tag(index, OPEN)));
+                ++next;
+            }
+            if (inFlight_ == 0) {
+                break;
+            }
+
+            ring_->SubmitAndWait();
+            IoRing::Completion completion;
+            while (ring_->Next(completion)) {
+                --inFlight_;
+                const size_t index = static_cast<size_t>(completion.tag >> 2);
+                switch (static_cast<Request>(completion.tag & 3)) {
+                    case OPEN: OnOpen(index, completion.result, files, algorithms, throttle); break;
+                    case READ: OnRead(index, completion.result, files, throttle); break;
+                    case CLOSE: break;
+                }
+            }
+        }
+    } catch (...) {
+        Drain();
+        throw;
+    }
+}
+
+void AsyncHasher::Drain() {
+    try {
+        while (inFlight_ != 0) {
+            ring_->SubmitAndWait();
+            IoRing::Completion completion;
+            while (ring_->Next(completion)) {
+                --inFlight_;
+                // An open that nobody will handle still installed a descriptor
+                if (static_cast<Request>(completion.tag & 3) == OPEN && completion.result >= 0) {
+                    close(completion.result);
+                }
+            }
+        }
+    } catch (...) {
+        // The kernel may still write into the buffers of requests left out,
+        // so they are leaked rather than handed back to the pool
+        for (auto& slot : slots_) {
+            if (slot.buffer) {
+                new BufferPool::Lease(std::move(*slot.buffer));
+                slot.buffer.reset();
+            }
+        }
+    }
+    for (auto& slot : slots_) {
+        if (slot.fd >= 0) {
+            close(slot.fd);
+            slot.fd = -1;
+        }
+        slot.buffer.reset();
+    }
+    ring_.reset();
+}
+
+void AsyncHasher::OnOpen(size_t index, int result, std::vector<File>& files, HashAlgorithmMask algorithms,
+                         ReadThrottle throttle) {
+    Slot& slot = slots_[index];
+    File& file = files[slot.file];
+    if (result < 0) {
+        file.error = -result;
+        Finish(index);
+        return;
+    }
+
+    slot.fd = result;
+    if (file.openOnly) {
+        Finish(index);
+        return;
+    }
+    slot.offset = 0;
+    slot.head = file.limit != 0 ? static_cast<size_t>(file.limit)
+                                : file.prefixFilter ? Constants::PREFIX_HASH_SIZE : 0;
+    slot.buffer.emplace(BufferPool::Acquire(std::max<uint64_t>(slot.head, BufferPool::ReadSizeFor(file.size))));
+    if (file.limit == 0) {
+        // The collected size may be stale, so ssdeep gets no size hint
+        if (!slot.hasher || slot.hasher->Algorithms() != algorithms) {
+            slot.hasher = std::make_unique<MultiHasher>(algorithms);
+        } else {
+            slot.hasher->Reset();
+        }
+    }
+    Read(index, throttle);
+}
+
+void AsyncHasher::Read(size_t index, ReadThrottle throttle) {
+    Slot& slot = slots_[index];
+    // The head is gathered at the start of the buffer, then the rest streams through it
+    unsigned char* target = slot.buffer->Data();
+    slot.requested = slot.buffer->Size();
+    if (slot.offset < slot.head) {
+        target += slot.offset;
+        slot.requested = slot.head - static_cast<size_t>(slot.offset);
+    }
+    if (throttle.concurrency != nullptr) {
+        slot.started = std::chrono::steady_clock::now();
+    }
+    if (!ring_->PrepareRead(slot.fd, target, static_cast<unsigned>(slot.requested), slot.offset, Tag(index, READ))) {
+        throw std::runtime_error("io_uring submission queue is full");
+    }
+    ++inFlight_;
+}
+
+void AsyncHasher::OnRead(size_t index, int result, std::vector<File>& files, ReadThrottle throttle) {
+    Slot& slot = slots_[index];
+    File& file = files[slot.file];
+    if (throttle.concurrency != nullptr) {
+        throttle.concurrency->RecordLatency(std::chrono::steady_clock::now() - slot.started);
+    }
+    if (result < 0) {
+        file.error = -result;
+        Finish(index);
+        return;
+    }
+
+    const size_t count = static_cast<size_t>(result);
+    if (throttle.bytes != nullptr && count != 0) {
+        throttle.bytes->Acquire(count);
+    }
+    const bool inHead = slot.offset < slot.head;
+    slot.offset += count;
+    // A short read past the collected size is the end; a read of nothing always is
+    const bool end = count == 0 || (count < slot.requested && slot.offset >= file.size);
+
+    if (inHead) {
+        if (slot.offset < slot.head && !end) {
+            Read(index, throttle);
+            return;
+        }
+        const size_t gathered = static_cast<size_t>(slot.offset);
+        if (file.observer) {
+            file.observer(slot.buffer->Data(), gathered);
+        }
+        if (file.limit != 0) {
+            Finish(index);
+            return;
+        }
+        if (file.prefixFilter) {
+            unsigned char prefixMd5[DigestSize(HashAlgorithm::MD5)];
+            FileHasher::PrefixDigest(slot.buffer->Data(), gathered, prefixMd5);
+            if (!file.prefixFilter(prefixMd5)) {
+                Finish(index);
+                return;
+            }
+        }
+        slot.hasher->Update(slot.buffer->Data(), gathered);
+    } else if (count != 0) {
+        slot.hasher->Update(slot.buffer->Data(), count);
+        if (file.observer) {
+            file.observer(slot.buffer->Data(), count);
+        }
+    }
+
+    if (end) {
+        file.digests = slot.hasher->Final();
+        Finish(index);
+    } else {
+        Read(index, throttle);
+    }
+}
+
+void AsyncHasher::Finish(size_t index) {
+    Slot& slot = slots_[index];
+    if (slot.fd >= 0) {
+        if (!ring_->PrepareClose(slot.fd, Tag(index, CLOSE))) {
+            close(slot.fd);
+        } else {
+            ++inFlight_;
+        }
+        slot.fd = -1;
+    }
+    slot.buffer.reset();
+    free_.push_back(index);
+}
+
+} // namespace Scanner
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "fileHasher.h"
+#include "fileReader.h"
+#include "ioRing.h"
+#include "throttle.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace Scanner {
+
+// Hashes a group of files on one thread with up to depth of them in flight.
+// Opens, reads and closes go through an IoRing, and a file's hashing resumes
+// when its read completes: each file is a small state machine rather than a
+// thread blocked in read(), so one worker waits on all of its files at once.
+// That pays off where every read waits long (network mounts, busy disks).
+// Reads use the page cache (CacheMode::Normal).
+class AsyncHasher {
+public:
+    struct File {
+        const std::filesystem::path* path = nullptr;
+        uint64_t size = 0;   // As collected; a file that has grown is still read to its end
+        uint64_t limit = 0;  // Only read this many leading bytes, hashing nothing; 0 = whole file
+        bool openOnly = false;  // Only opened and closed again, to report whether it can be read
+        FileHasher::PrefixFilter prefixFilter;
+        // Sees every buffer in order; the prefix before prefixFilter judges it
+        FileHasher::BufferObserver observer;
+
+        std::optional<FileDigests> digests;  // Unset when limited, rejected by the filter or failed
+        int error = 0;                       // errno of a failed open or read
+    };
+
+    // Nothing when io_uring cannot be used here
+    static std::unique_ptr<AsyncHasher> Create(size_t depth);
+
+    // Returns once every file is done; throws when the ring fails, and the
+    // hasher must not be used again then
+    void Run(std::vector<File>& files, HashAlgorithmMask algorithms, ReadThrottle throttle);
+
+private:
+    struct Slot {
+        size_t file = 0;
+        int fd = -1;
+        uint64_t offset = 0;
+        size_t head = 0;  // Leading bytes gathered before hashing starts (prefix or limit)
+        size_t requested = 0;
+        std::optional<BufferPool::Lease> buffer;
+        std::unique_ptr<MultiHasher> hasher;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    explicit AsyncHasher(size_t depth) : slots_(depth) {}
+
+    void Read(size_t index, ReadThrottle throttle);
+    // After a failure: waits for every request still in the kernel, then
+    // closes the descriptors and releases the buffers and the ring
+    void Drain();
+    // Hands the descriptor to the ring to close and frees the slot
+    void Finish(size_t index);
+    void OnOpen(size_t index, int result, std::vector<File>& files, HashAlgorithmMask algorithms,
+                ReadThrottle throttle);
+    void OnRead(size_t index, int result, std::vector<File>& files, ReadThrottle throttle);
+
+    // Destroyed after the ring, which may still write into their buffers
+    std::vector<Slot> slots_;
+    std::vector<size_t> free_;
+    size_t inFlight_ = 0;  // Requests submitted or prepared and not completed
+    std::unique_ptr<IoRing> ring_;
+};
+
+} // namespace Scanner
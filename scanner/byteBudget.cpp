@@ -0,0 +1,66 @@
+#include "byteBudget.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace Scanner {
+
+ByteBudget::Reservation::Reservation(Reservation&& other) noexcept
+    : budget_(std::exchange(other.budget_, nullptr)), bytes_(other.bytes_) {}
+
+ByteBudget::Reservation& ByteBudget::Reservation::operator=(Reservation&& other) noexcept {
+    if (this != &other) {
+        if (budget_ != nullptr) {
+            budget_->Release(bytes_);
+        }
+        budget_ = std::exchange(other.budget_, nullptr);
+        bytes_ = other.bytes_;
+    }
+    return *this;
+}
+
+ByteBudget::Reservation::~Reservation() {
+    if (budget_ != nullptr) {
+        budget_->Release(bytes_);
+    }
+}
+
+ByteBudget::ByteBudget(uint64_t capacity) : capacity_(capacity) {
+    if (capacity == 0) {
+        throw std::invalid_argument("ByteBudget capacity must be positive");
+    }
+}
+
+ByteBudget::Reservation ByteBudget::TryReserve(uint64_t bytes) {
+    bytes = std::min(bytes, capacity_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity_ - inUse_ < bytes) {
+        return Reservation();
+    }
+    inUse_ += bytes;
+    return Reservation(this, bytes);
+}
+
+ByteBudget::Reservation ByteBudget::Reserve(uint64_t bytes) {
+    bytes = std::min(bytes, capacity_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    released_.wait(lock, [&] { return capacity_ - inUse_ >= bytes; });
+    inUse_ += bytes;
+    return Reservation(this, bytes);
+}
+
+uint64_t ByteBudget::InUse() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inUse_;
+}
+
+void ByteBudget::Release(uint64_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inUse_ -= bytes;
+    }
+    released_.notify_all();
+}
+
+} // namespace Scanner
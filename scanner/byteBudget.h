@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace Scanner {
+
+// Bytes of file data being hashed at once, shared by all workers. A file
+// reserves its size, capped at the capacity so that any file fits alone.
+class ByteBudget {
+public:
+    class Reservation {
+    public:
+        Reservation() = default;
+        Reservation(Reservation&& other) noexcept;
+        Reservation& operator=(Reservation&& other) noexcept;
+        ~Reservation();
+
+        explicit operator bool() const { return budget_ != nullptr; }
+
+    private:
+        friend class ByteBudget;
+        Reservation(ByteBudget* budget, uint64_t bytes) : budget_(budget), bytes_(bytes) {}
+
+        ByteBudget* budget_ = nullptr;
+        uint64_t bytes_ = 0;
+    };
+
+    explicit ByteBudget(uint64_t capacity);
+
+    // Empty reservation when the bytes are not free right now
+    Reservation TryReserve(uint64_t bytes);
+    // Waits until the bytes are free
+    Reservation Reserve(uint64_t bytes);
+
+    uint64_t Capacity() const { return capacity_; }
+    uint64_t InUse() const;
+
+private:
+    void Release(uint64_t bytes);
+
+    const uint64_t capacity_;
+    uint64_t inUse_ = 0;
+    mutable std::mutex mutex_;
+    std::condition_variable released_;
+};
+
+} // namespace Scanner
@@ -0,0 +1,186 @@
+#include "checkpoint.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace Scanner {
+
+namespace {
+
+constexpr char HEADER[] = "virus_scanner checkpoint 1";
+
+template <typename T>
+bool ParseNumber(const std::string& text, T& value, int base = 10) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+} // namespace
+
+uint64_t Checkpoint::FileKey(const std::filesystem::path& path, uint64_t size) {
+    char bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<char>(size >> (i * 8));
+    }
+    return Utils::Fnv1a(std::string_view(bytes, sizeof(bytes)), Utils::Fnv1a(path.string()));
+}
+
+std::string Checkpoint::Fingerprint(const std::string& databasePath) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(databasePath, ec);
+    const auto modified = std::filesystem::last_write_time(databasePath, ec);
+    return std::to_string(size) + ":" + std::to_string(modified.time_since_epoch().count());
+}
+
+std::optional<Checkpoint::State> Checkpoint::Load(const std::string& path, const std::string& root,
+                                                  const std::string& fingerprint) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+
+    std::string line;
+    if (!std::getline(file, line) || line != HEADER) {
+        throw std::runtime_error("Not a scan checkpoint: " + path);
+    }
+
+    State state;
+    State unit;
+    while (std::getline(file, line)) {
+        const auto fields = Utils::SplitFields(line);
+        const std::string& kind = fields[0];
+        if (kind == "root" && fields.size() == 2) {
+            if (Utils::UnescapeField(fields[1]) != root) {
+                throw std::runtime_error("Checkpoint belongs to a scan of " + Utils::UnescapeField(fields[1]));
+            }
+        } else if (kind == "database" && fields.size() == 2) {
+            if (fields[1] != fingerprint) {
+                throw std::runtime_error("Checkpoint was made with another signature base");
+            }
+        } else if (kind == "D" && fields.size() == 2) {
+            uint64_t key = 0;
+            if (ParseNumber(fields[1], key, 16)) {
+                unit.done.push_back(key);
+            }
+        } else if (kind == "M" && fields.size() == 5) {
+            MalwareInfo info;
+            if (ParseNumber(fields[1], info.similarity)) {
+                info.hash = fields[2];
+                info.verdict = Utils::UnescapeField(fields[3]);
+                info.filePath = Utils::UnescapeField(fields[4]);
+                unit.malware.push_back(std::move(info));
+            }
+        } else if (kind == "E" && fields.size() == 2) {
+            size_t errors = 0;
+            if (ParseNumber(fields[1], errors)) {
+                unit.errors += errors;
+            }
+        } else if (kind == "C") {
+            state.done.insert(state.done.end(), unit.done.begin(), unit.done.end());
+            state.malware.insert(state.malware.end(), unit.malware.begin(), unit.malware.end());
+            state.errors += unit.errors;
+            unit = State();
+        } else if (kind == "R") {
+            unit = State();
+        } else if (kind == "T" && fields.size() == 2) {
+            int64_t elapsed = 0;
+            if (ParseNumber(fields[1], elapsed)) {
+                state.elapsed = std::chrono::milliseconds(elapsed);
+            }
+        }
+        // Anything else is a line cut short by a crash; its unit has no end marker
+    }
+    std::sort(state.done.begin(), state.done.end());
+    state.done.erase(std::unique(state.done.begin(), state.done.end()), state.done.end());
+    return state;
+}
+
+std::unique_ptr<Checkpoint> Checkpoint::Create(const std::string& path, const std::string& root,
+                                               const std::string& fingerprint, bool append) {
+    std::FILE* file = std::fopen(path.c_str(), append ? "ab" : "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Failed to open checkpoint file: " + path);
+    }
+
+    auto checkpoint = std::unique_ptr<Checkpoint>(new Checkpoint(path, file));
+    if (!append) {
+        checkpoint->pending_ = std::string(HEADER) + "\nroot\t" + Utils::EscapeField(root) +
+                               "\ndatabase\t" + fingerprint + "\n";
+        checkpoint->Flush(std::chrono::milliseconds(0));
+    } else {
+        // A crash may have cut the last line short: start on a line of our own,
+        // and drop the unfinished unit before it
+        checkpoint->pending_ = "\nR\n";
+    }
+    return checkpoint;
+}
+
+Checkpoint::~Checkpoint() {
+    if (file_ != nullptr) {
+        std::fclose(file_);
+    }
+}
+
+void Checkpoint::Commit(const std::vector<uint64_t>& files, const std::vector<MalwareInfo>& malware, size_t errors) {
+    std::string unit;
+    char key[24];
+    for (uint64_t file : files) {
+        auto end = std::to_chars(key, key + sizeof(key), file, 16).ptr;
+        unit += "D\t";
+        unit.append(key, end);
+        unit += '\n';
+    }
+    for (const auto& info : malware) {
+        unit += "M\t" + std::to_string(info.similarity) + "\t" + info.hash + "\t" + Utils::EscapeField(info.verdict) +
+                "\t" + Utils::EscapeField(info.filePath) + "\n";
+    }
+    if (errors != 0) {
+        unit += "E\t" + std::to_string(errors) + "\n";
+    }
+    unit += "C\n";
+
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    pending_ += unit;
+}
+
+void Checkpoint::Flush(std::chrono::milliseconds elapsed) {
+    std::string data;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        data.swap(pending_);
+    }
+    if (elapsed.count() != 0) {
+        data += "T\t" + std::to_string(elapsed.count()) + "\n";
+    }
+
+    std::lock_guard<std::mutex> lock(fileMutex_);
+    if (file_ == nullptr) {
+        return;
+    }
+    if (std::fwrite(data.data(), 1, data.size(), file_) != data.size() || std::fflush(file_) != 0) {
+        throw std::runtime_error("Failed to write checkpoint file: " + path_);
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    // Survives a reboot, not only a crash of this process
+    fsync(fileno(file_));
+#endif
+}
+
+void Checkpoint::Remove() {
+    std::lock_guard<std::mutex> lock(fileMutex_);
+    if (file_ != nullptr) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+    std::error_code ec;
+    std::filesystem::remove(path_, ec);
+}
+
+} // namespace Scanner
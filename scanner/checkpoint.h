@@ -0,0 +1,73 @@
+#pragma once
+
+#include "scannerApi.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Scanner {
+
+// Append-only journal of finished work, so an interrupted scan can resume.
+// Workers commit a unit (a task's files with their detections and errors)
+// to memory; the scan thread appends what was committed every few seconds
+// and syncs it. A unit is applied on resume only if its end marker made it
+// to disk, so a crash never leaves half a task recorded.
+//
+// Text lines after a "virus_scanner checkpoint 1" header:
+//   root <TAB> path              database <TAB> size:mtime
+//   D <TAB> file key             M <TAB> similarity <TAB> hash <TAB> verdict <TAB> path
+//   E <TAB> errors               C (end of unit)      T <TAB> elapsed ms
+//   R (resumed here: an unfinished unit before it is dropped)
+class Checkpoint {
+public:
+    // What a resumed scan starts from
+    struct State {
+        std::vector<uint64_t> done;  // Sorted file keys, 8 bytes per finished file
+        std::vector<MalwareInfo> malware;
+        size_t errors = 0;
+        std::chrono::milliseconds elapsed{0};
+    };
+
+    // Identifies a file by path and size, so a file that grew or shrank
+    // since the checkpoint is scanned again (FNV-1a, 64 bits)
+    static uint64_t FileKey(const std::filesystem::path& path, uint64_t size);
+    // Size and modification time of the signature base; a checkpoint made
+    // with other signatures cannot be resumed
+    static std::string Fingerprint(const std::string& databasePath);
+
+    // Nothing when there is no checkpoint file; throws when it belongs to
+    // another root or signature base
+    static std::optional<State> Load(const std::string& path, const std::string& root,
+                                     const std::string& fingerprint);
+    // Starts a new checkpoint, or appends to an existing one when resuming
+    static std::unique_ptr<Checkpoint> Create(const std::string& path, const std::string& root,
+                                              const std::string& fingerprint, bool append);
+
+    ~Checkpoint();
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+
+    void Commit(const std::vector<uint64_t>& files, const std::vector<MalwareInfo>& malware, size_t errors);
+    // Writes the units committed since the last call and syncs the file
+    void Flush(std::chrono::milliseconds elapsed);
+    // The scan finished: nothing is left to resume
+    void Remove();
+
+private:
+    Checkpoint(std::string path, std::FILE* file) : path_(std::move(path)), file_(file) {}
+
+    const std::string path_;
+    std::FILE* file_;
+    std::string pending_;
+    std::mutex pendingMutex_;
+    std::mutex fileMutex_;
+};
+
+} // namespace Scanner
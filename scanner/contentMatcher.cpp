@@ -0,0 +1,348 @@
+#include "contentMatcher.h"
+#include "cpuFeatures.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace Scanner {
+
+namespace {
+
+constexpr int32_t FREE_SLOT = -1;
+constexpr size_t ALPHABET = 256;
+constexpr unsigned MIN_PREFIX_BITS = 16;
+constexpr unsigned MAX_PREFIX_BITS = 24;  // 2 MB bitmap at most
+constexpr size_t PREFIX_BITS_PER_PATTERN = 16;
+// Past this share of random positions passing the masks, Teddy costs more than it filters
+constexpr double MAX_TEDDY_PASS_RATE = 0.1;
+
+unsigned CountTrailingZeros(uint32_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(value));
+#endif
+}
+
+uint32_t PrefixHash(const unsigned char* position, unsigned shift) {
+    uint32_t word;
+    std::memcpy(&word, position, sizeof(word));
+    return (word * 0x9E3779B1u) >> shift;
+}
+
+#if defined(SCANNER_X86)
+// Bit j is set when position j may start a pattern of some bucket
+SCANNER_TARGET("ssse3")
+uint32_t TeddyMask(const unsigned char* data, const unsigned char (*low)[16], const unsigned char (*high)[16],
+                   size_t width) {
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i buckets = _mm_set1_epi8(-1);
+    for (size_t k = 0; k < width; ++k) {
+        const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + k));
+        const __m128i lowNibbles = _mm_and_si128(input, nibble);
+        const __m128i highNibbles = _mm_and_si128(_mm_srli_epi16(input, 4), nibble);
+        const __m128i lowMatch = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(low[k])), lowNibbles);
+        const __m128i highMatch = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(high[k])), highNibbles);
+        buckets = _mm_and_si128(buckets, _mm_and_si128(lowMatch, highMatch));
+    }
+    const int empty = _mm_movemask_epi8(_mm_cmpeq_epi8(buckets, _mm_setzero_si128()));
+    return ~static_cast<uint32_t>(empty) & 0xFFFF;
+}
+#endif
+
+const bool SIMD_PREFILTER =
+#if defined(SCANNER_X86)
+    GetCpuFeatures().ssse3;
+#else
+    false;
+#endif
+
+} // namespace
+
+bool ContentMatcher::HasSimdPrefilter() {
+    return SIMD_PREFILTER;
+}
+
+void ContentMatcher::Build(const std::vector<Pattern>& patterns) {
+    units_.clear();
+    depth_.clear();
+    patternCount_ = 0;
+    std::memset(teddyLow_, 0, sizeof(teddyLow_));
+    std::memset(teddyHigh_, 0, sizeof(teddyHigh_));
+    prefixBits_.clear();
+    useTeddy_ = false;
+
+    // Plain trie first; the double array is laid out from it afterwards
+    struct TrieNode {
+        std::vector<std::pair<unsigned char, uint32_t>> children;
+        uint32_t output = 0;
+    };
+    std::vector<TrieNode> trie(1);
+    std::vector<const std::string*> accepted;
+
+    for (const auto& pattern : patterns) {
+        if (pattern.bytes.size() < MIN_PATTERN_SIZE || pattern.id == 0) {
+            continue;
+        }
+
+        uint32_t node = 0;
+        for (unsigned char c : pattern.bytes) {
+            auto& children = trie[node].children;
+            auto it = std::find_if(children.begin(), children.end(),
+                                   [c](const auto& child) { return child.first == c; });
+            if (it != children.end()) {
+                node = it->second;
+                continue;
+            }
+            const auto next = static_cast<uint32_t>(trie.size());
+            children.emplace_back(c, next);
+            trie.emplace_back();
+            node = next;
+        }
+        if (trie[node].output == 0) {
+            ++patternCount_;
+            accepted.push_back(&pattern.bytes);
+        }
+        trie[node].output = pattern.id;
+    }
+
+    if (patternCount_ == 0) {
+        return;
+    }
+
+    // Breadth-first order: parents get their slot before their children are placed
+    std::vector<uint32_t> order(1, 0);
+    for (size_t i = 0; i < order.size(); ++i) {
+        auto& children = trie[order[i]].children;
+        std::sort(children.begin(), children.end());
+        for (const auto& child : children) {
+            order.push_back(child.second);
+        }
+    }
+
+    std::vector<uint32_t> slotOf(trie.size(), 0);
+    units_.assign(ALPHABET + 1, Unit{1, FREE_SLOT, 0, 0});
+    units_[0].check = 0;  // Root; no base + byte can reach slot 0
+    std::vector<uint8_t> depthOf(trie.size(), 0);
+    size_t firstFree = 1;
+    size_t maxBase = 1;
+
+    for (uint32_t node : order) {
+        const uint32_t slot = slotOf[node];
+        const auto& children = trie[node].children;
+        if (children.empty()) {
+            continue;
+        }
+
+        while (firstFree < units_.size() && units_[firstFree].check != FREE_SLOT) {
+            ++firstFree;
+        }
+
+        // First base that puts every child byte on a free slot
+        size_t base = 0;
+        for (size_t position = firstFree;; ++position) {
+            if (position + ALPHABET >= units_.size()) {
+                units_.resize(position + 2 * ALPHABET, Unit{1, FREE_SLOT, 0, 0});
+            }
+            if (units_[position].check != FREE_SLOT || position <= children.front().first) {
+                continue;
+            }
+            base = position - children.front().first;
+            const bool fits = std::all_of(children.begin(), children.end(), [&](const auto& child) {
+                return units_[base + child.first].check == FREE_SLOT;
+            });
+            if (fits) {
+                break;
+            }
+        }
+
+        units_[slot].base = static_cast<int32_t>(base);
+        maxBase = std::max(maxBase, base);
+        for (const auto& child : children) {
+            const size_t childSlot = base + child.first;
+            units_[childSlot].check = static_cast<int32_t>(slot);
+            units_[childSlot].output = trie[child.second].output;
+            slotOf[child.second] = static_cast<uint32_t>(childSlot);
+            depthOf[child.second] = static_cast<uint8_t>(std::min<unsigned>(depthOf[node] + 1, UINT8_MAX));
+        }
+    }
+    // Any base + byte must stay inside the array, so Scan() needs no bounds check
+    units_.resize(maxBase + ALPHABET, Unit{1, FREE_SLOT, 0, 0});
+    depth_.assign(units_.size(), 0);
+    for (size_t node = 0; node < trie.size(); ++node) {
+        depth_[slotOf[node]] = depthOf[node];
+    }
+
+    // Failure links in the same order; a state also reports what its longest
+    // proper suffix state reports, so Scan() checks a single field
+    auto transition = [this](uint32_t state, unsigned char c) -> int64_t {
+        const size_t target = static_cast<size_t>(units_[state].base) + c;
+        return units_[target].check == static_cast<int32_t>(state) ? static_cast<int64_t>(target) : -1;
+    };
+    for (uint32_t node : order) {
+        const uint32_t slot = slotOf[node];
+        for (const auto& child : trie[node].children) {
+            const uint32_t childSlot = slotOf[child.second];
+            uint32_t fail = 0;
+            if (slot != 0) {
+                for (uint32_t state = units_[slot].fail;; state = units_[state].fail) {
+                    const int64_t next = transition(state, child.first);
+                    if (next >= 0) {
+                        fail = static_cast<uint32_t>(next);
+                        break;
+                    }
+                    if (state == 0) {
+                        break;
+                    }
+                }
+            }
+            units_[childSlot].fail = fail;
+            if (units_[childSlot].output == 0) {
+                units_[childSlot].output = units_[fail].output;
+            }
+        }
+    }
+
+    // Teddy buckets: neighbours in sorted order share leading nibbles, which
+    // keeps each bucket's masks tight
+    std::sort(accepted.begin(), accepted.end(),
+              [](const std::string* a, const std::string* b) { return *a < *b; });
+    for (size_t i = 0; i < accepted.size(); ++i) {
+        const auto bucketBit = static_cast<unsigned char>(1u << (i * TEDDY_BUCKETS / accepted.size()));
+        for (size_t k = 0; k < TEDDY_WIDTH; ++k) {
+            const auto c = static_cast<unsigned char>((*accepted[i])[k]);
+            teddyLow_[k][c & 0x0F] |= bucketBit;
+            teddyHigh_[k][c >> 4] |= bucketBit;
+        }
+    }
+
+    // Chance that a random position passes some bucket; the nibbles of a byte are independent
+    double passRate = 0;
+    for (size_t bucket = 0; bucket < TEDDY_BUCKETS; ++bucket) {
+        double bucketRate = 1;
+        for (size_t k = 0; k < TEDDY_WIDTH; ++k) {
+            size_t low = 0;
+            size_t high = 0;
+            for (size_t nibble = 0; nibble < 16; ++nibble) {
+                low += (teddyLow_[k][nibble] >> bucket) & 1;
+                high += (teddyHigh_[k][nibble] >> bucket) & 1;
+            }
+            bucketRate *= static_cast<double>(low * high) / 256;
+        }
+        passRate += bucketRate;
+    }
+    useTeddy_ = passRate <= MAX_TEDDY_PASS_RATE;
+
+    unsigned prefixBits = MIN_PREFIX_BITS;
+    while (prefixBits < MAX_PREFIX_BITS && (size_t{1} << prefixBits) < patternCount_ * PREFIX_BITS_PER_PATTERN) {
+        ++prefixBits;
+    }
+    prefixShift_ = 32 - prefixBits;
+    prefixBits_.assign((size_t{1} << prefixBits) / 64, 0);
+    for (const auto* bytes : accepted) {
+        const uint32_t hash = PrefixHash(reinterpret_cast<const unsigned char*>(bytes->data()), prefixShift_);
+        prefixBits_[hash / 64] |= uint64_t{1} << (hash % 64);
+    }
+}
+
+bool ContentMatcher::PrefixMayMatch(const unsigned char* position) const {
+    const uint32_t hash = PrefixHash(position, prefixShift_);
+    return (prefixBits_[hash / 64] >> (hash % 64)) & 1;
+}
+
+// First position at or after from where a pattern may start. Positions too
+// close to the end for a full prefix are returned as they are: the automaton
+// steps through them and carries any partial match into the next buffer.
+size_t ContentMatcher::NextCandidate(const unsigned char* data, size_t from, size_t size) const {
+    size_t position = from;
+#if defined(SCANNER_X86)
+    if (SIMD_PREFILTER && useTeddy_) {
+        while (position + 16 + MIN_PATTERN_SIZE - 1 <= size) {
+            uint32_t mask = TeddyMask(data + position, teddyLow_, teddyHigh_, TEDDY_WIDTH);
+            while (mask != 0) {
+                const size_t candidate = position + CountTrailingZeros(mask);
+                if (PrefixMayMatch(data + candidate)) {
+                    return candidate;
+                }
+                mask &= mask - 1;
+            }
+            position += 16;
+        }
+    }
+#endif
+    if (!useTeddy_) {
+        for (; position + MIN_PATTERN_SIZE <= size; ++position) {
+            if (PrefixMayMatch(data + position)) {
+                return position;
+            }
+        }
+        return position;
+    }
+    for (; position + MIN_PATTERN_SIZE <= size; ++position) {
+        unsigned char buckets = 0xFF;
+        for (size_t k = 0; k < TEDDY_WIDTH; ++k) {
+            const unsigned char c = data[position + k];
+            buckets &= teddyLow_[k][c & 0x0F] & teddyHigh_[k][c >> 4];
+        }
+        if (buckets != 0 && PrefixMayMatch(data + position)) {
+            return position;
+        }
+    }
+    return position;
+}
+
+void ContentMatcher::Scan(State& state, const unsigned char* data, size_t size) const {
+    if (state.match != 0 || units_.empty()) {
+        return;
+    }
+
+    uint32_t node = state.node;
+    size_t i = 0;
+    while (i < size) {
+        // Nothing partially matched, so skipped bytes cannot begin a pattern
+        if (node == 0) {
+            i = NextCandidate(data, i, size);
+            if (i >= size) {
+                break;
+            }
+        }
+
+        const unsigned char c = data[i++];
+        for (;;) {
+            const size_t target = static_cast<size_t>(units_[node].base) + c;
+            if (units_[target].check == static_cast<int32_t>(node)) {
+                node = static_cast<uint32_t>(target);
+                break;
+            }
+            if (node == 0) {
+                break;
+            }
+            node = units_[node].fail;
+        }
+
+        if (units_[node].output != 0) {
+            state.match = units_[node].output;
+            break;
+        }
+
+        // A failure link can land on a short prefix whose start the prefilter
+        // never saw; with a dense root the automaton would otherwise rarely get
+        // back to it. Drop such a start unless its first bytes could begin a pattern.
+        const size_t depth = depth_[node];
+        if (depth < MIN_PATTERN_SIZE && depth <= i && i - depth + MIN_PATTERN_SIZE <= size &&
+            !PrefixMayMatch(data + i - depth)) {
+            node = 0;
+            i = i - depth + 1;
+        }
+    }
+    state.node = node;
+}
+
+} // namespace Scanner
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Scanner {
+
+// Multi-pattern byte signature matcher, frozen after Build().
+//
+// Patterns are compiled into a double-array Aho-Corasick automaton: a
+// transition is base[s] + byte with an ownership check, so every state costs
+// 16 bytes and a step touches one cache line. Most input bytes cannot start
+// any pattern; while the automaton sits in its root state, a prefilter jumps
+// straight to the next position that might. The prefilter is Teddy-style:
+// SSSE3 nibble shuffles test 16 positions against the first three bytes of
+// eight pattern buckets at once, and each hit is confirmed with a bitmap of
+// hashed 4-byte pattern prefixes, which keeps large pattern sets selective.
+class ContentMatcher {
+public:
+    static constexpr size_t MIN_PATTERN_SIZE = 4;  // Shorter patterns would flag nearly every file
+
+    struct Pattern {
+        std::string bytes;
+        uint32_t id;  // Must be non-zero
+    };
+
+    // Progress through one stream; feed its buffers in order
+    struct State {
+        uint32_t node = 0;
+        uint32_t match = 0;  // Id of the first pattern found, 0 while none
+    };
+
+    // Patterns shorter than MIN_PATTERN_SIZE are ignored; for duplicates the later id wins
+    void Build(const std::vector<Pattern>& patterns);
+    void Scan(State& state, const unsigned char* data, size_t size) const;
+    size_t Size() const { return patternCount_; }
+    bool Empty() const { return patternCount_ == 0; }
+
+    // Whether Scan() uses the SIMD prefilter on this CPU
+    static bool HasSimdPrefilter();
+
+private:
+    static constexpr size_t TEDDY_WIDTH = 3;
+    static constexpr size_t TEDDY_BUCKETS = 8;
+
+    struct Unit {
+        int32_t base;
+        int32_t check;    // Parent state, -1 for a free slot
+        uint32_t fail;
+        uint32_t output;  // Pattern ending here or at a suffix state, 0 for none
+    };
+
+    size_t NextCandidate(const unsigned char* data, size_t from, size_t size) const;
+    bool PrefixMayMatch(const unsigned char* position) const;
+
+    std::vector<Unit> units_;
+    std::vector<uint8_t> depth_;  // Per slot, saturating; only depths below MIN_PATTERN_SIZE matter
+    size_t patternCount_ = 0;
+
+    alignas(16) unsigned char teddyLow_[TEDDY_WIDTH][16] = {};
+    alignas(16) unsigned char teddyHigh_[TEDDY_WIDTH][16] = {};
+    bool useTeddy_ = false;  // Large pattern sets saturate the masks; the bitmap alone filters better
+    std::vector<uint64_t> prefixBits_;
+    unsigned prefixShift_ = 32;
+};
+
+} // namespace Scanner
@@ -0,0 +1,67 @@
+#include "cpuFeatures.h"
+
+#include <cstring>
+
+#if defined(SCANNER_X86)
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+namespace Scanner {
+
+namespace {
+
+CpuFeatures DetectCpuFeatures() {
+    CpuFeatures features;
+#if defined(SCANNER_X86)
+    unsigned leaf1[4] = {};
+    unsigned leaf7[4] = {};
+    #if defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0);
+        const unsigned maxLeaf = static_cast<unsigned>(regs[0]);
+        __cpuid(regs, 1);
+        std::memcpy(leaf1, regs, sizeof(leaf1));
+        if (maxLeaf >= 7) {
+            __cpuidex(regs, 7, 0);
+            std::memcpy(leaf7, regs, sizeof(leaf7));
+        }
+    #else
+        const unsigned maxLeaf = __get_cpuid_max(0, nullptr);
+        __get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+        if (maxLeaf >= 7) {
+            __get_cpuid_count(7, 0, &leaf7[0], &leaf7[1], &leaf7[2], &leaf7[3]);
+        }
+    #endif
+
+    features.sse41 = (leaf1[2] >> 19) & 1;
+    features.ssse3 = (leaf1[2] >> 9) & 1;
+    features.shaNi = ((leaf7[1] >> 29) & 1) && features.sse41 && features.ssse3;
+
+    // AVX2 also needs the OS to save YMM state (OSXSAVE + XCR0 bits 1 and 2)
+    const bool osxsave = (leaf1[2] >> 27) & 1;
+    if (osxsave && ((leaf7[1] >> 5) & 1)) {
+    #if defined(_MSC_VER)
+        const unsigned long long xcr0 = _xgetbv(0);
+    #else
+        unsigned eax = 0, edx = 0;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        const unsigned long long xcr0 = (static_cast<unsigned long long>(edx) << 32) | eax;
+    #endif
+        features.avx2 = (xcr0 & 0x6) == 0x6;
+    }
+#endif
+    return features;
+}
+
+} // namespace
+
+const CpuFeatures& GetCpuFeatures() {
+    static const CpuFeatures features = DetectCpuFeatures();
+    return features;
+}
+
+} // namespace Scanner
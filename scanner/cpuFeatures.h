@@ -0,0 +1,28 @@
+#pragma once
+
+// x86 builds compile SIMD kernels per function with SCANNER_TARGET and pick
+// them at runtime from GetCpuFeatures(), so the library still loads on CPUs
+// without those extensions.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SCANNER_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #define SCANNER_TARGET(features)
+    #else
+        #define SCANNER_TARGET(features) __attribute__((target(features)))
+    #endif
+#endif
+
+namespace Scanner {
+
+struct CpuFeatures {
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool shaNi = false;
+    bool avx2 = false;
+};
+
+// Detected from CPUID on first use
+const CpuFeatures& GetCpuFeatures();
+
+} // namespace Scanner
@@ -0,0 +1,289 @@
+#include "digestCache.h"
+#include "hexCodec.h"
+#include "utils.h"
+
+#include <charconv>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/fsverity.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace Scanner {
+
+namespace {
+
+constexpr char HEADER[] = "virus_scanner digest cache 1";
+
+template <typename T>
+bool ParseNumber(const std::string& text, T& value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+bool ParseDigest(const std::string& text, FileDigests& digests) {
+    const size_t equals = text.find('=');
+    if (equals == std::string::npos) {
+        return false;
+    }
+    const auto algorithm = AlgorithmFromName(text.substr(0, equals));
+    if (!algorithm) {
+        return false;
+    }
+    const std::string value = text.substr(equals + 1);
+    if (*algorithm == HashAlgorithm::SSDEEP) {
+        digests.fuzzy = Utils::UnescapeField(value);
+        digests.present |= MaskOf(HashAlgorithm::SSDEEP);
+        return true;
+    }
+    unsigned char bytes[MAX_DIGEST_SIZE];
+    if (value.size() != DigestSize(*algorithm) * 2 || !Hex::Decode(value.data(), DigestSize(*algorithm), bytes)) {
+        return false;
+    }
+    digests.Set(*algorithm, bytes);
+    return true;
+}
+
+// Scanners with other signature bases store other digest types of the same file
+void Merge(DigestCache::Entry& into, const DigestCache::Entry& from) {
+    for (size_t i = 0; i < HASH_ALGORITHM_COUNT; ++i) {
+        const auto algorithm = static_cast<HashAlgorithm>(i);
+        if (from.digests.Has(algorithm) && !into.digests.Has(algorithm)) {
+            if (algorithm == HashAlgorithm::SSDEEP) {
+                into.digests.fuzzy = from.digests.fuzzy;
+                into.digests.present |= MaskOf(algorithm);
+            } else {
+                into.digests.Set(algorithm, from.digests.Bytes(algorithm));
+            }
+        }
+    }
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+// An open descriptor under flock(); both are released on every path out
+class LockedFile {
+public:
+    LockedFile(const std::string& path, int flags, int operation) : fd_(open(path.c_str(), flags | O_CLOEXEC, 0644)) {
+        if (fd_ >= 0) {
+            while (flock(fd_, operation) != 0 && errno == EINTR) {
+            }
+        }
+    }
+    ~LockedFile() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    LockedFile(const LockedFile&) = delete;
+    LockedFile& operator=(const LockedFile&) = delete;
+
+    int Get() const { return fd_; }
+
+private:
+    int fd_;
+};
+#endif
+
+} // namespace
+
+std::optional<DigestCache::Identity> DigestCache::Identify(const std::filesystem::path& path, uint64_t size) {
+#if defined(__linux__) && defined(FS_IOC_MEASURE_VERITY)
+#if defined(STATX_ATTR_VERITY)
+    // Most files have no verity; statx tells without opening them
+    struct statx attributes;
+    if (statx(AT_FDCWD, path.c_str(), 0, 0, &attributes) == 0 &&
+        (attributes.stx_attributes_mask & STATX_ATTR_VERITY) && !(attributes.stx_attributes & STATX_ATTR_VERITY)) {
+        return std::nullopt;
+    }
+#endif
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    constexpr size_t MAX_VERITY_DIGEST = 64;
+    alignas(fsverity_digest) unsigned char buffer[sizeof(fsverity_digest) + MAX_VERITY_DIGEST] = {};
+    auto* measured = reinterpret_cast<fsverity_digest*>(buffer);
+    measured->digest_size = MAX_VERITY_DIGEST;
+    const bool verity = ioctl(fd, FS_IOC_MEASURE_VERITY, measured) == 0;
+    close(fd);
+    if (!verity) {
+        return std::nullopt;
+    }
+
+    const char* algorithm = measured->digest_algorithm == FS_VERITY_HASH_ALG_SHA256   ? "sha256"
+                            : measured->digest_algorithm == FS_VERITY_HASH_ALG_SHA512 ? "sha512"
+                                                                                      : nullptr;
+    if (algorithm == nullptr || measured->digest_size > MAX_VERITY_DIGEST) {
+        return std::nullopt;
+    }
+    Identity identity;
+    identity.size = size;
+    identity.verity = std::string(algorithm) + ":" + Hex::Encode(measured->digest, measured->digest_size);
+    return identity;
+#else
+    (void)path;
+    (void)size;
+    return std::nullopt;
+#endif
+}
+
+std::unique_ptr<DigestCache> DigestCache::Open(const std::string& path) {
+    auto cache = std::unique_ptr<DigestCache>(new DigestCache(path));
+
+    std::string data;
+#if defined(__unix__) || defined(__APPLE__)
+    LockedFile file(path, O_RDONLY, LOCK_SH);
+    if (file.Get() < 0) {
+        if (errno == ENOENT) {
+            return cache;
+        }
+        throw std::runtime_error("Failed to open digest cache: " + path);
+    }
+    char chunk[64 * 1024];
+    ssize_t n;
+    while ((n = read(file.Get(), chunk, sizeof(chunk))) != 0) {
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw std::runtime_error("Failed to read digest cache: " + path);
+        }
+        data.append(chunk, static_cast<size_t>(n));
+    }
+#endif
+    if (data.empty()) {
+        return cache;
+    }
+
+    size_t begin = 0;
+    bool first = true;
+    while (begin < data.size()) {
+        size_t end = data.find('\n', begin);
+        if (end == std::string::npos) {
+            break;  // Cut short while another scanner was writing it
+        }
+        const std::string line = data.substr(begin, end - begin);
+        begin = end + 1;
+        if (first) {
+            if (line != HEADER) {
+                throw std::runtime_error("Not a digest cache: " + path);
+            }
+            first = false;
+            continue;
+        }
+
+        const auto fields = Utils::SplitFields(line);
+        Identity identity;
+        if (fields[0] != "V" || fields.size() < 5 || !ParseNumber(fields[1], identity.size) ||
+            (fields[3] != "0" && fields[3] != "1")) {
+            continue;
+        }
+        identity.verity = fields[2];
+        Entry entry;
+        entry.archive = fields[3] == "1";
+        bool valid = true;
+        for (size_t i = 4; i < fields.size() && valid; ++i) {
+            valid = ParseDigest(fields[i], entry.digests);
+        }
+        if (valid) {
+            Entry& known = cache->entries_[Key(identity)];
+            Merge(known, entry);
+            known.archive = entry.archive;
+        }
+    }
+    return cache;
+}
+
+void DigestCache::Lookup(const std::vector<std::optional<Identity>>& identities, HashAlgorithmMask required,
+                         std::vector<std::optional<Entry>>& hits) const {
+    hits.assign(identities.size(), std::nullopt);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < identities.size(); ++i) {
+        if (!identities[i]) {
+            continue;
+        }
+        auto it = entries_.find(Key(*identities[i]));
+        if (it != entries_.end() && (it->second.digests.present & required) == required) {
+            hits[i] = it->second;
+        }
+    }
+}
+
+void DigestCache::Add(const Identity& identity, const Entry& entry) {
+    std::string line = "V\t" + std::to_string(identity.size) + "\t" + identity.verity + "\t" +
+                       (entry.archive ? "1" : "0");
+    for (size_t i = 0; i < HASH_ALGORITHM_COUNT; ++i) {
+        const auto algorithm = static_cast<HashAlgorithm>(i);
+        if (entry.digests.Has(algorithm)) {
+            const std::string digest = entry.digests.Get(algorithm);
+            line += std::string("\t") + AlgorithmName(algorithm) + "=" +
+                    (algorithm == HashAlgorithm::SSDEEP ? Utils::EscapeField(digest) : digest);
+        }
+    }
+    line += '\n';
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& known = entries_[Key(identity)];
+    Merge(known, entry);
+    known.archive = entry.archive;
+    pending_ += line;
+}
+
+void DigestCache::Flush() {
+    std::string data;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        data.swap(pending_);
+    }
+    if (data.empty()) {
+        return;
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    std::lock_guard<std::mutex> lock(fileMutex_);
+    LockedFile file(path_, O_RDWR | O_CREAT | O_APPEND, LOCK_EX);
+    struct stat info;
+    if (file.Get() < 0 || fstat(file.Get(), &info) != 0) {
+        throw std::runtime_error("Failed to open digest cache: " + path_);
+    }
+    char last = '\n';
+    if (info.st_size == 0) {
+        data = std::string(HEADER) + "\n" + data;
+    } else if (pread(file.Get(), &last, 1, info.st_size - 1) == 1 && last != '\n') {
+        // A scanner that crashed mid-line: start on a line of our own
+        data = "\n" + data;
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t n = write(file.Get(), data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Failed to write digest cache: " + path_);
+        }
+        written += static_cast<size_t>(n);
+    }
+#endif
+}
+
+size_t DigestCache::Size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::string DigestCache::Key(const Identity& identity) {
+    return std::to_string(identity.size) + "\t" + identity.verity;
+}
+
+} // namespace Scanner
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "fileHasher.h"
+#include "hashTypes.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Scanner {
+
+// Digests of files that are the same on many hosts (OS packages, container
+// base layers), kept in a file that scanners load when they start and append
+// to, so a file one host has hashed is not hashed again by the others.
+//
+// A file is looked up only by an identity the kernel vouches for: its
+// fs-verity digest, which every read of the file is checked against. A size
+// and a partial hash would only name a candidate, so they are not used. The
+// cache is trusted like the signature base: whoever can write it can hide a
+// file from every scanner that loads it.
+//
+// Text lines after a "virus_scanner digest cache 1" header:
+//   V <TAB> size <TAB> verity algorithm:digest <TAB> archive (0/1) <TAB> algorithm=digest ...
+class DigestCache {
+public:
+    struct Identity {
+        uint64_t size = 0;
+        std::string verity;  // "sha256:<hex>", as fs-verity measured it
+    };
+    struct Entry {
+        FileDigests digests;
+        bool archive = false;  // The file is a zip/tar/gzip and its members still need a scan
+    };
+
+    // Nothing when the file has no fs-verity digest or the platform has no fs-verity
+    static std::optional<Identity> Identify(const std::filesystem::path& path, uint64_t size);
+
+    // Loads what other scanners wrote; an empty cache when the file does not
+    // exist yet. Throws for a file that is not a digest cache.
+    static std::unique_ptr<DigestCache> Open(const std::string& path);
+
+    // One lookup for a group of files. hits[i] is set when identities[i] is
+    // known and its entry has every digest in required.
+    void Lookup(const std::vector<std::optional<Identity>>& identities, HashAlgorithmMask required,
+                std::vector<std::optional<Entry>>& hits) const;
+    void Add(const Identity& identity, const Entry& entry);
+    // Appends the entries added since the last call; other scanners append to
+    // the same file under an exclusive lock
+    void Flush();
+    size_t Size() const;
+
+private:
+    explicit DigestCache(std::string path) : path_(std::move(path)) {}
+
+    static std::string Key(const Identity& identity);
+
+    const std::string path_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::string pending_;
+    mutable std::mutex mutex_;
+    std::mutex fileMutex_;
+};
+
+} // namespace Scanner
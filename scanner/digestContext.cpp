@@ -0,0 +1,66 @@
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "digestContext.h"
+
+#include <openssl/md5.h>
+#include <openssl/sha.h>
+#include <new>
+#include <stdexcept>
+
+namespace Scanner {
+
+namespace {
+
+static_assert(sizeof(MD5_CTX) <= 128 && sizeof(SHA_CTX) <= 128 && sizeof(SHA256_CTX) <= 128,
+              "OpenSSL contexts fit DigestContext");
+static_assert(alignof(MD5_CTX) <= 8 && alignof(SHA_CTX) <= 8 && alignof(SHA256_CTX) <= 8,
+              "OpenSSL contexts are aligned in DigestContext");
+
+template <typename Context>
+Context* As(unsigned char* state) {
+    return std::launder(reinterpret_cast<Context*>(state));
+}
+
+} // namespace
+
+DigestContext::DigestContext(HashAlgorithm algorithm) : algorithm_(algorithm) {
+    switch (algorithm) {
+        case HashAlgorithm::MD5: new (state_) MD5_CTX; break;
+        case HashAlgorithm::SHA1: new (state_) SHA_CTX; break;
+        case HashAlgorithm::SHA256: new (state_) SHA256_CTX; break;
+        default: throw std::invalid_argument("DigestContext takes MD5, SHA-1 or SHA-256");
+    }
+    Reset();
+}
+
+void DigestContext::Reset() {
+    switch (algorithm_) {
+        case HashAlgorithm::MD5: MD5_Init(As<MD5_CTX>(state_)); break;
+        case HashAlgorithm::SHA1: SHA1_Init(As<SHA_CTX>(state_)); break;
+        default: SHA256_Init(As<SHA256_CTX>(state_)); break;
+    }
+}
+
+void DigestContext::Update(const void* data, size_t size) {
+    switch (algorithm_) {
+        case HashAlgorithm::MD5: MD5_Update(As<MD5_CTX>(state_), data, size); break;
+        case HashAlgorithm::SHA1: SHA1_Update(As<SHA_CTX>(state_), data, size); break;
+        default: SHA256_Update(As<SHA256_CTX>(state_), data, size); break;
+    }
+}
+
+void DigestContext::Final(unsigned char* digest) {
+    switch (algorithm_) {
+        case HashAlgorithm::MD5: MD5_Final(digest, As<MD5_CTX>(state_)); break;
+        case HashAlgorithm::SHA1: SHA1_Final(digest, As<SHA_CTX>(state_)); break;
+        default: SHA256_Final(digest, As<SHA256_CTX>(state_)); break;
+    }
+}
+
+void DigestContext::Hash(HashAlgorithm algorithm, const void* data, size_t size, unsigned char* digest) {
+    DigestContext context(algorithm);
+    context.Update(data, size);
+    context.Final(digest);
+}
+
+} // namespace Scanner
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "hashTypes.h"
+
+#include <cstddef>
+
+namespace Scanner {
+
+// One MD5, SHA-1 or SHA-256 stream through OpenSSL's low-level contexts.
+// They live inline and restart without allocating, where OpenSSL 3.0's
+// EVP_DigestInit_ex() allocates a provider context on every init; both run
+// the same assembly. The deprecated API is used in digestContext.cpp only.
+class DigestContext {
+public:
+    // algorithm is MD5, SHA1 or SHA256
+    explicit DigestContext(HashAlgorithm algorithm);
+
+    void Reset();
+    void Update(const void* data, size_t size);
+    // Writes DigestSize(algorithm) bytes; Reset() before the next input
+    void Final(unsigned char* digest);
+
+    static void Hash(HashAlgorithm algorithm, const void* data, size_t size, unsigned char* digest);
+
+private:
+    HashAlgorithm algorithm_;
+    // Holds the OpenSSL context of the algorithm (checked in the .cpp)
+    alignas(8) unsigned char state_[128];
+};
+
+} // namespace Scanner
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+    #include <xmmintrin.h>
+    #define SCANNER_PREFETCH(addr) _mm_prefetch(reinterpret_cast<const char*>(addr), _MM_HINT_T0)
+#else
+    #define SCANNER_PREFETCH(addr) __builtin_prefetch(addr)
+#endif
+
+namespace Scanner {
+
+// Frozen open-addressing table from an N-byte binary digest to a value id.
+// Id 0 is reserved for empty slots. Built once, then only read.
+template <size_t N>
+class DigestTable {
+public:
+    struct Entry {
+        unsigned char digest[N];
+        uint32_t id;
+    };
+
+    void Build(const std::vector<Entry>& entries) {
+        slots_.clear();
+        size_ = 0;
+        if (entries.empty()) {
+            slots_.shrink_to_fit();
+            shift_ = 64;
+            return;
+        }
+
+        // Keep the load factor at or below 1/2 so probe chains stay short
+        unsigned bits = 1;
+        while ((size_t(1) << bits) < entries.size() * 2) {
+            ++bits;
+        }
+        shift_ = 64 - bits;
+        slots_.assign(size_t(1) << bits, Entry{});
+
+        const size_t mask = slots_.size() - 1;
+        for (const auto& entry : entries) {
+            size_t slot = HomeSlot(entry.digest);
+            while (slots_[slot].id != 0 && std::memcmp(slots_[slot].digest, entry.digest, N) != 0) {
+                slot = (slot + 1) & mask;
+            }
+            if (slots_[slot].id == 0) {
+                std::memcpy(slots_[slot].digest, entry.digest, N);
+                ++size_;
+            }
+            slots_[slot].id = entry.id;  // Later entries override earlier ones
+        }
+    }
+
+    size_t HomeSlot(const unsigned char* digest) const {
+        // Digests are already uniform; a multiplicative step keeps the table
+        // well spread even for hand-made feeds with shared prefixes
+        uint64_t key;
+        std::memcpy(&key, digest, sizeof(key));
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    void Prefetch(size_t slot) const {
+        SCANNER_PREFETCH(&slots_[slot]);
+    }
+
+    // Returns the stored id, or 0 when the digest is absent
+    uint32_t Find(const unsigned char* digest, size_t slot) const {
+        const size_t mask = slots_.size() - 1;
+        while (slots_[slot].id != 0) {
+            if (std::memcmp(slots_[slot].digest, digest, N) == 0) {
+                return slots_[slot].id;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return 0;
+    }
+
+    size_t Size() const { return size_; }
+    bool Empty() const { return size_ == 0; }
+
+private:
+    std::vector<Entry> slots_;
+    unsigned shift_ = 64;
+    size_t size_ = 0;
+};
+
+} // namespace Scanner
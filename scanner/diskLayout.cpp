@@ -0,0 +1,187 @@
+#include "diskLayout.h"
+#include "scannerConstants.h"
+
+#include <map>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace Scanner {
+namespace DiskLayout {
+
+namespace {
+
+#if defined(__unix__) || defined(__APPLE__)
+// Closes the descriptor on every path out
+class FileDescriptor {
+public:
+    explicit FileDescriptor(const std::filesystem::path& path) : fd_(open(path.c_str(), O_RDONLY | O_CLOEXEC)) {}
+    ~FileDescriptor() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    int Get() const { return fd_; }
+
+private:
+    int fd_;
+};
+#endif
+
+#if defined(__linux__)
+uint64_t FirstExtent(int fd) {
+    // Room for the header and a single extent
+    alignas(fiemap) unsigned char buffer[sizeof(fiemap) + sizeof(fiemap_extent)] = {};
+    auto* map = reinterpret_cast<fiemap*>(buffer);
+    map->fm_start = 0;
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = 1;
+    if (ioctl(fd, FS_IOC_FIEMAP, map) != 0 || map->fm_mapped_extents == 0) {
+        return 0;
+    }
+    // Inline and delayed-allocation data has no meaningful physical address
+    const fiemap_extent& extent = map->fm_extents[0];
+    if (extent.fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DATA_INLINE)) {
+        return 0;
+    }
+    return extent.fe_physical;
+}
+#endif
+
+} // namespace
+
+uint64_t SortKey(const std::filesystem::path& path, ReadOrder order) {
+#if defined(__unix__) || defined(__APPLE__)
+    if (order == ReadOrder::Directory) {
+        return 0;
+    }
+
+    FileDescriptor file(path);
+    if (file.Get() < 0) {
+        return 0;
+    }
+#if defined(__linux__)
+    if (order == ReadOrder::Extent) {
+        if (uint64_t physical = FirstExtent(file.Get())) {
+            return physical;
+        }
+    }
+#endif
+    struct stat info;
+    return fstat(file.Get(), &info) == 0 ? static_cast<uint64_t>(info.st_ino) : 0;
+#else
+    (void)path;
+    (void)order;
+    return 0;
+#endif
+}
+
+std::optional<FileIdentity> Identify(const std::filesystem::path& path) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0) {
+        return FileIdentity{static_cast<uint64_t>(info.st_dev), static_cast<uint64_t>(info.st_ino),
+                            static_cast<uint64_t>(info.st_size), static_cast<uint64_t>(info.st_nlink)};
+    }
+#else
+    (void)path;
+#endif
+    return std::nullopt;
+}
+
+ExtentList SharedExtents(const std::filesystem::path& path) {
+    std::vector<std::array<uint64_t, 3>> extents;
+#if defined(__linux__)
+    FileDescriptor file(path);
+    if (file.Get() < 0) {
+        return extents;
+    }
+    // Counted first, then fetched; a file in many pieces is not worth comparing
+    fiemap header = {};
+    header.fm_length = FIEMAP_MAX_OFFSET;
+    if (ioctl(file.Get(), FS_IOC_FIEMAP, &header) != 0 || header.fm_mapped_extents == 0 ||
+        header.fm_mapped_extents > Constants::MAX_SHARED_EXTENTS) {
+        return extents;
+    }
+    std::vector<unsigned char> buffer(sizeof(fiemap) + header.fm_mapped_extents * sizeof(fiemap_extent));
+    auto* map = reinterpret_cast<fiemap*>(buffer.data());
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = header.fm_mapped_extents;
+    if (ioctl(file.Get(), FS_IOC_FIEMAP, map) != 0) {
+        return extents;
+    }
+    constexpr uint32_t unplaced = FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC | FIEMAP_EXTENT_ENCODED |
+                                  FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_DATA_TAIL | FIEMAP_EXTENT_UNWRITTEN;
+    for (uint32_t i = 0; i < map->fm_mapped_extents; ++i) {
+        const fiemap_extent& extent = map->fm_extents[i];
+        if (!(extent.fe_flags & FIEMAP_EXTENT_SHARED) || (extent.fe_flags & unplaced)) {
+            extents.clear();
+            return extents;
+        }
+        extents.push_back({extent.fe_logical, extent.fe_physical, extent.fe_length});
+    }
+    // The mapping may have changed between the two calls
+    if (!(map->fm_extents[map->fm_mapped_extents - 1].fe_flags & FIEMAP_EXTENT_LAST)) {
+        extents.clear();
+    }
+#else
+    (void)path;
+#endif
+    return extents;
+}
+
+std::vector<size_t> FindSharedContent(const std::vector<uint64_t>& sizes,
+                                      const std::function<ExtentList(size_t)>& extentsOf) {
+    // Only a size held by more than one file can have a twin
+    std::unordered_map<uint64_t, size_t> counts;
+    for (uint64_t size : sizes) {
+        if (size >= Constants::DEDUPE_MIN_SIZE) {
+            counts[size]++;
+        }
+    }
+    
+    std::vector<size_t> firsts(sizes.size());
+    std::map<std::pair<uint64_t, ExtentList>, size_t> seen;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        firsts[i] = i;
+        if (sizes[i] < Constants::DEDUPE_MIN_SIZE || counts[sizes[i]] < 2) {
+            continue;
+        }
+        auto extents = extentsOf(i);
+        if (extents.empty()) {
+            continue;
+        }
+        auto known = seen.emplace(std::make_pair(sizes[i], std::move(extents)), i).first;
+        firsts[i] = known->second;
+    }
+    return firsts;
+}
+
+void Prefetch(const std::filesystem::path& path, uint64_t bytes) {
+#if defined(__linux__)
+    FileDescriptor file(path);
+    if (file.Get() >= 0) {
+        posix_fadvise(file.Get(), 0, static_cast<off_t>(bytes), POSIX_FADV_WILLNEED);
+    }
+#else
+    (void)path;
+    (void)bytes;
+#endif
+}
+
+} // namespace DiskLayout
+} // namespace Scanner
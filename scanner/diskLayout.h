@@ -0,0 +1,92 @@
+#pragma once
+
+#include "scannerApi.h"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace Scanner {
+
+// Where a file lives on disk, as far as the platform tells. Sorting by these
+// keys turns a scan into mostly forward reads on disks where seeks are costly.
+namespace DiskLayout {
+
+// ReadOrder::Inode: the inode number, which most filesystems allocate close
+// to the data. ReadOrder::Extent: the physical byte offset of the first
+// extent (FIEMAP), falling back to the inode where FIEMAP is not supported
+// or the file has no extent yet. 0 when neither is available, including on
+// platforms without them.
+uint64_t SortKey(const std::filesystem::path& path, ReadOrder order);
+
+// What stat tells about a file, following symbolic links
+struct FileIdentity {
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    uint64_t links;  // Hard links to the inode
+};
+// Nothing where stat fails or the platform has no inodes
+std::optional<FileIdentity> Identify(const std::filesystem::path& path);
+
+// Logical offset, physical offset and length of every extent of a file whose
+// data lies wholly in extents shared with other files (reflink copies,
+// snapshots, deduplicating filesystems). Two files of the same size with the
+// same list read the same blocks, so they hold the same bytes. Empty when any
+// extent is not shared or has no fixed place on disk, and where FIEMAP is
+// not available.
+using ExtentList = std::vector<std::array<uint64_t, 3>>;
+ExtentList SharedExtents(const std::filesystem::path& path);
+
+// For each file, the index of the first file with the same size and the
+// same shared extents, or its own index. extentsOf(i) is SharedExtents of
+// file i; it is only asked for files of at least DEDUPE_MIN_SIZE whose size
+// another file has, and an empty list leaves the file alone.
+std::vector<size_t> FindSharedContent(const std::vector<uint64_t>& sizes,
+                                      const std::function<ExtentList(size_t)>& extentsOf);
+
+struct MergedContent {
+    size_t files = 0;    // Duplicates folded into another file
+    uint64_t bytes = 0;  // Their sizes, which are not read
+};
+// Folds each file that FindSharedContent matched to another into that one:
+// its path and aliases become aliases of the first file, and it leaves files.
+// File has path, size and aliases like ScannerImpl::PendingFile.
+template <typename File>
+MergedContent MergeSharedContent(std::vector<File>& files, const std::vector<size_t>& firsts) {
+    MergedContent merged;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (firsts[i] == i) {
+            continue;
+        }
+        auto& first = files[firsts[i]];
+        first.aliases.push_back(std::move(files[i].path));
+        first.aliases.insert(first.aliases.end(), files[i].aliases.begin(), files[i].aliases.end());
+        merged.files++;
+        merged.bytes += files[i].size;
+    }
+    
+    size_t kept = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (firsts[i] != i) {
+            continue;
+        }
+        if (kept != i) {
+            files[kept] = std::move(files[i]);
+        }
+        ++kept;
+    }
+    files.resize(kept);
+    return merged;
+}
+
+// Asks the kernel to start reading the first bytes of a file in the
+// background (posix_fadvise WILLNEED); a no-op where that is not available
+void Prefetch(const std::filesystem::path& path, uint64_t bytes);
+
+} // namespace DiskLayout
+
+} // namespace Scanner
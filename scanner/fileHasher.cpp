@@ -0,0 +1,189 @@
+#include "fileHasher.h"
+#include "digestContext.h"
+#include "fileReader.h"
+#include "fuzzyHash.h"
+#include "hexCodec.h"
+#include "sha256Calc.h"
+#include "treeHash.h"
+#include "scannerConstants.h"
+
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+namespace Scanner {
+
+void FileDigests::Set(HashAlgorithm algorithm, const unsigned char* digest) {
+    std::memcpy(bytes[static_cast<size_t>(algorithm)].data(), digest, DigestSize(algorithm));
+    present |= MaskOf(algorithm);
+}
+
+std::string FileDigests::Get(HashAlgorithm algorithm) const {
+    if (!Has(algorithm)) {
+        return std::string();
+    }
+    if (algorithm == HashAlgorithm::SSDEEP) {
+        return fuzzy;
+    }
+    return Hex::Encode(Bytes(algorithm), DigestSize(algorithm));
+}
+
+struct MultiHasher::Impl {
+    HashAlgorithmMask algorithms = 0;
+    std::optional<DigestContext> md5;
+    std::optional<DigestContext> sha1;
+    std::optional<SHA256Calculator> sha256;
+    std::optional<FuzzyHasher> fuzzy;
+    std::optional<TreeHasher> tree;
+};
+
+MultiHasher::MultiHasher(HashAlgorithmMask algorithms, std::optional<uint64_t> totalSize)
+    : impl_(std::make_unique<Impl>()) {
+    impl_->algorithms = algorithms;
+    if (algorithms & MaskOf(HashAlgorithm::MD5)) {
+        impl_->md5.emplace(HashAlgorithm::MD5);
+    }
+    if (algorithms & MaskOf(HashAlgorithm::SHA1)) {
+        impl_->sha1.emplace(HashAlgorithm::SHA1);
+    }
+    if (algorithms & MaskOf(HashAlgorithm::SHA256)) {
+        impl_->sha256.emplace();
+    }
+    Reset(totalSize);
+}
+
+MultiHasher::~MultiHasher() = default;
+
+void MultiHasher::Reset(std::optional<uint64_t> totalSize) {
+    if (impl_->md5) {
+        impl_->md5->Reset();
+    }
+    if (impl_->sha1) {
+        impl_->sha1->Reset();
+    }
+    if (impl_->sha256) {
+        impl_->sha256->Reset();
+    }
+    if (impl_->algorithms & MaskOf(HashAlgorithm::TREE)) {
+        impl_->tree.emplace();
+    }
+    if (impl_->algorithms & MaskOf(HashAlgorithm::SSDEEP)) {
+        if (totalSize) {
+            impl_->fuzzy.emplace(*totalSize);
+        } else {
+            impl_->fuzzy.emplace();
+        }
+    }
+}
+
+HashAlgorithmMask MultiHasher::Algorithms() const {
+    return impl_->algorithms;
+}
+
+void MultiHasher::Update(const void* data, size_t size) {
+    if (impl_->md5) {
+        impl_->md5->Update(data, size);
+    }
+    if (impl_->sha1) {
+        impl_->sha1->Update(data, size);
+    }
+    if (impl_->sha256) {
+        impl_->sha256->Update(data, size);
+    }
+    if (impl_->fuzzy) {
+        impl_->fuzzy->Update(data, size);
+    }
+    if (impl_->tree) {
+        impl_->tree->Update(data, size);
+    }
+}
+
+FileDigests MultiHasher::Final() {
+    FileDigests digests;
+    unsigned char result[MAX_DIGEST_SIZE];
+    if (impl_->md5) {
+        impl_->md5->Final(result);
+        digests.Set(HashAlgorithm::MD5, result);
+    }
+    if (impl_->sha1) {
+        impl_->sha1->Final(result);
+        digests.Set(HashAlgorithm::SHA1, result);
+    }
+    if (impl_->sha256) {
+        digests.Set(HashAlgorithm::SHA256, impl_->sha256->Final().data());
+    }
+    if (impl_->fuzzy) {
+        digests.fuzzy = impl_->fuzzy->Final();
+        digests.present |= MaskOf(HashAlgorithm::SSDEEP);
+    }
+    if (impl_->tree) {
+        digests.Set(HashAlgorithm::TREE, impl_->tree->Final().data());
+    }
+    return digests;
+}
+
+void FileHasher::PrefixDigest(const unsigned char* data, size_t size, unsigned char* prefixMd5) {
+    DigestContext::Hash(HashAlgorithm::MD5, data, size, prefixMd5);
+}
+
+FileDigests FileHasher::CalculateFile(const std::filesystem::path& filepath, HashAlgorithmMask algorithms) {
+    return *CalculateFile(filepath, algorithms, nullptr);
+}
+
+std::optional<FileDigests> FileHasher::CalculateFile(const std::filesystem::path& filepath,
+                                                     HashAlgorithmMask algorithms,
+                                                     const PrefixFilter& prefixFilter,
+                                                     const BufferObserver& observer,
+                                                     CacheMode cacheMode,
+                                                     ReadThrottle throttle) {
+    FileReader file(filepath, cacheMode, 0, 0, throttle);
+    return CalculateFile(file, file.Size(), algorithms, prefixFilter, observer);
+}
+
+std::optional<FileDigests> FileHasher::CalculateFile(FileReader& file, uint64_t fileSize,
+                                                     HashAlgorithmMask algorithms,
+                                                     const PrefixFilter& prefixFilter,
+                                                     const BufferObserver& observer) {
+    // Kept by the worker between files; rebuilt only when the algorithms change
+    thread_local std::unique_ptr<MultiHasher> hasher;
+    if (!hasher || hasher->Algorithms() != algorithms) {
+        hasher = std::make_unique<MultiHasher>(algorithms, fileSize);
+    } else {
+        hasher->Reset(fileSize);
+    }
+    
+    static_assert(Constants::PREFIX_HASH_SIZE <= Constants::MIN_READ_BUFFER_SIZE, "Prefix must fit one read");
+    static_assert(Constants::PREFIX_HASH_SIZE % Constants::DIRECT_IO_ALIGNMENT == 0, "Prefix read must suit O_DIRECT");
+    auto buffer = BufferPool::Acquire(BufferPool::ReadSizeFor(fileSize));
+    
+    auto feed = [&](size_t count) {
+        hasher->Update(buffer.Data(), count);
+        if (observer) {
+            observer(buffer.Data(), count);
+        }
+    };
+    
+    // The first read is just the prefix, so a rejected file costs one small read
+    if (prefixFilter) {
+        const auto count = file.Read(buffer.Data(), Constants::PREFIX_HASH_SIZE);
+        if (observer) {
+            observer(buffer.Data(), count);
+        }
+        
+        unsigned char prefixMd5[DigestSize(HashAlgorithm::MD5)];
+        PrefixDigest(buffer.Data(), count, prefixMd5);
+        if (!prefixFilter(prefixMd5)) {
+            return std::nullopt;
+        }
+        hasher->Update(buffer.Data(), count);
+    }
+    
+    while (const auto count = file.Read(buffer.Data(), buffer.Size())) {
+        feed(count);
+    }
+    
+    return hasher->Final();
+}
+
+} // namespace Scanner
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "hashTypes.h"
+#include "scannerApi.h"
+#include "throttle.h"
+
+#include <array>
+#include <filesystem>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace Scanner {
+
+class FileReader;
+
+// Digests of one file: binary for exact types, ssdeep's own text format for
+// SSDEEP. Only the requested algorithms are set; nothing is allocated unless
+// ssdeep is among them.
+struct FileDigests {
+    HashAlgorithmMask present = 0;
+    std::array<std::array<unsigned char, MAX_DIGEST_SIZE>, HASH_ALGORITHM_COUNT> bytes{};
+    std::string fuzzy;
+
+    bool Has(HashAlgorithm algorithm) const { return (present & MaskOf(algorithm)) != 0; }
+    const unsigned char* Bytes(HashAlgorithm algorithm) const { return bytes[static_cast<size_t>(algorithm)].data(); }
+    // Stores DigestSize(algorithm) bytes
+    void Set(HashAlgorithm algorithm, const unsigned char* digest);
+    // Hex (the ssdeep text for SSDEEP), empty when not requested; for reports
+    std::string Get(HashAlgorithm algorithm) const;
+};
+
+// Streaming digests of one input for a set of algorithms. SHA-256 uses
+// SHA256Calculator, ssdeep FuzzyHasher and tree digests TreeHasher; MD5 and
+// SHA-1 use OpenSSL's digest code, which picks SHA-NI / ARMv8 crypto code
+// paths at runtime.
+class MultiHasher {
+public:
+    // totalSize, when known, lets the ssdeep hasher drop unusable block sizes
+    // early; exactly that many bytes must follow
+    explicit MultiHasher(HashAlgorithmMask algorithms, std::optional<uint64_t> totalSize = std::nullopt);
+    ~MultiHasher();
+
+    MultiHasher(const MultiHasher&) = delete;
+    MultiHasher& operator=(const MultiHasher&) = delete;
+
+    void Update(const void* data, size_t size);
+    FileDigests Final();
+    // Starts the next input with the same algorithms, keeping the contexts
+    void Reset(std::optional<uint64_t> totalSize = std::nullopt);
+    HashAlgorithmMask Algorithms() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+class FileHasher {
+public:
+    // Receives the MD5 of the first PREFIX_HASH_SIZE bytes; false stops the read
+    using PrefixFilter = std::function<bool(const unsigned char* prefixMd5)>;
+    // The digest a PrefixFilter receives, of the size leading bytes read
+    static void PrefixDigest(const unsigned char* data, size_t size, unsigned char* prefixMd5);
+    // Sees every buffer of the file in order, alongside the hashers; the
+    // prefix is seen before the filter judges it
+    using BufferObserver = std::function<void(const unsigned char* data, size_t size)>;
+
+    // Reads the file once and feeds every buffer to a MultiHasher, so extra
+    // digest types cost CPU but no extra I/O. The hasher and the read buffer
+    // are kept per thread, so a worker allocates nothing per file once warm
+    // (ssdeep and tree digests aside).
+    static FileDigests CalculateFile(const std::filesystem::path& filepath, HashAlgorithmMask algorithms);
+    // Same, but the prefix is read and checked first; returns nothing when the
+    // filter rejects it, leaving the rest of the file unread.
+    static std::optional<FileDigests> CalculateFile(const std::filesystem::path& filepath,
+                                                    HashAlgorithmMask algorithms,
+                                                    const PrefixFilter& prefixFilter,
+                                                    const BufferObserver& observer = nullptr,
+                                                    CacheMode cacheMode = CacheMode::Normal,
+                                                    ReadThrottle throttle = {});
+    // Same, on a file the caller has opened and not read yet; fileSize is
+    // its current size (FileReader::Size())
+    static std::optional<FileDigests> CalculateFile(FileReader& file, uint64_t fileSize,
+                                                    HashAlgorithmMask algorithms,
+                                                    const PrefixFilter& prefixFilter,
+                                                    const BufferObserver& observer = nullptr);
+};
+
+} // namespace Scanner
@@ -0,0 +1,262 @@
+#include "fileReader.h"
+#include "scannerConstants.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+namespace Scanner {
+
+namespace {
+
+#if defined(__linux__)
+#if defined(SYS_cachestat)
+constexpr long CACHESTAT_SYSCALL = SYS_cachestat;
+#elif !defined(__alpha__)
+constexpr long CACHESTAT_SYSCALL = 451;  // Same number on every other architecture
+#else
+constexpr long CACHESTAT_SYSCALL = -1;
+#endif
+
+// Layouts of struct cachestat_range and struct cachestat (Linux 6.5)
+struct CacheStatRange {
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct CacheStat {
+    uint64_t cached;
+    uint64_t dirty;
+    uint64_t writeback;
+    uint64_t evicted;
+    uint64_t recentlyEvicted;
+};
+
+// Without cachestat (older kernels) every range counts as not cached, so
+// DropBehind may evict files other processes were using
+bool IsCached(int fd, uint64_t offset, uint64_t length) {
+    if (CACHESTAT_SYSCALL < 0) {
+        return false;
+    }
+    CacheStatRange range{offset, length};
+    CacheStat stat{};
+    return syscall(CACHESTAT_SYSCALL, fd, &range, &stat, 0) == 0 && stat.cached > 0;
+}
+#endif
+
+// Pool sizes are MIN_READ_BUFFER_SIZE << index
+constexpr size_t PoolClass(size_t size) {
+    size_t index = 0;
+    while ((Constants::MIN_READ_BUFFER_SIZE << index) < size &&
+           (Constants::MIN_READ_BUFFER_SIZE << index) < Constants::MAX_READ_BUFFER_SIZE) {
+        ++index;
+    }
+    return index;
+}
+
+constexpr size_t POOL_CLASSES = PoolClass(Constants::MAX_READ_BUFFER_SIZE) + 1;
+
+thread_local std::array<std::vector<AlignedBuffer>, POOL_CLASSES> freeBuffers;
+
+} // namespace
+
+AlignedBuffer::AlignedBuffer(size_t size)
+    : data_(nullptr),
+      size_((size + Constants::DIRECT_IO_ALIGNMENT - 1) / Constants::DIRECT_IO_ALIGNMENT * Constants::DIRECT_IO_ALIGNMENT) {
+    data_.reset(static_cast<unsigned char*>(
+        ::operator new[](size_, std::align_val_t{Constants::DIRECT_IO_ALIGNMENT})));
+}
+
+void AlignedBuffer::Deleter::operator()(unsigned char* data) const {
+    ::operator delete[](data, std::align_val_t{Constants::DIRECT_IO_ALIGNMENT});
+}
+
+BufferPool::Lease::~Lease() {
+    if (buffer_.Data()) {
+        try {
+            freeBuffers[PoolClass(buffer_.Size())].push_back(std::move(buffer_));
+        } catch (const std::bad_alloc&) {
+            // The buffer is simply freed
+        }
+    }
+}
+
+BufferPool::Lease BufferPool::Acquire(size_t size) {
+    const size_t index = PoolClass(size);
+    auto& buffers = freeBuffers[index];
+    if (buffers.empty()) {
+        return Lease(AlignedBuffer(Constants::MIN_READ_BUFFER_SIZE << index));
+    }
+    Lease lease(std::move(buffers.back()));
+    buffers.pop_back();
+    return lease;
+}
+
+size_t BufferPool::ReadSizeFor(uint64_t fileSize) {
+    return Constants::MIN_READ_BUFFER_SIZE << PoolClass(static_cast<size_t>(
+        std::min<uint64_t>(fileSize, Constants::MAX_READ_BUFFER_SIZE)));
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+FileReader::FileReader(const std::filesystem::path& path, CacheMode mode, uint64_t offset, uint64_t length,
+                       ReadThrottle throttle)
+    : throttle_(throttle), position_(offset), length_(length), dropFrom_(offset) {
+#if defined(__linux__)
+    if (mode == CacheMode::Direct) {
+        fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+        if (fd_ >= 0) {
+            mode_ = CacheMode::Direct;
+        }
+    }
+#endif
+    if (fd_ < 0) {
+        fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open file: " + path.string());
+    }
+
+#if defined(__APPLE__)
+    if (mode == CacheMode::Direct && fcntl(fd_, F_NOCACHE, 1) == 0) {
+        mode_ = CacheMode::Direct;
+    }
+#endif
+    if (mode != CacheMode::Normal && mode_ == CacheMode::Normal) {
+        StartDropBehind();
+    }
+}
+
+FileReader::~FileReader() {
+    Drop();
+    close(fd_);
+}
+
+uint64_t FileReader::Size() const {
+    struct stat info;
+    if (fstat(fd_, &info) != 0) {
+        throw std::runtime_error("Cannot get file size");
+    }
+    return static_cast<uint64_t>(info.st_size);
+}
+
+void FileReader::StartDropBehind() {
+    mode_ = CacheMode::DropBehind;
+#if defined(__linux__)
+    keepCached_ = IsCached(fd_, position_, length_);
+#elif defined(__APPLE__)
+    // No posix_fadvise here; uncached reads are the closest match
+    fcntl(fd_, F_NOCACHE, 1);
+#endif
+}
+
+void FileReader::Drop() {
+#if defined(__linux__)
+    if (mode_ == CacheMode::DropBehind && !keepCached_ && position_ > dropFrom_) {
+        posix_fadvise(fd_, static_cast<off_t>(dropFrom_), static_cast<off_t>(position_ - dropFrom_), POSIX_FADV_DONTNEED);
+    }
+#endif
+    dropFrom_ = position_;
+}
+
+size_t FileReader::ReadFile(unsigned char* data, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        const ssize_t count = pread(fd_, data + total, size - total, static_cast<off_t>(position_));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+#if defined(__linux__)
+            // Some filesystems accept O_DIRECT at open time but not for reads
+            if (errno == EINVAL && mode_ == CacheMode::Direct) {
+                fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+                StartDropBehind();
+                continue;
+            }
+#endif
+            throw std::runtime_error("Cannot read file");
+        }
+        if (count == 0) {
+            break;
+        }
+        total += static_cast<size_t>(count);
+        position_ += static_cast<uint64_t>(count);
+    }
+
+    // Large files are evicted in windows, so a scan holds a bounded amount of cache
+    if (position_ - dropFrom_ >= Constants::DROP_BEHIND_WINDOW) {
+        Drop();
+    }
+    return total;
+}
+
+#else
+
+// Cache policies are not implemented here; every mode reads normally
+FileReader::FileReader(const std::filesystem::path& path, CacheMode, uint64_t offset, uint64_t,
+                       ReadThrottle throttle)
+    : throttle_(throttle), stream_(std::make_unique<std::ifstream>(path, std::ios::binary)) {
+    if (!stream_->is_open()) {
+        throw std::runtime_error("Cannot open file: " + path.string());
+    }
+    stream_->seekg(static_cast<std::streamoff>(offset));
+    streamSize_ = std::filesystem::file_size(path);
+}
+
+FileReader::~FileReader() = default;
+
+uint64_t FileReader::Size() const {
+    return streamSize_;
+}
+
+void FileReader::StartDropBehind() {
+}
+
+void FileReader::Drop() {
+}
+
+size_t FileReader::ReadFile(unsigned char* data, size_t size) {
+    stream_->read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+    if (stream_->bad()) {
+        throw std::runtime_error("Cannot read file");
+    }
+    return static_cast<size_t>(stream_->gcount());
+}
+
+#endif
+
+size_t FileReader::Read(unsigned char* data, size_t size) {
+    if (throttle_.concurrency == nullptr && throttle_.bytes == nullptr) {
+        return ReadFile(data, size);
+    }
+    
+    const auto started = std::chrono::steady_clock::now();
+    const size_t count = ReadFile(data, size);
+    if (throttle_.concurrency != nullptr) {
+        throttle_.concurrency->RecordLatency(std::chrono::steady_clock::now() - started);
+    }
+    // Charged after the read, with what it returned: a small file pays for
+    // its bytes, not for the buffer it was read into
+    if (throttle_.bytes != nullptr && count != 0) {
+        throttle_.bytes->Acquire(count);
+    }
+    return count;
+}
+
+} // namespace Scanner
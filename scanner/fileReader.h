@@ -0,0 +1,101 @@
+#pragma once
+
+#include "scannerApi.h"
+#include "throttle.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
+
+namespace Scanner {
+
+// Heap buffer aligned to DIRECT_IO_ALIGNMENT, as O_DIRECT reads require;
+// the size is rounded up to a multiple of it
+class AlignedBuffer {
+public:
+    explicit AlignedBuffer(size_t size);
+
+    unsigned char* Data() const { return data_.get(); }
+    size_t Size() const { return size_; }
+
+private:
+    struct Deleter {
+        void operator()(unsigned char* data) const;
+    };
+
+    std::unique_ptr<unsigned char[], Deleter> data_;
+    size_t size_;
+};
+
+// Aligned read buffers kept per thread in power-of-two sizes from
+// MIN_READ_BUFFER_SIZE to MAX_READ_BUFFER_SIZE. A lease hands its buffer back
+// to the pool of the thread that releases it, so once a worker has used each
+// size it reads files without allocating.
+class BufferPool {
+public:
+    class Lease {
+    public:
+        Lease(Lease&& other) noexcept = default;
+        Lease& operator=(Lease&&) = delete;
+        ~Lease();
+
+        unsigned char* Data() const { return buffer_.Data(); }
+        size_t Size() const { return buffer_.Size(); }
+
+    private:
+        friend class BufferPool;
+        explicit Lease(AlignedBuffer buffer) : buffer_(std::move(buffer)) {}
+
+        AlignedBuffer buffer_;
+    };
+
+    // A buffer of the pool size that fits size, capped at MAX_READ_BUFFER_SIZE
+    static Lease Acquire(size_t size);
+    // Read size for a file: a small file in one read, large ones in maximum-size reads
+    static size_t ReadSizeFor(uint64_t fileSize);
+};
+
+// Reads one file front to back under a page cache policy (see CacheMode).
+// DropBehind evicts what was read as it goes, unless part of the range was
+// already cached when the reader opened it: that is someone else's working
+// set. Direct bypasses the cache and falls back to DropBehind where the
+// filesystem refuses it. With Direct, buffers must come from AlignedBuffer
+// and every read but the last must be a multiple of DIRECT_IO_ALIGNMENT.
+// A throttle is charged the bytes of each read and told its latency.
+class FileReader {
+public:
+    // Reading starts at offset; length is the part of the file the caller
+    // means to read (0 = to the end), used for the earlier-caching check
+    FileReader(const std::filesystem::path& path, CacheMode mode, uint64_t offset = 0, uint64_t length = 0,
+               ReadThrottle throttle = {});
+    ~FileReader();
+
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+
+    // Fills the buffer unless the file ends first; returns the bytes read
+    size_t Read(unsigned char* data, size_t size);
+    // Current size of the open file (fstat), without another lookup of its path
+    uint64_t Size() const;
+    // The mode in effect, after any fallback
+    CacheMode Mode() const { return mode_; }
+
+private:
+    size_t ReadFile(unsigned char* data, size_t size);
+    void StartDropBehind();
+    void Drop();
+
+    ReadThrottle throttle_;
+    int fd_ = -1;
+    CacheMode mode_ = CacheMode::Normal;
+    uint64_t position_ = 0;
+    uint64_t length_ = 0;
+    uint64_t dropFrom_ = 0;  // Start of the range read but not yet evicted
+    bool keepCached_ = false;
+    std::unique_ptr<std::ifstream> stream_;  // Platforms without POSIX reads
+    uint64_t streamSize_ = 0;
+};
+
+} // namespace Scanner
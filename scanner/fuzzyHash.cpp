@@ -0,0 +1,304 @@
+#include "fuzzyHash.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Scanner {
+
+namespace {
+
+constexpr uint32_t HASH_PRIME = 0x01000193;
+constexpr uint32_t HASH_INIT = 0x28021967;
+constexpr char BASE64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+constexpr uint32_t BlockSizeAt(size_t index) {
+    return FuzzyHasher::MIN_BLOCKSIZE << index;
+}
+
+uint32_t SumHash(unsigned char c, uint32_t h) {
+    return (h * HASH_PRIME) ^ c;
+}
+
+bool IsBase64(char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '+' || c == '/';
+}
+
+// Identical runs carry little information and would inflate scores
+std::string EliminateSequences(const std::string& part) {
+    std::string result;
+    result.reserve(part.size());
+    for (size_t i = 0; i < part.size(); ++i) {
+        if (i < 3 || part[i] != part[i - 1] || part[i] != part[i - 2] || part[i] != part[i - 3]) {
+            result += part[i];
+        }
+    }
+    return result;
+}
+
+bool HasCommonSubstring(const std::string& first, const std::string& second) {
+    if (first.size() < FuzzyHasher::ROLLING_WINDOW || second.size() < FuzzyHasher::ROLLING_WINDOW) {
+        return false;
+    }
+    for (size_t i = 0; i + FuzzyHasher::ROLLING_WINDOW <= first.size(); ++i) {
+        if (second.find(first.data() + i, 0, FuzzyHasher::ROLLING_WINDOW) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Insertions and deletions cost 1, a substitution 2
+uint32_t EditDistance(const std::string& first, const std::string& second) {
+    std::vector<uint32_t> previous(second.size() + 1);
+    std::vector<uint32_t> current(second.size() + 1);
+    for (size_t j = 0; j <= second.size(); ++j) {
+        previous[j] = static_cast<uint32_t>(j);
+    }
+    for (size_t i = 1; i <= first.size(); ++i) {
+        current[0] = static_cast<uint32_t>(i);
+        for (size_t j = 1; j <= second.size(); ++j) {
+            const uint32_t replace = previous[j - 1] + (first[i - 1] == second[j - 1] ? 0 : 2);
+            current[j] = std::min({previous[j] + 1, current[j - 1] + 1, replace});
+        }
+        std::swap(previous, current);
+    }
+    return previous[second.size()];
+}
+
+int ScoreStrings(const std::string& first, const std::string& second, uint64_t blockSize) {
+    if (first.size() > FuzzyHasher::SPAMSUM_LENGTH || second.size() > FuzzyHasher::SPAMSUM_LENGTH) {
+        return 0;
+    }
+    if (!HasCommonSubstring(first, second)) {
+        return 0;
+    }
+
+    uint64_t score = EditDistance(first, second);
+    score = (score * FuzzyHasher::SPAMSUM_LENGTH) / (first.size() + second.size());
+    score = (100 * score) / FuzzyHasher::SPAMSUM_LENGTH;
+    if (score >= 100) {
+        return 0;
+    }
+    score = 100 - score;
+
+    // Tiny block sizes cannot justify a high score for short digests
+    constexpr uint64_t uncappedBlockSize =
+        (99 + FuzzyHasher::ROLLING_WINDOW) / FuzzyHasher::ROLLING_WINDOW * FuzzyHasher::MIN_BLOCKSIZE;
+    if (blockSize < uncappedBlockSize) {
+        score = std::min<uint64_t>(score, blockSize / FuzzyHasher::MIN_BLOCKSIZE *
+                                              std::min(first.size(), second.size()));
+    }
+    return static_cast<int>(score);
+}
+
+} // namespace
+
+std::optional<FuzzyDigest> FuzzyDigest::Parse(const std::string& text) {
+    const size_t first = text.find(':');
+    if (first == std::string::npos || first == 0 || first > 10) {
+        return std::nullopt;
+    }
+
+    uint64_t blockSize = 0;
+    for (size_t i = 0; i < first; ++i) {
+        if (text[i] < '0' || text[i] > '9') {
+            return std::nullopt;
+        }
+        blockSize = blockSize * 10 + static_cast<uint64_t>(text[i] - '0');
+    }
+    if (blockSize < FuzzyHasher::MIN_BLOCKSIZE || blockSize > UINT32_MAX / 2) {
+        return std::nullopt;
+    }
+
+    const size_t second = text.find(':', first + 1);
+    if (second == std::string::npos) {
+        return std::nullopt;
+    }
+    size_t end = text.find(',', second + 1);
+    if (end == std::string::npos) {
+        end = text.size();
+    }
+
+    std::string part1 = text.substr(first + 1, second - first - 1);
+    std::string part2 = text.substr(second + 1, end - second - 1);
+    if (part1.size() > FuzzyHasher::SPAMSUM_LENGTH || part2.size() > FuzzyHasher::SPAMSUM_LENGTH ||
+        !std::all_of(part1.begin(), part1.end(), IsBase64) || !std::all_of(part2.begin(), part2.end(), IsBase64)) {
+        return std::nullopt;
+    }
+
+    FuzzyDigest digest;
+    digest.blockSize = static_cast<uint32_t>(blockSize);
+    digest.part1 = EliminateSequences(part1);
+    digest.part2 = EliminateSequences(part2);
+    return digest;
+}
+
+FuzzyHasher::FuzzyHasher() {
+    blocks_[0].h = HASH_INIT;
+    blocks_[0].halfh = HASH_INIT;
+    blocks_[0].digest[0] = '\0';
+    blocks_[0].halfdigest = '\0';
+    blocks_[0].dindex = 0;
+}
+
+FuzzyHasher::FuzzyHasher(uint64_t totalSize) : FuzzyHasher() {
+    fixedSize_ = totalSize;
+
+    // Final() starts at the first block size that fits the input and also reads the next one
+    size_t guess = 0;
+    while (static_cast<uint64_t>(BlockSizeAt(guess)) * SPAMSUM_LENGTH < totalSize && guess + 1 < NUM_BLOCKHASHES) {
+        ++guess;
+    }
+    blockEndLimit_ = std::min(guess + 2, NUM_BLOCKHASHES);
+}
+
+void FuzzyHasher::Update(const void* data, size_t size) {
+    totalSize_ += size;
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        Step(bytes[i]);
+    }
+}
+
+void FuzzyHasher::Step(unsigned char c) {
+    rollH2_ -= rollH1_;
+    rollH2_ += static_cast<uint32_t>(ROLLING_WINDOW) * c;
+    rollH1_ += c;
+    rollH1_ -= window_[rollN_ % ROLLING_WINDOW];
+    window_[rollN_ % ROLLING_WINDOW] = c;
+    ++rollN_;
+    rollH3_ <<= 5;
+    rollH3_ ^= c;
+
+    const uint32_t h = RollSum();
+    for (size_t i = blockStart_; i < blockEnd_; ++i) {
+        blocks_[i].h = SumHash(c, blocks_[i].h);
+        blocks_[i].halfh = SumHash(c, blocks_[i].halfh);
+    }
+
+    // A trigger at block size 2b is always a trigger at b, so stop at the first miss
+    for (size_t i = blockStart_; i < blockEnd_; ++i) {
+        if (h % BlockSizeAt(i) != BlockSizeAt(i) - 1) {
+            break;
+        }
+
+        BlockHash& block = blocks_[i];
+        if (block.dindex == 0) {
+            TryFork();
+        }
+        block.halfdigest = BASE64[block.halfh % 64];
+        block.digest[block.dindex] = BASE64[block.h % 64];
+        if (block.dindex < SPAMSUM_LENGTH - 1) {
+            // Once the digest is full its last piece keeps absorbing the tail
+            block.digest[++block.dindex] = '\0';
+            block.h = HASH_INIT;
+            if (block.dindex < SPAMSUM_LENGTH / 2) {
+                block.halfh = HASH_INIT;
+                block.halfdigest = '\0';
+            }
+        } else {
+            TryReduce();
+        }
+    }
+}
+
+// The next block size starts from the same sums, as if it had been tracked from the start
+void FuzzyHasher::TryFork() {
+    if (blockEnd_ >= blockEndLimit_) {
+        return;
+    }
+    const BlockHash& previous = blocks_[blockEnd_ - 1];
+    BlockHash& next = blocks_[blockEnd_];
+    next.h = previous.h;
+    next.halfh = previous.halfh;
+    next.digest[0] = '\0';
+    next.halfdigest = '\0';
+    next.dindex = 0;
+    ++blockEnd_;
+}
+
+// Stops tracking the smallest block size once it can no longer be selected
+void FuzzyHasher::TryReduce() {
+    if (blockEnd_ - blockStart_ < 2) {
+        return;
+    }
+    if (static_cast<uint64_t>(BlockSizeAt(blockStart_)) * SPAMSUM_LENGTH >= std::max(totalSize_, fixedSize_)) {
+        return;
+    }
+    if (blocks_[blockStart_ + 1].dindex < SPAMSUM_LENGTH / 2) {
+        return;
+    }
+    ++blockStart_;
+}
+
+std::string FuzzyHasher::Final() const {
+    const uint32_t h = RollSum();
+
+    // Smallest block size expected to fill the digest, lowered while the
+    // digest it produced is too short
+    size_t index = blockStart_;
+    while (static_cast<uint64_t>(BlockSizeAt(index)) * SPAMSUM_LENGTH < totalSize_ && index + 1 < NUM_BLOCKHASHES) {
+        ++index;
+    }
+    while (index >= blockEnd_) {
+        --index;
+    }
+    while (index > blockStart_ && blocks_[index].dindex < SPAMSUM_LENGTH / 2) {
+        --index;
+    }
+
+    const BlockHash& block = blocks_[index];
+    std::string result = std::to_string(BlockSizeAt(index)) + ":";
+    result.append(block.digest, block.dindex);
+    if (h != 0) {
+        result += BASE64[block.h % 64];
+    } else if (block.dindex < SPAMSUM_LENGTH && block.digest[block.dindex] != '\0') {
+        result += block.digest[block.dindex];
+    }
+    result += ':';
+
+    if (index + 1 < blockEnd_) {
+        const BlockHash& next = blocks_[index + 1];
+        result.append(next.digest, std::min(next.dindex, SPAMSUM_LENGTH / 2 - 1));
+        if (h != 0) {
+            result += BASE64[next.halfh % 64];
+        } else if (next.halfdigest != '\0') {
+            result += next.halfdigest;
+        }
+    } else if (h != 0) {
+        result += BASE64[block.h % 64];
+    }
+    return result;
+}
+
+int FuzzyHasher::Compare(const FuzzyDigest& first, const FuzzyDigest& second) {
+    const uint64_t size1 = first.blockSize;
+    const uint64_t size2 = second.blockSize;
+    if (size1 != size2 && size1 * 2 != size2 && size2 * 2 != size1) {
+        return 0;
+    }
+
+    if (size1 == size2 && first.part1 == second.part1 && first.part2 == second.part2) {
+        return 100;
+    }
+
+    if (size1 == size2) {
+        return std::max(ScoreStrings(first.part1, second.part1, size1),
+                        ScoreStrings(first.part2, second.part2, size1 * 2));
+    }
+    if (size1 * 2 == size2) {
+        return ScoreStrings(second.part1, first.part2, size2);
+    }
+    return ScoreStrings(first.part1, second.part2, size1);
+}
+
+int FuzzyHasher::Compare(const std::string& first, const std::string& second) {
+    auto parsedFirst = FuzzyDigest::Parse(first);
+    auto parsedSecond = FuzzyDigest::Parse(second);
+    if (!parsedFirst || !parsedSecond) {
+        return 0;
+    }
+    return Compare(*parsedFirst, *parsedSecond);
+}
+
+} // namespace Scanner
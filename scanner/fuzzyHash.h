@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace Scanner {
+
+// Parsed "blocksize:part1:part2" digest as printed by ssdeep
+struct FuzzyDigest {
+    uint32_t blockSize = 0;
+    std::string part1;  // Pieces of blockSize bytes, runs of more than three equal characters collapsed
+    std::string part2;  // Pieces of 2 * blockSize bytes, same collapsing
+
+    // Accepts an optional trailing ,"filename" as written by the ssdeep tool
+    static std::optional<FuzzyDigest> Parse(const std::string& text);
+};
+
+// Context-triggered piecewise hash, output compatible with ssdeep 2.x.
+// A rolling hash over a 7-byte window cuts the input into pieces wherever it
+// hits a block-size dependent value; each piece contributes one base64
+// character, so a local edit only changes the characters of nearby pieces.
+// All block sizes are tracked at once, so the digest needs a single pass.
+class FuzzyHasher {
+public:
+    static constexpr size_t SPAMSUM_LENGTH = 64;
+    static constexpr size_t ROLLING_WINDOW = 7;
+    static constexpr uint32_t MIN_BLOCKSIZE = 3;
+
+    FuzzyHasher();
+    // With the input length known up front, block sizes that cannot be
+    // selected are dropped early, which keeps fewer running sums per byte.
+    // The digest is the same either way, provided exactly totalSize bytes follow.
+    explicit FuzzyHasher(uint64_t totalSize);
+
+    void Update(const void* data, size_t size);
+    std::string Final() const;
+
+    // Similarity on ssdeep's 0-100 scale; 0 for malformed or incomparable digests
+    static int Compare(const FuzzyDigest& first, const FuzzyDigest& second);
+    static int Compare(const std::string& first, const std::string& second);
+
+private:
+    static constexpr size_t NUM_BLOCKHASHES = 31;
+
+    struct BlockHash {
+        uint32_t h;
+        uint32_t halfh;
+        char digest[SPAMSUM_LENGTH];
+        char halfdigest;
+        size_t dindex;
+    };
+
+    void Step(unsigned char c);
+    void TryFork();
+    void TryReduce();
+    uint32_t RollSum() const { return rollH1_ + rollH2_ + rollH3_; }
+
+    std::array<BlockHash, NUM_BLOCKHASHES> blocks_;
+    size_t blockStart_ = 0;
+    size_t blockEnd_ = 1;
+    uint64_t totalSize_ = 0;
+    uint64_t fixedSize_ = 0;  // 0 when the length is not known in advance
+    size_t blockEndLimit_ = NUM_BLOCKHASHES;
+
+    unsigned char window_[ROLLING_WINDOW] = {};
+    uint32_t rollH1_ = 0;
+    uint32_t rollH2_ = 0;
+    uint32_t rollH3_ = 0;
+    uint32_t rollN_ = 0;
+};
+
+} // namespace Scanner
@@ -0,0 +1,117 @@
+#include "fuzzyIndex.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace Scanner {
+
+namespace {
+
+constexpr size_t BUCKET_OCCUPANCY = 4;  // Average postings per directory bucket
+
+uint64_t Mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDull;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+void AppendPartKeys(uint64_t blockSize, const std::string& part, std::vector<uint64_t>& keys) {
+    for (size_t i = 0; i + FuzzyHasher::ROLLING_WINDOW <= part.size(); ++i) {
+        uint64_t hash = 0xCBF29CE484222325ull ^ blockSize;
+        for (size_t j = 0; j < FuzzyHasher::ROLLING_WINDOW; ++j) {
+            hash = (hash ^ static_cast<unsigned char>(part[i + j])) * 0x100000001B3ull;
+        }
+        keys.push_back(Mix(hash));
+    }
+}
+
+} // namespace
+
+// part1 is written at the digest's block size and part2 at twice that, which
+// is exactly the pairing ssdeep uses between neighbouring block sizes. One more
+// key covers the whole digest, so identical digests too short to have a 7-gram
+// (small files) are still found.
+void FuzzyIndex::GramKeys(const FuzzyDigest& digest, std::vector<uint64_t>& keys) {
+    keys.clear();
+    AppendPartKeys(digest.blockSize, digest.part1, keys);
+    AppendPartKeys(static_cast<uint64_t>(digest.blockSize) * 2, digest.part2, keys);
+
+    uint64_t whole = 0x84222325CBF29CE4ull ^ digest.blockSize;
+    for (char c : digest.part1 + ':' + digest.part2) {
+        whole = (whole ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+    }
+    keys.push_back(Mix(whole));
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+void FuzzyIndex::Build(std::vector<Entry> entries) {
+    entries_ = std::move(entries);
+
+    std::vector<std::pair<uint64_t, uint32_t>> postings;
+    std::vector<uint64_t> keys;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        GramKeys(entries_[i].digest, keys);
+        for (uint64_t key : keys) {
+            postings.emplace_back(key, static_cast<uint32_t>(i));
+        }
+    }
+    std::sort(postings.begin(), postings.end());
+
+    unsigned bits = 1;
+    while ((size_t{1} << bits) * BUCKET_OCCUPANCY < postings.size() && bits < 32) {
+        ++bits;
+    }
+    shift_ = 64 - bits;
+
+    directory_.assign((size_t{1} << bits) + 1, 0);
+    fingerprints_.resize(postings.size());
+    refs_.resize(postings.size());
+    for (size_t i = 0; i < postings.size(); ++i) {
+        ++directory_[(postings[i].first >> shift_) + 1];
+        fingerprints_[i] = static_cast<uint32_t>(postings[i].first);
+        refs_[i] = postings[i].second;
+    }
+    for (size_t i = 1; i < directory_.size(); ++i) {
+        directory_[i] += directory_[i - 1];
+    }
+}
+
+FuzzyIndex::Match FuzzyIndex::FindBest(const FuzzyDigest& digest, int threshold) const {
+    Match best;
+    if (entries_.empty()) {
+        return best;
+    }
+
+    // A query at block size b also meets digests at b / 2 and 2 * b, because
+    // their part2 / part1 lands on the same keys as its part1 / part2
+    std::vector<uint64_t> keys;
+    GramKeys(digest, keys);
+
+    std::vector<uint32_t> candidates;
+    for (uint64_t key : keys) {
+        const size_t bucket = key >> shift_;
+        const auto fingerprint = static_cast<uint32_t>(key);
+        for (uint32_t i = directory_[bucket]; i < directory_[bucket + 1]; ++i) {
+            if (fingerprints_[i] == fingerprint) {
+                candidates.push_back(refs_[i]);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for (uint32_t ref : candidates) {
+        const int score = FuzzyHasher::Compare(digest, entries_[ref].digest);
+        if (score >= threshold && score >= best.score && score > 0) {
+            best.id = entries_[ref].id;
+            best.score = score;
+        }
+    }
+    return best;
+}
+
+} // namespace Scanner
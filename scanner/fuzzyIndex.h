@@ -0,0 +1,45 @@
+#pragma once
+
+#include "fuzzyHash.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Scanner {
+
+// Similarity search over ssdeep digests, frozen after Build().
+// ssdeep scores two parts only when they share a 7-character substring at the
+// same block size, so every digest is indexed under each such substring (keyed
+// together with its block size) and a query scores just the digests it shares
+// one with, instead of comparing against the whole base.
+class FuzzyIndex {
+public:
+    struct Entry {
+        FuzzyDigest digest;
+        uint32_t id;
+    };
+
+    struct Match {
+        uint32_t id = 0;  // 0 when nothing reaches the threshold
+        int score = 0;
+    };
+
+    void Build(std::vector<Entry> entries);
+    // Highest scoring entry with score >= threshold; ties go to the later entry
+    Match FindBest(const FuzzyDigest& digest, int threshold) const;
+    size_t Size() const { return entries_.size(); }
+    bool Empty() const { return entries_.empty(); }
+
+private:
+    static void GramKeys(const FuzzyDigest& digest, std::vector<uint64_t>& keys);
+
+    std::vector<Entry> entries_;
+    // Postings sorted by key; the top bits of a key select a directory bucket,
+    // the low 32 bits are kept to tell keys of the same bucket apart
+    std::vector<uint32_t> directory_;
+    std::vector<uint32_t> fingerprints_;
+    std::vector<uint32_t> refs_;
+    unsigned shift_ = 63;
+};
+
+} // namespace Scanner
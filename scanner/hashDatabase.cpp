@@ -1,66 +1,517 @@
 #include "hashDatabase.h"
+#include "hexCodec.h"
 #include "utils.h"
 #include "scannerConstants.h"
 #include <algorithm>
-#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
 
 namespace Scanner {
 
+static_assert(DigestSize(HashAlgorithm::MD5) * 2 == Constants::MD5_HASH_LENGTH, "MD5 hex length");
+static_assert(DigestSize(HashAlgorithm::SHA1) * 2 == Constants::SHA1_HASH_LENGTH, "SHA-1 hex length");
+static_assert(DigestSize(HashAlgorithm::SHA256) * 2 == Constants::SHA256_HASH_LENGTH, "SHA-256 hex length");
+
+namespace {
+
+struct SignatureLine {
+    std::string hash;
+    std::string verdict;
+    std::string type;
+    std::string size;
+    std::string prefix;
+};
+
+bool ParseSize(const std::string& text, uint64_t& size) {
+    if (text.empty() || text.size() > 19) {
+        return false;
+    }
+    size = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        size = size * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return true;
+}
+
+// Splits "hash;verdict[;key=value...]". Trailing fields with a known key are
+// attributes; anything else stays part of the verdict, as it always has.
+bool ParseSignatureLine(const std::string& line, SignatureLine& signature) {
+    size_t delimPos = line.find(Constants::CSV_DELIMITER);
+    if (delimPos == std::string::npos) {
+        return false;
+    }
+
+    signature.hash = Utils::Trim(line.substr(0, delimPos));
+    std::string rest = line.substr(delimPos + 1);
+
+    size_t fieldPos;
+    while ((fieldPos = rest.rfind(Constants::CSV_DELIMITER)) != std::string::npos) {
+        std::string field = Utils::Trim(rest.substr(fieldPos + 1));
+        size_t eqPos = field.find('=');
+        if (eqPos == std::string::npos) {
+            break;
+        }
+
+        std::string key = field.substr(0, eqPos);
+        if (key == "type") {
+            signature.type = field.substr(eqPos + 1);
+        } else if (key == "size") {
+            signature.size = field.substr(eqPos + 1);
+        } else if (key == "prefix") {
+            signature.prefix = field.substr(eqPos + 1);
+        } else {
+            break;
+        }
+        rest.erase(fieldPos);
+    }
+
+    signature.verdict = Utils::Trim(rest);
+    return true;
+}
+
+} // namespace
+
 bool HashDatabase::LoadFromCSV(const std::string& filepath) {
     std::ifstream file(filepath);
     if (!file.is_open()) {
         return false;
     }
-    
+
+    Clear();
+    if (!ReadSignatures(file, nullptr, nullptr)) {
+        Clear();
+        return false;  // Database too large
+    }
+    return GetSize() != 0;
+}
+
+bool HashDatabase::ReadSignatures(std::istream& input, SignatureIndex::Builder* builder, std::string* memoryLines) {
     std::string line;
-    database_.clear();
+    std::vector<DigestTable<DigestSize(HashAlgorithm::MD5)>::Entry> md5Entries;
+    std::vector<DigestTable<DigestSize(HashAlgorithm::SHA1)>::Entry> sha1Entries;
+    std::vector<DigestTable<DigestSize(HashAlgorithm::SHA256)>::Entry> sha256Entries;
+    std::vector<DigestTable<DigestSize(HashAlgorithm::TREE)>::Entry> treeEntries;
+    std::vector<FuzzyIndex::Entry> fuzzyEntries;
+    std::vector<ContentMatcher::Pattern> contentPatterns;
+    std::unordered_map<std::string, uint32_t> verdictIds;
+    for (size_t i = 0; i < verdicts_.size(); ++i) {
+        verdictIds.emplace(verdicts_[i], static_cast<uint32_t>(i + 1));
+    }
+
+    // Verdicts repeat heavily across a feed, store each one once
+    auto internVerdict = [&](const std::string& verdict) {
+        auto inserted = verdictIds.emplace(verdict, static_cast<uint32_t>(verdicts_.size() + 1));
+        if (inserted.second) {
+            verdicts_.push_back(verdict);
+        }
+        return inserted.first->second;
+    };
     size_t lineCount = 0;
-    
-    while (std::getline(file, line)) {
+
+    while (std::getline(input, line)) {
         if (line.empty()) {
             continue;
         }
-        
-        // Check database size limit
-        if (++lineCount > Constants::MAX_DATABASE_ENTRIES) {
-            return false;  // Database too large
+
+        // Check database size limit; an index holds exact digests on disk
+        if (builder == nullptr && ++lineCount > Constants::MAX_DATABASE_ENTRIES) {
+            return false;
         }
-        
-        size_t delimPos = line.find(Constants::CSV_DELIMITER);
-        if (delimPos == std::string::npos) {
+
+        SignatureLine signature;
+        if (!ParseSignatureLine(line, signature)) {
             continue;  // Skip malformed lines
         }
-        
-        std::string hash = Utils::ToLower(Utils::Trim(line.substr(0, delimPos)));
-        std::string verdict = Utils::Trim(line.substr(delimPos + 1));
-        
-        // Validate hash format (MD5 should be 32 hex characters)
-        if (hash.length() != Constants::MD5_HASH_LENGTH) {
-            continue;  // Skip invalid hash
+
+        if (signature.verdict.empty()) {
+            continue;
+        }
+
+        // Byte signatures can occur in a file of any size
+        if (signature.type == "content") {
+            if (builder != nullptr) {
+                *memoryLines += line + '\n';
+                continue;
+            }
+            ContentMatcher::Pattern pattern;
+            if (!ParseContent(signature.hash, pattern.bytes) || !signature.size.empty() ||
+                !signature.prefix.empty()) {
+                continue;
+            }
+            ++unsizedSignatures_;
+            pattern.id = internVerdict(signature.verdict);
+            contentPatterns.push_back(std::move(pattern));
+            continue;
+        }
+
+        std::optional<HashAlgorithm> declared;
+        if (!signature.type.empty()) {
+            declared = AlgorithmFromName(signature.type);
+            if (!declared) {
+                continue;  // Unknown type
+            }
+        }
+
+        // Validate hash format (32, 40 or 64 hex characters, or an ssdeep digest)
+        DigestKey parsed;
+        std::optional<FuzzyDigest> fuzzy;
+        if (!ParseHash(signature.hash, parsed, declared && IsExactDigest(*declared) ? declared : std::nullopt)) {
+            fuzzy = FuzzyDigest::Parse(signature.hash);
+            if (!fuzzy) {
+                continue;  // Skip invalid hash
+            }
+            parsed.algorithm = HashAlgorithm::SSDEEP;
+        }
+
+        if (declared && *declared != parsed.algorithm) {
+            continue;  // Length does not match the declared type
+        }
+        if (fuzzy && builder != nullptr) {
+            *memoryLines += line + '\n';
+            continue;
+        }
+
+        // A prefix digest is only meaningful together with the sample size
+        uint64_t sampleSize = 0;
+        DigestKey prefix;
+        // Similar files differ in size, so similarity signatures never take the fast path
+        const bool hasSize = !signature.size.empty() && !fuzzy;
+        const bool hasPrefix = !signature.prefix.empty();
+        if ((hasSize && !ParseSize(signature.size, sampleSize)) ||
+            (hasPrefix && (!hasSize || !ParseHash(signature.prefix, prefix) ||
+                           prefix.algorithm != HashAlgorithm::MD5))) {
+            continue;
+        }
+
+        if (!hasSize) {
+            ++unsizedSignatures_;
+        } else if (!hasPrefix || builder != nullptr) {
+            fullHashSizes_.insert(sampleSize);
+        } else {
+            prefixSizes_.insert(sampleSize);
+            prefixKeys_.insert(PrefixKey(sampleSize, prefix.digest.data()));
         }
-        
-        if (!std::all_of(hash.begin(), hash.end(), [](unsigned char c) {
-            return std::isxdigit(c);
-        })) {
-            continue;  // Skip non-hex hash
+
+        const uint32_t id = internVerdict(signature.verdict);
+        if (builder != nullptr) {
+            builder->Add(parsed.algorithm, parsed.digest.data(), id);
+            continue;
+        }
+
+        auto append = [&](auto& entries) {
+            entries.emplace_back();
+            std::copy_n(parsed.digest.begin(), sizeof(entries.back().digest), entries.back().digest);
+            entries.back().id = id;
+        };
+        switch (parsed.algorithm) {
+            case HashAlgorithm::MD5: append(md5Entries); break;
+            case HashAlgorithm::SHA1: append(sha1Entries); break;
+            case HashAlgorithm::SHA256: append(sha256Entries); break;
+            case HashAlgorithm::SSDEEP: fuzzyEntries.push_back({std::move(*fuzzy), id}); break;
+            case HashAlgorithm::TREE: append(treeEntries); break;
+        }
+    }
+
+    md5_.Build(md5Entries);
+    sha1_.Build(sha1Entries);
+    sha256_.Build(sha256Entries);
+    tree_.Build(treeEntries);
+    fuzzy_.Build(std::move(fuzzyEntries));
+    content_.Build(contentPatterns);
+    return true;
+}
+
+namespace {
+
+// What an index records of the CSV it was built from
+bool SourceIdentity(const std::string& csvPath, uint64_t& size, int64_t& modified) {
+    std::error_code ec;
+    size = std::filesystem::file_size(csvPath, ec);
+    if (ec) {
+        return false;
+    }
+    const auto time = std::filesystem::last_write_time(csvPath, ec);
+    modified = static_cast<int64_t>(time.time_since_epoch().count());
+    return !ec;
+}
+
+} // namespace
+
+bool HashDatabase::BuildIndex(const std::string& csvPath, const std::string& indexPath, size_t memoryBudget) {
+    SignatureIndex::Metadata metadata;
+    std::ifstream file(csvPath);
+    if (!file.is_open() || !SourceIdentity(csvPath, metadata.sourceSize, metadata.sourceModified)) {
+        return false;
+    }
+
+    HashDatabase staging;
+    SignatureIndex::Builder builder(indexPath, memoryBudget);
+    staging.ReadSignatures(file, &builder, &metadata.memoryLines);
+    metadata.verdicts = std::move(staging.verdicts_);
+    metadata.fullHashSizes.assign(staging.fullHashSizes_.begin(), staging.fullHashSizes_.end());
+    std::sort(metadata.fullHashSizes.begin(), metadata.fullHashSizes.end());
+    metadata.unsizedSignatures = staging.unsizedSignatures_;
+    builder.Finish(metadata);
+    return true;
+}
+
+bool HashDatabase::LoadIndexed(const std::string& csvPath, const std::string& indexPath, size_t cacheSize) {
+    uint64_t sourceSize = 0;
+    int64_t sourceModified = 0;
+    if (!SourceIdentity(csvPath, sourceSize, sourceModified)) {
+        return false;
+    }
+
+    const size_t cachePages = cacheSize / Constants::INDEX_PAGE_SIZE;
+    auto index = SignatureIndex::Open(indexPath, cachePages);
+    if (!index || index->GetMetadata().sourceSize != sourceSize ||
+        index->GetMetadata().sourceModified != sourceModified) {
+        index.reset();
+        if (!BuildIndex(csvPath, indexPath)) {
+            return false;
         }
-        
-        if (!hash.empty() && !verdict.empty()) {
-            database_[hash] = verdict;
+        index = SignatureIndex::Open(indexPath, cachePages);
+        if (!index) {
+            return false;
         }
     }
-    
-    return !database_.empty();
+
+    Clear();
+    const SignatureIndex::Metadata& metadata = index->GetMetadata();
+    verdicts_ = metadata.verdicts;
+    fullHashSizes_.insert(metadata.fullHashSizes.begin(), metadata.fullHashSizes.end());
+    unsizedSignatures_ = static_cast<size_t>(metadata.unsizedSignatures);
+    std::istringstream memoryLines(metadata.memoryLines);
+    if (!ReadSignatures(memoryLines, nullptr, nullptr)) {
+        Clear();
+        return false;  // Too many ssdeep and byte signatures
+    }
+    index_ = std::move(index);
+    return GetSize() != 0;
 }
 
 bool HashDatabase::IsMalicious(const std::string& hash, std::string& verdict) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = database_.find(Utils::ToLower(hash));
-    if (it != database_.end()) {
-        verdict = it->second;
+    DigestKey parsed;
+    if (!ParseHash(hash, parsed)) {
+        return false;
+    }
+
+    uint32_t id = index_ ? index_->Find(parsed.algorithm, parsed.digest.data()) : Find(parsed, HomeSlot(parsed));
+    if (id != 0) {
+        verdict = verdicts_[id - 1];
         return true;
     }
     return false;
 }
 
-} // namespace Scanner
\ No newline at end of file
+template <typename KeyAt>
+size_t HashDatabase::LookupBatch(size_t count, std::vector<std::string>& verdicts, KeyAt keyAt) const {
+    verdicts.assign(count, std::string());
+
+    if (index_) {
+        // The whole batch at once, so that digests in the same page share its read
+        thread_local std::vector<DigestKey> indexKeys;
+        thread_local std::vector<SignatureIndex::Lookup> lookups;
+        thread_local std::vector<size_t> positions;
+        indexKeys.resize(count);
+        lookups.clear();
+        positions.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (keyAt(i, indexKeys[i])) {
+                lookups.push_back({indexKeys[i].algorithm, indexKeys[i].digest.data(), 0});
+                positions.push_back(i);
+            }
+        }
+        index_->FindBatch(lookups);
+        size_t found = 0;
+        for (size_t i = 0; i < lookups.size(); ++i) {
+            if (lookups[i].id != 0) {
+                verdicts[positions[i]] = verdicts_[lookups[i].id - 1];
+                ++found;
+            }
+        }
+        return found;
+    }
+
+    std::array<DigestKey, Constants::LOOKUP_BATCH_SIZE> keys;
+    std::array<size_t, Constants::LOOKUP_BATCH_SIZE> homes;
+    std::array<bool, Constants::LOOKUP_BATCH_SIZE> valid;
+    size_t found = 0;
+
+    for (size_t base = 0; base < count; base += Constants::LOOKUP_BATCH_SIZE) {
+        const size_t group = std::min(Constants::LOOKUP_BATCH_SIZE, count - base);
+
+        // Stage 1: compute every home slot and start its cache line loading
+        for (size_t i = 0; i < group; ++i) {
+            valid[i] = keyAt(base + i, keys[i]);
+            if (valid[i]) {
+                homes[i] = HomeSlot(keys[i]);
+                Prefetch(keys[i], homes[i]);
+            }
+        }
+
+        // Stage 2: the lines are in flight (or already cached), compare keys
+        for (size_t i = 0; i < group; ++i) {
+            if (!valid[i]) {
+                continue;
+            }
+            if (uint32_t id = Find(keys[i], homes[i])) {
+                verdicts[base + i] = verdicts_[id - 1];
+                ++found;
+            }
+        }
+    }
+
+    return found;
+}
+
+size_t HashDatabase::IsMaliciousBatch(const std::vector<std::string>& hashes,
+                                      std::vector<std::string>& verdicts,
+                                      const std::vector<HashAlgorithm>& algorithms) const {
+    return LookupBatch(hashes.size(), verdicts, [&](size_t i, DigestKey& key) {
+        return algorithms.empty() ? ParseHash(hashes[i], key) : ParseHash(hashes[i], key, algorithms[i]);
+    });
+}
+
+size_t HashDatabase::IsMaliciousBatch(const std::vector<DigestKey>& keys, std::vector<std::string>& verdicts) const {
+    return LookupBatch(keys.size(), verdicts, [&](size_t i, DigestKey& key) {
+        key = keys[i];
+        return IsExactDigest(key.algorithm);
+    });
+}
+
+bool HashDatabase::FindSimilar(const std::string& fuzzyDigest, int threshold,
+                               std::string& verdict, int& score) const {
+    auto digest = FuzzyDigest::Parse(fuzzyDigest);
+    if (!digest) {
+        return false;
+    }
+
+    auto match = fuzzy_.FindBest(*digest, threshold);
+    if (match.id == 0) {
+        return false;
+    }
+    verdict = verdicts_[match.id - 1];
+    score = match.score;
+    return true;
+}
+
+void HashDatabase::ScanContent(ContentMatcher::State& state, const unsigned char* data, size_t size) const {
+    content_.Scan(state, data, size);
+}
+
+bool HashDatabase::ContentVerdict(const ContentMatcher::State& state, std::string& verdict) const {
+    if (state.match == 0) {
+        return false;
+    }
+    verdict = verdicts_[state.match - 1];
+    return true;
+}
+
+size_t HashDatabase::GetSize() const {
+    return md5_.Size() + sha1_.Size() + sha256_.Size() + tree_.Size() + fuzzy_.Size() + content_.Size() +
+           (index_ ? static_cast<size_t>(index_->Size()) : 0);
+}
+
+HashAlgorithmMask HashDatabase::GetRequiredAlgorithms() const {
+    HashAlgorithmMask mask = index_ ? index_->Algorithms() : 0;
+    if (!md5_.Empty()) mask |= MaskOf(HashAlgorithm::MD5);
+    if (!sha1_.Empty()) mask |= MaskOf(HashAlgorithm::SHA1);
+    if (!sha256_.Empty()) mask |= MaskOf(HashAlgorithm::SHA256);
+    if (!fuzzy_.Empty()) mask |= MaskOf(HashAlgorithm::SSDEEP);
+    if (!tree_.Empty()) mask |= MaskOf(HashAlgorithm::TREE);
+    return mask;
+}
+
+HashDatabase::SizeCheck HashDatabase::CheckSize(uint64_t fileSize) const {
+    if (unsizedSignatures_ != 0 || fullHashSizes_.count(fileSize) != 0) {
+        return SizeCheck::FullHash;
+    }
+    return prefixSizes_.count(fileSize) != 0 ? SizeCheck::CheckPrefix : SizeCheck::Clean;
+}
+
+bool HashDatabase::MatchesPrefix(uint64_t fileSize, const unsigned char* prefixMd5) const {
+    return prefixKeys_.count(PrefixKey(fileSize, prefixMd5)) != 0;
+}
+
+bool HashDatabase::ParseHash(const std::string& hex, DigestKey& parsed, std::optional<HashAlgorithm> algorithm) {
+    if (!algorithm) {
+        algorithm = AlgorithmFromHexLength(hex.length());
+    }
+    if (!algorithm || !IsExactDigest(*algorithm) || hex.length() != DigestSize(*algorithm) * 2) {
+        return false;
+    }
+    parsed.algorithm = *algorithm;
+    return Hex::Decode(hex.data(), DigestSize(*algorithm), parsed.digest.data());
+}
+
+bool HashDatabase::ParseContent(const std::string& hex, std::string& bytes) {
+    if (hex.size() % 2 != 0 || hex.size() / 2 < ContentMatcher::MIN_PATTERN_SIZE ||
+        hex.size() / 2 > Constants::MAX_CONTENT_PATTERN_SIZE) {
+        return false;
+    }
+
+    bytes.resize(hex.size() / 2);
+    return Hex::Decode(hex.data(), bytes.size(), reinterpret_cast<unsigned char*>(&bytes[0]));
+}
+
+size_t HashDatabase::HomeSlot(const DigestKey& hash) const {
+    switch (hash.algorithm) {
+        case HashAlgorithm::MD5: return md5_.Empty() ? 0 : md5_.HomeSlot(hash.digest.data());
+        case HashAlgorithm::SHA1: return sha1_.Empty() ? 0 : sha1_.HomeSlot(hash.digest.data());
+        case HashAlgorithm::SHA256: return sha256_.Empty() ? 0 : sha256_.HomeSlot(hash.digest.data());
+        case HashAlgorithm::TREE: return tree_.Empty() ? 0 : tree_.HomeSlot(hash.digest.data());
+        case HashAlgorithm::SSDEEP: break;
+    }
+    return 0;
+}
+
+void HashDatabase::Prefetch(const DigestKey& hash, size_t slot) const {
+    switch (hash.algorithm) {
+        case HashAlgorithm::MD5: if (!md5_.Empty()) md5_.Prefetch(slot); break;
+        case HashAlgorithm::SHA1: if (!sha1_.Empty()) sha1_.Prefetch(slot); break;
+        case HashAlgorithm::SHA256: if (!sha256_.Empty()) sha256_.Prefetch(slot); break;
+        case HashAlgorithm::TREE: if (!tree_.Empty()) tree_.Prefetch(slot); break;
+        case HashAlgorithm::SSDEEP: break;
+    }
+}
+
+uint32_t HashDatabase::Find(const DigestKey& hash, size_t slot) const {
+    switch (hash.algorithm) {
+        case HashAlgorithm::MD5: return md5_.Empty() ? 0 : md5_.Find(hash.digest.data(), slot);
+        case HashAlgorithm::SHA1: return sha1_.Empty() ? 0 : sha1_.Find(hash.digest.data(), slot);
+        case HashAlgorithm::SHA256: return sha256_.Empty() ? 0 : sha256_.Find(hash.digest.data(), slot);
+        case HashAlgorithm::TREE: return tree_.Empty() ? 0 : tree_.Find(hash.digest.data(), slot);
+        case HashAlgorithm::SSDEEP: break;
+    }
+    return 0;
+}
+
+uint64_t HashDatabase::PrefixKey(uint64_t fileSize, const unsigned char* prefixMd5) {
+    uint64_t key;
+    std::memcpy(&key, prefixMd5, sizeof(key));
+    return key ^ (fileSize * 0x9E3779B97F4A7C15ull);
+}
+
+void HashDatabase::Clear() {
+    md5_.Build({});
+    sha1_.Build({});
+    sha256_.Build({});
+    tree_.Build({});
+    fuzzy_.Build({});
+    content_.Build({});
+    index_.reset();
+    verdicts_.clear();
+    unsizedSignatures_ = 0;
+    fullHashSizes_.clear();
+    prefixSizes_.clear();
+    prefixKeys_.clear();
+}
+
+} // namespace Scanner
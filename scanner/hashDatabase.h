@@ -1,22 +1,121 @@
 #pragma once
 
-#include <unordered_map>
+#include "contentMatcher.h"
+#include "digestTable.h"
+#include "fuzzyIndex.h"
+#include "hashTypes.h"
+#include "scannerConstants.h"
+#include "signatureIndex.h"
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <optional>
 #include <string>
-#include <mutex>
-#include <fstream>
-#include <sstream>
+#include <unordered_set>
+#include <vector>
 
 namespace Scanner {
 
+// Signature tables frozen after LoadFromCSV(): one open-addressing table per
+// digest type, so concurrent lookups need no lock and a probe is one cache line.
+//
+// CSV line format: hash;verdict[;type=md5|sha1|sha256|ssdeep|tree|content][;size=N][;prefix=MD5]
+// Without a type column the algorithm is inferred from the hash: 32/40/64 hex
+// characters, or "blocksize:part1:part2" for an ssdeep similarity digest.
+// type=tree marks a 64-character TreeHasher root, which looks like a SHA-256.
+// type=content makes the first column a hex byte string that is searched for
+// anywhere in a file (MIN_PATTERN_SIZE to MAX_CONTENT_PATTERN_SIZE bytes).
+// size= is the sample length in bytes, prefix= the MD5 of its first
+// PREFIX_HASH_SIZE bytes; when every signature carries them, most files can
+// be ruled out from a stat or a single small read.
+//
+// LoadIndexed() keeps the exact digests in an on-disk SignatureIndex instead,
+// for bases larger than memory; ssdeep and byte signatures stay in memory.
 class HashDatabase {
 public:
+    enum class SizeCheck {
+        Clean,         // No signature has this size, the file need not be read
+        CheckPrefix,   // Only signatures with a prefix digest have this size
+        FullHash,      // Some signature of this size (or of unknown size) needs the full digest
+    };
+
+    // An exact digest in binary form
+    struct DigestKey {
+        HashAlgorithm algorithm;
+        std::array<unsigned char, MAX_DIGEST_SIZE> digest;
+    };
+
     bool LoadFromCSV(const std::string& filepath);
+    // Opens the index at indexPath, first building it from the CSV when it
+    // is missing or was built from another version of the file. Prefix
+    // digests are not kept in the index: a sized signature always takes the
+    // full hash of files of its size. Throws when the index cannot be written.
+    bool LoadIndexed(const std::string& csvPath, const std::string& indexPath,
+                     size_t cacheSize = Constants::DEFAULT_INDEX_CACHE_SIZE);
+    // Writes the index of a CSV base, sorting at most memoryBudget bytes of digests in memory at once
+    static bool BuildIndex(const std::string& csvPath, const std::string& indexPath,
+                           size_t memoryBudget = Constants::INDEX_BUILD_MEMORY);
+    bool IsIndexed() const { return index_ != nullptr; }
     bool IsMalicious(const std::string& hash, std::string& verdict) const;
-    size_t GetSize() const { return database_.size(); }
+    // Resolves a group of digests: all home slots are prefetched before any key
+    // is compared, so the memory misses of the group overlap.
+    // verdicts[i] is left empty for clean (or malformed) hashes.
+    // algorithms, if not empty, gives the digest type of each hash; otherwise
+    // it is inferred from the length, which never yields TREE.
+    // Returns the number of malicious hashes.
+    size_t IsMaliciousBatch(const std::vector<std::string>& hashes,
+                            std::vector<std::string>& verdicts,
+                            const std::vector<HashAlgorithm>& algorithms = {}) const;
+    // Same for binary digests: nothing is parsed, and with verdicts reused
+    // between calls only matches allocate
+    size_t IsMaliciousBatch(const std::vector<DigestKey>& keys, std::vector<std::string>& verdicts) const;
+    // Best ssdeep signature scoring at least threshold against a file's digest
+    bool FindSimilar(const std::string& fuzzyDigest, int threshold,
+                     std::string& verdict, int& score) const;
+    bool HasContentSignatures() const { return !content_.Empty(); }
+    // Feed a file's buffers in order, then ask for the verdict
+    void ScanContent(ContentMatcher::State& state, const unsigned char* data, size_t size) const;
+    bool ContentVerdict(const ContentMatcher::State& state, std::string& verdict) const;
+    size_t GetSize() const;
+    // Digest types present in the loaded base; files need no other hashes
+    HashAlgorithmMask GetRequiredAlgorithms() const;
+    SizeCheck CheckSize(uint64_t fileSize) const;
+    // prefixMd5 is the digest of the first min(fileSize, PREFIX_HASH_SIZE) bytes
+    bool MatchesPrefix(uint64_t fileSize, const unsigned char* prefixMd5) const;
+
+private:
+    // Adds the signatures of a CSV stream. With an index builder, exact
+    // digests go to it and the other lines are kept as text in memoryLines.
+    bool ReadSignatures(std::istream& input, SignatureIndex::Builder* builder, std::string* memoryLines);
+    static bool ParseHash(const std::string& hex, DigestKey& parsed,
+                          std::optional<HashAlgorithm> algorithm = std::nullopt);
+    static bool ParseContent(const std::string& hex, std::string& bytes);
+    size_t HomeSlot(const DigestKey& hash) const;
+    void Prefetch(const DigestKey& hash, size_t slot) const;
+    uint32_t Find(const DigestKey& hash, size_t slot) const;
+    static uint64_t PrefixKey(uint64_t fileSize, const unsigned char* prefixMd5);
+    // keyAt(i, key) fills the i-th key and returns false for one that cannot match
+    template <typename KeyAt>
+    size_t LookupBatch(size_t count, std::vector<std::string>& verdicts, KeyAt keyAt) const;
+    void Clear();
 
 private:
-    std::unordered_map<std::string, std::string> database_;
-    mutable std::mutex mutex_;
+    DigestTable<DigestSize(HashAlgorithm::MD5)> md5_;
+    DigestTable<DigestSize(HashAlgorithm::SHA1)> sha1_;
+    DigestTable<DigestSize(HashAlgorithm::SHA256)> sha256_;
+    DigestTable<DigestSize(HashAlgorithm::TREE)> tree_;
+    FuzzyIndex fuzzy_;
+    ContentMatcher content_;
+    // Shared by copies of the database, with its page cache
+    std::shared_ptr<const SignatureIndex> index_;
+    std::vector<std::string> verdicts_;
+    // Fast path data: a colliding PrefixKey only costs a full hash, never a miss
+    size_t unsizedSignatures_ = 0;
+    std::unordered_set<uint64_t> fullHashSizes_;
+    std::unordered_set<uint64_t> prefixSizes_;
+    std::unordered_set<uint64_t> prefixKeys_;
 };
 
-} // namespace Scanner
\ No newline at end of file
+} // namespace Scanner
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+namespace Scanner {
+
+enum class HashAlgorithm : unsigned {
+    MD5 = 0,
+    SHA1 = 1,
+    SHA256 = 2,
+    SSDEEP = 3,  // Similarity digest, matched by score rather than equality
+    TREE = 4,    // SHA-256 tree over 1 MB chunks (TreeHasher), only with an explicit type=tree
+};
+
+constexpr size_t HASH_ALGORITHM_COUNT = 5;
+
+// Set of algorithms, one bit per HashAlgorithm value
+using HashAlgorithmMask = unsigned;
+
+constexpr HashAlgorithmMask MaskOf(HashAlgorithm algorithm) {
+    return 1u << static_cast<unsigned>(algorithm);
+}
+
+constexpr size_t DigestSize(HashAlgorithm algorithm) {
+    switch (algorithm) {
+        case HashAlgorithm::MD5: return 16;
+        case HashAlgorithm::SHA1: return 20;
+        case HashAlgorithm::SHA256: return 32;
+        case HashAlgorithm::SSDEEP: return 0;  // Variable-length text
+        case HashAlgorithm::TREE: return 32;
+    }
+    return 0;
+}
+
+// Digests that are looked up by equality in the exact signature tables
+constexpr bool IsExactDigest(HashAlgorithm algorithm) {
+    return DigestSize(algorithm) != 0;
+}
+
+constexpr size_t MAX_DIGEST_SIZE = 32;
+
+inline const char* AlgorithmName(HashAlgorithm algorithm) {
+    switch (algorithm) {
+        case HashAlgorithm::MD5: return "md5";
+        case HashAlgorithm::SHA1: return "sha1";
+        case HashAlgorithm::SHA256: return "sha256";
+        case HashAlgorithm::SSDEEP: return "ssdeep";
+        case HashAlgorithm::TREE: return "tree";
+    }
+    return "unknown";
+}
+
+// Name as written in the database "type=" column, case-sensitive
+inline std::optional<HashAlgorithm> AlgorithmFromName(const std::string& name) {
+    for (size_t i = 0; i < HASH_ALGORITHM_COUNT; ++i) {
+        auto algorithm = static_cast<HashAlgorithm>(i);
+        if (name == AlgorithmName(algorithm)) {
+            return algorithm;
+        }
+    }
+    return std::nullopt;
+}
+
+// Algorithm implied by the length of a hex digest; 64 characters mean SHA-256,
+// never TREE, which has to be declared
+inline std::optional<HashAlgorithm> AlgorithmFromHexLength(size_t length) {
+    for (size_t i = 0; i < HASH_ALGORITHM_COUNT; ++i) {
+        auto algorithm = static_cast<HashAlgorithm>(i);
+        if (IsExactDigest(algorithm) && length == DigestSize(algorithm) * 2) {
+            return algorithm;
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace Scanner
@@ -0,0 +1,138 @@
+#include "hexCodec.h"
+#include "cpuFeatures.h"
+
+namespace Scanner {
+namespace Hex {
+
+namespace {
+
+constexpr char DIGITS[] = "0123456789abcdef";
+
+// Both characters of every byte, so encoding is one load per byte
+struct PairTable {
+    char pairs[512] = {};
+};
+
+constexpr PairTable MakePairTable() {
+    PairTable table;
+    for (int byte = 0; byte < 256; ++byte) {
+        table.pairs[2 * byte] = DIGITS[byte >> 4];
+        table.pairs[2 * byte + 1] = DIGITS[byte & 0x0F];
+    }
+    return table;
+}
+
+// Nibble of every character, -1 for non-hex ones
+struct ValueTable {
+    signed char values[256] = {};
+};
+
+constexpr ValueTable MakeValueTable() {
+    ValueTable table;
+    for (int c = 0; c < 256; ++c) {
+        table.values[c] = -1;
+    }
+    for (int c = 0; c < 10; ++c) {
+        table.values['0' + c] = static_cast<signed char>(c);
+    }
+    for (int c = 0; c < 6; ++c) {
+        table.values['a' + c] = static_cast<signed char>(10 + c);
+        table.values['A' + c] = static_cast<signed char>(10 + c);
+    }
+    return table;
+}
+
+constexpr PairTable PAIRS = MakePairTable();
+constexpr ValueTable VALUES = MakeValueTable();
+
+static_assert(PAIRS.pairs[2 * 0xA7] == 'a' && PAIRS.pairs[2 * 0xA7 + 1] == '7', "Pair table");
+static_assert(VALUES.values['F'] == 15 && VALUES.values['g'] == -1, "Value table");
+
+#if defined(SCANNER_X86)
+// 16 bytes to 32 characters: each nibble indexes the digit string
+SCANNER_TARGET("ssse3")
+void Encode16(const unsigned char* data, char* out) {
+    const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(DIGITS));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    const __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+    const __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, nibble));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(high, low));
+}
+
+// 16 characters to 8 bytes; false unless all of them are hex digits
+SCANNER_TARGET("ssse3")
+bool Decode8(const char* hex, unsigned char* out) {
+    const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex));
+    // Unsigned "at most" through min: a wrapped subtraction lands far above the bound
+    const __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    const __m128i letter = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+    if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xFFFF) {
+        return false;
+    }
+    const __m128i values = _mm_or_si128(_mm_and_si128(isDigit, digit),
+                                        _mm_and_si128(isLetter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+    // Each pair becomes high * 16 + low in a 16-bit lane, then one byte
+    const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi16(0x0110));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(pairs, pairs));
+    return true;
+}
+#endif
+
+const bool SIMD_HEX =
+#if defined(SCANNER_X86)
+    GetCpuFeatures().ssse3;
+#else
+    false;
+#endif
+
+} // namespace
+
+void Encode(const unsigned char* data, size_t size, char* out) {
+    size_t i = 0;
+#if defined(SCANNER_X86)
+    if (SIMD_HEX) {
+        for (; i + 16 <= size; i += 16) {
+            Encode16(data + i, out + 2 * i);
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        out[2 * i] = PAIRS.pairs[2 * data[i]];
+        out[2 * i + 1] = PAIRS.pairs[2 * data[i] + 1];
+    }
+}
+
+std::string Encode(const unsigned char* data, size_t size) {
+    std::string hex(2 * size, '\0');
+    Encode(data, size, &hex[0]);
+    return hex;
+}
+
+bool Decode(const char* hex, size_t size, unsigned char* out) {
+    size_t i = 0;
+#if defined(SCANNER_X86)
+    if (SIMD_HEX) {
+        for (; i + 8 <= size; i += 8) {
+            if (!Decode8(hex + 2 * i, out + i)) {
+                return false;
+            }
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        const int high = VALUES.values[static_cast<unsigned char>(hex[2 * i])];
+        const int low = VALUES.values[static_cast<unsigned char>(hex[2 * i + 1])];
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        out[i] = static_cast<unsigned char>((high << 4) | low);
+    }
+    return true;
+}
+
+} // namespace Hex
+} // namespace Scanner
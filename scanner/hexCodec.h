@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Scanner {
+namespace Hex {
+
+// Lowercase hex of size bytes into out[0, 2 * size), no terminator. Lookup
+// tables are built at compile time; with SSSE3, 16 bytes take one shuffle.
+void Encode(const unsigned char* data, size_t size, char* out);
+std::string Encode(const unsigned char* data, size_t size);
+
+// size bytes from hex[0, 2 * size), either case; false on any other character
+bool Decode(const char* hex, size_t size, unsigned char* out);
+
+} // namespace Hex
+} // namespace Scanner
@@ -0,0 +1,224 @@
+#include "ioRing.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Scanner {
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(IORING_FEAT_SINGLE_MMAP)
+
+struct IoRing::Impl {
+    int fd = -1;
+    void* rings = MAP_FAILED;
+    size_t ringsSize = 0;
+    void* entries = MAP_FAILED;
+    size_t entriesSize = 0;
+
+    // Submission queue; the kernel moves the head, this process the tail
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned prepared = 0;   // Tail including requests not yet handed to the kernel
+    unsigned submitted = 0;  // Tail the kernel has been told about
+
+    // Completion queue; the kernel moves the tail, this process the head
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned cqMask = 0;
+
+    ~Impl() {
+        if (entries != MAP_FAILED) {
+            munmap(entries, entriesSize);
+        }
+        if (rings != MAP_FAILED) {
+            munmap(rings, ringsSize);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    io_uring_sqe* Claim(uint64_t tag) {
+        if (prepared - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+            return nullptr;
+        }
+        const unsigned index = prepared & sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = tag;
+        sqArray[index] = index;
+        ++prepared;
+        return sqe;
+    }
+};
+
+namespace {
+
+bool Supports(int fd, std::initializer_list<unsigned> operations) {
+    constexpr unsigned OPERATIONS = 256;
+    std::vector<unsigned char> buffer(sizeof(io_uring_probe) + OPERATIONS * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, OPERATIONS) < 0) {
+        return false;
+    }
+    for (unsigned operation : operations) {
+        if (operation > probe->last_op || !(probe->ops[operation].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::unique_ptr<IoRing> IoRing::Create(unsigned entries) {
+    auto impl = std::make_unique<Impl>();
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    impl->fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    // Kernels before 5.6 have no openat and close on the ring and need two mappings
+    if (impl->fd < 0 || !(params.features & IORING_FEAT_SINGLE_MMAP) ||
+        !Supports(impl->fd, {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE})) {
+        return nullptr;
+    }
+
+    impl->ringsSize = std::max<size_t>(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                       params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    impl->rings = mmap(nullptr, impl->ringsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, impl->fd,
+                       IORING_OFF_SQ_RING);
+    impl->entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+    impl->entries = mmap(nullptr, impl->entriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, impl->fd,
+                         IORING_OFF_SQES);
+    if (impl->rings == MAP_FAILED || impl->entries == MAP_FAILED) {
+        return nullptr;
+    }
+
+    auto* base = static_cast<unsigned char*>(impl->rings);
+    impl->sqHead = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    impl->sqTail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    impl->sqArray = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    impl->sqMask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    impl->sqEntries = params.sq_entries;
+    impl->sqes = static_cast<io_uring_sqe*>(impl->entries);
+    impl->prepared = impl->submitted = *impl->sqTail;
+    impl->cqHead = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    impl->cqTail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    impl->cqMask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    impl->cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+    return std::unique_ptr<IoRing>(new IoRing(std::move(impl)));
+}
+
+bool IoRing::PrepareOpen(const char* path, int flags, uint64_t tag) {
+    io_uring_sqe* sqe = impl_->Claim(tag);
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = reinterpret_cast<uintptr_t>(path);
+    sqe->open_flags = static_cast<uint32_t>(flags);
+    return true;
+}
+
+bool IoRing::PrepareRead(int fd, void* buffer, unsigned size, uint64_t offset, uint64_t tag) {
+    io_uring_sqe* sqe = impl_->Claim(tag);
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uintptr_t>(buffer);
+    sqe->len = size;
+    sqe->off = offset;
+    return true;
+}
+
+bool IoRing::PrepareClose(int fd, uint64_t tag) {
+    io_uring_sqe* sqe = impl_->Claim(tag);
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    return true;
+}
+
+void IoRing::SubmitAndWait() {
+    __atomic_store_n(impl_->sqTail, impl_->prepared, __ATOMIC_RELEASE);
+    while (true) {
+        const unsigned pending = impl_->prepared - impl_->submitted;
+        const long result = syscall(__NR_io_uring_enter, impl_->fd, pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (result >= 0) {
+            impl_->submitted += static_cast<unsigned>(result);
+            return;
+        }
+        if (errno != EINTR) {
+            throw std::runtime_error(std::string("io_uring submission failed: ") + std::strerror(errno));
+        }
+    }
+}
+
+bool IoRing::Next(Completion& completion) {
+    const unsigned head = *impl_->cqHead;
+    if (head == __atomic_load_n(impl_->cqTail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    const io_uring_cqe& cqe = impl_->cqes[head & impl_->cqMask];
+    completion.tag = cqe.user_data;
+    completion.result = cqe.res;
+    __atomic_store_n(impl_->cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+#else
+
+struct IoRing::Impl {};
+
+std::unique_ptr<IoRing> IoRing::Create(unsigned) {
+    return nullptr;
+}
+
+bool IoRing::PrepareOpen(const char*, int, uint64_t) {
+    return false;
+}
+
+bool IoRing::PrepareRead(int, void*, unsigned, uint64_t, uint64_t) {
+    return false;
+}
+
+bool IoRing::PrepareClose(int, uint64_t) {
+    return false;
+}
+
+void IoRing::SubmitAndWait() {
+    throw std::runtime_error("io_uring is not supported on this platform");
+}
+
+bool IoRing::Next(Completion&) {
+    return false;
+}
+
+#endif
+
+IoRing::IoRing(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+IoRing::~IoRing() = default;
+
+} // namespace Scanner
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Scanner {
+
+// An io_uring instance through its system calls (no liburing): a submission
+// and a completion queue shared with the kernel, for one thread. Requests
+// carry a caller's tag that comes back with their result.
+class IoRing {
+public:
+    struct Completion {
+        uint64_t tag;
+        int result;  // As the system call would return it, -errno on failure
+    };
+
+    // Nothing when the kernel has no io_uring, forbids it (seccomp,
+    // io_uring_disabled) or lacks openat, read or close on it
+    static std::unique_ptr<IoRing> Create(unsigned entries);
+    ~IoRing();
+
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+
+    // Queue a request; false when the submission queue is full. path and
+    // buffer must stay valid until the request completes.
+    bool PrepareOpen(const char* path, int flags, uint64_t tag);
+    bool PrepareRead(int fd, void* buffer, unsigned size, uint64_t offset, uint64_t tag);
+    bool PrepareClose(int fd, uint64_t tag);
+
+    // Submits the queued requests and waits until at least one completion is
+    // available; throws when the kernel refuses the submission
+    void SubmitAndWait();
+    // Takes one completion, if any has arrived
+    bool Next(Completion& completion);
+
+private:
+    struct Impl;
+    explicit IoRing(std::unique_ptr<Impl> impl);
+
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace Scanner
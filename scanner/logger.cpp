@@ -43,6 +43,9 @@ void Logger::LogMalware(const MalwareInfo& info) {
         log_file_ << "  Path: " << info.filePath << "\n";
         log_file_ << "  Hash: " << info.hash << "\n";
         log_file_ << "  Verdict: " << info.verdict << "\n";
+        if (info.similarity < 100) {
+            log_file_ << "  Similarity: " << info.similarity << "\n";
+        }
         log_file_ << "---\n";
     }
 }
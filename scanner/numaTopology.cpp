@@ -0,0 +1,99 @@
+#include "numaTopology.h"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Scanner {
+
+NumaTopology NumaTopology::Detect() {
+    NumaTopology topology;
+    std::vector<std::pair<int, std::vector<int>>> found;
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+        const std::string name = entry.path().filename().string();
+        int node = 0;
+        if (name.compare(0, 4, "node") != 0 ||
+            std::from_chars(name.data() + 4, name.data() + name.size(), node).ec != std::errc()) {
+            continue;
+        }
+        std::ifstream file(entry.path() / "cpulist");
+        std::string list;
+        std::getline(file, list);
+        auto cpus = ParseCpuList(list);
+        // Memory-only nodes (CXL, HBM) run no workers
+        if (!cpus.empty()) {
+            found.emplace_back(node, std::move(cpus));
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    for (auto& node : found) {
+        topology.nodes_.push_back(std::move(node.second));
+    }
+    if (topology.nodes_.empty()) {
+        topology.nodes_.emplace_back();
+    }
+    return topology;
+}
+
+std::vector<int> NumaTopology::ParseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t begin = 0;
+    while (begin < list.size()) {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+
+        const char* first = list.data() + begin;
+        const char* last = list.data() + end;
+        while (last > first && (last[-1] == '\n' || last[-1] == ' ')) {
+            --last;
+        }
+        int low = 0;
+        int high = 0;
+        auto parsed = std::from_chars(first, last, low);
+        if (parsed.ec == std::errc()) {
+            high = low;
+            if (parsed.ptr != last &&
+                (*parsed.ptr != '-' || std::from_chars(parsed.ptr + 1, last, high).ptr != last)) {
+                high = -1;
+            }
+            for (int cpu = low; cpu <= high; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        begin = end + 1;
+    }
+    return cpus;
+}
+
+bool NumaTopology::PinCurrentThread(size_t node) const {
+#if defined(__linux__)
+    if (node >= nodes_.size() || nodes_[node].empty()) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : nodes_[node]) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+} // namespace Scanner
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Scanner {
+
+// NUMA nodes with CPUs, as Linux lists them under /sys/devices/system/node.
+// Elsewhere, or when sysfs says nothing, there is one node and pinning to it
+// does nothing.
+class NumaTopology {
+public:
+    static NumaTopology Detect();
+    // A sysfs cpulist such as "0-3,8-11"; malformed parts are skipped
+    static std::vector<int> ParseCpuList(const std::string& list);
+
+    size_t NodeCount() const { return nodes_.size(); }
+    const std::vector<int>& CpusOf(size_t node) const { return nodes_[node]; }
+    // Restricts the calling thread to the CPUs of one node. Memory it touches
+    // first from then on is placed on that node by the kernel's default policy.
+    bool PinCurrentThread(size_t node) const;
+
+private:
+    std::vector<std::vector<int>> nodes_;
+};
+
+} // namespace Scanner
@@ -0,0 +1,310 @@
+#include "scanFilter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+#endif
+
+namespace Scanner {
+
+namespace {
+
+bool HasWildcards(std::string_view text) {
+    return text.find_first_of("*?[") != std::string_view::npos;
+}
+
+std::string_view BaseName(std::string_view path) {
+    const size_t slash = path.rfind('/');
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+bool ContainsName(const std::vector<std::string>& sorted, std::string_view name) {
+    auto it = std::lower_bound(sorted.begin(), sorted.end(), name,
+                               [](const std::string& a, std::string_view b) { return std::string_view(a) < b; });
+    return it != sorted.end() && *it == name;
+}
+
+std::optional<uint64_t> DeviceOf(const std::filesystem::path& path) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0) {
+        return static_cast<uint64_t>(info.st_dev);
+    }
+#else
+    (void)path;
+#endif
+    return std::nullopt;
+}
+
+// Compiles a bracket class at pattern[0] == '['; returns 0 when the bracket
+// is not closed and stands for itself
+size_t CompileClass(std::string_view pattern, std::bitset<256>& members) {
+    size_t i = 1;
+    const bool negated = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+    if (negated) {
+        ++i;
+    }
+    const size_t first = i;
+    for (; i < pattern.size() && (pattern[i] != ']' || i == first); ++i) {
+        if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+            for (int c = static_cast<unsigned char>(pattern[i]); c <= static_cast<unsigned char>(pattern[i + 2]); ++c) {
+                members.set(c);
+            }
+            i += 2;
+        } else {
+            members.set(static_cast<unsigned char>(pattern[i]));
+        }
+    }
+    if (i >= pattern.size()) {
+        return 0;
+    }
+    if (negated) {
+        members.flip();
+    }
+    return i + 1;
+}
+
+} // namespace
+
+ScanFilter::ScanFilter(const ScanSettings& settings) {
+    for (const auto& pattern : settings.includePatterns) {
+        include_.Add(pattern);
+    }
+    for (const auto& pattern : settings.excludePatterns) {
+        exclude_.Add(pattern);
+    }
+    for (const auto& extension : settings.extensions) {
+        std::string normalized = extension.empty() || extension[0] == '.' ? extension : "." + extension;
+        std::transform(normalized.begin(), normalized.end(), normalized.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        extensions_.push_back(std::move(normalized));
+    }
+    if (settings.modifiedSince != 0) {
+        // file_time_type has its own epoch before C++20: convert through the
+        // offset between the two clocks now
+        const auto since = std::chrono::system_clock::time_point(std::chrono::seconds(settings.modifiedSince));
+        modifiedSince_ = std::filesystem::file_time_type::clock::now() +
+                         std::chrono::duration_cast<std::filesystem::file_time_type::duration>(
+                             since - std::chrono::system_clock::now());
+    }
+    if (settings.sameFileSystem) {
+        rootDevice_ = DeviceOf(settings.rootPath);
+    }
+    active_ = !include_.Empty() || !exclude_.Empty() || !extensions_.empty();
+}
+
+void ScanFilter::Rules::Add(std::string pattern) {
+    const bool directory = pattern.size() > 1 && pattern.back() == '/';
+    if (directory) {
+        pattern.pop_back();
+    }
+    Pattern compiled;
+    compiled.baseName = pattern.find('/') == std::string::npos;
+    if (!compiled.baseName && pattern[0] == '/') {
+        pattern.erase(0, 1);
+    }
+
+    auto& names = directory ? directoryNames : this->names;
+    auto& patterns = directory ? directoryPatterns : this->patterns;
+    if (compiled.baseName && !HasWildcards(pattern)) {
+        names.insert(std::upper_bound(names.begin(), names.end(), pattern), pattern);
+        return;
+    }
+    if (compiled.baseName && pattern.size() > 1 && pattern[0] == '*' &&
+        !HasWildcards(std::string_view(pattern).substr(1))) {
+        compiled.suffix = pattern.substr(1);
+    } else {
+        compiled.glob.emplace(pattern);
+    }
+    patterns.push_back(std::move(compiled));
+}
+
+bool ScanFilter::Rules::Empty() const {
+    return names.empty() && patterns.empty() && directoryNames.empty() && directoryPatterns.empty();
+}
+
+bool ScanFilter::Rules::Matches(std::string_view relativePath, bool directory) const {
+    const std::string_view name = BaseName(relativePath);
+    auto matches = [&](const std::vector<std::string>& literal, const std::vector<Pattern>& globbed) {
+        if (!literal.empty() && ContainsName(literal, name)) {
+            return true;
+        }
+        for (const auto& pattern : globbed) {
+            const std::string_view subject = pattern.baseName ? name : relativePath;
+            if (pattern.glob ? pattern.glob->Matches(subject)
+                             : subject.size() >= pattern.suffix.size() &&
+                                   subject.compare(subject.size() - pattern.suffix.size(), pattern.suffix.size(),
+                                                   pattern.suffix) == 0) {
+                return true;
+            }
+        }
+        return false;
+    };
+    return matches(names, patterns) || (directory && matches(directoryNames, directoryPatterns));
+}
+
+bool ScanFilter::PrunesDirectory(const std::filesystem::directory_entry& entry, std::string_view relativePath) const {
+    if (active_ && exclude_.Matches(relativePath, true)) {
+        return true;
+    }
+    if (rootDevice_) {
+        const auto device = DeviceOf(entry.path());
+        return device && *device != *rootDevice_;
+    }
+    return false;
+}
+
+bool ScanFilter::AcceptsFile(std::string_view relativePath) const {
+    if (!active_) {
+        return true;
+    }
+    if (!extensions_.empty()) {
+        const std::string_view name = BaseName(relativePath);
+        const size_t dot = name.rfind('.');
+        // As std::filesystem::path::extension(): ".profile" has none
+        if (dot == std::string_view::npos || dot == 0) {
+            return false;
+        }
+        const std::string_view extension = name.substr(dot);
+        const bool listed = std::any_of(extensions_.begin(), extensions_.end(), [&](const std::string& wanted) {
+            return wanted.size() == extension.size() &&
+                   std::equal(wanted.begin(), wanted.end(), extension.begin(), [](char a, char b) {
+                       return a == static_cast<char>(std::tolower(static_cast<unsigned char>(b)));
+                   });
+        });
+        if (!listed) {
+            return false;
+        }
+    }
+    if (!include_.Empty() && !include_.Matches(relativePath, false)) {
+        return false;
+    }
+    return !exclude_.Matches(relativePath, false);
+}
+
+bool ScanFilter::AcceptsModified(const std::filesystem::directory_entry& entry) const {
+    if (!modifiedSince_) {
+        return true;
+    }
+    std::error_code ec;
+    const auto modified = entry.last_write_time(ec);
+    // A file whose time cannot be read is scanned rather than silently skipped
+    return ec || modified >= *modifiedSince_;
+}
+
+bool ScanFilter::Match(std::string_view pattern, std::string_view path) {
+    return Glob(pattern).Matches(path);
+}
+
+ScanFilter::Glob::Glob(std::string_view pattern) {
+    size_t start = 0;
+    while (true) {
+        const size_t slash = pattern.find('/', start);
+        const std::string_view text = pattern.substr(start, slash == std::string_view::npos ? slash : slash - start);
+        Segment segment;
+        if (text == "**") {
+            // A trailing "**" matches what is inside the directory, not the directory itself
+            if (slash == std::string_view::npos) {
+                segments_.push_back(Segment{false, {Step{Token::STAR, 0, 0}}});
+            }
+            segment.anyDepth = true;
+        }
+        for (size_t i = 0; !segment.anyDepth && i < text.size();) {
+            std::bitset<256> members;
+            const size_t consumed = text[i] == '[' ? CompileClass(text.substr(i), members) : 0;
+            if (consumed != 0) {
+                segment.steps.push_back({Token::CLASS, 0, static_cast<uint16_t>(classes_.size())});
+                classes_.push_back(members);
+                i += consumed;
+                continue;
+            }
+            if (text[i] == '*') {
+                if (segment.steps.empty() || segment.steps.back().token != Token::STAR) {
+                    segment.steps.push_back({Token::STAR, 0, 0});
+                }
+            } else if (text[i] == '?') {
+                segment.steps.push_back({Token::ANY, 0, 0});
+            } else {
+                segment.steps.push_back({Token::LITERAL, text[i], 0});
+            }
+            ++i;
+        }
+        segments_.push_back(std::move(segment));
+        if (slash == std::string_view::npos) {
+            break;
+        }
+        start = slash + 1;
+    }
+}
+
+bool ScanFilter::Glob::MatchesComponent(const Segment& segment, std::string_view component) const {
+    const auto& steps = segment.steps;
+    auto matches = [&](const Step& step, char c) {
+        switch (step.token) {
+            case Token::LITERAL: return step.literal == c;
+            case Token::CLASS: return classes_[step.classIndex].test(static_cast<unsigned char>(c));
+            default: return true;
+        }
+    };
+    size_t p = 0;
+    size_t s = 0;
+    size_t star = std::string_view::npos;
+    size_t starFrom = 0;
+    while (s < component.size()) {
+        if (p < steps.size() && steps[p].token == Token::STAR) {
+            star = p++;
+            starFrom = s;
+        } else if (p < steps.size() && matches(steps[p], component[s])) {
+            ++p;
+            ++s;
+        } else if (star != std::string_view::npos) {
+            // Let the last star take one more character; earlier ones need not move
+            p = star + 1;
+            s = ++starFrom;
+        } else {
+            return false;
+        }
+    }
+    while (p < steps.size() && steps[p].token == Token::STAR) {
+        ++p;
+    }
+    return p == steps.size();
+}
+
+bool ScanFilter::Glob::Matches(std::string_view path) const {
+    // The same scan over components, "**" standing for the star; a component
+    // starts at `at`, and at == path.size() + 1 once all are consumed
+    auto next = [&](size_t from) {
+        const size_t slash = path.find('/', from);
+        return slash == std::string_view::npos ? path.size() + 1 : slash + 1;
+    };
+    size_t g = 0;
+    size_t at = 0;
+    size_t star = std::string_view::npos;
+    size_t starFrom = 0;
+    while (at <= path.size()) {
+        const size_t end = next(at);
+        if (g < segments_.size() && segments_[g].anyDepth) {
+            star = g++;
+            starFrom = at;
+        } else if (g < segments_.size() && MatchesComponent(segments_[g], path.substr(at, end - 1 - at))) {
+            ++g;
+            at = end;
+        } else if (star != std::string_view::npos) {
+            g = star + 1;
+            starFrom = next(starFrom);
+            at = starFrom;
+        } else {
+            return false;
+        }
+    }
+    while (g < segments_.size() && segments_[g].anyDepth) {
+        ++g;
+    }
+    return g == segments_.size();
+}
+
+} // namespace Scanner
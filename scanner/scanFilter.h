@@ -0,0 +1,94 @@
+#pragma once
+
+#include "scannerApi.h"
+
+#include <bitset>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Scanner {
+
+// Which directories a scan descends into and which files it collects,
+// compiled once from ScanSettings so that an entry costs a few comparisons.
+// Paths are relative to the scan root with '/' separators.
+//
+// A pattern without '/' is matched against the last path component at any
+// depth ("*.o", ".git"); one with '/' against the whole relative path
+// ("build/**/cache"), a leading '/' only anchoring it to the root. A trailing
+// '/' makes a pattern apply to directories only. Excluded directories are
+// not opened at all; include patterns only select files.
+class ScanFilter {
+public:
+    ScanFilter() = default;
+    explicit ScanFilter(const ScanSettings& settings);
+
+    // False when no rule is set, so the walk need not build relative paths
+    bool IsActive() const { return active_; }
+    // Excluded, or on another filesystem than the root when that is asked for
+    bool PrunesDirectory(const std::filesystem::directory_entry& entry, std::string_view relativePath) const;
+    // The include, exclude and extension rules
+    bool AcceptsFile(std::string_view relativePath) const;
+    // Changed at or after ScanSettings::modifiedSince; looks at the file only when that is set
+    bool AcceptsModified(const std::filesystem::directory_entry& entry) const;
+
+    // '*' and '?' stay within a path component, a "**" component spans any
+    // number of them ("a/**/b" also matches "a/b", "a/**" only what is in a),
+    // [a-z] and [!a-z] match one character; '**' inside a component is '*'
+    static bool Match(std::string_view pattern, std::string_view path);
+
+private:
+    // A pattern split once into '/'-separated segments. A segment is matched
+    // against one path component and "**" against any number of them, both
+    // with the two-pointer star scan: no recursion, and a failed star only
+    // moves its start one step, so a match costs O(pattern * path) at worst.
+    class Glob {
+    public:
+        explicit Glob(std::string_view pattern);
+        bool Matches(std::string_view path) const;
+
+    private:
+        enum class Token : uint8_t { LITERAL, ANY, CLASS, STAR };
+        struct Step {
+            Token token;
+            char literal;        // For LITERAL
+            uint16_t classIndex;  // For CLASS, into classes_
+        };
+        struct Segment {
+            bool anyDepth = false;  // "**"
+            std::vector<Step> steps;
+        };
+
+        bool MatchesComponent(const Segment& segment, std::string_view component) const;
+
+        std::vector<Segment> segments_;
+        std::vector<std::bitset<256>> classes_;
+    };
+    struct Pattern {
+        std::string suffix;  // For "*" followed by a literal: the literal, compared, not globbed
+        std::optional<Glob> glob;
+        bool baseName;  // Matched against the last component
+    };
+    struct Rules {
+        std::vector<std::string> names;  // Literal base names, sorted
+        std::vector<Pattern> patterns;
+        std::vector<std::string> directoryNames;  // The same for patterns with a trailing '/'
+        std::vector<Pattern> directoryPatterns;
+
+        void Add(std::string pattern);
+        bool Empty() const;
+        bool Matches(std::string_view relativePath, bool directory) const;
+    };
+
+    bool active_ = false;
+    Rules include_;
+    Rules exclude_;
+    std::vector<std::string> extensions_;  // Lowercase, with the dot
+    std::optional<std::filesystem::file_time_type> modifiedSince_;
+    std::optional<uint64_t> rootDevice_;
+};
+
+} // namespace Scanner
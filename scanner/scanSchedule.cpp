@@ -0,0 +1,42 @@
+#include "scanSchedule.h"
+#include "scannerConstants.h"
+
+#include <algorithm>
+
+namespace Scanner {
+
+std::vector<std::vector<size_t>> PlanBatches(const std::vector<uint64_t>& sizes, size_t maxFiles, uint64_t maxBytes) {
+    std::vector<size_t> large;
+    std::vector<size_t> small;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        (sizes[i] >= Constants::SCHEDULE_LARGE_FILE_SIZE ? large : small).push_back(i);
+    }
+
+    // Stable, so equal sizes keep their collection order
+    std::stable_sort(large.begin(), large.end(), [&sizes](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    std::vector<std::vector<size_t>> batches;
+    batches.reserve(large.size() + small.size() / maxFiles + 1);
+    for (size_t index : large) {
+        batches.push_back({index});
+    }
+
+    std::vector<size_t> batch;
+    uint64_t batchBytes = 0;
+    for (size_t index : small) {
+        if (!batch.empty() && (batch.size() == maxFiles ||
+                               batchBytes + sizes[index] > maxBytes)) {
+            batches.push_back(std::move(batch));
+            batch.clear();
+            batchBytes = 0;
+        }
+        batch.push_back(index);
+        batchBytes += sizes[index];
+    }
+    if (!batch.empty()) {
+        batches.push_back(std::move(batch));
+    }
+    return batches;
+}
+
+} // namespace Scanner
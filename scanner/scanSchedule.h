@@ -0,0 +1,22 @@
+#pragma once
+
+#include "scannerConstants.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Scanner {
+
+// Splits a scan into pool tasks from the file sizes found while collecting.
+// Files of at least SCHEDULE_LARGE_FILE_SIZE get a task each and are
+// dispatched first, largest first, so the longest jobs start while every
+// worker is still busy; nothing large is left for the end of the scan.
+// Smaller files keep their collection order (directory or disk layout) and are
+// packed into tasks of up to maxFiles files and maxBytes.
+// Returns indices into sizes, one vector per task, in dispatch order.
+std::vector<std::vector<size_t>> PlanBatches(const std::vector<uint64_t>& sizes,
+                                             size_t maxFiles = Constants::LOOKUP_BATCH_SIZE,
+                                             uint64_t maxBytes = Constants::MAX_BATCH_BYTES);
+
+} // namespace Scanner
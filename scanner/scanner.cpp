@@ -1,20 +1,153 @@
 #include "scanner.h"
+#include "archiveWalker.h"
+#include "asyncHasher.h"
+#include "byteBudget.h"
+#include "diskLayout.h"
+#include "scanSchedule.h"
+#include "shardCoordinator.h"
+#include "treeHash.h"
 #include "hashDatabase.h"
 #include "logger.h"
+#include "fileHasher.h"
+#include "fileReader.h"
 #include "md5Calc.h"
+#include "numaTopology.h"
 #include "threadPool.h"
 #include "utils.h"
 #include "settingsValidator.h"
 #include "scannerConstants.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
 #include <stdexcept>
 #include <iostream>
 
 namespace Scanner {
 
+struct ScannerImpl::FileScan {
+    bool hashed = false;         // digests and contentVerdict are valid
+    FileDigests digests;
+    std::string contentVerdict;  // Set when a byte signature occurs in the file
+    bool archive = false;
+    const std::vector<std::filesystem::path>* aliases = nullptr;  // Reported with the same verdict
+};
+
+namespace {
+
+// Detections and errors of the task a worker is running, committed to the
+// checkpoint together with the task's files
+struct UnitRecord {
+    std::vector<MalwareInfo> malware;
+    size_t errors = 0;
+};
+thread_local UnitRecord currentUnit;
+
+// Set on workers pinned to a NUMA node that has its own copy of the tables
+thread_local const HashDatabase* nodeDatabase = nullptr;
+
+// Bytes needed to tell an archive from its header (tar keeps its magic at 257)
+constexpr size_t ARCHIVE_SNIFF_SIZE = 512;
+
+// Reads the header of a file that has not been read from yet
+bool LooksLikeArchive(FileReader& file) {
+    static_assert(ARCHIVE_SNIFF_SIZE <= Constants::DIRECT_IO_ALIGNMENT, "Sniff must fit one aligned block");
+    thread_local AlignedBuffer header(Constants::DIRECT_IO_ALIGNMENT);
+    const size_t count = file.Read(header.Data(), header.Size());
+    return ArchiveWalker::DetectFormat(header.Data(), std::min(count, ARCHIVE_SNIFF_SIZE)) != ArchiveWalker::Format::None;
+}
+
+// Serves the archive walker's reads of any size from aligned FileReader reads
+class ReaderSource : public ByteSource {
+public:
+    ReaderSource(const std::filesystem::path& filepath, CacheMode cacheMode, ReadThrottle throttle)
+        : file_(filepath, cacheMode, 0, 0, throttle), buffer_(Constants::HASH_BUFFER_SIZE) {}
+
+    size_t Read(unsigned char* data, size_t size) override {
+        size_t total = 0;
+        while (total < size) {
+            if (begin_ == end_) {
+                begin_ = 0;
+                end_ = file_.Read(buffer_.Data(), buffer_.Size());
+                if (end_ == 0) {
+                    break;
+                }
+            }
+            const size_t count = std::min(size - total, end_ - begin_);
+            std::memcpy(data + total, buffer_.Data() + begin_, count);
+            begin_ += count;
+            total += count;
+        }
+        return total;
+    }
+
+private:
+    FileReader file_;
+    AlignedBuffer buffer_;
+    size_t begin_ = 0;
+    size_t end_ = 0;
+};
+
+// Hashes one archive member as it streams out of the walker
+class MemberHasher : public MemberSink {
+public:
+    MemberHasher(const HashDatabase& database, std::optional<uint64_t> size, std::function<void(FileDigests, std::string)> done)
+        : database_(database), hasher_(database.GetRequiredAlgorithms(), size), done_(std::move(done)) {}
+
+    void Update(const unsigned char* data, size_t size) override {
+        hasher_.Update(data, size);
+        if (database_.HasContentSignatures()) {
+            database_.ScanContent(content_, data, size);
+        }
+    }
+
+    void Final() override {
+        std::string contentVerdict;
+        database_.ContentVerdict(content_, contentVerdict);
+        done_(hasher_.Final(), std::move(contentVerdict));
+    }
+
+private:
+    const HashDatabase& database_;
+    MultiHasher hasher_;
+    ContentMatcher::State content_;
+    std::function<void(FileDigests, std::string)> done_;
+};
+
+} // namespace
+
+// Leaves of one file hashed by several pool tasks; the task that finishes
+// last computes the root and reports the file
+struct ScannerImpl::TreeJob {
+    std::filesystem::path path;
+    uint64_t size = 0;
+    std::vector<std::filesystem::path> aliases;
+    std::vector<TreeHasher::Digest> leaves;
+    std::atomic<size_t> remaining{0};
+    std::atomic<bool> failed{false};
+    bool archive = false;  // Written by the first chunk's task before it counts down
+};
+
 ScannerImpl::ScannerImpl() 
     : isScanning_(false), stopRequested_(false),
-      totalFiles_(0), malwareFiles_(0), errors_(0) {
+      totalFiles_(0), malwareFiles_(0), errors_(0),
+      similarityThreshold_(static_cast<int>(Constants::DEFAULT_SIMILARITY_THRESHOLD)),
+      scanArchives_(true),
+      archiveMaxDepth_(Constants::DEFAULT_ARCHIVE_DEPTH),
+      archiveMaxMembers_(Constants::DEFAULT_ARCHIVE_MEMBERS),
+      archiveMaxExpansion_(Constants::DEFAULT_ARCHIVE_EXPANSION),
+      maxFileSize_(0),
+      minFileSize_(0),
+      dedupeContent_(false),
+      hardLinkDuplicates_(0),
+      contentDuplicates_(0),
+      duplicateBytes_(0),
+      readOrder_(ReadOrder::Directory),
+      cacheMode_(CacheMode::Normal),
+      asyncDepth_(0),
+      lookUpDigests_(false),
+      digestCacheHits_(0) {
 }
 
 ScannerImpl::~ScannerImpl() {
@@ -26,6 +159,14 @@ ScanResult ScannerImpl::Scan(const ScanSettings& settings) {
 }
 
 ScanResult ScannerImpl::ScanWithProgress(const ScanSettings& settings, ProgressCallback callback) {
+    return RunScan(settings, callback, false);
+}
+
+ScanResult ScannerImpl::Resume(const ScanSettings& settings, ProgressCallback callback) {
+    return RunScan(settings, callback, true);
+}
+
+ScanResult ScannerImpl::RunScan(const ScanSettings& settings, ProgressCallback callback, bool resume) {
     if (isScanning_) {
         throw std::runtime_error("Scan already in progress");
     }
@@ -34,6 +175,38 @@ ScanResult ScannerImpl::ScanWithProgress(const ScanSettings& settings, ProgressC
     if (auto error = SettingsValidator::Validate(settings)) {
         throw std::runtime_error("Invalid scan settings: " + *error);
     }
+    if (resume && settings.checkpointPath.empty()) {
+        throw std::runtime_error("Invalid scan settings: resuming needs a checkpoint path");
+    }
+    
+    // The workers are forks of this process, each with a scanner of its own
+    if (settings.workerProcesses > 1) {
+        isScanning_ = true;
+        stopRequested_ = false;
+        startTime_ = std::chrono::steady_clock::now();
+        ScanResult result;
+        try {
+            logger_ = Logger::Create(settings.logPath);
+            result = ShardCoordinator::Run(settings, *logger_, stopRequested_);
+        } catch (const std::exception& e) {
+            if (logger_) {
+                logger_->LogError(std::string("Fatal error: ") + e.what());
+            }
+            isScanning_ = false;
+            throw;
+        }
+        result.executionTime = std::chrono::ceil<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                            startTime_);
+        isScanning_ = false;
+        return result;
+    }
+    
+    // Work recorded by earlier runs; throws for a checkpoint of another scan
+    std::optional<Checkpoint::State> resumed;
+    const std::string fingerprint = Checkpoint::Fingerprint(settings.databasePath);
+    if (resume) {
+        resumed = Checkpoint::Load(settings.checkpointPath, settings.rootPath, fingerprint);
+    }
     
     isScanning_ = true;
     stopRequested_ = false;
@@ -43,11 +216,36 @@ ScanResult ScannerImpl::ScanWithProgress(const ScanSettings& settings, ProgressC
     malwareFiles_ = 0;
     errors_ = 0;
     detectedMalware_.clear();
+    deferredFiles_.clear();
+    doneFiles_.clear();
+    hardLinkDuplicates_ = 0;
+    contentDuplicates_ = 0;
+    duplicateBytes_ = 0;
+    previousElapsed_ = std::chrono::milliseconds(0);
+    checkpoint_.reset();
+    digestCache_.reset();
+    digestCacheHits_ = 0;
+    if (resumed) {
+        doneFiles_ = std::move(resumed->done);
+        detectedMalware_ = std::move(resumed->malware);
+        totalFiles_ = doneFiles_.size();
+        malwareFiles_ = detectedMalware_.size();
+        errors_ = resumed->errors;
+        previousElapsed_ = resumed->elapsed;
+    }
     
     startTime_ = std::chrono::steady_clock::now();
     
     try {
         InitializeDependencies(settings);
+        if (!settings.checkpointPath.empty()) {
+            checkpoint_ = Checkpoint::Create(settings.checkpointPath, settings.rootPath, fingerprint,
+                                             resumed.has_value());
+            if (resumed) {
+                logger_->LogInfo("Resuming from " + settings.checkpointPath + ": " +
+                                 std::to_string(doneFiles_.size()) + " files already scanned");
+            }
+        }
         ExecuteScan(settings);
     } catch (const std::exception& e) {
         if (logger_) {
@@ -59,14 +257,18 @@ ScanResult ScannerImpl::ScanWithProgress(const ScanSettings& settings, ProgressC
     }
     
     auto endTime = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime_);
+    // Round up so a sub-millisecond scan is not reported as taking no time
+    auto duration = std::chrono::ceil<std::chrono::milliseconds>(endTime - startTime_);
     
     ScanResult result;
     result.totalFilesProcessed = totalFiles_;
     result.malwareFilesDetected = malwareFiles_;
     result.errorsCount = errors_;
-    result.executionTime = duration;
+    result.executionTime = previousElapsed_ + duration;
     result.detectedMalware = detectedMalware_;
+    result.hardLinkDuplicates = hardLinkDuplicates_;
+    result.contentDuplicates = contentDuplicates_;
+    result.duplicateBytesSkipped = duplicateBytes_;
     
     isScanning_ = false;
     
@@ -80,44 +282,301 @@ void ScannerImpl::InitializeDependencies(const ScanSettings& settings) {
     
     // Load malware database
     database_ = std::make_unique<HashDatabase>();
-    if (!database_->LoadFromCSV(settings.databasePath)) {
+    const bool loaded = settings.indexPath.empty()
+        ? database_->LoadFromCSV(settings.databasePath)
+        : database_->LoadIndexed(settings.databasePath, settings.indexPath,
+                                 settings.indexCacheSize != 0 ? static_cast<size_t>(settings.indexCacheSize)
+                                                              : Constants::DEFAULT_INDEX_CACHE_SIZE);
+    if (!loaded) {
         throw std::runtime_error("Failed to load hash database from: " + settings.databasePath);
     }
-    logger_->LogInfo("Loaded " + std::to_string(database_->GetSize()) + " malware signatures");
+    logger_->LogInfo("Loaded " + std::to_string(database_->GetSize()) + " malware signatures" +
+                     (database_->IsIndexed() ? ", exact digests from the index " + settings.indexPath : ""));
+    
+    similarityThreshold_ = static_cast<int>(settings.similarityThreshold != 0
+        ? settings.similarityThreshold : Constants::DEFAULT_SIMILARITY_THRESHOLD);
+    scanArchives_ = settings.scanArchives;
+    archiveMaxDepth_ = settings.archiveMaxDepth != 0 ? settings.archiveMaxDepth : Constants::DEFAULT_ARCHIVE_DEPTH;
+    archiveMaxMembers_ = settings.archiveMaxMembers != 0 ? settings.archiveMaxMembers
+                                                          : Constants::DEFAULT_ARCHIVE_MEMBERS;
+    archiveMaxExpansion_ = settings.archiveMaxExpansion != 0 ? settings.archiveMaxExpansion
+                                                              : Constants::DEFAULT_ARCHIVE_EXPANSION;
+    maxFileSize_ = settings.maxFileSize;
+    minFileSize_ = settings.minFileSize;
+    filter_ = ScanFilter(settings);
+    dedupeContent_ = settings.dedupeContent;
+    readOrder_ = settings.readOrder;
+    shardSelected_.clear();
+    if (settings.shardCount != 0) {
+        shardSelected_.assign(settings.shardCount, settings.shards.empty());
+        for (size_t shard : settings.shards) {
+            shardSelected_[shard] = true;
+        }
+    }
+    cacheMode_ = settings.cacheMode;
+    if (!settings.digestCachePath.empty()) {
+        digestCache_ = DigestCache::Open(settings.digestCachePath);
+        // Entries are still added for scanners with other signatures
+        lookUpDigests_ = !database_->HasContentSignatures();
+        logger_->LogInfo("Digest cache: " + std::to_string(digestCache_->Size()) + " entries in " +
+                         settings.digestCachePath +
+                         (lookUpDigests_ ? "" : ", not looked up since byte signatures read every file"));
+    }
+    initialPageCache_ = Utils::GetPageCacheSize();
+    if (initialPageCache_) {
+        logger_->LogInfo("Page cache at scan start: " + std::to_string(*initialPageCache_ / (1024 * 1024)) + " MB");
+    }
+    byteBudget_ = std::make_unique<ByteBudget>(settings.maxBytesInFlight != 0 ? settings.maxBytesInFlight
+                                                                              : Constants::DEFAULT_BYTES_IN_FLIGHT);
     
     // Initialize thread pool
     size_t threadCount = settings.threadCount;
     if (threadCount == 0) {
         threadCount = Utils::GetHardwareConcurrency();
     }
-    threadPool_ = std::make_unique<ThreadPool>(threadCount);
+    
+    // Rate limits allow THROTTLE_BURST_MS of their rate at once, so a short
+    // burst after an idle moment does not exceed the cap noticeably
+    byteRate_.reset();
+    fileRate_.reset();
+    concurrency_.reset();
+    if (settings.maxBytesPerSecond != 0) {
+        byteRate_ = std::make_unique<RateLimiter>(settings.maxBytesPerSecond,
+                                                  settings.maxBytesPerSecond * Constants::THROTTLE_BURST_MS / 1000);
+        logger_->LogInfo("Read rate limit: " + std::to_string(settings.maxBytesPerSecond) + " bytes/s");
+    }
+    if (settings.maxFilesPerSecond != 0) {
+        fileRate_ = std::make_unique<RateLimiter>(settings.maxFilesPerSecond,
+                                                  settings.maxFilesPerSecond * Constants::THROTTLE_BURST_MS / 1000);
+        logger_->LogInfo("File rate limit: " + std::to_string(settings.maxFilesPerSecond) + " files/s");
+    }
+    if (settings.adaptiveConcurrency) {
+        concurrency_ = std::make_unique<ConcurrencyLimiter>(threadCount, true);
+        logger_->LogInfo("Adaptive concurrency: up to " + std::to_string(threadCount) + " concurrent readers");
+    }
+    throttle_ = ReadThrottle{byteRate_.get(), concurrency_.get()};
+    
+    asyncDepth_ = settings.asyncDepth;
+    if (asyncDepth_ != 0 && !AsyncHasher::Create(1)) {
+        logger_->LogInfo("Asynchronous reads are not available here (io_uring), using blocking reads");
+        asyncDepth_ = 0;
+    } else if (asyncDepth_ != 0) {
+        logger_->LogInfo("Asynchronous reads: up to " + std::to_string(asyncDepth_) + " files in flight per worker");
+    }
+    
+    // Workers go round-robin over the nodes. Read buffers and hasher state are
+    // per thread and first touched after pinning, so they are node-local too.
+    nodeDatabases_.clear();
+    NumaTopology topology;
+    if (settings.numaAware) {
+        topology = NumaTopology::Detect();
+        if (topology.NodeCount() > 1) {
+            // Each copy is made by a thread pinned to its node, so its pages land there
+            nodeDatabases_.resize(topology.NodeCount());
+            for (size_t node = 0; node < topology.NodeCount(); ++node) {
+                std::thread([&, node]() {
+                    topology.PinCurrentThread(node);
+                    nodeDatabases_[node] = std::make_unique<HashDatabase>(*database_);
+                }).join();
+            }
+            logger_->LogInfo("NUMA: " + std::to_string(topology.NodeCount()) +
+                             " nodes, workers pinned and signature tables replicated per node");
+        } else {
+            logger_->LogInfo("NUMA: single node, worker placement unchanged");
+        }
+    }
+    
+    const bool background = settings.background;
+    auto warned = std::make_shared<std::atomic<bool>>(false);
+    auto onStart = [this, topology, background, warned](size_t worker) {
+        if (!nodeDatabases_.empty()) {
+            const size_t node = worker % nodeDatabases_.size();
+            topology.PinCurrentThread(node);
+            nodeDatabase = nodeDatabases_[node].get();
+        }
+        if (background && !Utils::EnterBackgroundMode() && !warned->exchange(true)) {
+            logger_->LogInfo("Background mode is not fully supported here, workers keep their priority");
+        }
+    };
+    if (background) {
+        logger_->LogInfo("Background mode: workers use idle I/O and CPU priority");
+    }
+    threadPool_ = std::make_unique<ThreadPool>(threadCount, std::move(onStart));
     logger_->LogInfo("Using " + std::to_string(threadCount) + " threads");
 }
 
 void ScannerImpl::ExecuteScan(const ScanSettings& settings) {
-    std::vector<std::filesystem::path> files;
+    std::vector<PendingFile> files;
     CollectFiles(settings.rootPath, files);
     
     logger_->LogInfo("Found " + std::to_string(files.size()) + " files to scan");
     
-    for (const auto& file : files) {
+    if (!doneFiles_.empty()) {
+        files.erase(std::remove_if(files.begin(), files.end(), [this](const PendingFile& file) {
+                        return std::binary_search(doneFiles_.begin(), doneFiles_.end(),
+                                                  Checkpoint::FileKey(file.path, file.size));
+                    }),
+                    files.end());
+        logger_->LogInfo(std::to_string(files.size()) + " of them not scanned by earlier runs");
+    }
+    
+    if (dedupeContent_) {
+        MergeSharedExtents(files);
+    }
+    if (hardLinkDuplicates_ != 0 || contentDuplicates_ != 0) {
+        logger_->LogInfo("Duplicates read once: " + std::to_string(hardLinkDuplicates_) + " hard links, " +
+                         std::to_string(contentDuplicates_) + " files on shared extents (" +
+                         std::to_string(duplicateBytes_ / (1024 * 1024)) + " MB not read)");
+    }
+    
+    // Small files are hashed in this order (large ones still go largest first),
+    // so reads mostly move forward across the disk
+    if (readOrder_ != ReadOrder::Directory) {
+        std::vector<std::pair<uint64_t, size_t>> keys(files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            keys[i] = {DiskLayout::SortKey(files[i].path, readOrder_), i};
+        }
+        std::sort(keys.begin(), keys.end());
+        std::vector<PendingFile> ordered;
+        ordered.reserve(files.size());
+        for (const auto& key : keys) {
+            ordered.push_back(std::move(files[key.second]));
+        }
+        files = std::move(ordered);
+    }
+    
+    // When tree digests are the only whole-file signatures, a large file is
+    // split into chunks that any worker can hash. Those are queued first, so a
+    // large file does not leave a single worker busy at the end of the scan.
+    if (Database().GetRequiredAlgorithms() == MaskOf(HashAlgorithm::TREE) && !Database().HasContentSignatures()) {
+        std::vector<PendingFile> rest;
+        for (auto& file : files) {
+            if (file.size >= Constants::PARALLEL_TREE_MIN_SIZE &&
+                Database().CheckSize(file.size) == HashDatabase::SizeCheck::FullHash) {
+                HashTreeInParallel(file);
+            } else {
+                rest.push_back(std::move(file));
+            }
+        }
+        files = std::move(rest);
+    }
+    
+    // Large files first, then small ones in groups that are resolved with one
+    // batched database lookup, so the table misses of a group overlap. With
+    // asynchronous reads a group is what a worker keeps in flight.
+    std::vector<uint64_t> sizes(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        sizes[i] = files[i].size;
+    }
+    const size_t batchFiles = std::max(Constants::LOOKUP_BATCH_SIZE, asyncDepth_);
+    const uint64_t batchBytes = static_cast<uint64_t>(Constants::MAX_BATCH_BYTES) * batchFiles /
+                                Constants::LOOKUP_BATCH_SIZE;
+    for (const auto& indices : PlanBatches(sizes, batchFiles, batchBytes)) {
         if (stopRequested_) {
             logger_->LogInfo("Scan stopped by user");
             break;
         }
         
-        threadPool_->Enqueue([this, file]() {
+        std::vector<PendingFile> batch;
+        batch.reserve(indices.size());
+        for (size_t index : indices) {
+            batch.push_back(std::move(files[index]));
+        }
+        threadPool_->Enqueue([this, batch = std::move(batch)]() {
             if (!stopRequested_) {
-                ProcessFile(file);
+                ProcessBatch(batch);
             }
         });
     }
     
     // Wait for all tasks to complete
-    threadPool_->Wait();
+    WaitForTasks();
+    
+    // Only files that did not fit the byte budget are left, so workers may
+    // now wait for it without holding up small files
+    std::vector<PendingFile> deferred;
+    {
+        std::lock_guard<std::mutex> lock(deferredMutex_);
+        deferred.swap(deferredFiles_);
+    }
+    if (!deferred.empty() && !stopRequested_) {
+        logger_->LogInfo("Hashing " + std::to_string(deferred.size()) + " files deferred by the byte budget");
+        std::stable_sort(deferred.begin(), deferred.end(),
+                         [](const PendingFile& a, const PendingFile& b) { return a.size > b.size; });
+        for (auto& file : deferred) {
+            threadPool_->Enqueue([this, file = std::move(file)]() {
+                if (!stopRequested_) {
+                    ProcessBatch({file}, true);
+                }
+            });
+        }
+        WaitForTasks();
+    }
+    
+    if (digestCache_) {
+        logger_->LogInfo("Digest cache: " + std::to_string(digestCacheHits_) + " files not hashed, " +
+                         std::to_string(digestCache_->Size()) + " entries");
+    }
+    if (stopRequested_) {
+        if (checkpoint_) {
+            logger_->LogInfo("Scan stopped, resume it from " + settings.checkpointPath);
+        }
+        return;
+    }
+    if (checkpoint_) {
+        checkpoint_->Remove();
+    }
     logger_->LogInfo("Scan completed");
 }
 
+void ScannerImpl::WaitForTasks() {
+    auto logPageCache = [this]() {
+        const auto size = Utils::GetPageCacheSize();
+        if (!size || !initialPageCache_) {
+            return;
+        }
+        const auto delta = static_cast<int64_t>(*size / (1024 * 1024)) -
+                           static_cast<int64_t>(*initialPageCache_ / (1024 * 1024));
+        logger_->LogInfo("Page cache: " + std::to_string(*size / (1024 * 1024)) + " MB (" +
+                         (delta >= 0 ? "+" : "") + std::to_string(delta) + " MB since scan start)");
+    };
+    
+    // Losing the checkpoint costs a resume, not the scan
+    auto flushCheckpoint = [this]() {
+        if (!checkpoint_) {
+            return;
+        }
+        try {
+            checkpoint_->Flush(previousElapsed_ + std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                      std::chrono::steady_clock::now() - startTime_));
+        } catch (const std::exception& e) {
+            logger_->LogError(e.what());
+        }
+    };
+    
+    // Without the cache, the next scanners only hash what this one did
+    auto flushDigestCache = [this]() {
+        if (!digestCache_) {
+            return;
+        }
+        try {
+            digestCache_->Flush();
+        } catch (const std::exception& e) {
+            logger_->LogError(e.what());
+        }
+    };
+    
+    const std::chrono::milliseconds interval(Constants::PAGE_CACHE_REPORT_INTERVAL_MS);
+    while (!threadPool_->WaitFor(interval)) {
+        logPageCache();
+        flushCheckpoint();
+        flushDigestCache();
+    }
+    logPageCache();
+    flushCheckpoint();
+    flushDigestCache();
+}
+
 void ScannerImpl::Stop() {
     stopRequested_ = true;
     if (threadPool_) {
@@ -130,13 +589,19 @@ bool ScannerImpl::IsScanning() const {
 }
 
 void ScannerImpl::CollectFiles(const std::filesystem::path& root, 
-                               std::vector<std::filesystem::path>& files) {
+                               std::vector<PendingFile>& files) {
+    const size_t rootLength = root.generic_string().size();
+    const bool needsRelativePath = filter_.IsActive() || !shardSelected_.empty();
+    size_t filteredFiles = 0;
+    size_t prunedDirectories = 0;
+    // Only files with more than one link, indexed into files
+    std::map<std::pair<uint64_t, uint64_t>, size_t> inodes;
     try {
         std::error_code ec;
-        for (const auto& entry : std::filesystem::recursive_directory_iterator(
-                root, 
-                std::filesystem::directory_options::skip_permission_denied,
-                ec)) {
+        std::filesystem::recursive_directory_iterator it(
+            root, std::filesystem::directory_options::skip_permission_denied, ec);
+        for (; it != std::filesystem::recursive_directory_iterator(); ++it) {
+            const auto& entry = *it;
             
             if (stopRequested_) {
                 break;
@@ -151,10 +616,40 @@ void ScannerImpl::CollectFiles(const std::filesystem::path& root,
                 continue;
             }
             
+            std::string path;
+            std::string_view relative;
+            if (needsRelativePath) {
+                path = entry.path().generic_string();
+                relative = path;
+                relative.remove_prefix(std::min(rootLength, relative.size()));
+                while (!relative.empty() && relative.front() == '/') {
+                    relative.remove_prefix(1);
+                }
+            }
+            
+            if (entry.is_directory(ec)) {
+                if (filter_.PrunesDirectory(entry, relative)) {
+                    it.disable_recursion_pending();
+                    prunedDirectories++;
+                }
+                continue;
+            }
+            
             if (entry.is_regular_file(ec)) {
-                // Check file size before adding
-                auto fileSize = entry.file_size(ec);
-                if (ec) {
+                // Files of other shards are left to the scans that cover them
+                if (!shardSelected_.empty() &&
+                    !shardSelected_[ShardCoordinator::ShardOf(relative, shardSelected_.size())]) {
+                    continue;
+                }
+                if (!filter_.AcceptsFile(relative)) {
+                    filteredFiles++;
+                    continue;
+                }
+                
+                // One stat gives the size and, where there are inodes, the identity
+                const auto identity = DiskLayout::Identify(entry.path());
+                const uint64_t fileSize = identity ? identity->size : entry.file_size(ec);
+                if (!identity && ec) {
                     if (logger_) {
                         logger_->LogError("Cannot get file size: " + entry.path().string());
                     }
@@ -163,16 +658,32 @@ void ScannerImpl::CollectFiles(const std::filesystem::path& root,
                     continue;
                 }
                 
-                if (fileSize > Constants::MAX_FILE_SIZE) {
+                // An explicit limit is a choice, not a failure
+                if (maxFileSize_ != 0 && fileSize > maxFileSize_) {
                     if (logger_) {
-                        logger_->LogError("File too large, skipping: " + entry.path().string() + 
+                        logger_->LogInfo("File above the size limit, skipping: " + entry.path().string() + 
                                          " (" + std::to_string(fileSize) + " bytes)");
                     }
-                    errors_++;
                     continue;
                 }
+                if (fileSize < minFileSize_ || !filter_.AcceptsModified(entry)) {
+                    filteredFiles++;
+                    continue;
+                }
+                
+                // Another name of an inode already collected is scanned with it
+                if (identity && identity->links > 1) {
+                    auto [known, inserted] = inodes.emplace(std::make_pair(identity->device, identity->inode),
+                                                            files.size());
+                    if (!inserted) {
+                        files[known->second].aliases.push_back(entry.path());
+                        hardLinkDuplicates_++;
+                        duplicateBytes_ += fileSize;
+                        continue;
+                    }
+                }
                 
-                files.push_back(entry.path());
+                files.push_back({entry.path(), fileSize, {}});
             }
         }
     } catch (const std::exception& e) {
@@ -181,45 +692,530 @@ void ScannerImpl::CollectFiles(const std::filesystem::path& root,
         }
         errors_++;
     }
+    
+    if ((filteredFiles != 0 || prunedDirectories != 0) && logger_) {
+        logger_->LogInfo("Filters left out " + std::to_string(filteredFiles) + " files and " +
+                         std::to_string(prunedDirectories) + " directories");
+    }
 }
 
-void ScannerImpl::ProcessFile(const std::filesystem::path& filepath) {
-    totalFiles_++;
-    
-    if (progressCallback_) {
-        std::lock_guard<std::mutex> lock(progressMutex_);
-        progressCallback_(filepath.string(), totalFiles_);
+void ScannerImpl::MergeSharedExtents(std::vector<PendingFile>& files) {
+    std::vector<uint64_t> sizes(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        sizes[i] = files[i].size;
+    }
+    // A stopped scan probes nothing more, and what was matched is still merged
+    const auto firsts = DiskLayout::FindSharedContent(sizes, [this, &files](size_t i) {
+        return stopRequested_ ? DiskLayout::ExtentList() : DiskLayout::SharedExtents(files[i].path);
+    });
+    const auto merged = DiskLayout::MergeSharedContent(files, firsts);
+    contentDuplicates_ += merged.files;
+    duplicateBytes_ += merged.bytes;
+}
+
+void ScannerImpl::HashTreeInParallel(const PendingFile& file) {
+    if (fileRate_) {
+        fileRate_->Acquire(1);
+    }
+    CountFile(file.path);
+    for (const auto& alias : file.aliases) {
+        CountFile(alias);
     }
     
+    auto job = std::make_shared<TreeJob>();
+    job->path = file.path;
+    job->size = file.size;
+    job->aliases = file.aliases;
+    job->leaves.resize(TreeHasher::ChunkCount(file.size));
+    job->remaining = job->leaves.size();
+    for (size_t chunk = 0; chunk < job->leaves.size(); ++chunk) {
+        threadPool_->Enqueue([this, job, chunk]() {
+            if (!stopRequested_) {
+                HashTreeChunk(*job, chunk);
+            }
+        });
+    }
+}
+
+void ScannerImpl::HashTreeChunk(TreeJob& job, size_t chunk) {
     try {
-        if (!Utils::IsFileReadable(filepath)) {
-            logger_->LogError("Cannot read file: " + filepath.string());
+        if (!job.failed) {
+            static_assert(TreeHasher::CHUNK_SIZE % Constants::DIRECT_IO_ALIGNMENT == 0, "Chunks must suit O_DIRECT");
+            static_assert(TreeHasher::CHUNK_SIZE <= Constants::MAX_READ_BUFFER_SIZE, "Chunks must fit a pooled buffer");
+            auto slot = EnterReadSlot();
+            auto buffer = BufferPool::Acquire(TreeHasher::CHUNK_SIZE);
+            FileReader file(job.path, cacheMode_, chunk * TreeHasher::CHUNK_SIZE, TreeHasher::CHUNK_SIZE, throttle_);
+            const auto count = file.Read(buffer.Data(), TreeHasher::CHUNK_SIZE);
+            const uint64_t expected = std::min<uint64_t>(TreeHasher::CHUNK_SIZE,
+                                                         job.size - chunk * TreeHasher::CHUNK_SIZE);
+            if (count != expected) {
+                throw std::runtime_error("File changed while it was read");
+            }
+            
+            job.leaves[chunk] = TreeHasher::Leaf(buffer.Data(), count);
+            if (chunk == 0 && scanArchives_) {
+                job.archive = ArchiveWalker::DetectFormat(buffer.Data(), count) != ArchiveWalker::Format::None;
+            }
+        }
+    } catch (const std::exception& e) {
+        if (!job.failed.exchange(true)) {
+            logger_->LogError("Error processing file " + job.path.string() + ": " + e.what());
             errors_++;
+        }
+    }
+    
+    if (job.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1 || job.failed) {
+        return;
+    }
+    
+    currentUnit = UnitRecord();
+    FileScan scan;
+    scan.hashed = true;
+    const auto root = TreeHasher::Root(job.leaves);
+    scan.digests.Set(HashAlgorithm::TREE, root.data());
+    scan.aliases = &job.aliases;
+    ReportMatches([&job](size_t) { return job.path.string(); }, {scan});
+    if (job.archive && !stopRequested_) {
+        ScanArchive(job.path);
+    }
+    if (!stopRequested_) {
+        std::vector<uint64_t> finished{Checkpoint::FileKey(job.path, job.size)};
+        for (const auto& alias : job.aliases) {
+            finished.push_back(Checkpoint::FileKey(alias, job.size));
+        }
+        CommitUnit(finished);
+    }
+}
+
+void ScannerImpl::ProcessBatch(const std::vector<PendingFile>& batch, bool waitForBudget) {
+    // The kernel fetches the rest of the group while the first file is hashed.
+    // Not with a cache mode: prefetched pages would look like another process's
+    // working set to DropBehind, and Direct reads do not use them.
+    if (readOrder_ != ReadOrder::Directory && cacheMode_ == CacheMode::Normal) {
+        for (size_t i = 1; i < batch.size(); ++i) {
+            DiskLayout::Prefetch(batch[i].path, std::min<uint64_t>(batch[i].size, Constants::READAHEAD_SIZE));
+        }
+    }
+    
+    // Reused by the worker for every batch; paths are only built for matches
+    thread_local std::vector<FileScan> scans;
+    thread_local std::vector<uint64_t> finished;
+    scans.clear();
+    scans.resize(batch.size());
+    finished.clear();
+    currentUnit.malware.clear();
+    currentUnit.errors = 0;
+    
+    // Files another scanner has hashed, found with one lookup for the task
+    thread_local std::vector<std::optional<DigestCache::Identity>> identities;
+    thread_local std::vector<std::optional<DigestCache::Entry>> cached;
+    identities.clear();
+    cached.clear();
+    if (digestCache_) {
+        for (const auto& file : batch) {
+            identities.push_back(DigestCache::Identify(file.path, file.size));
+        }
+        if (lookUpDigests_) {
+            digestCache_->Lookup(identities, Database().GetRequiredAlgorithms(), cached);
+        }
+    }
+    
+    // With asynchronous reads the files are queued and read together below,
+    // each holding its share of the byte budget until then
+    thread_local std::vector<size_t> queued;
+    std::vector<ByteBudget::Reservation> reservations;
+    queued.clear();
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (stopRequested_) {
             return;
         }
         
-        std::string hash = MD5Calculator::CalculateFile(filepath);
-        std::string verdict;
-
-        if (database_->IsMalicious(hash, verdict)) {
-            MalwareInfo info;
-            info.filePath = filepath.string();
-            info.hash = hash;
-            info.verdict = verdict;
+        if (!cached.empty() && cached[i]) {
+            CountFile(batch[i].path);
+            scans[i].hashed = true;
+            scans[i].digests = std::move(cached[i]->digests);
+            scans[i].archive = scanArchives_ && cached[i]->archive;
+            digestCacheHits_++;
+        } else {
+            auto reservation = waitForBudget ? byteBudget_->Reserve(batch[i].size)
+                                             : byteBudget_->TryReserve(batch[i].size);
+            if (!reservation) {
+                std::lock_guard<std::mutex> lock(deferredMutex_);
+                deferredFiles_.push_back(batch[i]);
+                continue;
+            }
+            if (fileRate_) {
+                fileRate_->Acquire(1);
+            }
+            CountFile(batch[i].path);
+            if (asyncDepth_ != 0) {
+                queued.push_back(i);
+                reservations.push_back(std::move(reservation));
+            } else {
+                auto slot = EnterReadSlot();
+                scans[i].hashed = HashFile(batch[i].path, scans[i]);
+            }
+        }
+        scans[i].aliases = &batch[i].aliases;
+        for (const auto& alias : batch[i].aliases) {
+            CountFile(alias);
+        }
+        if (checkpoint_) {
+            finished.push_back(Checkpoint::FileKey(batch[i].path, batch[i].size));
+            for (const auto& alias : batch[i].aliases) {
+                finished.push_back(Checkpoint::FileKey(alias, batch[i].size));
+            }
+        }
+    }
+    
+    if (!queued.empty() && !HashAsync(batch, queued, scans)) {
+        for (size_t i : queued) {
+            auto slot = EnterReadSlot();
+            scans[i].hashed = HashFile(batch[i].path, scans[i]);
+        }
+    }
+    reservations.clear();
+    
+    // The archive flag is only known when archives are scanned
+    if (!identities.empty() && scanArchives_) {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (scans[i].hashed && identities[i] && (cached.empty() || !cached[i])) {
+                digestCache_->Add(*identities[i], {scans[i].digests, scans[i].archive});
+            }
+        }
+    }
+    
+    ReportMatches([&batch](size_t i) { return batch[i].path.string(); }, scans);
+    
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (scans[i].archive && !stopRequested_) {
+            ScanArchive(batch[i].path);
+        }
+    }
+    if (!stopRequested_) {
+        CommitUnit(finished);
+    }
+}
+
+void ScannerImpl::ReportMatches(const std::function<std::string(size_t)>& pathOf, const std::vector<FileScan>& scans) {
+    const HashAlgorithmMask algorithms = Database().GetRequiredAlgorithms();
+    std::array<HashAlgorithm, HASH_ALGORITHM_COUNT> required;
+    size_t requiredCount = 0;
+    for (size_t i = 0; i < HASH_ALGORITHM_COUNT; ++i) {
+        auto algorithm = static_cast<HashAlgorithm>(i);
+        if ((algorithms & MaskOf(algorithm)) && IsExactDigest(algorithm)) {
+            required[requiredCount++] = algorithm;
+        }
+    }
+    
+    // One binary key per (hashed entry, digest type), typed, since tree roots
+    // look like SHA-256 digests. Kept by the worker, so a clean batch allocates nothing.
+    thread_local std::vector<HashDatabase::DigestKey> keys;
+    thread_local std::vector<std::string> verdicts;
+    keys.clear();
+    for (const auto& scan : scans) {
+        if (scan.hashed) {
+            for (size_t j = 0; j < requiredCount; ++j) {
+                HashDatabase::DigestKey key;
+                key.algorithm = required[j];
+                key.digest = scan.digests.bytes[static_cast<size_t>(required[j])];
+                keys.push_back(key);
+            }
+        }
+    }
+    Database().IsMaliciousBatch(keys, verdicts);
+    
+    size_t next = 0;
+    for (size_t i = 0; i < scans.size(); ++i) {
+        if (!scans[i].hashed) {
+            continue;
+        }
+        
+        MalwareInfo info;
+        const size_t first = next;
+        next += requiredCount;
+        for (size_t j = 0; j < requiredCount; ++j) {
+            if (!verdicts[first + j].empty()) {
+                info.hash = scans[i].digests.Get(required[j]);
+                info.verdict = verdicts[first + j];
+                break;  // One report per file, whichever digest type matched first
+            }
+        }
+        
+        // Then byte signatures, reported under the file's first exact digest
+        if (info.verdict.empty() && !scans[i].contentVerdict.empty()) {
+            info.verdict = scans[i].contentVerdict;
+            info.hash = requiredCount == 0 ? std::string() : scans[i].digests.Get(required[0]);
+        }
+        
+        // Similarity is only consulted for files no exact signature caught
+        const std::string& fuzzyDigest = scans[i].digests.fuzzy;
+        if (info.verdict.empty() && !fuzzyDigest.empty() &&
+            Database().FindSimilar(fuzzyDigest, similarityThreshold_, info.verdict, info.similarity)) {
+            info.hash = fuzzyDigest;
+        }
+        if (info.verdict.empty()) {
+            continue;
+        }
+        
+        // Every path of the data is reported, so that each can be dealt with
+        const size_t aliasCount = scans[i].aliases != nullptr ? scans[i].aliases->size() : 0;
+        for (size_t alias = 0; alias <= aliasCount; ++alias) {
+            info.filePath = alias == 0 ? pathOf(i) : (*scans[i].aliases)[alias - 1].string();
             logger_->LogMalware(info);
             
             {
                 std::lock_guard<std::mutex> lock(resultMutex_);
                 detectedMalware_.push_back(info);
             }
+            if (checkpoint_) {
+                currentUnit.malware.push_back(info);
+            }
             
             malwareFiles_++;
         }
+    }
+}
+
+void ScannerImpl::ScanArchive(const std::filesystem::path& filepath) {
+    std::vector<std::string> paths;
+    std::vector<FileScan> members;
+    
+    ArchiveWalker::Limits limits;
+    limits.maxDepth = archiveMaxDepth_;
+    limits.maxMembers = archiveMaxMembers_;
+    limits.maxExpansionRatio = archiveMaxExpansion_;
+    
+    // Members are reported as archive!member, nested ones as archive!inner.zip!member
+    ArchiveWalker walker(limits, [&](const std::string& memberPath, std::optional<uint64_t> size)
+                                     -> std::unique_ptr<MemberSink> {
+        if (size && Database().CheckSize(*size) == HashDatabase::SizeCheck::Clean) {
+            return nullptr;  // Still walked if it is an archive itself
+        }
+        std::string reportPath = filepath.string() + "!" + memberPath;
+        return std::make_unique<MemberHasher>(Database(), size,
+            [&paths, &members, reportPath = std::move(reportPath)](FileDigests digests, std::string contentVerdict) {
+                FileScan member;
+                member.hashed = true;
+                member.digests = std::move(digests);
+                member.contentVerdict = std::move(contentVerdict);
+                members.push_back(std::move(member));
+                paths.push_back(reportPath);
+            });
+    });
+    
+    try {
+        auto slot = EnterReadSlot();
+        ReaderSource source(filepath, cacheMode_, throttle_);
+        switch (walker.Walk(source, std::filesystem::file_size(filepath))) {
+            case ArchiveWalker::Status::LimitReached:
+                logger_->LogInfo("Archive limits reached, not every member was scanned: " + filepath.string());
+                break;
+            case ArchiveWalker::Status::Corrupt:
+                logger_->LogInfo("Archive is damaged or uses an unsupported feature, scanned partially: " +
+                                 filepath.string());
+                break;
+            case ArchiveWalker::Status::NotArchive:
+            case ArchiveWalker::Status::Complete:
+                break;
+        }
+    } catch (const std::exception& e) {
+        logger_->LogError("Error processing archive " + filepath.string() + ": " + e.what());
+        CountError();
+    }
+    
+    // Members finished before a failure are still worth reporting
+    ReportMatches([&paths](size_t i) { return paths[i]; }, members);
+}
+
+const HashDatabase& ScannerImpl::Database() const {
+    return nodeDatabase != nullptr ? *nodeDatabase : *database_;
+}
+
+void ScannerImpl::CommitUnit(const std::vector<uint64_t>& files) {
+    if (checkpoint_ && !files.empty()) {
+        checkpoint_->Commit(files, currentUnit.malware, currentUnit.errors);
+    }
+}
+
+void ScannerImpl::CountError() {
+    errors_++;
+    currentUnit.errors++;
+}
+
+std::optional<ConcurrencyLimiter::Slot> ScannerImpl::EnterReadSlot() {
+    if (!concurrency_) {
+        return std::nullopt;
+    }
+    return concurrency_->Enter();
+}
+
+void ScannerImpl::CountFile(const std::filesystem::path& filepath) {
+    totalFiles_++;
+    
+    if (progressCallback_) {
+        std::lock_guard<std::mutex> lock(progressMutex_);
+        progressCallback_(filepath.string(), totalFiles_);
+    }
+}
+
+bool ScannerImpl::HashFile(const std::filesystem::path& filepath, FileScan& scan) {
+    try {
+        // One open and one fstat per file: the descriptor answers the size and
+        // serves every read, which saves round trips on NFS and FUSE. A file
+        // that cannot be opened is the unreadable case.
+        std::optional<FileReader> file;
+        try {
+            file.emplace(filepath, cacheMode_, 0, 0, throttle_);
+        } catch (const std::runtime_error&) {
+            logger_->LogError("Cannot read file: " + filepath.string());
+            CountError();
+            return false;
+        }
+        
+        // Signature sizes and prefixes rule most files out before they are fully read
+        const uint64_t fileSize = file->Size();
+        FileHasher::PrefixFilter prefixFilter;
+        switch (Database().CheckSize(fileSize)) {
+            case HashDatabase::SizeCheck::Clean:
+                // The file itself matches nothing, but an archive may hold a member that does
+                scan.archive = scanArchives_ && LooksLikeArchive(*file);
+                return false;
+            case HashDatabase::SizeCheck::CheckPrefix:
+                prefixFilter = [this, fileSize](const unsigned char* prefixMd5) {
+                    return Database().MatchesPrefix(fileSize, prefixMd5);
+                };
+                break;
+            case HashDatabase::SizeCheck::FullHash:
+                break;
+        }
+        
+        // Byte signatures and the archive check use the same buffers the hashers
+        // read. A single captured pointer keeps the observer inside
+        // std::function's inline storage, so it is not allocated per file.
+        struct Observed {
+            ScannerImpl& scanner;
+            FileScan& scan;
+            ContentMatcher::State content;
+            bool firstBuffer = true;
+        } observed{*this, scan, {}};
+        auto observer = [&observed](const unsigned char* data, size_t size) {
+            if (observed.scanner.Database().HasContentSignatures()) {
+                observed.scanner.Database().ScanContent(observed.content, data, size);
+            }
+            if (observed.firstBuffer && observed.scanner.scanArchives_) {
+                observed.scan.archive = ArchiveWalker::DetectFormat(data, size) != ArchiveWalker::Format::None;
+            }
+            observed.firstBuffer = false;
+        };
+        
+        // A rejected prefix has still been through the observer, archive check included
+        auto result = FileHasher::CalculateFile(*file, fileSize, Database().GetRequiredAlgorithms(),
+                                                prefixFilter, observer);
+        if (!result) {
+            return false;
+        }
+        scan.digests = std::move(*result);
+        Database().ContentVerdict(observed.content, scan.contentVerdict);
+        return true;
         
     } catch (const std::exception& e) {
         logger_->LogError("Error processing file " + filepath.string() + ": " + e.what());
-        errors_++;
+        CountError();
+        return false;
+    }
+}
+
+bool ScannerImpl::HashAsync(const std::vector<PendingFile>& batch, const std::vector<size_t>& queued,
+                            std::vector<FileScan>& scans) {
+    // One ring per worker, kept for the whole scan
+    thread_local std::unique_ptr<AsyncHasher> hasher;
+    thread_local size_t hasherDepth = 0;
+    if (!hasher || hasherDepth != asyncDepth_) {
+        hasher = AsyncHasher::Create(asyncDepth_);
+        hasherDepth = asyncDepth_;
+        if (!hasher) {
+            return false;
+        }
+    }
+    
+    // As in HashFile, with the size seen while collecting: a file that
+    // matches no signature size is only sniffed for an archive header, or
+    // only opened without archives, so an unreadable one is still an error
+    struct Observed {
+        ScannerImpl* scanner;
+        FileScan* scan;
+        ContentMatcher::State content;
+        bool sniffOnly;
+        bool firstBuffer;
+    };
+    std::vector<Observed> observed(queued.size());
+    std::vector<AsyncHasher::File> files;
+    std::vector<size_t> owners;
+    files.reserve(queued.size());
+    for (size_t q = 0; q < queued.size(); ++q) {
+        const PendingFile& pending = batch[queued[q]];
+        AsyncHasher::File file;
+        file.path = &pending.path;
+        file.size = pending.size;
+        switch (Database().CheckSize(pending.size)) {
+            case HashDatabase::SizeCheck::Clean:
+                if (scanArchives_) {
+                    file.limit = ARCHIVE_SNIFF_SIZE;
+                } else {
+                    file.openOnly = true;
+                }
+                break;
+            case HashDatabase::SizeCheck::CheckPrefix:
+                file.prefixFilter = [this, size = pending.size](const unsigned char* prefixMd5) {
+                    return Database().MatchesPrefix(size, prefixMd5);
+                };
+                break;
+            case HashDatabase::SizeCheck::FullHash:
+                break;
+        }
+        observed[q] = {this, &scans[queued[q]], {}, file.limit != 0 || file.openOnly, true};
+        file.observer = [state = &observed[q]](const unsigned char* data, size_t size) {
+            if (!state->sniffOnly && state->scanner->Database().HasContentSignatures()) {
+                state->scanner->Database().ScanContent(state->content, data, size);
+            }
+            if (state->firstBuffer && state->scanner->scanArchives_) {
+                state->scan->archive = ArchiveWalker::DetectFormat(data, size) != ArchiveWalker::Format::None;
+            }
+            state->firstBuffer = false;
+        };
+        files.push_back(std::move(file));
+        owners.push_back(q);
+    }
+    
+    try {
+        auto slot = EnterReadSlot();
+        hasher->Run(files, Database().GetRequiredAlgorithms(), throttle_);
+    } catch (const std::exception& e) {
+        logger_->LogError("Asynchronous reads failed, reading this batch again: " + std::string(e.what()));
+        hasher.reset();
+        for (size_t i : queued) {
+            scans[i].archive = false;
+        }
+        return false;
+    }
+    
+    for (size_t f = 0; f < files.size(); ++f) {
+        Observed& state = observed[owners[f]];
+        if (files[f].error != 0) {
+            logger_->LogError("Error processing file " + files[f].path->string() + ": " +
+                              std::strerror(files[f].error));
+            CountError();
+            state.scan->archive = false;
+            continue;
+        }
+        if (files[f].digests) {
+            state.scan->digests = std::move(*files[f].digests);
+            state.scan->hashed = true;
+            Database().ContentVerdict(state.content, state.scan->contentVerdict);
+        }
     }
+    return true;
 }
 
 } // namespace Scanner
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "scannerApi.h"
+#include "checkpoint.h"
+#include "digestCache.h"
+#include "scanFilter.h"
+#include "throttle.h"
 
 #include <unordered_map>
 #include <mutex>
@@ -9,17 +13,20 @@
 #include <queue>
 #include <condition_variable>
 #include <filesystem>
+#include <functional>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <memory>
+#include <optional>
 
 namespace Scanner {
     
+class ByteBudget;
 class HashDatabase;
 class Logger;
-class MD5Calculator;
 class ThreadPool;
+struct FileDigests;
 
 class ScannerImpl : public IScanner {
 public:
@@ -29,14 +36,55 @@ public:
 public:
     ScanResult Scan(const ScanSettings& settings) override;
     ScanResult ScanWithProgress(const ScanSettings& settings, ProgressCallback callback) override;
+    ScanResult Resume(const ScanSettings& settings, ProgressCallback callback) override;
     void Stop() override;
     bool IsScanning() const override;
 
 private:
+    struct PendingFile {
+        std::filesystem::path path;
+        uint64_t size;  // As seen while collecting
+        std::vector<std::filesystem::path> aliases;  // Other paths of the same data, reported alike
+    };
+    struct FileScan;
+    struct TreeJob;
+
+    ScanResult RunScan(const ScanSettings& settings, ProgressCallback callback, bool resume);
     void InitializeDependencies(const ScanSettings& settings);
     void ExecuteScan(const ScanSettings& settings);
-    void CollectFiles(const std::filesystem::path& root, std::vector<std::filesystem::path>& files);
-    void ProcessFile(const std::filesystem::path& filepath);
+    // ThreadPool::Wait() that logs the page cache size and flushes the checkpoint
+    // and digest cache while it waits
+    void WaitForTasks();
+    // Hard links to a collected file become aliases of it
+    void CollectFiles(const std::filesystem::path& root, std::vector<PendingFile>& files);
+    // Same-size files on the same disk extents become aliases of the first one
+    void MergeSharedExtents(std::vector<PendingFile>& files);
+    // Files that do not fit the byte budget are deferred unless waitForBudget is set
+    void ProcessBatch(const std::vector<PendingFile>& batch, bool waitForBudget = false);
+    // Queues one task per TreeHasher chunk of a file
+    void HashTreeInParallel(const PendingFile& file);
+    void HashTreeChunk(TreeJob& job, size_t chunk);
+    // The signature tables of the calling worker's NUMA node, else the shared ones
+    const HashDatabase& Database() const;
+    // With adaptive concurrency, waits for a read slot; held while the file is read
+    std::optional<ConcurrencyLimiter::Slot> EnterReadSlot();
+    // Records a finished task (its files with their detections and errors) in the checkpoint
+    void CommitUnit(const std::vector<uint64_t>& files);
+    // Counts an error, also for the checkpoint unit of the calling worker
+    void CountError();
+    // Counts a file as processed and reports progress
+    void CountFile(const std::filesystem::path& filepath);
+    // False when there is nothing to look up: read error, or ruled out by size/prefix
+    bool HashFile(const std::filesystem::path& filepath, FileScan& scan);
+    // HashFile for batch[queued...] with all of them read through the worker's
+    // AsyncHasher; false, with nothing hashed, when its ring failed
+    bool HashAsync(const std::vector<PendingFile>& batch, const std::vector<size_t>& queued,
+                   std::vector<FileScan>& scans);
+    // Looks up every hashed entry with one batched query and reports the
+    // matches; pathOf(i) names entry i and is only called for a match
+    void ReportMatches(const std::function<std::string(size_t)>& pathOf, const std::vector<FileScan>& scans);
+    // Hashes the members of a zip/tar/gzip file without extracting it
+    void ScanArchive(const std::filesystem::path& filepath);
     
 private:
     std::atomic<bool> isScanning_;
@@ -47,12 +95,51 @@ private:
     std::atomic<size_t> errors_;
     
     std::unique_ptr<HashDatabase> database_;
+    // One copy of database_ per NUMA node, made on that node; empty unless numaAware
+    std::vector<std::unique_ptr<HashDatabase>> nodeDatabases_;
     std::unique_ptr<Logger> logger_;
     std::unique_ptr<ThreadPool> threadPool_;
+    int similarityThreshold_;
+    bool scanArchives_;
+    size_t archiveMaxDepth_;
+    size_t archiveMaxMembers_;
+    size_t archiveMaxExpansion_;
+    uint64_t maxFileSize_;
+    uint64_t minFileSize_;
+    ScanFilter filter_;
+    bool dedupeContent_;
+    // Duplicates found while collecting, for the ScanResult
+    size_t hardLinkDuplicates_;
+    size_t contentDuplicates_;
+    uint64_t duplicateBytes_;
+    ReadOrder readOrder_;
+    // Indexed by shard; empty when the whole tree is scanned
+    std::vector<bool> shardSelected_;
+    CacheMode cacheMode_;
+    std::optional<uint64_t> initialPageCache_;
+    std::unique_ptr<ByteBudget> byteBudget_;
+    // Throttles shared by all workers; absent when not configured
+    std::unique_ptr<RateLimiter> byteRate_;
+    std::unique_ptr<RateLimiter> fileRate_;
+    std::unique_ptr<ConcurrencyLimiter> concurrency_;
+    ReadThrottle throttle_;
+    size_t asyncDepth_;  // 0 = blocking reads
+    // Files put off while the byte budget was taken, hashed once the pool drains
+    std::vector<PendingFile> deferredFiles_;
+    std::mutex deferredMutex_;
 
     std::vector<MalwareInfo> detectedMalware_;
     std::mutex resultMutex_;
 
+    std::unique_ptr<Checkpoint> checkpoint_;
+    // Digests other scanners computed; absent when not configured
+    std::unique_ptr<DigestCache> digestCache_;
+    bool lookUpDigests_;  // False while byte signatures need every file read anyway
+    std::atomic<size_t> digestCacheHits_;
+    // Keys of files finished by earlier runs of a resumed scan
+    std::vector<uint64_t> doneFiles_;  // Sorted
+    std::chrono::milliseconds previousElapsed_{0};
+
     ProgressCallback progressCallback_;
     std::mutex progressMutex_;
     
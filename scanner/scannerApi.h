@@ -10,6 +10,7 @@
     #define SCANNER_API
 #endif
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
@@ -22,6 +23,7 @@ struct MalwareInfo {
     std::string filePath;
     std::string hash;
     std::string verdict;
+    int similarity = 100;  // ssdeep score for similarity matches, 100 for exact ones
 };
 
 struct ScanResult {
@@ -30,13 +32,59 @@ struct ScanResult {
     size_t errorsCount;
     std::chrono::milliseconds executionTime;
     std::vector<MalwareInfo> detectedMalware;
+    size_t hardLinkDuplicates = 0;       // Further names of a file already collected, not read again
+    size_t contentDuplicates = 0;        // Files sharing every data extent with one already collected
+    uint64_t duplicateBytesSkipped = 0;  // What those two kinds of duplicate would have read
+};
+
+// Order in which collected files are read
+enum class ReadOrder {
+    Directory,  // As the directory walk finds them
+    Inode,      // By inode number, close to on-disk order on most filesystems
+    Extent,     // By the physical offset of the first extent (Linux FIEMAP), else by inode
+};
+
+// What a scan leaves in the page cache
+enum class CacheMode {
+    Normal,      // Files stay cached like any other read
+    DropBehind,  // Read pages are evicted after hashing (posix_fadvise DONTNEED)
+    Direct,      // Reads bypass the cache (O_DIRECT), else as DropBehind
 };
 
 struct ScanSettings {
     std::string rootPath;
     std::string databasePath;
     std::string logPath;
+    std::string indexPath;           // On-disk index of the base's exact digests, built when missing or stale; empty = in memory
+    uint64_t indexCacheSize = 0;     // Bytes of index pages cached in memory, 0 = default
     size_t threadCount = 0;
+    size_t similarityThreshold = 0;  // Minimum ssdeep score (1-100), 0 = default
+    bool scanArchives = true;        // Hash the members of zip/tar/gzip files too
+    size_t archiveMaxDepth = 0;      // Nested container layers, 0 = default
+    size_t archiveMaxMembers = 0;    // Members per archive, 0 = default
+    size_t archiveMaxExpansion = 0;  // Inflated bytes per archive byte, 0 = default
+    uint64_t maxFileSize = 0;        // Larger files are skipped, 0 = no limit
+    uint64_t minFileSize = 0;        // Smaller files are skipped, 0 = no limit
+    std::vector<std::string> includePatterns;  // Globs a file must match one of (see ScanFilter), all when empty
+    std::vector<std::string> excludePatterns;  // Globs of files and directories left out; such directories are not opened
+    std::vector<std::string> extensions;       // Only files with one of these extensions, any case, all when empty
+    int64_t modifiedSince = 0;       // Files last changed before this (seconds since 1970, UTC) are skipped, 0 = none
+    bool sameFileSystem = false;     // Directories on other filesystems than the root are not descended into
+    bool dedupeContent = false;      // Same-size files on the same disk extents (reflinks, snapshots) are read once
+    std::string digestCachePath;     // Digests shared between scanners, looked up by fs-verity digest, empty = none
+    uint64_t maxBytesInFlight = 0;   // Sum of the sizes of files hashed at once, 0 = default
+    ReadOrder readOrder = ReadOrder::Directory;  // Other orders also prefetch the files of each task
+    CacheMode cacheMode = CacheMode::Normal;
+    uint64_t maxBytesPerSecond = 0;   // File data read per second by all workers together, 0 = no limit
+    uint64_t maxFilesPerSecond = 0;   // Files opened per second, 0 = no limit
+    bool background = false;          // Workers run at idle I/O priority and under SCHED_IDLE
+    bool adaptiveConcurrency = false; // Fewer workers read at once while read latency is high
+    size_t asyncDepth = 0;            // Files each worker keeps in flight through io_uring, 0 = blocking reads
+    bool numaAware = false;           // Workers pinned per NUMA node, each node with its own signature tables
+    std::string checkpointPath;       // Journal of finished work that Resume() continues from, empty = none
+    size_t shardCount = 0;            // Shards the tree is split into by a hash of each path, 0 = not split
+    std::vector<size_t> shards;       // The shards this scan covers, all when empty
+    size_t workerProcesses = 0;       // Local processes the shards are handed out to, 0 = scan in this process
 };
 
 using ProgressCallback = std::function<void(const std::string& currentFile, size_t processedFiles)>;
@@ -49,6 +97,9 @@ public:
 public:    
     virtual ScanResult Scan(const ScanSettings& settings) = 0;    
     virtual ScanResult ScanWithProgress(const ScanSettings& settings, ProgressCallback callback) = 0;    
+    // Continues the scan recorded at settings.checkpointPath, or starts one if
+    // there is no checkpoint yet. The result covers the earlier runs too.
+    virtual ScanResult Resume(const ScanSettings& settings, ProgressCallback callback = nullptr) = 0;
     virtual void Stop() = 0;    
     virtual bool IsScanning() const = 0;
 };
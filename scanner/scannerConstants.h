@@ -1,23 +1,69 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 
 namespace Scanner {
 namespace Constants {
 
-// File processing limits
-constexpr size_t MAX_FILE_SIZE = 100 * 1024 * 1024;  // 100 MB
+// File processing limits; the file size limit is ScanSettings::maxFileSize
+constexpr size_t DEFAULT_BYTES_IN_FLIGHT = 512 * 1024 * 1024;  // Sum of the sizes of files hashed at once
 constexpr size_t MAX_PATH_DEPTH = 100;
 constexpr size_t MIN_THREAD_COUNT = 1;
 constexpr size_t MAX_THREAD_COUNT = 256;
 
 // Hash calculation
 constexpr size_t HASH_BUFFER_SIZE = 64 * 1024;  // 64 KB
+constexpr size_t PREFIX_HASH_SIZE = 16 * 1024;  // Leading bytes covered by a signature's prefix= MD5
+constexpr size_t MIN_READ_BUFFER_SIZE = 16 * 1024;  // Pooled read buffers, per worker thread
+constexpr size_t MAX_READ_BUFFER_SIZE = 1024 * 1024;
+constexpr size_t DIRECT_IO_ALIGNMENT = 4096;  // Buffer, offset and size granularity of O_DIRECT reads
+constexpr size_t DROP_BEHIND_WINDOW = 8 * 1024 * 1024;  // Bytes read before DropBehind evicts them
+constexpr size_t PAGE_CACHE_REPORT_INTERVAL_MS = 10'000;
+
+// Throttling
+constexpr size_t THROTTLE_BURST_MS = 100;  // Rate limits allow this much of their rate at once
+constexpr size_t LATENCY_WINDOW = 32;  // Reads per adaptive concurrency decision
+constexpr size_t LATENCY_BACKOFF_FACTOR = 2;  // Window mean latency, over the long-run mean, that lowers the limit
+constexpr size_t MAX_ASYNC_DEPTH = 4096;  // Files one worker keeps in flight with asynchronous reads
+
+// Sharding
+constexpr size_t SHARDS_PER_WORKER = 4;  // Default shards per worker process, so idle workers have some to take over
+constexpr size_t MAX_SHARD_COUNT = 65'536;
+constexpr size_t MAX_WORKER_PROCESSES = 256;
+constexpr size_t SHARD_POLL_INTERVAL_MS = 100;  // How soon the coordinator notices Stop()
 
 // Database limits
-constexpr size_t MAX_DATABASE_ENTRIES = 10'000'000;
+constexpr size_t MAX_DATABASE_ENTRIES = 10'000'000;  // Signatures held in memory; an on-disk index has no such cap
 constexpr char CSV_DELIMITER = ';';
 constexpr size_t MD5_HASH_LENGTH = 32;
+constexpr size_t SHA1_HASH_LENGTH = 40;
+constexpr size_t SHA256_HASH_LENGTH = 64;
+constexpr size_t LOOKUP_BATCH_SIZE = 16;  // Files hashed per task and resolved with one batched lookup
+constexpr size_t SCHEDULE_LARGE_FILE_SIZE = 1024 * 1024;  // Files given a task of their own, largest first
+constexpr size_t MAX_BATCH_BYTES = 4 * 1024 * 1024;  // Bytes of small files per task
+constexpr size_t READAHEAD_SIZE = 2 * 1024 * 1024;  // Leading bytes prefetched per file in layout order
+constexpr size_t DEDUPE_MIN_SIZE = 64 * 1024;  // Smaller files are read rather than compared by their extents
+constexpr size_t MAX_SHARED_EXTENTS = 4096;  // Extents per file compared for content deduplication
+constexpr size_t PARALLEL_TREE_MIN_SIZE = 4 * 1024 * 1024;  // Files split across the pool for tree digests
+constexpr size_t MAX_CONTENT_PATTERN_SIZE = 1024;  // Bytes of a type=content signature
+constexpr size_t INDEX_PAGE_SIZE = 4096;  // Signature index page: a lookup that misses the cache reads one
+constexpr size_t DEFAULT_INDEX_CACHE_SIZE = 64 * 1024 * 1024;  // Index pages kept in memory
+constexpr uint64_t MAX_INDEX_CACHE_SIZE = 64ull * 1024 * 1024 * 1024;
+constexpr size_t INDEX_BUILD_MEMORY = 256 * 1024 * 1024;  // Digests sorted in memory per run when building an index
+constexpr size_t INDEX_COALESCED_PAGES = 16;  // Neighbouring pages of one batch fetched with a single read
+
+// Similarity matching
+constexpr size_t DEFAULT_SIMILARITY_THRESHOLD = 80;
+constexpr size_t MAX_SIMILARITY_THRESHOLD = 100;
+
+// Archive scanning
+constexpr size_t DEFAULT_ARCHIVE_DEPTH = 4;  // Container layers; a zip inside a tar.gz takes three
+constexpr size_t MAX_ARCHIVE_DEPTH = 16;
+constexpr size_t DEFAULT_ARCHIVE_MEMBERS = 10'000;  // Per scanned file, nested members included
+constexpr size_t MAX_ARCHIVE_MEMBERS = 1'000'000;
+constexpr size_t DEFAULT_ARCHIVE_EXPANSION = 100;  // Inflated bytes per byte of the archive
+constexpr size_t MAX_ARCHIVE_EXPANSION = 10'000;
 
 } // namespace Constants
 } // namespace Scanner
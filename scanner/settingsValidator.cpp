@@ -17,6 +17,30 @@ std::optional<std::string> SettingsValidator::Validate(const ScanSettings& setti
         return error;
     }
     
+    if (auto error = ValidateSimilarityThreshold(settings.similarityThreshold)) {
+        return error;
+    }
+    
+    if (auto error = ValidateArchiveLimits(settings)) {
+        return error;
+    }
+    
+    if (auto error = ValidateSharding(settings)) {
+        return error;
+    }
+    
+    if (auto error = ValidateFilters(settings)) {
+        return error;
+    }
+    
+    if (auto error = ValidateAsyncReads(settings)) {
+        return error;
+    }
+    
+    if (auto error = ValidateIndex(settings)) {
+        return error;
+    }
+    
     // Validate log path parent directory exists if path has parent
     if (!settings.logPath.empty()) {
         std::filesystem::path logPath(settings.logPath);
@@ -99,4 +123,108 @@ std::optional<std::string> SettingsValidator::ValidateThreadCount(size_t threadC
     return std::nullopt;
 }
 
+std::optional<std::string> SettingsValidator::ValidateSimilarityThreshold(size_t threshold) {
+    // 0 means the default threshold
+    if (threshold > Constants::MAX_SIMILARITY_THRESHOLD) {
+        return "Similarity threshold cannot exceed " + std::to_string(Constants::MAX_SIMILARITY_THRESHOLD);
+    }
+    
+    return std::nullopt;
+}
+
+std::optional<std::string> SettingsValidator::ValidateArchiveLimits(const ScanSettings& settings) {
+    // 0 means the default for each limit
+    if (settings.archiveMaxDepth > Constants::MAX_ARCHIVE_DEPTH) {
+        return "Archive depth cannot exceed " + std::to_string(Constants::MAX_ARCHIVE_DEPTH);
+    }
+    
+    if (settings.archiveMaxMembers > Constants::MAX_ARCHIVE_MEMBERS) {
+        return "Archive member limit cannot exceed " + std::to_string(Constants::MAX_ARCHIVE_MEMBERS);
+    }
+    
+    if (settings.archiveMaxExpansion > Constants::MAX_ARCHIVE_EXPANSION) {
+        return "Archive expansion ratio cannot exceed " + std::to_string(Constants::MAX_ARCHIVE_EXPANSION);
+    }
+    
+    return std::nullopt;
+}
+
+std::optional<std::string> SettingsValidator::ValidateSharding(const ScanSettings& settings) {
+    if (settings.shardCount > Constants::MAX_SHARD_COUNT) {
+        return "Shard count cannot exceed " + std::to_string(Constants::MAX_SHARD_COUNT);
+    }
+    
+    for (size_t shard : settings.shards) {
+        if (shard >= settings.shardCount) {
+            return "Shard " + std::to_string(shard) + " is out of range for " +
+                   std::to_string(settings.shardCount) + " shards";
+        }
+    }
+    
+    if (settings.workerProcesses > Constants::MAX_WORKER_PROCESSES) {
+        return "Worker process count cannot exceed " + std::to_string(Constants::MAX_WORKER_PROCESSES);
+    }
+    
+    // Worker processes hand out the shards themselves and keep no journal
+    if (settings.workerProcesses > 1 && (!settings.shards.empty() || !settings.checkpointPath.empty())) {
+        return "Worker processes cannot be combined with selected shards or a checkpoint";
+    }
+    
+    return std::nullopt;
+}
+
+std::optional<std::string> SettingsValidator::ValidateFilters(const ScanSettings& settings) {
+    for (const auto* patterns : {&settings.includePatterns, &settings.excludePatterns, &settings.extensions}) {
+        for (const auto& pattern : *patterns) {
+            if (pattern.empty()) {
+                return "Filter patterns and extensions cannot be empty";
+            }
+        }
+    }
+    
+    if (settings.maxFileSize != 0 && settings.minFileSize > settings.maxFileSize) {
+        return "Minimum file size cannot exceed the maximum file size";
+    }
+    
+    if (settings.modifiedSince < 0) {
+        return "Modification time filter cannot be before 1970";
+    }
+    
+    return std::nullopt;
+}
+
+std::optional<std::string> SettingsValidator::ValidateIndex(const ScanSettings& settings) {
+    if (settings.indexCacheSize > Constants::MAX_INDEX_CACHE_SIZE) {
+        return "Index cache cannot exceed " + std::to_string(Constants::MAX_INDEX_CACHE_SIZE / (1024 * 1024)) + " MB";
+    }
+    if (settings.indexPath.empty()) {
+        return std::nullopt;
+    }
+    
+    // The index is rebuilt in place, next to its run files
+    std::error_code ec;
+    if (std::filesystem::equivalent(settings.indexPath, settings.databasePath, ec)) {
+        return "Index path must differ from the database path";
+    }
+    std::filesystem::path indexPath(settings.indexPath);
+    if (indexPath.has_parent_path() && !std::filesystem::is_directory(indexPath.parent_path())) {
+        return "Index parent directory does not exist: " + indexPath.parent_path().string();
+    }
+    
+    return std::nullopt;
+}
+
+std::optional<std::string> SettingsValidator::ValidateAsyncReads(const ScanSettings& settings) {
+    if (settings.asyncDepth > Constants::MAX_ASYNC_DEPTH) {
+        return "Asynchronous read depth cannot exceed " + std::to_string(Constants::MAX_ASYNC_DEPTH);
+    }
+    
+    // The ring reads through the page cache
+    if (settings.asyncDepth != 0 && settings.cacheMode != CacheMode::Normal) {
+        return "Asynchronous reads cannot be combined with direct or drop-behind reads";
+    }
+    
+    return std::nullopt;
+}
+
 } // namespace Scanner
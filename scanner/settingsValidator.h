@@ -15,6 +15,12 @@ private:
     static std::optional<std::string> ValidatePath(const std::string& path);
     static std::optional<std::string> ValidateDatabasePath(const std::string& path);
     static std::optional<std::string> ValidateThreadCount(size_t threadCount);
+    static std::optional<std::string> ValidateSimilarityThreshold(size_t threshold);
+    static std::optional<std::string> ValidateArchiveLimits(const ScanSettings& settings);
+    static std::optional<std::string> ValidateSharding(const ScanSettings& settings);
+    static std::optional<std::string> ValidateFilters(const ScanSettings& settings);
+    static std::optional<std::string> ValidateAsyncReads(const ScanSettings& settings);
+    static std::optional<std::string> ValidateIndex(const ScanSettings& settings);
 };
 
 } // namespace Scanner
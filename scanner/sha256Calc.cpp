@@ -0,0 +1,411 @@
+#include "sha256Calc.h"
+#include "cpuFeatures.h"
+#include "digestContext.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+namespace Scanner {
+
+namespace {
+
+constexpr size_t BLOCK_SIZE = 64;
+
+alignas(16) const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+const uint32_t INITIAL_STATE[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+// Appends the SHA-256 padding for a message of totalLength bytes whose last
+// partial block (tailLength bytes) is already in block; returns block count (1 or 2)
+size_t PadTail(unsigned char* block, size_t tailLength, uint64_t totalLength) {
+    block[tailLength] = 0x80;
+    const size_t blocks = tailLength + 1 + 8 <= BLOCK_SIZE ? 1 : 2;
+    std::memset(block + tailLength + 1, 0, blocks * BLOCK_SIZE - tailLength - 1);
+    const uint64_t bits = totalLength * 8;
+    for (size_t i = 0; i < 8; ++i) {
+        block[blocks * BLOCK_SIZE - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+    }
+    return blocks;
+}
+
+void StoreDigest(const uint32_t state[8], unsigned char* out) {
+    for (size_t i = 0; i < 8; ++i) {
+        out[4 * i] = static_cast<unsigned char>(state[i] >> 24);
+        out[4 * i + 1] = static_cast<unsigned char>(state[i] >> 16);
+        out[4 * i + 2] = static_cast<unsigned char>(state[i] >> 8);
+        out[4 * i + 3] = static_cast<unsigned char>(state[i]);
+    }
+}
+
+#if defined(SCANNER_X86)
+
+// ---------------------------------------------------------------------------
+// SHA-NI kernel: four rounds per sha256rnds2 pair, message schedule in
+// sha256msg1/msg2. State is kept in the ABEF/CDGH layout the instructions use.
+// ---------------------------------------------------------------------------
+
+SCANNER_TARGET("sha,sse4.1,ssse3")
+inline void ShaNiQuad(__m128i& state0, __m128i& state1, __m128i msg, size_t group) {
+    msg = _mm_add_epi32(msg, _mm_load_si128(reinterpret_cast<const __m128i*>(&K[4 * group])));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+    msg = _mm_shuffle_epi32(msg, 0x0E);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+}
+
+// Rounds 4g..4g+3 for g >= 3: extends the schedule into next while hashing current
+SCANNER_TARGET("sha,sse4.1,ssse3")
+inline void ShaNiScheduleQuad(__m128i& state0, __m128i& state1, size_t group,
+                              __m128i& current, __m128i& previous, __m128i& next, __m128i& oldest,
+                              bool expandNext, bool prepareOldest) {
+    __m128i msg = _mm_add_epi32(current, _mm_load_si128(reinterpret_cast<const __m128i*>(&K[4 * group])));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+    if (expandNext) {
+        next = _mm_add_epi32(next, _mm_alignr_epi8(current, previous, 4));
+        next = _mm_sha256msg2_epu32(next, current);
+    }
+    msg = _mm_shuffle_epi32(msg, 0x0E);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+    if (prepareOldest) {
+        oldest = _mm_sha256msg1_epu32(oldest, current);
+    }
+}
+
+SCANNER_TARGET("sha,sse4.1,ssse3")
+void CompressShaNi(uint32_t state[8], const unsigned char* data, size_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);              // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);        // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);  // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);     // CDGH
+
+    for (; blocks > 0; --blocks, data += BLOCK_SIZE) {
+        const __m128i abefSave = state0;
+        const __m128i cdghSave = state1;
+
+        __m128i m[4];
+        for (size_t i = 0; i < 4; ++i) {
+            m[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), byteSwap);
+        }
+
+        ShaNiQuad(state0, state1, m[0], 0);
+        ShaNiQuad(state0, state1, m[1], 1);
+        m[0] = _mm_sha256msg1_epu32(m[0], m[1]);
+        ShaNiQuad(state0, state1, m[2], 2);
+        m[1] = _mm_sha256msg1_epu32(m[1], m[2]);
+
+        // Groups 3..15 rotate through the four schedule registers
+        ShaNiScheduleQuad(state0, state1, 3, m[3], m[2], m[0], m[2], true, true);
+        ShaNiScheduleQuad(state0, state1, 4, m[0], m[3], m[1], m[3], true, true);
+        ShaNiScheduleQuad(state0, state1, 5, m[1], m[0], m[2], m[0], true, true);
+        ShaNiScheduleQuad(state0, state1, 6, m[2], m[1], m[3], m[1], true, true);
+        ShaNiScheduleQuad(state0, state1, 7, m[3], m[2], m[0], m[2], true, true);
+        ShaNiScheduleQuad(state0, state1, 8, m[0], m[3], m[1], m[3], true, true);
+        ShaNiScheduleQuad(state0, state1, 9, m[1], m[0], m[2], m[0], true, true);
+        ShaNiScheduleQuad(state0, state1, 10, m[2], m[1], m[3], m[1], true, true);
+        ShaNiScheduleQuad(state0, state1, 11, m[3], m[2], m[0], m[2], true, true);
+        ShaNiScheduleQuad(state0, state1, 12, m[0], m[3], m[1], m[3], true, true);
+        ShaNiScheduleQuad(state0, state1, 13, m[1], m[0], m[2], m[0], true, false);
+        ShaNiScheduleQuad(state0, state1, 14, m[2], m[1], m[3], m[1], true, false);
+        ShaNiScheduleQuad(state0, state1, 15, m[3], m[2], m[0], m[2], false, false);
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);           // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);        // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);     // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);        // ABEF
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2 multi-buffer kernel: lane i of every register belongs to message i
+// ---------------------------------------------------------------------------
+
+template <int N>
+SCANNER_TARGET("avx2")
+inline __m256i Rotr(__m256i x) {
+    return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N));
+}
+
+SCANNER_TARGET("avx2")
+inline __m256i LoadLaneWords(const unsigned char* const blocks[8], size_t offset) {
+    auto word = [&](size_t lane) {
+        const unsigned char* p = blocks[lane] + offset;
+        return static_cast<int>((uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3]);
+    };
+    return _mm256_set_epi32(word(7), word(6), word(5), word(4), word(3), word(2), word(1), word(0));
+}
+
+// One block per lane; lanes with a zero mask keep their previous state
+SCANNER_TARGET("avx2")
+void CompressAvx2(__m256i state[8], const unsigned char* const blocks[8], __m256i activeMask) {
+    __m256i w[16];
+    __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+    __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (size_t t = 0; t < 64; ++t) {
+        __m256i wt;
+        if (t < 16) {
+            wt = LoadLaneWords(blocks, 4 * t);
+        } else {
+            const __m256i w2 = w[(t - 2) & 15];
+            const __m256i w15 = w[(t - 15) & 15];
+            const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(Rotr<7>(w15), Rotr<18>(w15)), _mm256_srli_epi32(w15, 3));
+            const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(Rotr<17>(w2), Rotr<19>(w2)), _mm256_srli_epi32(w2, 10));
+            wt = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0), _mm256_add_epi32(w[(t - 7) & 15], s1));
+        }
+        w[t & 15] = wt;
+
+        const __m256i bigSigma1 = _mm256_xor_si256(_mm256_xor_si256(Rotr<6>(e), Rotr<11>(e)), Rotr<25>(e));
+        const __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        const __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(h, bigSigma1), _mm256_add_epi32(ch, wt)),
+                                            _mm256_set1_epi32(static_cast<int>(K[t])));
+        const __m256i bigSigma0 = _mm256_xor_si256(_mm256_xor_si256(Rotr<2>(a), Rotr<13>(a)), Rotr<22>(a));
+        const __m256i maj = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)),
+                                             _mm256_and_si256(b, c));
+        const __m256i t2 = _mm256_add_epi32(bigSigma0, maj);
+
+        h = g; g = f; f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c; c = b; b = a;
+        a = _mm256_add_epi32(t1, t2);
+    }
+
+    const __m256i updated[8] = {a, b, c, d, e, f, g, h};
+    for (size_t i = 0; i < 8; ++i) {
+        state[i] = _mm256_blendv_epi8(state[i], _mm256_add_epi32(state[i], updated[i]), activeMask);
+    }
+}
+
+// Hashes up to 8 messages at once; block streams of different lengths are
+// handled by masking lanes that already finished
+SCANNER_TARGET("avx2")
+void HashGroupAvx2(const std::string_view* messages, size_t count, SHA256Calculator::Digest* out) {
+    alignas(32) unsigned char tails[8][2 * BLOCK_SIZE];
+    static const unsigned char idleBlock[BLOCK_SIZE] = {};
+    size_t fullBlocks[8] = {};
+    size_t totalBlocks[8] = {};
+    size_t maxBlocks = 0;
+
+    for (size_t lane = 0; lane < count; ++lane) {
+        const size_t size = messages[lane].size();
+        fullBlocks[lane] = size / BLOCK_SIZE;
+        const size_t tailLength = size % BLOCK_SIZE;
+        std::memcpy(tails[lane], messages[lane].data() + fullBlocks[lane] * BLOCK_SIZE, tailLength);
+        totalBlocks[lane] = fullBlocks[lane] + PadTail(tails[lane], tailLength, size);
+        maxBlocks = std::max(maxBlocks, totalBlocks[lane]);
+    }
+
+    __m256i state[8];
+    for (size_t i = 0; i < 8; ++i) {
+        state[i] = _mm256_set1_epi32(static_cast<int>(INITIAL_STATE[i]));
+    }
+
+    const unsigned char* blocks[8];
+    for (size_t index = 0; index < maxBlocks; ++index) {
+        alignas(32) int mask[8];
+        for (size_t lane = 0; lane < 8; ++lane) {
+            if (lane >= count || index >= totalBlocks[lane]) {
+                blocks[lane] = idleBlock;
+                mask[lane] = 0;
+            } else if (index < fullBlocks[lane]) {
+                blocks[lane] = reinterpret_cast<const unsigned char*>(messages[lane].data()) + index * BLOCK_SIZE;
+                mask[lane] = -1;
+            } else {
+                blocks[lane] = tails[lane] + (index - fullBlocks[lane]) * BLOCK_SIZE;
+                mask[lane] = -1;
+            }
+        }
+        CompressAvx2(state, blocks, _mm256_load_si256(reinterpret_cast<const __m256i*>(mask)));
+    }
+
+    alignas(32) uint32_t words[8][8];
+    for (size_t i = 0; i < 8; ++i) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(words[i]), state[i]);
+    }
+    for (size_t lane = 0; lane < count; ++lane) {
+        uint32_t laneState[8];
+        for (size_t i = 0; i < 8; ++i) {
+            laneState[i] = words[i][lane];
+        }
+        StoreDigest(laneState, out[lane].data());
+    }
+}
+
+#endif // SCANNER_X86
+
+} // namespace
+
+struct SHA256Calculator::Impl {
+    Sha256Backend backend;
+    std::optional<DigestContext> openssl;
+    uint32_t state[8];
+    unsigned char buffer[BLOCK_SIZE];
+    size_t buffered = 0;
+    uint64_t total = 0;
+};
+
+SHA256Calculator::SHA256Calculator() : SHA256Calculator(StreamBackend()) {
+}
+
+SHA256Calculator::SHA256Calculator(Sha256Backend backend) : impl_(std::make_unique<Impl>()) {
+    if (backend == Sha256Backend::Avx2MultiBuffer) {
+        throw std::invalid_argument("Multi-buffer SHA-256 backend cannot hash a single stream");
+    }
+    if (!IsSupported(backend)) {
+        throw std::invalid_argument(std::string("SHA-256 backend not supported on this CPU: ") + BackendName(backend));
+    }
+
+    impl_->backend = backend;
+    if (backend == Sha256Backend::OpenSSL) {
+        impl_->openssl.emplace(HashAlgorithm::SHA256);
+    } else {
+        std::memcpy(impl_->state, INITIAL_STATE, sizeof(INITIAL_STATE));
+    }
+}
+
+SHA256Calculator::~SHA256Calculator() = default;
+
+void SHA256Calculator::Update(const void* data, size_t size) {
+    if (impl_->backend == Sha256Backend::OpenSSL) {
+        impl_->openssl->Update(data, size);
+        return;
+    }
+
+#if defined(SCANNER_X86)
+    auto bytes = static_cast<const unsigned char*>(data);
+    impl_->total += size;
+
+    if (impl_->buffered > 0) {
+        const size_t take = std::min(size, BLOCK_SIZE - impl_->buffered);
+        std::memcpy(impl_->buffer + impl_->buffered, bytes, take);
+        impl_->buffered += take;
+        bytes += take;
+        size -= take;
+        if (impl_->buffered < BLOCK_SIZE) {
+            return;
+        }
+        CompressShaNi(impl_->state, impl_->buffer, 1);
+        impl_->buffered = 0;
+    }
+
+    const size_t blocks = size / BLOCK_SIZE;
+    if (blocks > 0) {
+        CompressShaNi(impl_->state, bytes, blocks);
+    }
+    impl_->buffered = size % BLOCK_SIZE;
+    std::memcpy(impl_->buffer, bytes + blocks * BLOCK_SIZE, impl_->buffered);
+#endif
+}
+
+SHA256Calculator::Digest SHA256Calculator::Final() {
+    Digest digest{};
+    if (impl_->backend == Sha256Backend::OpenSSL) {
+        impl_->openssl->Final(digest.data());
+        return digest;
+    }
+
+#if defined(SCANNER_X86)
+    unsigned char tail[2 * BLOCK_SIZE];
+    std::memcpy(tail, impl_->buffer, impl_->buffered);
+    const size_t blocks = PadTail(tail, impl_->buffered, impl_->total);
+    CompressShaNi(impl_->state, tail, blocks);
+    StoreDigest(impl_->state, digest.data());
+#endif
+    return digest;
+}
+
+void SHA256Calculator::Reset() {
+    if (impl_->backend == Sha256Backend::OpenSSL) {
+        impl_->openssl->Reset();
+        return;
+    }
+    std::memcpy(impl_->state, INITIAL_STATE, sizeof(INITIAL_STATE));
+    impl_->buffered = 0;
+    impl_->total = 0;
+}
+
+SHA256Calculator::Digest SHA256Calculator::Hash(const void* data, size_t size, Sha256Backend backend) {
+    if (backend == Sha256Backend::Avx2MultiBuffer) {
+        return HashMany({std::string_view(static_cast<const char*>(data), size)}, backend).front();
+    }
+    SHA256Calculator calculator(backend);
+    calculator.Update(data, size);
+    return calculator.Final();
+}
+
+std::vector<SHA256Calculator::Digest> SHA256Calculator::HashMany(const std::vector<std::string_view>& messages,
+                                                                Sha256Backend backend) {
+    if (!IsSupported(backend)) {
+        throw std::invalid_argument(std::string("SHA-256 backend not supported on this CPU: ") + BackendName(backend));
+    }
+
+    std::vector<Digest> digests(messages.size());
+#if defined(SCANNER_X86)
+    if (backend == Sha256Backend::Avx2MultiBuffer) {
+        for (size_t base = 0; base < messages.size(); base += LANES) {
+            HashGroupAvx2(messages.data() + base, std::min(LANES, messages.size() - base), digests.data() + base);
+        }
+        return digests;
+    }
+#endif
+    for (size_t i = 0; i < messages.size(); ++i) {
+        digests[i] = Hash(messages[i].data(), messages[i].size(), backend);
+    }
+    return digests;
+}
+
+std::vector<SHA256Calculator::Digest> SHA256Calculator::HashMany(const std::vector<std::string_view>& messages) {
+    return HashMany(messages, MultiBufferBackend());
+}
+
+bool SHA256Calculator::IsSupported(Sha256Backend backend) {
+    switch (backend) {
+        case Sha256Backend::OpenSSL: return true;
+        case Sha256Backend::ShaNi: return GetCpuFeatures().shaNi;
+        case Sha256Backend::Avx2MultiBuffer: return GetCpuFeatures().avx2;
+    }
+    return false;
+}
+
+Sha256Backend SHA256Calculator::StreamBackend() {
+    return GetCpuFeatures().shaNi ? Sha256Backend::ShaNi : Sha256Backend::OpenSSL;
+}
+
+Sha256Backend SHA256Calculator::MultiBufferBackend() {
+    // SHA-NI on one stream already beats eight AVX2 lanes
+    if (GetCpuFeatures().shaNi) {
+        return Sha256Backend::ShaNi;
+    }
+    return GetCpuFeatures().avx2 ? Sha256Backend::Avx2MultiBuffer : Sha256Backend::OpenSSL;
+}
+
+const char* SHA256Calculator::BackendName(Sha256Backend backend) {
+    switch (backend) {
+        case Sha256Backend::OpenSSL: return "openssl";
+        case Sha256Backend::ShaNi: return "sha-ni";
+        case Sha256Backend::Avx2MultiBuffer: return "avx2-multibuffer";
+    }
+    return "unknown";
+}
+
+} // namespace Scanner
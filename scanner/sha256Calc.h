@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace Scanner {
+
+enum class Sha256Backend {
+    OpenSSL,          // SHA256_CTX, always available
+    ShaNi,            // Intel SHA extensions, single stream
+    Avx2MultiBuffer,  // 8 independent messages per pass, no SHA extensions needed
+};
+
+// SHA-256 engine with backends picked once from CPUID (see GetCpuFeatures()).
+// A streaming instance uses the fastest single-stream backend (SHA-NI, else
+// OpenSSL); HashMany() additionally uses the AVX2 multi-buffer kernel for
+// groups of independent messages, such as the chunks of a tree digest.
+class SHA256Calculator {
+public:
+    static constexpr size_t DIGEST_SIZE = 32;
+    static constexpr size_t LANES = 8;
+    using Digest = std::array<unsigned char, DIGEST_SIZE>;
+
+    SHA256Calculator();
+    explicit SHA256Calculator(Sha256Backend backend);
+    ~SHA256Calculator();
+
+    SHA256Calculator(const SHA256Calculator&) = delete;
+    SHA256Calculator& operator=(const SHA256Calculator&) = delete;
+
+    void Update(const void* data, size_t size);
+    Digest Final();
+    // Starts a new message on the same backend
+    void Reset();
+
+    static Digest Hash(const void* data, size_t size, Sha256Backend backend);
+    static std::vector<Digest> HashMany(const std::vector<std::string_view>& messages, Sha256Backend backend);
+    static std::vector<Digest> HashMany(const std::vector<std::string_view>& messages);
+
+    static bool IsSupported(Sha256Backend backend);
+    static Sha256Backend StreamBackend();
+    static Sha256Backend MultiBufferBackend();
+    static const char* BackendName(Sha256Backend backend);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace Scanner
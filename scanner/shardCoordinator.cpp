@@ -0,0 +1,346 @@
+#include "shardCoordinator.h"
+#include "logger.h"
+#include "scanner.h"
+#include "scannerConstants.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <charconv>
+#include <deque>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace Scanner {
+
+size_t ShardCoordinator::ShardOf(std::string_view relativePath, size_t shardCount) {
+    return static_cast<size_t>(Utils::Fnv1a(relativePath) % shardCount);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+namespace {
+
+template <typename T>
+bool ParseNumber(const std::string& text, T& value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+bool SendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        // A peer that is gone must not kill this process with SIGPIPE
+        const ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Splits what arrives on a socket into lines
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd_(fd) {}
+
+    // Reads what is available; false once the peer has closed the socket
+    bool Fill() {
+        char chunk[64 * 1024];
+        ssize_t n;
+        do {
+            n = read(fd_, chunk, sizeof(chunk));
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            return false;
+        }
+        buffer_.append(chunk, static_cast<size_t>(n));
+        return true;
+    }
+
+    std::optional<std::string> Next() {
+        const size_t end = buffer_.find('\n', begin_);
+        if (end == std::string::npos) {
+            buffer_.erase(0, begin_);
+            begin_ = 0;
+            return std::nullopt;
+        }
+        std::string line = buffer_.substr(begin_, end - begin_);
+        begin_ = end + 1;
+        return line;
+    }
+
+private:
+    int fd_;
+    std::string buffer_;
+    size_t begin_ = 0;
+};
+
+std::string FormatResult(const ScanResult& result) {
+    std::string reply = "F\t" + std::to_string(result.totalFilesProcessed) + "\nE\t" +
+                        std::to_string(result.errorsCount) + "\nD\t" + std::to_string(result.hardLinkDuplicates) +
+                        "\t" + std::to_string(result.contentDuplicates) + "\t" +
+                        std::to_string(result.duplicateBytesSkipped) + "\n";
+    for (const auto& info : result.detectedMalware) {
+        reply += "M\t" + std::to_string(info.similarity) + "\t" + info.hash + "\t" + Utils::EscapeField(info.verdict) +
+                 "\t" + Utils::EscapeField(info.filePath) + "\n";
+    }
+    return reply + "C\n";
+}
+
+// The loop of a forked worker: scans the shards it is handed until told to exit
+int RunWorker(int fd, const ScanSettings& settings, size_t index) {
+    LineReader reader(fd);
+    ScannerImpl scanner;
+    while (true) {
+        std::optional<std::string> line;
+        while (!(line = reader.Next())) {
+            if (!reader.Fill()) {
+                return 1;
+            }
+        }
+        const auto fields = Utils::SplitFields(*line);
+        if (fields[0] != "S" || fields.size() != 3) {
+            return 0;
+        }
+
+        ScanSettings shard = settings;
+        shard.workerProcesses = 0;
+        shard.shards.clear();
+        ParseNumber(fields[1], shard.shardCount);
+        size_t begin = 0;
+        while (begin < fields[2].size()) {
+            size_t end = fields[2].find(',', begin);
+            if (end == std::string::npos) {
+                end = fields[2].size();
+            }
+            size_t selected = 0;
+            if (ParseNumber(fields[2].substr(begin, end - begin), selected)) {
+                shard.shards.push_back(selected);
+            }
+            begin = end + 1;
+        }
+        shard.logPath = settings.logPath + ".worker" + std::to_string(index);
+
+        std::string reply;
+        try {
+            reply = FormatResult(scanner.Scan(shard));
+        } catch (const std::exception& e) {
+            reply = "X\t" + Utils::EscapeField(e.what()) + "\n";
+        }
+        if (!SendAll(fd, reply)) {
+            return 1;
+        }
+    }
+}
+
+} // namespace
+
+ScanResult ShardCoordinator::Run(const ScanSettings& settings, Logger& logger, const std::atomic<bool>& stopRequested) {
+    const size_t shardCount = settings.shardCount != 0 ? settings.shardCount
+                                                       : settings.workerProcesses * Constants::SHARDS_PER_WORKER;
+    std::deque<size_t> queue;
+    for (size_t shard = 0; shard < shardCount; ++shard) {
+        queue.push_back(shard);
+    }
+    logger.LogInfo("Splitting the scan into " + std::to_string(shardCount) + " shards across " +
+                   std::to_string(settings.workerProcesses) + " worker processes");
+    // A forked worker would write whatever is still buffered a second time
+    logger.Flush();
+
+    struct Worker {
+        pid_t pid;
+        int fd;
+        LineReader reader;
+        std::vector<size_t> assigned;  // Empty while idle
+        ScanResult partial{};          // What arrived for the assigned shards so far
+    };
+    std::vector<Worker> workers;
+    workers.reserve(settings.workerProcesses);
+    for (size_t i = 0; i < settings.workerProcesses; ++i) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            logger.LogError("Cannot create a socket for worker process " + std::to_string(i + 1));
+            break;
+        }
+        const pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            for (const auto& worker : workers) {
+                close(worker.fd);
+            }
+            // Skips the exit handlers and destructors of the coordinator's copy
+            _exit(RunWorker(fds[1], settings, i + 1));
+        }
+        close(fds[1]);
+        if (pid < 0) {
+            close(fds[0]);
+            logger.LogError("Cannot start worker process " + std::to_string(i + 1));
+            break;
+        }
+        workers.push_back({pid, fds[0], LineReader(fds[0]), {}, {}});
+    }
+    if (workers.empty()) {
+        throw std::runtime_error("Failed to start worker processes");
+    }
+
+    // Half of a fair share per request: large pieces while much is left,
+    // single shards near the end, when idle workers take over the rest
+    auto assign = [&](Worker& worker) {
+        const size_t take = std::max<size_t>(1, queue.size() / (2 * workers.size()));
+        std::string list;
+        for (size_t i = 0; i < take && !queue.empty(); ++i) {
+            worker.assigned.push_back(queue.front());
+            list += (list.empty() ? "" : ",") + std::to_string(queue.front());
+            queue.pop_front();
+        }
+        // A worker that cannot be reached is noticed as lost by the poll below
+        SendAll(worker.fd, "S\t" + std::to_string(shardCount) + "\t" + list + "\n");
+    };
+
+    ScanResult result{};
+    std::optional<std::string> failure;
+    bool stopped = false;
+    while (true) {
+        if ((stopRequested || failure) && !stopped) {
+            stopped = true;
+            queue.clear();
+            if (stopRequested) {
+                for (const auto& worker : workers) {
+                    if (!worker.assigned.empty()) {
+                        kill(worker.pid, SIGTERM);
+                    }
+                }
+            }
+        }
+        for (auto& worker : workers) {
+            if (worker.fd >= 0 && worker.assigned.empty() && !queue.empty()) {
+                assign(worker);
+            }
+        }
+
+        std::vector<pollfd> polled;
+        std::vector<Worker*> busy;
+        for (auto& worker : workers) {
+            if (worker.fd >= 0 && !worker.assigned.empty()) {
+                polled.push_back({worker.fd, POLLIN, 0});
+                busy.push_back(&worker);
+            }
+        }
+        if (busy.empty()) {
+            break;
+        }
+        if (poll(polled.data(), polled.size(), static_cast<int>(Constants::SHARD_POLL_INTERVAL_MS)) <= 0) {
+            continue;
+        }
+
+        for (size_t i = 0; i < polled.size(); ++i) {
+            if (polled[i].revents == 0) {
+                continue;
+            }
+            Worker& worker = *busy[i];
+            if (!worker.reader.Fill()) {
+                if (!stopped) {
+                    logger.LogError("Worker process " + std::to_string(worker.pid) +
+                                    " exited before finishing its shards, handing them to the others");
+                    queue.insert(queue.begin(), worker.assigned.begin(), worker.assigned.end());
+                }
+                worker.assigned.clear();
+                close(worker.fd);
+                worker.fd = -1;
+                continue;
+            }
+            while (auto line = worker.reader.Next()) {
+                const auto fields = Utils::SplitFields(*line);
+                size_t count = 0;
+                if (fields[0] == "F" && fields.size() == 2 && ParseNumber(fields[1], count)) {
+                    worker.partial.totalFilesProcessed += count;
+                } else if (fields[0] == "E" && fields.size() == 2 && ParseNumber(fields[1], count)) {
+                    worker.partial.errorsCount += count;
+                } else if (fields[0] == "D" && fields.size() == 4) {
+                    uint64_t bytes = 0;
+                    if (ParseNumber(fields[1], count)) {
+                        worker.partial.hardLinkDuplicates += count;
+                    }
+                    if (ParseNumber(fields[2], count)) {
+                        worker.partial.contentDuplicates += count;
+                    }
+                    if (ParseNumber(fields[3], bytes)) {
+                        worker.partial.duplicateBytesSkipped += bytes;
+                    }
+                } else if (fields[0] == "M" && fields.size() == 5) {
+                    MalwareInfo info;
+                    ParseNumber(fields[1], info.similarity);
+                    info.hash = fields[2];
+                    info.verdict = Utils::UnescapeField(fields[3]);
+                    info.filePath = Utils::UnescapeField(fields[4]);
+                    worker.partial.detectedMalware.push_back(std::move(info));
+                } else if (fields[0] == "X" && fields.size() == 2) {
+                    failure = Utils::UnescapeField(fields[1]);
+                    worker.assigned.clear();
+                } else if (fields[0] == "C") {
+                    result.totalFilesProcessed += worker.partial.totalFilesProcessed;
+                    result.errorsCount += worker.partial.errorsCount;
+                    result.hardLinkDuplicates += worker.partial.hardLinkDuplicates;
+                    result.contentDuplicates += worker.partial.contentDuplicates;
+                    result.duplicateBytesSkipped += worker.partial.duplicateBytesSkipped;
+                    for (auto& info : worker.partial.detectedMalware) {
+                        logger.LogMalware(info);
+                        result.detectedMalware.push_back(std::move(info));
+                    }
+                    worker.partial = ScanResult{};
+                    worker.assigned.clear();
+                }
+            }
+        }
+    }
+
+    for (auto& worker : workers) {
+        if (worker.fd >= 0) {
+            SendAll(worker.fd, "Q\n");
+            close(worker.fd);
+        }
+        int status = 0;
+        while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) {
+        }
+    }
+
+    if (failure) {
+        throw std::runtime_error(*failure);
+    }
+    if (!queue.empty()) {
+        throw std::runtime_error("All worker processes exited, " + std::to_string(queue.size()) +
+                                 " shards were not scanned");
+    }
+    result.malwareFilesDetected = result.detectedMalware.size();
+    if (stopped) {
+        logger.LogInfo("Scan stopped by user");
+    } else {
+        logger.LogInfo("Scan completed");
+    }
+    return result;
+}
+
+#else
+
+ScanResult ShardCoordinator::Run(const ScanSettings&, Logger&, const std::atomic<bool>&) {
+    throw std::runtime_error("Worker processes are not supported on this platform");
+}
+
+#endif
+
+} // namespace Scanner
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "scannerApi.h"
+
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+
+namespace Scanner {
+
+class Logger;
+
+// Runs one scan as several local processes. The tree is split into shards by
+// a hash of each file's path below the root; every worker is a fork of this
+// process, connected to it by a socket pair, that scans the shards it is handed
+// and asks for more. Shards go out in shrinking pieces, so workers that finish
+// early take over the shards slower ones have not reached. Results are merged
+// as they come back, and the shards of a worker that dies go to the others.
+//
+// Lines on the socket, fields separated by tabs:
+//   to a worker:    S <TAB> shard count <TAB> shard,shard,...     Q (exit)
+//   from a worker:  F <TAB> files    E <TAB> errors    M <TAB> similarity <TAB> hash <TAB> verdict <TAB> path
+//                   D <TAB> hard links <TAB> shared-extent files <TAB> bytes (duplicates skipped)
+//                   C (those shards are done)    X <TAB> message (the scan failed)
+class ShardCoordinator {
+public:
+    // Shard of a file from its path relative to the scan root, with '/'
+    // separators, so every process and host agrees on it
+    static size_t ShardOf(std::string_view relativePath, size_t shardCount);
+
+    // Splits the scan over settings.workerProcesses workers; they log to the
+    // log path with ".worker<N>" appended. Stops handing out shards and ends
+    // the workers once stopRequested is set. Throws when no worker could be
+    // started, a worker's scan failed, or shards are left that no worker is
+    // alive to scan.
+    static ScanResult Run(const ScanSettings& settings, Logger& logger, const std::atomic<bool>& stopRequested);
+};
+
+} // namespace Scanner
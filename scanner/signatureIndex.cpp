@@ -0,0 +1,765 @@
+#include "signatureIndex.h"
+#include "scannerConstants.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Scanner {
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'C', 'N', 'I', 'N', 'D', 'E', 'X'};
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t ORDER_MARK = 0x01020304;
+constexpr size_t PAGE_BYTES = Constants::INDEX_PAGE_SIZE;
+constexpr size_t CACHE_SHARDS = 16;
+constexpr size_t RUN_READ_RECORDS = 64 * 1024;
+
+struct SectionHeader {
+    uint64_t firstPage;
+    uint64_t pageCount;
+    uint64_t entries;
+};
+
+// Page 0 of the file; digest pages follow, then the metadata
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t pageSize;
+    uint64_t metadataOffset;
+    uint64_t metadataSize;
+    SectionHeader sections[HASH_ALGORITHM_COUNT];
+};
+
+static_assert(sizeof(FileHeader) <= PAGE_BYTES, "Index header fits its page");
+
+template <size_t N>
+struct Record {
+    unsigned char digest[N];
+    uint32_t id;
+};
+
+static_assert(sizeof(Record<16>) == 20 && sizeof(Record<20>) == 24 && sizeof(Record<32>) == 36,
+              "Records are packed");
+
+template <size_t N>
+bool RecordLess(const Record<N>& a, const Record<N>& b) {
+    return std::memcmp(a.digest, b.digest, N) < 0;
+}
+
+// Big-endian, so that fences order like the digests they start
+uint64_t Fence(const unsigned char* digest) {
+    uint64_t fence = 0;
+    for (size_t i = 0; i < sizeof(fence); ++i) {
+        fence = (fence << 8) | digest[i];
+    }
+    return fence;
+}
+
+size_t RecordSize(HashAlgorithm algorithm) {
+    return DigestSize(algorithm) + sizeof(uint32_t);
+}
+
+void PutU64(std::string& out, uint64_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void PutString(std::string& out, const std::string& value) {
+    PutU64(out, value.size());
+    out += value;
+}
+
+class BlobReader {
+public:
+    explicit BlobReader(const std::string& data) : data_(data) {}
+
+    bool U64(uint64_t& value) {
+        if (data_.size() - position_ < sizeof(value)) {
+            return false;
+        }
+        std::memcpy(&value, data_.data() + position_, sizeof(value));
+        position_ += sizeof(value);
+        return true;
+    }
+
+    bool String(std::string& value) {
+        uint64_t size = 0;
+        if (!U64(size) || data_.size() - position_ < size) {
+            return false;
+        }
+        value.assign(data_, position_, static_cast<size_t>(size));
+        position_ += static_cast<size_t>(size);
+        return true;
+    }
+
+    // A count of items of at least itemSize bytes each that the rest can hold
+    bool Count(uint64_t& count, size_t itemSize) {
+        return U64(count) && count <= (data_.size() - position_) / itemSize;
+    }
+
+private:
+    const std::string& data_;
+    size_t position_ = 0;
+};
+
+void Write(std::ofstream& out, const void* data, size_t size) {
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    if (!out) {
+        throw std::runtime_error("Cannot write signature index");
+    }
+}
+
+// Fills pages with the records next() yields in digest order. Of equal
+// digests the last one is kept.
+template <size_t N, typename Next>
+SectionHeader WritePages(std::ofstream& out, uint64_t& nextPage, std::vector<uint64_t>& fences, Next next) {
+    constexpr size_t PER_PAGE = PAGE_BYTES / sizeof(Record<N>);
+    std::vector<unsigned char> page(PAGE_BYTES, 0);
+    SectionHeader section{nextPage, 0, 0};
+    size_t inPage = 0;
+
+    auto emit = [&](const Record<N>& record) {
+        if (inPage == 0) {
+            fences.push_back(Fence(record.digest));
+        }
+        std::memcpy(page.data() + inPage * sizeof(record), &record, sizeof(record));
+        ++section.entries;
+        if (++inPage == PER_PAGE) {
+            Write(out, page.data(), page.size());
+            std::fill(page.begin(), page.end(), 0);
+            ++section.pageCount;
+            inPage = 0;
+        }
+    };
+
+    Record<N> pending;
+    Record<N> record;
+    bool havePending = false;
+    while (next(record)) {
+        if (havePending && std::memcmp(pending.digest, record.digest, N) != 0) {
+            emit(pending);
+        }
+        pending = record;
+        havePending = true;
+    }
+    if (havePending) {
+        emit(pending);
+    }
+    if (inPage != 0) {
+        Write(out, page.data(), page.size());
+        ++section.pageCount;
+    }
+    nextPage += section.pageCount;
+    return section;
+}
+
+template <size_t N>
+class RunReader {
+public:
+    explicit RunReader(const std::string& path) : in_(path, std::ios::binary) {
+        if (!in_) {
+            throw std::runtime_error("Cannot read index run: " + path);
+        }
+    }
+
+    bool Next(Record<N>& record) {
+        if (position_ == buffer_.size()) {
+            buffer_.resize(RUN_READ_RECORDS);
+            in_.read(reinterpret_cast<char*>(buffer_.data()),
+                     static_cast<std::streamsize>(buffer_.size() * sizeof(Record<N>)));
+            buffer_.resize(static_cast<size_t>(in_.gcount()) / sizeof(Record<N>));
+            position_ = 0;
+            if (buffer_.empty()) {
+                return false;
+            }
+        }
+        record = buffer_[position_++];
+        return true;
+    }
+
+private:
+    std::ifstream in_;
+    std::vector<Record<N>> buffer_;
+    size_t position_ = 0;
+};
+
+// The digests of one type: a sorted buffer, spilled to run files when the
+// builder runs out of memory, and merged into pages at the end
+template <size_t N>
+struct RunSet {
+    std::vector<Record<N>> buffer;
+    std::vector<std::string> runs;
+
+    void Add(const unsigned char* digest, uint32_t id) {
+        buffer.emplace_back();
+        std::memcpy(buffer.back().digest, digest, N);
+        buffer.back().id = id;
+    }
+
+    // Stable, so that of equal digests the one added last stays last
+    void Spill(const std::string& path) {
+        std::stable_sort(buffer.begin(), buffer.end(), RecordLess<N>);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        Write(out, buffer.data(), buffer.size() * sizeof(Record<N>));
+        runs.push_back(path);
+        buffer.clear();
+    }
+
+    template <typename RunPath>
+    SectionHeader Emit(std::ofstream& out, uint64_t& nextPage, std::vector<uint64_t>& fences, RunPath runPath) {
+        if (runs.empty()) {
+            std::stable_sort(buffer.begin(), buffer.end(), RecordLess<N>);
+            size_t next = 0;
+            return WritePages<N>(out, nextPage, fences, [&](Record<N>& record) {
+                if (next == buffer.size()) {
+                    return false;
+                }
+                record = buffer[next++];
+                return true;
+            });
+        }
+
+        if (!buffer.empty()) {
+            Spill(runPath());
+        }
+        std::vector<std::unique_ptr<RunReader<N>>> readers;
+        // Ties go to the earlier run first, so the later digest is the one kept
+        using Head = std::pair<Record<N>, size_t>;
+        auto later = [](const Head& a, const Head& b) {
+            const int order = std::memcmp(a.first.digest, b.first.digest, N);
+            return order != 0 ? order > 0 : a.second > b.second;
+        };
+        std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+        for (const auto& run : runs) {
+            readers.push_back(std::make_unique<RunReader<N>>(run));
+            Record<N> record;
+            if (readers.back()->Next(record)) {
+                heads.emplace(record, readers.size() - 1);
+            }
+        }
+        return WritePages<N>(out, nextPage, fences, [&](Record<N>& record) {
+            if (heads.empty()) {
+                return false;
+            }
+            const size_t run = heads.top().second;
+            record = heads.top().first;
+            heads.pop();
+            Record<N> following;
+            if (readers[run]->Next(following)) {
+                heads.emplace(following, run);
+            }
+            return true;
+        });
+    }
+
+    void RemoveRuns() {
+        for (const auto& run : runs) {
+            std::error_code ec;
+            std::filesystem::remove(run, ec);
+        }
+        runs.clear();
+    }
+};
+
+// Most recently used pages, split into shards so that threads looking up
+// different pages rarely wait for each other. Pages are copied in and out,
+// so nothing handed out can be evicted under its reader.
+class PageCache {
+public:
+    explicit PageCache(size_t pages) {
+        for (auto& shard : shards_) {
+            shard.capacity = (pages + CACHE_SHARDS - 1) / CACHE_SHARDS;
+        }
+    }
+
+    bool Get(uint64_t page, unsigned char* data) {
+        Shard& shard = ShardOf(page);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto found = shard.pages.find(page);
+        if (found == shard.pages.end()) {
+            return false;
+        }
+        shard.order.splice(shard.order.begin(), shard.order, found->second);
+        std::memcpy(data, shard.frames[found->second->second].get(), PAGE_BYTES);
+        return true;
+    }
+
+    void Put(uint64_t page, const unsigned char* data) {
+        Shard& shard = ShardOf(page);
+        if (shard.capacity == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.pages.count(page) != 0) {
+            return;
+        }
+        size_t frame;
+        if (shard.frames.size() < shard.capacity) {
+            frame = shard.frames.size();
+            shard.frames.push_back(std::make_unique<unsigned char[]>(PAGE_BYTES));
+        } else {
+            frame = shard.order.back().second;
+            shard.pages.erase(shard.order.back().first);
+            shard.order.pop_back();
+        }
+        std::memcpy(shard.frames[frame].get(), data, PAGE_BYTES);
+        shard.order.emplace_front(page, frame);
+        shard.pages.emplace(page, shard.order.begin());
+    }
+
+private:
+    struct Shard {
+        std::mutex mutex;
+        size_t capacity = 0;
+        std::vector<std::unique_ptr<unsigned char[]>> frames;
+        std::list<std::pair<uint64_t, size_t>> order;  // Page and frame, most recent first
+        std::unordered_map<uint64_t, std::list<std::pair<uint64_t, size_t>>::iterator> pages;
+    };
+
+    Shard& ShardOf(uint64_t page) {
+        return shards_[static_cast<size_t>((page * 0x9E3779B97F4A7C15ull) >> 60) % CACHE_SHARDS];
+    }
+
+    std::array<Shard, CACHE_SHARDS> shards_;
+};
+
+} // namespace
+
+struct SignatureIndex::Builder::Impl {
+    std::string path;
+    std::string stem;  // Of the temporary files, unique to the builder
+    std::string temporaryPath;
+    size_t memoryBudget;
+    size_t buffered = 0;
+    size_t nextRun = 0;
+    RunSet<DigestSize(HashAlgorithm::MD5)> md5;
+    RunSet<DigestSize(HashAlgorithm::SHA1)> sha1;
+    RunSet<DigestSize(HashAlgorithm::SHA256)> sha256;
+    RunSet<DigestSize(HashAlgorithm::TREE)> tree;
+
+    std::string RunPath() {
+        return stem + ".run" + std::to_string(nextRun++);
+    }
+
+    void SpillAll() {
+        if (!md5.buffer.empty()) md5.Spill(RunPath());
+        if (!sha1.buffer.empty()) sha1.Spill(RunPath());
+        if (!sha256.buffer.empty()) sha256.Spill(RunPath());
+        if (!tree.buffer.empty()) tree.Spill(RunPath());
+        buffered = 0;
+    }
+
+    ~Impl() {
+        md5.RemoveRuns();
+        sha1.RemoveRuns();
+        sha256.RemoveRuns();
+        tree.RemoveRuns();
+        std::error_code ec;
+        std::filesystem::remove(temporaryPath, ec);
+    }
+};
+
+SignatureIndex::Builder::Builder(const std::string& path, size_t memoryBudget) : impl_(std::make_unique<Impl>()) {
+    // Scan workers may build the same index at once; each writes its own
+    // files and the last rename wins
+    impl_->path = path;
+    impl_->stem = path + "." + std::to_string(std::random_device{}());
+    impl_->temporaryPath = impl_->stem + ".tmp";
+    impl_->memoryBudget = memoryBudget;
+}
+
+SignatureIndex::Builder::~Builder() = default;
+
+void SignatureIndex::Builder::Add(HashAlgorithm algorithm, const unsigned char* digest, uint32_t id) {
+    switch (algorithm) {
+        case HashAlgorithm::MD5: impl_->md5.Add(digest, id); break;
+        case HashAlgorithm::SHA1: impl_->sha1.Add(digest, id); break;
+        case HashAlgorithm::SHA256: impl_->sha256.Add(digest, id); break;
+        case HashAlgorithm::TREE: impl_->tree.Add(digest, id); break;
+        case HashAlgorithm::SSDEEP: return;
+    }
+    impl_->buffered += RecordSize(algorithm);
+    if (impl_->buffered >= impl_->memoryBudget) {
+        impl_->SpillAll();
+    }
+}
+
+void SignatureIndex::Builder::Finish(const Metadata& metadata) {
+    std::ofstream out(impl_->temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot create signature index: " + impl_->temporaryPath);
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::vector<unsigned char> first(PAGE_BYTES, 0);
+    Write(out, first.data(), first.size());
+
+    uint64_t nextPage = 1;
+    std::array<std::vector<uint64_t>, HASH_ALGORITHM_COUNT> fences;
+    auto runPath = [this] { return impl_->RunPath(); };
+    auto section = [](HashAlgorithm algorithm) { return static_cast<size_t>(algorithm); };
+    header.sections[section(HashAlgorithm::MD5)] =
+        impl_->md5.Emit(out, nextPage, fences[section(HashAlgorithm::MD5)], runPath);
+    header.sections[section(HashAlgorithm::SHA1)] =
+        impl_->sha1.Emit(out, nextPage, fences[section(HashAlgorithm::SHA1)], runPath);
+    header.sections[section(HashAlgorithm::SHA256)] =
+        impl_->sha256.Emit(out, nextPage, fences[section(HashAlgorithm::SHA256)], runPath);
+    header.sections[section(HashAlgorithm::TREE)] =
+        impl_->tree.Emit(out, nextPage, fences[section(HashAlgorithm::TREE)], runPath);
+
+    std::string blob;
+    PutU64(blob, metadata.sourceSize);
+    PutU64(blob, static_cast<uint64_t>(metadata.sourceModified));
+    PutU64(blob, metadata.verdicts.size());
+    for (const auto& verdict : metadata.verdicts) {
+        PutString(blob, verdict);
+    }
+    PutU64(blob, metadata.fullHashSizes.size());
+    for (uint64_t size : metadata.fullHashSizes) {
+        PutU64(blob, size);
+    }
+    PutU64(blob, metadata.unsizedSignatures);
+    PutString(blob, metadata.memoryLines);
+    for (const auto& sectionFences : fences) {
+        for (uint64_t fence : sectionFences) {
+            PutU64(blob, fence);
+        }
+    }
+    Write(out, blob.data(), blob.size());
+
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = ORDER_MARK;
+    header.pageSize = PAGE_BYTES;
+    header.metadataOffset = nextPage * PAGE_BYTES;
+    header.metadataSize = blob.size();
+    out.seekp(0);
+    Write(out, &header, sizeof(header));
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Cannot write signature index: " + impl_->temporaryPath);
+    }
+
+    impl_->md5.RemoveRuns();
+    impl_->sha1.RemoveRuns();
+    impl_->sha256.RemoveRuns();
+    impl_->tree.RemoveRuns();
+    std::filesystem::rename(impl_->temporaryPath, impl_->path);
+}
+
+struct SignatureIndex::Impl {
+    PageCache cache;
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = -1;
+#else
+    std::mutex mutex;
+    std::ifstream file;
+#endif
+
+    explicit Impl(size_t cachePages) : cache(cachePages) {}
+
+    ~Impl() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    bool Open(const std::string& path) {
+#if defined(__unix__) || defined(__APPLE__)
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        return fd >= 0;
+#else
+        file.open(path, std::ios::binary);
+        return file.is_open();
+#endif
+    }
+
+    // False on an error or when the file ends first
+    bool ReadAt(uint64_t offset, void* data, size_t size) {
+#if defined(__unix__) || defined(__APPLE__)
+        auto* target = static_cast<unsigned char*>(data);
+        while (size > 0) {
+            const ssize_t count = pread(fd, target, size, static_cast<off_t>(offset));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                return false;
+            }
+            target += count;
+            offset += static_cast<uint64_t>(count);
+            size -= static_cast<size_t>(count);
+        }
+        return true;
+#else
+        std::lock_guard<std::mutex> lock(mutex);
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(static_cast<char*>(data), static_cast<std::streamsize>(size));
+        return static_cast<size_t>(file.gcount()) == size;
+#endif
+    }
+
+    void ReadPages(uint64_t filePage, size_t count, unsigned char* data) {
+        if (!ReadAt(filePage * PAGE_BYTES, data, count * PAGE_BYTES)) {
+            throw std::runtime_error("Cannot read signature index page " + std::to_string(filePage));
+        }
+    }
+};
+
+SignatureIndex::SignatureIndex(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+SignatureIndex::~SignatureIndex() = default;
+
+std::unique_ptr<SignatureIndex> SignatureIndex::Open(const std::string& path, size_t cachePages) {
+    auto impl = std::make_unique<Impl>(cachePages);
+    FileHeader header;
+    if (!impl->Open(path) || !impl->ReadAt(0, &header, sizeof(header)) ||
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.byteOrder != ORDER_MARK || header.pageSize != PAGE_BYTES) {
+        return nullptr;
+    }
+
+    std::error_code ec;
+    const uint64_t fileSize = std::filesystem::file_size(path, ec);
+    if (ec || header.metadataOffset > fileSize || header.metadataSize > fileSize - header.metadataOffset) {
+        return nullptr;
+    }
+    std::string blob(static_cast<size_t>(header.metadataSize), '\0');
+    if (!impl->ReadAt(header.metadataOffset, &blob[0], blob.size())) {
+        return nullptr;
+    }
+
+    std::unique_ptr<SignatureIndex> index(new SignatureIndex(std::move(impl)));
+    Metadata& metadata = index->metadata_;
+    BlobReader reader(blob);
+    uint64_t modified = 0;
+    uint64_t count = 0;
+    if (!reader.U64(metadata.sourceSize) || !reader.U64(modified) || !reader.Count(count, sizeof(uint64_t))) {
+        return nullptr;
+    }
+    metadata.sourceModified = static_cast<int64_t>(modified);
+    metadata.verdicts.resize(static_cast<size_t>(count));
+    for (auto& verdict : metadata.verdicts) {
+        if (!reader.String(verdict)) {
+            return nullptr;
+        }
+    }
+    if (!reader.Count(count, sizeof(uint64_t))) {
+        return nullptr;
+    }
+    metadata.fullHashSizes.resize(static_cast<size_t>(count));
+    for (auto& size : metadata.fullHashSizes) {
+        reader.U64(size);
+    }
+    if (!reader.U64(metadata.unsizedSignatures) || !reader.String(metadata.memoryLines)) {
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < HASH_ALGORITHM_COUNT; ++i) {
+        const auto algorithm = static_cast<HashAlgorithm>(i);
+        const SectionHeader& stored = header.sections[i];
+        Section& section = index->sections_[i];
+        if (stored.pageCount == 0) {
+            continue;
+        }
+        const uint64_t perPage = PAGE_BYTES / RecordSize(algorithm);
+        if (!IsExactDigest(algorithm) || stored.firstPage == 0 ||
+            stored.firstPage + stored.pageCount > header.metadataOffset / PAGE_BYTES ||
+            stored.entries > stored.pageCount * perPage || stored.entries <= (stored.pageCount - 1) * perPage) {
+            return nullptr;
+        }
+        section.firstPage = stored.firstPage;
+        section.pageCount = stored.pageCount;
+        section.entries = stored.entries;
+        section.fences.resize(static_cast<size_t>(stored.pageCount));
+        for (auto& fence : section.fences) {
+            if (!reader.U64(fence)) {
+                return nullptr;
+            }
+        }
+    }
+    return index;
+}
+
+uint64_t SignatureIndex::Size() const {
+    uint64_t size = 0;
+    for (const auto& section : sections_) {
+        size += section.entries;
+    }
+    return size;
+}
+
+HashAlgorithmMask SignatureIndex::Algorithms() const {
+    HashAlgorithmMask mask = 0;
+    for (size_t i = 0; i < HASH_ALGORITHM_COUNT; ++i) {
+        if (sections_[i].entries != 0) {
+            mask |= MaskOf(static_cast<HashAlgorithm>(i));
+        }
+    }
+    return mask;
+}
+
+const SignatureIndex::Section* SignatureIndex::SectionOf(HashAlgorithm algorithm) const {
+    const Section& section = sections_[static_cast<size_t>(algorithm)];
+    return section.pageCount != 0 ? &section : nullptr;
+}
+
+bool SignatureIndex::PageOf(const Section& section, const unsigned char* digest, uint64_t& page) {
+    auto after = std::upper_bound(section.fences.begin(), section.fences.end(), Fence(digest));
+    if (after == section.fences.begin()) {
+        return false;
+    }
+    page = static_cast<uint64_t>(after - section.fences.begin()) - 1;
+    return true;
+}
+
+uint32_t SignatureIndex::SearchPage(const Section& section, size_t digestSize, uint64_t page,
+                                    const unsigned char* data, const unsigned char* digest) const {
+    const size_t recordSize = digestSize + sizeof(uint32_t);
+    const uint64_t perPage = PAGE_BYTES / recordSize;
+    const size_t count = static_cast<size_t>(page + 1 < section.pageCount ? perPage
+                                                                          : section.entries - page * perPage);
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        const unsigned char* record = data + middle * recordSize;
+        const int order = std::memcmp(record, digest, digestSize);
+        if (order == 0) {
+            uint32_t id;
+            std::memcpy(&id, record + digestSize, sizeof(id));
+            return id;
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return 0;
+}
+
+void SignatureIndex::LoadPage(uint64_t filePage, unsigned char* data) const {
+    if (!impl_->cache.Get(filePage, data)) {
+        impl_->ReadPages(filePage, 1, data);
+        impl_->cache.Put(filePage, data);
+    }
+}
+
+uint32_t SignatureIndex::FindBefore(const Section& section, size_t digestSize, uint64_t page,
+                                    const unsigned char* digest) const {
+    // Digests sharing their leading eight bytes can straddle a page boundary;
+    // with real digests that never happens, so this rarely reads anything
+    thread_local std::vector<unsigned char> data(PAGE_BYTES);
+    const uint64_t fence = Fence(digest);
+    while (page > 0 && section.fences[page] == fence) {
+        --page;
+        LoadPage(section.firstPage + page, data.data());
+        if (uint32_t id = SearchPage(section, digestSize, page, data.data(), digest)) {
+            return id;
+        }
+    }
+    return 0;
+}
+
+uint32_t SignatureIndex::Find(HashAlgorithm algorithm, const unsigned char* digest) const {
+    const Section* section = SectionOf(algorithm);
+    uint64_t page = 0;
+    if (section == nullptr || !PageOf(*section, digest, page)) {
+        return 0;
+    }
+    thread_local std::vector<unsigned char> data(PAGE_BYTES);
+    LoadPage(section->firstPage + page, data.data());
+    if (uint32_t id = SearchPage(*section, DigestSize(algorithm), page, data.data(), digest)) {
+        return id;
+    }
+    return FindBefore(*section, DigestSize(algorithm), page, digest);
+}
+
+void SignatureIndex::FindBatch(std::vector<Lookup>& lookups) const {
+    // (file page, lookup) in page order, so each page is visited once
+    thread_local std::vector<std::pair<uint64_t, size_t>> order;
+    thread_local std::vector<unsigned char> pages(Constants::INDEX_COALESCED_PAGES * PAGE_BYTES);
+    thread_local std::vector<size_t> starts;  // First lookup of each page of one read
+    order.clear();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        lookups[i].id = 0;
+        const Section* section = SectionOf(lookups[i].algorithm);
+        uint64_t page = 0;
+        if (section != nullptr && PageOf(*section, lookups[i].digest, page)) {
+            order.emplace_back(section->firstPage + page, i);
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    auto resolve = [&](size_t begin, size_t end, const unsigned char* data) {
+        for (size_t k = begin; k < end; ++k) {
+            Lookup& lookup = lookups[order[k].second];
+            const Section& section = *SectionOf(lookup.algorithm);
+            const uint64_t page = order[k].first - section.firstPage;
+            const size_t digestSize = DigestSize(lookup.algorithm);
+            lookup.id = SearchPage(section, digestSize, page, data, lookup.digest);
+            if (lookup.id == 0) {
+                lookup.id = FindBefore(section, digestSize, page, lookup.digest);
+            }
+        }
+    };
+    // End of the lookups on the page that order[begin] is on
+    auto groupEnd = [&](size_t begin) {
+        size_t end = begin + 1;
+        while (end < order.size() && order[end].first == order[begin].first) {
+            ++end;
+        }
+        return end;
+    };
+
+    size_t next = 0;
+    while (next < order.size()) {
+        const uint64_t first = order[next].first;
+        if (impl_->cache.Get(first, pages.data())) {
+            const size_t end = groupEnd(next);
+            resolve(next, end, pages.data());
+            next = end;
+            continue;
+        }
+
+        // A missing page and the needed pages right after it, in one read
+        starts.assign(1, next);
+        size_t end = groupEnd(next);
+        while (end < order.size() && starts.size() < Constants::INDEX_COALESCED_PAGES &&
+               order[end].first == first + starts.size()) {
+            starts.push_back(end);
+            end = groupEnd(end);
+        }
+        impl_->ReadPages(first, starts.size(), pages.data());
+        for (size_t page = 0; page < starts.size(); ++page) {
+            const unsigned char* data = pages.data() + page * PAGE_BYTES;
+            impl_->cache.Put(first + page, data);
+            resolve(starts[page], page + 1 < starts.size() ? starts[page + 1] : end, data);
+        }
+        next = end;
+    }
+}
+
+} // namespace Scanner
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "hashTypes.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Scanner {
+
+// Exact digests of a signature base kept on disk, for bases too large to
+// hold in memory. Each digest type is sorted into pages of INDEX_PAGE_SIZE
+// bytes; the only part in memory is a directory with the leading eight
+// bytes of every page's first digest (8 bytes per page, about 20 MB for
+// 500M MD5 signatures). A lookup searches that directory, then reads and
+// searches one page, so a digest that is not in the cache costs one page
+// read. Recently used pages stay in an LRU cache shared by all threads.
+//
+// The file is written in native byte order by Builder and is only read
+// back by the machine type that wrote it; a base that changed, or an index
+// from another version, is rebuilt by HashDatabase::LoadIndexed.
+class SignatureIndex {
+public:
+    // Everything that is not a sorted digest, loaded into memory on Open
+    struct Metadata {
+        uint64_t sourceSize = 0;       // The CSV the index was built from
+        int64_t sourceModified = 0;
+        std::vector<std::string> verdicts;  // Id i + 1 is verdicts[i]
+        std::vector<uint64_t> fullHashSizes;  // Sample sizes of the exact signatures that carry one
+        uint64_t unsizedSignatures = 0;        // Exact signatures without a size
+        std::string memoryLines;  // CSV lines of ssdeep and byte signatures, which stay in memory
+    };
+
+    // Sorts digests into an index file. Digests are buffered up to
+    // memoryBudget bytes, then sorted and spilled to run files beside the
+    // index, which are merged when the index is finished; so building needs
+    // that much memory whatever the size of the base. A digest added twice
+    // keeps the id added last.
+    class Builder {
+    public:
+        Builder(const std::string& path, size_t memoryBudget);
+        ~Builder();
+
+        Builder(const Builder&) = delete;
+        Builder& operator=(const Builder&) = delete;
+
+        // id is never 0
+        void Add(HashAlgorithm algorithm, const unsigned char* digest, uint32_t id);
+        // Writes the index next to its final path and renames it into place; throws on I/O errors
+        void Finish(const Metadata& metadata);
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> impl_;
+    };
+
+    // A digest to resolve; id is set to the signature's id, or 0
+    struct Lookup {
+        HashAlgorithm algorithm;
+        const unsigned char* digest;
+        uint32_t id;
+    };
+
+    // Nothing when the file is missing or is not an index of this version
+    static std::unique_ptr<SignatureIndex> Open(const std::string& path, size_t cachePages);
+    ~SignatureIndex();
+
+    SignatureIndex(const SignatureIndex&) = delete;
+    SignatureIndex& operator=(const SignatureIndex&) = delete;
+
+    const Metadata& GetMetadata() const { return metadata_; }
+    uint64_t Size() const;
+    // Exact digest types with at least one signature
+    HashAlgorithmMask Algorithms() const;
+
+    // Safe to call from several threads at once; throws on read errors
+    uint32_t Find(HashAlgorithm algorithm, const unsigned char* digest) const;
+    // Resolves a group: digests in the same page share one read of it, and
+    // pages missing from the cache that lie next to each other on disk are
+    // fetched with a single read of up to INDEX_COALESCED_PAGES pages
+    void FindBatch(std::vector<Lookup>& lookups) const;
+
+private:
+    struct Section {
+        uint64_t firstPage = 0;  // In pages from the start of the file
+        uint64_t pageCount = 0;
+        uint64_t entries = 0;
+        std::vector<uint64_t> fences;  // Leading bytes of each page's first digest, big-endian
+    };
+    struct Impl;
+
+    explicit SignatureIndex(std::unique_ptr<Impl> impl);
+
+    const Section* SectionOf(HashAlgorithm algorithm) const;
+    // Last page whose first digest is not above the digest; false if there is none
+    static bool PageOf(const Section& section, const unsigned char* digest, uint64_t& page);
+    uint32_t SearchPage(const Section& section, size_t digestSize, uint64_t page, const unsigned char* data,
+                        const unsigned char* digest) const;
+    // Reads the page through the cache
+    void LoadPage(uint64_t filePage, unsigned char* data) const;
+    // Searches the pages before page whose first digests share the leading bytes
+    uint32_t FindBefore(const Section& section, size_t digestSize, uint64_t page, const unsigned char* digest) const;
+
+    std::array<Section, HASH_ALGORITHM_COUNT> sections_;
+    Metadata metadata_;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace Scanner
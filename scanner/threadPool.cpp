@@ -2,12 +2,15 @@
 
 namespace Scanner {
 
-ThreadPool::ThreadPool(size_t numThreads) 
+ThreadPool::ThreadPool(size_t numThreads, std::function<void(size_t worker)> onStart) 
     : stop_(false), activeTasks_(0) {
     if (numThreads == 0)
         throw std::invalid_argument("ThreadPool must have at least 1 thread");
     for (size_t i = 0; i < numThreads; ++i) {
-        workers_.emplace_back([this] {
+        workers_.emplace_back([this, onStart, i] {
+            if (onStart) {
+                onStart(i);
+            }
             while (true) {
                 std::function<void()> task;
                 
@@ -48,6 +51,13 @@ void ThreadPool::Wait() {
     });
 }
 
+bool ThreadPool::WaitFor(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(queueMutex_);
+    return finished_.wait_for(lock, timeout, [this] { 
+        return tasks_.empty() && activeTasks_ == 0; 
+    });
+}
+
 void ThreadPool::Stop() {
     {
         std::unique_lock<std::mutex> lock(queueMutex_);
@@ -7,12 +7,14 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 #include <stdexcept>
 
 namespace Scanner {
 class ThreadPool {
 public:
-    explicit ThreadPool(size_t numThreads);
+    // onStart, if set, runs first on every worker thread with its index
+    explicit ThreadPool(size_t numThreads, std::function<void(size_t worker)> onStart = nullptr);
     ~ThreadPool();
 
 public:
@@ -30,6 +32,8 @@ public:
     
 public:
     void Wait();
+    // Returns false if tasks are still running when the timeout expires
+    bool WaitFor(std::chrono::milliseconds timeout);
     void Stop();
 
 private:
@@ -0,0 +1,130 @@
+#include "throttle.h"
+#include "scannerConstants.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace Scanner {
+
+namespace {
+
+int64_t NowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+RateLimiter::RateLimiter(uint64_t ratePerSecond, uint64_t burst)
+    : nanosPerUnit_(ratePerSecond != 0 ? 1e9 / static_cast<double>(ratePerSecond) : 0.0),
+      burst_(static_cast<int64_t>(static_cast<double>(burst) * nanosPerUnit_)),
+      paidUntil_(NowNanos()) {
+    if (ratePerSecond == 0) {
+        throw std::invalid_argument("RateLimiter rate must be positive");
+    }
+}
+
+std::chrono::nanoseconds RateLimiter::Reserve(uint64_t units) {
+    const int64_t now = NowNanos();
+    const auto cost = static_cast<int64_t>(static_cast<double>(units) * nanosPerUnit_);
+    int64_t paidUntil = paidUntil_.load(std::memory_order_relaxed);
+    int64_t start = 0;
+    do {
+        // Time not used while idle is credit, but only up to the burst
+        start = std::max(paidUntil, now - burst_);
+    } while (!paidUntil_.compare_exchange_weak(paidUntil, start + cost, std::memory_order_relaxed));
+    return std::chrono::nanoseconds(std::max<int64_t>(0, start - now));
+}
+
+void RateLimiter::Acquire(uint64_t units) {
+    const auto wait = Reserve(units);
+    if (wait.count() > 0) {
+        std::this_thread::sleep_for(wait);
+    }
+}
+
+ConcurrencyLimiter::Slot::Slot(Slot&& other) noexcept
+    : limiter_(std::exchange(other.limiter_, nullptr)) {}
+
+ConcurrencyLimiter::Slot::~Slot() {
+    if (limiter_ != nullptr) {
+        limiter_->Leave();
+    }
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter(size_t maxLimit, bool adaptive)
+    : maxLimit_(maxLimit), adaptive_(adaptive), limit_(maxLimit) {
+    if (maxLimit == 0) {
+        throw std::invalid_argument("ConcurrencyLimiter limit must be positive");
+    }
+}
+
+ConcurrencyLimiter::Slot ConcurrencyLimiter::Enter() {
+    if (!TryEnter()) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiting_.fetch_add(1);
+        released_.wait(lock, [this] { return TryEnter(); });
+        waiting_.fetch_sub(1);
+    }
+    return Slot(this);
+}
+
+bool ConcurrencyLimiter::TryEnter() {
+    size_t active = active_.load();
+    while (active < limit_.load(std::memory_order_relaxed)) {
+        if (active_.compare_exchange_weak(active, active + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ConcurrencyLimiter::Leave() {
+    active_.fetch_sub(1);
+    // A waiter registers before it checks the limit, so either it sees this
+    // slot free or this sees it waiting
+    if (waiting_.load() > 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        released_.notify_one();
+    }
+}
+
+void ConcurrencyLimiter::RecordLatency(std::chrono::nanoseconds latency) {
+    if (!adaptive_) {
+        return;
+    }
+    windowNanos_.fetch_add(latency.count(), std::memory_order_relaxed);
+    // The read that completes a window adjusts the limit; samples landing
+    // while it does so count toward the next window
+    if (samples_.fetch_add(1, std::memory_order_relaxed) + 1 == Constants::LATENCY_WINDOW) {
+        const int64_t total = windowNanos_.exchange(0, std::memory_order_relaxed);
+        samples_.store(0, std::memory_order_relaxed);
+        Adjust(total / static_cast<int64_t>(Constants::LATENCY_WINDOW));
+    }
+}
+
+void ConcurrencyLimiter::Adjust(int64_t windowMean) {
+    const int64_t average = averageNanos_.load(std::memory_order_relaxed);
+    // The long-run mean moves by an eighth per window, so a change in the mix
+    // of read sizes costs one backoff rather than a lasting low limit
+    averageNanos_.store(average == 0 ? windowMean : average + (windowMean - average) / 8,
+                        std::memory_order_relaxed);
+    if (average == 0) {
+        return;
+    }
+
+    const size_t limit = limit_.load(std::memory_order_relaxed);
+    if (windowMean > average * static_cast<int64_t>(Constants::LATENCY_BACKOFF_FACTOR)) {
+        limit_.store(limit > 1 ? limit - std::max<size_t>(1, limit / 4) : 1, std::memory_order_relaxed);
+    } else if (limit < maxLimit_) {
+        limit_.store(limit + 1, std::memory_order_relaxed);
+        if (waiting_.load() > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            released_.notify_one();
+        }
+    }
+}
+
+} // namespace Scanner
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace Scanner {
+
+// Token bucket shared by all workers, as a single atomic "paid until" time
+// (the generic cell rate algorithm): a caller claims its cost with one
+// compare-and-swap and sleeps off any debt, so there is no lock and the
+// long-run rate is exact. A request may start while the bucket holds any of
+// its burst; what it overdraws is paid by the next callers.
+class RateLimiter {
+public:
+    // ratePerSecond units per second, up to burst units at once after idling
+    RateLimiter(uint64_t ratePerSecond, uint64_t burst);
+
+    // Claims units and returns how long the caller must wait before using them
+    std::chrono::nanoseconds Reserve(uint64_t units);
+    // Reserve() and sleep
+    void Acquire(uint64_t units);
+
+private:
+    const double nanosPerUnit_;
+    const int64_t burst_;  // In nanoseconds of rate
+    std::atomic<int64_t> paidUntil_;
+};
+
+// Workers allowed to read at once. With adaptive on, the limit follows read
+// latency like a congestion window: when the mean latency of a window of
+// reads exceeds LATENCY_BACKOFF_FACTOR times its long-run average, the limit
+// drops by a quarter, otherwise it grows by one up to the maximum. Entering
+// and recording are atomic operations; only workers over the limit block.
+class ConcurrencyLimiter {
+public:
+    class Slot {
+    public:
+        Slot(Slot&& other) noexcept;
+        Slot& operator=(Slot&&) = delete;
+        ~Slot();
+
+    private:
+        friend class ConcurrencyLimiter;
+        explicit Slot(ConcurrencyLimiter* limiter) : limiter_(limiter) {}
+
+        ConcurrencyLimiter* limiter_;
+    };
+
+    ConcurrencyLimiter(size_t maxLimit, bool adaptive);
+
+    // Waits while the limit is taken
+    Slot Enter();
+    // One read's latency; ignored unless adaptive
+    void RecordLatency(std::chrono::nanoseconds latency);
+    size_t Limit() const { return limit_.load(std::memory_order_relaxed); }
+
+private:
+    bool TryEnter();
+    void Leave();
+    void Adjust(int64_t windowMean);
+
+    const size_t maxLimit_;
+    const bool adaptive_;
+    std::atomic<size_t> limit_;
+    std::atomic<size_t> active_{0};
+    std::atomic<size_t> samples_{0};
+    std::atomic<int64_t> windowNanos_{0};
+    std::atomic<int64_t> averageNanos_{0};  // Long-run mean, 0 until the first window
+    // Only used by workers that are over the limit
+    std::atomic<size_t> waiting_{0};
+    std::mutex mutex_;
+    std::condition_variable released_;
+};
+
+// What FileReader consults around every read; either part may be absent
+struct ReadThrottle {
+    RateLimiter* bytes = nullptr;
+    ConcurrencyLimiter* concurrency = nullptr;
+};
+
+} // namespace Scanner
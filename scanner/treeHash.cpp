@@ -0,0 +1,47 @@
+#include "treeHash.h"
+
+#include <algorithm>
+
+namespace Scanner {
+
+TreeHasher::TreeHasher() {
+    chunk_.emplace();
+}
+
+TreeHasher::~TreeHasher() = default;
+
+void TreeHasher::Update(const void* data, size_t size) {
+    auto bytes = static_cast<const unsigned char*>(data);
+    while (size != 0) {
+        if (chunkBytes_ == CHUNK_SIZE) {
+            leaves_.push_back(chunk_->Final());
+            chunk_.emplace();
+            chunkBytes_ = 0;
+        }
+        const size_t count = std::min(size, CHUNK_SIZE - chunkBytes_);
+        chunk_->Update(bytes, count);
+        chunkBytes_ += count;
+        bytes += count;
+        size -= count;
+    }
+}
+
+TreeHasher::Digest TreeHasher::Final() {
+    // The last chunk may be short, but is never dropped: it is the only leaf of an empty input
+    leaves_.push_back(chunk_->Final());
+    return Root(leaves_);
+}
+
+TreeHasher::Digest TreeHasher::Leaf(const void* data, size_t size) {
+    return SHA256Calculator::Hash(data, size, SHA256Calculator::StreamBackend());
+}
+
+TreeHasher::Digest TreeHasher::Root(const std::vector<Digest>& leaves) {
+    return SHA256Calculator::Hash(leaves.data(), leaves.size() * sizeof(Digest), SHA256Calculator::StreamBackend());
+}
+
+size_t TreeHasher::ChunkCount(uint64_t size) {
+    return size == 0 ? 1 : static_cast<size_t>((size + CHUNK_SIZE - 1) / CHUNK_SIZE);
+}
+
+} // namespace Scanner
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "sha256Calc.h"
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace Scanner {
+
+// Two-level Merkle digest: the input is cut into CHUNK_SIZE chunks, each
+// chunk gets its own SHA-256 (a leaf), and the root is the SHA-256 of the
+// leaves concatenated in order. An empty input has one leaf, SHA-256("").
+// Leaves are independent, so the chunks of one file can be hashed on
+// different threads and combined with Root().
+class TreeHasher {
+public:
+    static constexpr size_t CHUNK_SIZE = 1024 * 1024;
+    using Digest = SHA256Calculator::Digest;
+
+    TreeHasher();
+    ~TreeHasher();
+
+    TreeHasher(const TreeHasher&) = delete;
+    TreeHasher& operator=(const TreeHasher&) = delete;
+
+    void Update(const void* data, size_t size);
+    Digest Final();
+
+    static Digest Leaf(const void* data, size_t size);
+    static Digest Root(const std::vector<Digest>& leaves);
+    static size_t ChunkCount(uint64_t size);
+
+private:
+    std::optional<SHA256Calculator> chunk_;
+    size_t chunkBytes_ = 0;
+    std::vector<Digest> leaves_;
+};
+
+} // namespace Scanner
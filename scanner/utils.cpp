@@ -1,17 +1,66 @@
 #include "utils.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
 namespace Scanner {
 namespace Utils {
 
 bool IsFileReadable(const std::filesystem::path& path) {
+#if defined(__unix__) || defined(__APPLE__)
+    // Без открытия потока: std::ifstream выделяет буфер на каждый файл
+    return access(path.c_str(), R_OK) == 0;
+#else
     std::ifstream file(path);
     return file.good();
+#endif
 }
 
 size_t GetHardwareConcurrency() {
     return std::thread::hardware_concurrency();
 }
 
+std::optional<uint64_t> GetPageCacheSize() {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    uint64_t kilobytes = 0;
+    std::string unit;
+    while (meminfo >> key >> kilobytes >> unit) {
+        if (key == "Cached:") {
+            return kilobytes * 1024;
+        }
+    }
+    return std::nullopt;
+}
+
+bool EnterBackgroundMode() {
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    // Значения из linux/ioprio.h; who = 0 означает вызывающий поток
+    constexpr int IOPRIO_CLASS_IDLE = 3;
+    constexpr int IOPRIO_CLASS_SHIFT = 13;
+    constexpr int IOPRIO_WHO_PROCESS = 1;
+    const bool ioIdle = syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) == 0;
+    
+    sched_param param{};
+    const bool cpuIdle = pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) == 0;
+    return ioIdle && cpuIdle;
+#elif defined(__APPLE__)
+    // Фоновый режим Darwin снижает приоритет и процессора, и ввода-вывода
+    return setpriority(PRIO_DARWIN_THREAD, 0, PRIO_DARWIN_BG) == 0;
+#else
+    return false;
+#endif
+}
+
 std::string ToLower(const std::string& str) {
     std::string result = str;
     std::transform(result.begin(), result.end(), result.begin(),
@@ -32,5 +81,54 @@ std::string Trim(const std::string& str) {
     return std::string(start, end);
 }
 
+uint64_t Fnv1a(std::string_view bytes, uint64_t hash) {
+    for (char c : bytes) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string EscapeField(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '\t': escaped += "\\t"; break;
+            case '\n': escaped += "\\n"; break;
+            default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string UnescapeField(const std::string& text) {
+    std::string plain;
+    plain.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size()) {
+            const char next = text[++i];
+            plain += next == 't' ? '\t' : next == 'n' ? '\n' : next;
+        } else {
+            plain += text[i];
+        }
+    }
+    return plain;
+}
+
+std::vector<std::string> SplitFields(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t begin = 0;
+    while (true) {
+        const size_t end = line.find('\t', begin);
+        fields.push_back(line.substr(begin, end - begin));
+        if (end == std::string::npos) {
+            return fields;
+        }
+        begin = end + 1;
+    }
+}
+
 } // namespace Utils
 } // namespace Scanner
\ No newline at end of file
@@ -6,6 +6,10 @@
 #include <thread>
 #include <algorithm>
 #include <cctype>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
 
 namespace Scanner {
     
@@ -15,9 +19,22 @@ namespace Utils {
     bool IsFileReadable(const std::filesystem::path& path);   
     // Получение количества процессорных ядер
     size_t GetHardwareConcurrency();
+    // Размер кэша страниц в системе (Cached из /proc/meminfo), если известен
+    std::optional<uint64_t> GetPageCacheSize();
+    // Перевод вызывающего потока в фоновый режим: класс ввода-вывода idle
+    // (ioprio) и планировщик SCHED_IDLE; false, если что-то не удалось
+    bool EnterBackgroundMode();
     
     std::string ToLower(const std::string& str);
     std::string Trim(const std::string& str);
+    
+    // FNV-1a, 64 бита; hash продолжает ранее начатое вычисление
+    uint64_t Fnv1a(std::string_view bytes, uint64_t hash = 14695981039346656037ull);
+    // Поля текстовых записей разделяются табуляцией, записи - переводом строки;
+    // обратная косая черта, табуляция и перевод строки внутри поля экранируются
+    std::string EscapeField(const std::string& text);
+    std::string UnescapeField(const std::string& text);
+    std::vector<std::string> SplitFields(const std::string& line);
 }
 
 } // namespace Scanner
\ No newline at end of file
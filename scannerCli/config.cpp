@@ -1,5 +1,7 @@
 #include "config.h"
 
+#include <charconv>
+
 namespace console
 {
 Config::Config(bool debug) : debug_(debug) {}
@@ -50,6 +52,362 @@ bool Config::SetScanPath(std::string_view path)
     return true;
 }
 
+bool Config::SetSimilarityThreshold(std::string_view value)
+{
+    size_t threshold = 0;
+    auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), threshold);
+    if (error != std::errc() || end != value.data() + value.size() || threshold < 1 || threshold > 100) {
+        std::cerr << "[ERROR]: " << value 
+                    << " - Similarity threshold must be a number from 1 to 100" << std::endl;
+        return false;
+    }
+
+    PrintDebug("SetSimilarityThreshold: ", value);
+    similarity_threshold_ = threshold;
+    return true;
+}
+
+void Config::DisableArchives()
+{
+    PrintDebug("DisableArchives");
+    scan_archives_ = false;
+}
+
+bool Config::SetArchiveDepth(std::string_view value)
+{
+    if (!ParseCount(value, 16, "Archive depth", archive_depth_)) {
+        return false;
+    }
+    PrintDebug("SetArchiveDepth: ", value);
+    return true;
+}
+
+bool Config::SetArchiveMembers(std::string_view value)
+{
+    if (!ParseCount(value, 1000000, "Archive member limit", archive_members_)) {
+        return false;
+    }
+    PrintDebug("SetArchiveMembers: ", value);
+    return true;
+}
+
+bool Config::SetArchiveExpansion(std::string_view value)
+{
+    if (!ParseCount(value, 10000, "Archive expansion ratio", archive_expansion_)) {
+        return false;
+    }
+    PrintDebug("SetArchiveExpansion: ", value);
+    return true;
+}
+
+bool Config::SetMaxFileSize(std::string_view value)
+{
+    if (!ParseCount(value, 1024 * 1024, "Maximum file size in MB", max_file_size_mb_)) {
+        return false;
+    }
+    PrintDebug("SetMaxFileSize: ", value);
+    return true;
+}
+
+bool Config::SetMaxInFlight(std::string_view value)
+{
+    if (!ParseCount(value, 1024 * 1024, "Bytes in flight in MB", max_in_flight_mb_)) {
+        return false;
+    }
+    PrintDebug("SetMaxInFlight: ", value);
+    return true;
+}
+
+bool Config::SetReadOrder(std::string_view value)
+{
+    if (value == "directory") {
+        read_order_ = Scanner::ReadOrder::Directory;
+    } else if (value == "inode") {
+        read_order_ = Scanner::ReadOrder::Inode;
+    } else if (value == "extent") {
+        read_order_ = Scanner::ReadOrder::Extent;
+    } else {
+        std::cerr << "[ERROR]: " << value 
+                    << " - Read order must be directory, inode or extent" << std::endl;
+        return false;
+    }
+
+    PrintDebug("SetReadOrder: ", value);
+    return true;
+}
+
+bool Config::SetCacheMode(std::string_view value)
+{
+    if (value == "normal") {
+        cache_mode_ = Scanner::CacheMode::Normal;
+    } else if (value == "drop-behind") {
+        cache_mode_ = Scanner::CacheMode::DropBehind;
+    } else if (value == "direct") {
+        cache_mode_ = Scanner::CacheMode::Direct;
+    } else {
+        std::cerr << "[ERROR]: " << value 
+                    << " - Cache mode must be normal, drop-behind or direct" << std::endl;
+        return false;
+    }
+
+    PrintDebug("SetCacheMode: ", value);
+    return true;
+}
+
+bool Config::SetThreadCount(std::string_view value)
+{
+    if (!ParseCount(value, 256, "Thread count", thread_count_)) {
+        return false;
+    }
+    PrintDebug("SetThreadCount: ", value);
+    return true;
+}
+
+bool Config::SetMaxRate(std::string_view value)
+{
+    if (!ParseCount(value, 1024 * 1024, "Read rate in MB/s", max_rate_mb_)) {
+        return false;
+    }
+    PrintDebug("SetMaxRate: ", value);
+    return true;
+}
+
+bool Config::SetMaxFilesRate(std::string_view value)
+{
+    if (!ParseCount(value, 10000000, "File rate in files/s", max_files_rate_)) {
+        return false;
+    }
+    PrintDebug("SetMaxFilesRate: ", value);
+    return true;
+}
+
+void Config::EnableBackground()
+{
+    PrintDebug("EnableBackground");
+    background_ = true;
+}
+
+void Config::EnableAdaptive()
+{
+    PrintDebug("EnableAdaptive");
+    adaptive_ = true;
+}
+
+bool Config::SetAsyncDepth(std::string_view value)
+{
+    if (!ParseCount(value, 4096, "Asynchronous read depth", async_depth_)) {
+        return false;
+    }
+    PrintDebug("SetAsyncDepth: ", value);
+    return true;
+}
+
+void Config::EnableNuma()
+{
+    PrintDebug("EnableNuma");
+    numa_ = true;
+}
+
+bool Config::SetCheckpointPath(std::string_view path)
+{
+    fs::path checkpointPath(path);
+    if (checkpointPath.has_parent_path() && !fs::exists(checkpointPath.parent_path())) {
+        std::cerr << "[ERROR]: Directory for checkpoint file does not exist: " 
+                    << checkpointPath.parent_path() << std::endl;
+        return false;
+    }
+
+    PrintDebug("SetCheckpointPath: ", path);
+    path_checkpoint_ = path;
+    return true;
+}
+
+void Config::EnableResume()
+{
+    PrintDebug("EnableResume");
+    resume_ = true;
+}
+
+bool Config::SetShard(std::string_view value)
+{
+    // "<i>/<n>": the i-th of n shards, counted from 1
+    const size_t slash = value.find('/');
+    if (slash == std::string_view::npos) {
+        std::cerr << "[ERROR]: " << value 
+                    << " - Shard must be given as <i>/<n>, such as 2/8" << std::endl;
+        return false;
+    }
+    if (!ParseCount(value.substr(slash + 1), 65536, "Shard count", shard_count_) ||
+        !ParseCount(value.substr(0, slash), shard_count_, "Shard", shard_index_)) {
+        return false;
+    }
+
+    PrintDebug("SetShard: ", value);
+    return true;
+}
+
+bool Config::SetWorkers(std::string_view value)
+{
+    if (!ParseCount(value, 256, "Worker process count", workers_)) {
+        return false;
+    }
+    PrintDebug("SetWorkers: ", value);
+    return true;
+}
+
+bool Config::AddInclude(std::string_view pattern)
+{
+    if (pattern.empty()) {
+        std::cerr << "[ERROR]: Include pattern cannot be empty" << std::endl;
+        return false;
+    }
+    PrintDebug("AddInclude: ", pattern);
+    includes_.emplace_back(pattern);
+    return true;
+}
+
+bool Config::AddExclude(std::string_view pattern)
+{
+    if (pattern.empty()) {
+        std::cerr << "[ERROR]: Exclude pattern cannot be empty" << std::endl;
+        return false;
+    }
+    PrintDebug("AddExclude: ", pattern);
+    excludes_.emplace_back(pattern);
+    return true;
+}
+
+bool Config::SetExtensions(std::string_view value)
+{
+    // Comma-separated, with or without the dot: "exe,dll,.js"
+    extensions_.clear();
+    size_t begin = 0;
+    while (begin <= value.size()) {
+        size_t end = value.find(',', begin);
+        if (end == std::string_view::npos) {
+            end = value.size();
+        }
+        if (end == begin) {
+            std::cerr << "[ERROR]: " << value 
+                        << " - Extensions must be a comma-separated list, such as exe,dll" << std::endl;
+            return false;
+        }
+        extensions_.emplace_back(value.substr(begin, end - begin));
+        begin = end + 1;
+    }
+
+    PrintDebug("SetExtensions: ", value);
+    return true;
+}
+
+bool Config::SetMinFileSize(std::string_view value)
+{
+    if (!ParseCount(value, 1024 * 1024, "Minimum file size in KB", min_file_size_kb_)) {
+        return false;
+    }
+    PrintDebug("SetMinFileSize: ", value);
+    return true;
+}
+
+bool Config::SetChangedSince(std::string_view value)
+{
+    // Seconds since 1970, or a UTC date as YYYY-MM-DD
+    int64_t seconds = 0;
+    int year = 0;
+    unsigned month = 0;
+    unsigned day = 0;
+    const char* end = value.data() + value.size();
+    if (std::from_chars(value.data(), end, seconds).ptr == end && seconds > 0) {
+        changed_since_ = seconds;
+    } else if (value.size() == 10 && value[4] == '-' && value[7] == '-' &&
+               std::from_chars(value.data(), value.data() + 4, year).ptr == value.data() + 4 &&
+               std::from_chars(value.data() + 5, value.data() + 7, month).ptr == value.data() + 7 &&
+               std::from_chars(value.data() + 8, end, day).ptr == end &&
+               year >= 1970 && month >= 1 && month <= 12 && day >= 1 && day <= 31) {
+        // Days since 1970-01-01 in the proleptic Gregorian calendar
+        const int y = year - (month <= 2 ? 1 : 0);
+        const int era = y / 400;
+        const int yearOfEra = y - era * 400;
+        const int dayOfYear = (153 * static_cast<int>(month > 2 ? month - 3 : month + 9) + 2) / 5 +
+                              static_cast<int>(day) - 1;
+        const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        changed_since_ = (int64_t{era} * 146097 + dayOfEra - 719468) * 86400;
+        if (changed_since_ == 0) {
+            changed_since_ = 1;
+        }
+    } else {
+        std::cerr << "[ERROR]: " << value 
+                    << " - Time must be a date (YYYY-MM-DD) or seconds since 1970" << std::endl;
+        return false;
+    }
+
+    PrintDebug("SetChangedSince: ", value);
+    return true;
+}
+
+void Config::EnableOneFileSystem()
+{
+    PrintDebug("EnableOneFileSystem");
+    one_file_system_ = true;
+}
+
+void Config::EnableDedupeContent()
+{
+    PrintDebug("EnableDedupeContent");
+    dedupe_content_ = true;
+}
+
+bool Config::SetDigestCachePath(std::string_view path)
+{
+    fs::path cachePath(path);
+    if (cachePath.has_parent_path() && !fs::exists(cachePath.parent_path())) {
+        std::cerr << "[ERROR]: Directory for digest cache does not exist: " 
+                    << cachePath.parent_path() << std::endl;
+        return false;
+    }
+
+    PrintDebug("SetDigestCachePath: ", path);
+    path_digest_cache_ = path;
+    return true;
+}
+
+bool Config::SetIndexPath(std::string_view path)
+{
+    fs::path indexPath(path);
+    if (indexPath.has_parent_path() && !fs::exists(indexPath.parent_path())) {
+        std::cerr << "[ERROR]: Directory for signature index does not exist: " 
+                    << indexPath.parent_path() << std::endl;
+        return false;
+    }
+
+    PrintDebug("SetIndexPath: ", path);
+    path_index_ = path;
+    return true;
+}
+
+bool Config::SetIndexCache(std::string_view value)
+{
+    if (!ParseCount(value, 65536, "Index cache in MB", index_cache_mb_)) {
+        return false;
+    }
+    PrintDebug("SetIndexCache: ", value);
+    return true;
+}
+
+bool Config::ParseCount(std::string_view value, size_t max, std::string_view what, size_t& result) const
+{
+    size_t count = 0;
+    auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), count);
+    if (error != std::errc() || end != value.data() + value.size() || count < 1 || count > max) {
+        std::cerr << "[ERROR]: " << value 
+                    << " - " << what << " must be a number from 1 to " << max << std::endl;
+        return false;
+    }
+
+    result = count;
+    return true;
+}
+
 bool Config::CheckFileExtension(std::string_view path, std::string_view extension) const
 {
     fs::path filePath(path);
@@ -81,5 +439,36 @@ bool Config::ValidateFile(std::string_view path) const
 const std::string& Config::GetHashDatabasePath() const noexcept { return path_hashes_; }
 const std::string& Config::GetLogPath() const noexcept { return path_report_log_; }
 const std::string& Config::GetScanPath() const noexcept { return path_scan_; }
+size_t Config::GetSimilarityThreshold() const noexcept { return similarity_threshold_; }
+bool Config::GetScanArchives() const noexcept { return scan_archives_; }
+size_t Config::GetArchiveDepth() const noexcept { return archive_depth_; }
+size_t Config::GetArchiveMembers() const noexcept { return archive_members_; }
+size_t Config::GetArchiveExpansion() const noexcept { return archive_expansion_; }
+uint64_t Config::GetMaxFileSize() const noexcept { return uint64_t{max_file_size_mb_} * 1024 * 1024; }
+uint64_t Config::GetMaxInFlight() const noexcept { return uint64_t{max_in_flight_mb_} * 1024 * 1024; }
+Scanner::ReadOrder Config::GetReadOrder() const noexcept { return read_order_; }
+Scanner::CacheMode Config::GetCacheMode() const noexcept { return cache_mode_; }
+size_t Config::GetThreadCount() const noexcept { return thread_count_; }
+uint64_t Config::GetMaxRate() const noexcept { return uint64_t{max_rate_mb_} * 1024 * 1024; }
+uint64_t Config::GetMaxFilesRate() const noexcept { return max_files_rate_; }
+bool Config::GetBackground() const noexcept { return background_; }
+bool Config::GetAdaptive() const noexcept { return adaptive_; }
+size_t Config::GetAsyncDepth() const noexcept { return async_depth_; }
+bool Config::GetNuma() const noexcept { return numa_; }
+const std::string& Config::GetCheckpointPath() const noexcept { return path_checkpoint_; }
+bool Config::GetResume() const noexcept { return resume_; }
+size_t Config::GetShardIndex() const noexcept { return shard_index_ - 1; }
+size_t Config::GetShardCount() const noexcept { return shard_count_; }
+size_t Config::GetWorkers() const noexcept { return workers_; }
+const std::vector<std::string>& Config::GetIncludes() const noexcept { return includes_; }
+const std::vector<std::string>& Config::GetExcludes() const noexcept { return excludes_; }
+const std::vector<std::string>& Config::GetExtensions() const noexcept { return extensions_; }
+uint64_t Config::GetMinFileSize() const noexcept { return uint64_t{min_file_size_kb_} * 1024; }
+int64_t Config::GetChangedSince() const noexcept { return changed_since_; }
+bool Config::GetOneFileSystem() const noexcept { return one_file_system_; }
+bool Config::GetDedupeContent() const noexcept { return dedupe_content_; }
+const std::string& Config::GetDigestCachePath() const noexcept { return path_digest_cache_; }
+const std::string& Config::GetIndexPath() const noexcept { return path_index_; }
+uint64_t Config::GetIndexCache() const noexcept { return uint64_t{index_cache_mb_} * 1024 * 1024; }
 
 } // namespace console
\ No newline at end of file
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <filesystem>
 #include <iostream>
 
+#include "scannerApi.h"
+
 namespace fs = std::filesystem;
 
 namespace console 
@@ -18,22 +22,115 @@ namespace console
         bool SetHashDatabasePath(std::string_view path);
         bool SetLogPath(std::string_view path);
         bool SetScanPath(std::string_view path);
+        bool SetSimilarityThreshold(std::string_view value);
+        void DisableArchives();
+        bool SetArchiveDepth(std::string_view value);
+        bool SetArchiveMembers(std::string_view value);
+        bool SetArchiveExpansion(std::string_view value);
+        bool SetMaxFileSize(std::string_view value);
+        bool SetMaxInFlight(std::string_view value);
+        bool SetReadOrder(std::string_view value);
+        bool SetCacheMode(std::string_view value);
+        bool SetThreadCount(std::string_view value);
+        bool SetMaxRate(std::string_view value);
+        bool SetMaxFilesRate(std::string_view value);
+        void EnableBackground();
+        void EnableAdaptive();
+        bool SetAsyncDepth(std::string_view value);
+        void EnableNuma();
+        bool SetCheckpointPath(std::string_view path);
+        void EnableResume();
+        bool SetShard(std::string_view value);
+        bool SetWorkers(std::string_view value);
+        bool AddInclude(std::string_view pattern);
+        bool AddExclude(std::string_view pattern);
+        bool SetExtensions(std::string_view value);
+        bool SetMinFileSize(std::string_view value);
+        bool SetChangedSince(std::string_view value);
+        void EnableOneFileSystem();
+        void EnableDedupeContent();
+        bool SetDigestCachePath(std::string_view path);
+        bool SetIndexPath(std::string_view path);
+        bool SetIndexCache(std::string_view value);
 
     private:
         bool CheckFileExtension(std::string_view path, std::string_view extension) const;
         bool ValidateDirectory(std::string_view path) const;
         bool ValidateFile(std::string_view path) const;
+        bool ParseCount(std::string_view value, size_t max, std::string_view what, size_t& result) const;
         void PrintDebug(std::string_view prefix, std::string_view value = {}) const;
     
     public:
         const std::string& GetHashDatabasePath() const noexcept;
         const std::string& GetLogPath() const noexcept;
         const std::string& GetScanPath() const noexcept;
+        size_t GetSimilarityThreshold() const noexcept;
+        bool GetScanArchives() const noexcept;
+        size_t GetArchiveDepth() const noexcept;
+        size_t GetArchiveMembers() const noexcept;
+        size_t GetArchiveExpansion() const noexcept;
+        uint64_t GetMaxFileSize() const noexcept;
+        uint64_t GetMaxInFlight() const noexcept;
+        Scanner::ReadOrder GetReadOrder() const noexcept;
+        Scanner::CacheMode GetCacheMode() const noexcept;
+        size_t GetThreadCount() const noexcept;
+        uint64_t GetMaxRate() const noexcept;
+        uint64_t GetMaxFilesRate() const noexcept;
+        bool GetBackground() const noexcept;
+        bool GetAdaptive() const noexcept;
+        size_t GetAsyncDepth() const noexcept;
+        bool GetNuma() const noexcept;
+        const std::string& GetCheckpointPath() const noexcept;
+        bool GetResume() const noexcept;
+        size_t GetShardIndex() const noexcept;
+        size_t GetShardCount() const noexcept;
+        size_t GetWorkers() const noexcept;
+        const std::vector<std::string>& GetIncludes() const noexcept;
+        const std::vector<std::string>& GetExcludes() const noexcept;
+        const std::vector<std::string>& GetExtensions() const noexcept;
+        uint64_t GetMinFileSize() const noexcept;
+        int64_t GetChangedSince() const noexcept;
+        bool GetOneFileSystem() const noexcept;
+        bool GetDedupeContent() const noexcept;
+        const std::string& GetDigestCachePath() const noexcept;
+        const std::string& GetIndexPath() const noexcept;
+        uint64_t GetIndexCache() const noexcept;
     
     private:
         std::string path_hashes_;
         std::string path_report_log_;
         std::string path_scan_;
+        size_t similarity_threshold_ = 0;
+        bool scan_archives_ = true;
+        size_t archive_depth_ = 0;
+        size_t archive_members_ = 0;
+        size_t archive_expansion_ = 0;
+        size_t max_file_size_mb_ = 0;
+        size_t max_in_flight_mb_ = 0;
+        Scanner::ReadOrder read_order_ = Scanner::ReadOrder::Directory;
+        Scanner::CacheMode cache_mode_ = Scanner::CacheMode::Normal;
+        size_t thread_count_ = 0;
+        size_t max_rate_mb_ = 0;
+        size_t max_files_rate_ = 0;
+        bool background_ = false;
+        bool adaptive_ = false;
+        size_t async_depth_ = 0;
+        bool numa_ = false;
+        std::string path_checkpoint_;
+        bool resume_ = false;
+        size_t shard_index_ = 0;
+        size_t shard_count_ = 0;
+        size_t workers_ = 0;
+        std::vector<std::string> includes_;
+        std::vector<std::string> excludes_;
+        std::vector<std::string> extensions_;
+        size_t min_file_size_kb_ = 0;
+        int64_t changed_since_ = 0;
+        bool one_file_system_ = false;
+        bool dedupe_content_ = false;
+        std::string path_digest_cache_;
+        std::string path_index_;
+        size_t index_cache_mb_ = 0;
         bool debug_;
     };
 } // namespace console
\ No newline at end of file
@@ -50,6 +50,165 @@ namespace console {
                     }
                     hasPath = true;
                 }
+                else if (arg == "--similarity") {
+                    auto value = requireNext("--similarity");
+                    if (!_config.SetSimilarityThreshold(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--no-archives") {
+                    _config.DisableArchives();
+                }
+                else if (arg == "--archive-depth") {
+                    auto value = requireNext("--archive-depth");
+                    if (!_config.SetArchiveDepth(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--archive-members") {
+                    auto value = requireNext("--archive-members");
+                    if (!_config.SetArchiveMembers(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--archive-expansion") {
+                    auto value = requireNext("--archive-expansion");
+                    if (!_config.SetArchiveExpansion(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--max-file-size") {
+                    auto value = requireNext("--max-file-size");
+                    if (!_config.SetMaxFileSize(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--min-file-size") {
+                    auto value = requireNext("--min-file-size");
+                    if (!_config.SetMinFileSize(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--include") {
+                    auto value = requireNext("--include");
+                    if (!_config.AddInclude(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--exclude") {
+                    auto value = requireNext("--exclude");
+                    if (!_config.AddExclude(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--ext") {
+                    auto value = requireNext("--ext");
+                    if (!_config.SetExtensions(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--changed-since") {
+                    auto value = requireNext("--changed-since");
+                    if (!_config.SetChangedSince(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--one-file-system") {
+                    _config.EnableOneFileSystem();
+                }
+                else if (arg == "--dedupe-content") {
+                    _config.EnableDedupeContent();
+                }
+                else if (arg == "--digest-cache") {
+                    auto value = requireNext("--digest-cache");
+                    if (!_config.SetDigestCachePath(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--index") {
+                    auto value = requireNext("--index");
+                    if (!_config.SetIndexPath(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--index-cache") {
+                    auto value = requireNext("--index-cache");
+                    if (!_config.SetIndexCache(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--max-in-flight") {
+                    auto value = requireNext("--max-in-flight");
+                    if (!_config.SetMaxInFlight(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--read-order") {
+                    auto value = requireNext("--read-order");
+                    if (!_config.SetReadOrder(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--cache-mode") {
+                    auto value = requireNext("--cache-mode");
+                    if (!_config.SetCacheMode(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--threads" || arg == "-t") {
+                    auto value = requireNext("--threads");
+                    if (!_config.SetThreadCount(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--max-rate") {
+                    auto value = requireNext("--max-rate");
+                    if (!_config.SetMaxRate(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--max-files-rate") {
+                    auto value = requireNext("--max-files-rate");
+                    if (!_config.SetMaxFilesRate(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--background") {
+                    _config.EnableBackground();
+                }
+                else if (arg == "--adaptive") {
+                    _config.EnableAdaptive();
+                }
+                else if (arg == "--async") {
+                    auto value = requireNext("--async");
+                    if (!_config.SetAsyncDepth(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--numa") {
+                    _config.EnableNuma();
+                }
+                else if (arg == "--checkpoint") {
+                    auto value = requireNext("--checkpoint");
+                    if (!_config.SetCheckpointPath(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--resume") {
+                    _config.EnableResume();
+                }
+                else if (arg == "--shard") {
+                    auto value = requireNext("--shard");
+                    if (!_config.SetShard(value)) {
+                        return false;
+                    }
+                }
+                else if (arg == "--workers") {
+                    auto value = requireNext("--workers");
+                    if (!_config.SetWorkers(value)) {
+                        return false;
+                    }
+                }
                 else if (arg == "--help" || arg == "-h") {
                     printHelp();
                     return false;
@@ -65,6 +224,12 @@ namespace console {
             if (!hasPath) {
                 throw std::runtime_error("Missing required option: --path");
             }
+            if (_config.GetResume() && _config.GetCheckpointPath().empty()) {
+                throw std::runtime_error("Option '--resume' requires --checkpoint");
+            }
+            if (_config.GetWorkers() > 1 && (_config.GetShardCount() != 0 || !_config.GetCheckpointPath().empty())) {
+                throw std::runtime_error("Option '--workers' cannot be combined with --shard or --checkpoint");
+            }
 
             return true;
         }
@@ -88,10 +253,48 @@ namespace console {
 R"(Usage: scanner.exe [OPTIONS]
 
 Options:
-      --log <path>      Path to log report file
-  -b, --base <path>     Path to base hashes file (.csv)
-  -p, --path <path>     Directory to scan
-  -h, --help            Show help
+      --log <path>             Path to log report file
+  -b, --base <path>            Path to base hashes file (.csv)
+      --index <path>           On-disk index of the base's exact digests, for bases larger than
+                               memory; built from --base when missing or out of date
+      --index-cache <MB>       Index pages kept in memory (1-65536, default: 64)
+  -p, --path <path>            Directory to scan
+      --similarity <N>         Minimum ssdeep score (1-100) for similarity matches (default: 80)
+      --no-archives            Do not look inside zip, tar and gzip files
+      --archive-depth <N>      Nested container layers to open (1-16, default: 4)
+      --archive-members <N>    Members scanned per archive (1-1000000, default: 10000)
+      --archive-expansion <N>  Inflated bytes allowed per archive byte (1-10000, default: 100)
+      --max-file-size <MB>     Skip files larger than this (default: no limit)
+      --min-file-size <KB>     Skip files smaller than this (default: no limit)
+      --include <glob>         Scan only files matching one of these globs (repeatable)
+      --exclude <glob>         Skip matching files and directories; a trailing '/' matches
+                               directories only, which are not opened (repeatable)
+      --ext <list>             Scan only these extensions, comma-separated (exe,dll,js)
+      --changed-since <time>   Skip files not modified since a UTC date (YYYY-MM-DD)
+                               or a time in seconds since 1970
+      --one-file-system        Do not descend into other mounted filesystems
+      --dedupe-content         Read files on the same disk extents (reflinks, snapshots)
+                               once; hard links are always read once
+      --digest-cache <path>    Digests shared with other scanners: files with an fs-verity
+                               digest found there are not hashed again
+      --max-in-flight <MB>     Total size of files hashed at once (default: 512)
+      --read-order <order>     directory, inode or extent (physical offset); the last
+                               two also prefetch upcoming files (default: directory)
+      --cache-mode <mode>      normal, drop-behind (evict what the scan read) or direct
+                               (bypass the page cache) (default: normal)
+  -t, --threads <N>            Worker threads (1-256, default: one per CPU core)
+      --max-rate <MB/s>        Cap on file data read per second by all workers
+      --max-files-rate <N>     Cap on files opened per second
+      --background             Idle I/O priority (ioprio) and SCHED_IDLE for workers
+      --adaptive               Fewer concurrent readers while read latency is high
+      --async <N>              Keep up to N files per worker in flight through io_uring
+                               (1-4096; Linux, --cache-mode normal only)
+      --numa                   Pin workers per NUMA node, with a copy of the signatures on each
+      --checkpoint <path>      Record finished work there while scanning (removed on completion)
+      --resume                 Continue the scan recorded by --checkpoint, if there is one
+      --shard <i>/<n>          Scan only the i-th of n shards of the tree, split by path hash
+      --workers <N>            Split the scan across N local worker processes (1-256)
+  -h, --help                   Show help
 
 Example:
   scanner.exe --base base.csv --log report.log --path C:/folder
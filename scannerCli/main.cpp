@@ -26,7 +26,39 @@ int main(int argc, char* argv[])
         settings.rootPath = config.GetScanPath();
         settings.databasePath = config.GetHashDatabasePath();
         settings.logPath = config.GetLogPath();
-        settings.threadCount = std::thread::hardware_concurrency();
+        settings.threadCount = config.GetThreadCount() != 0 ? config.GetThreadCount()
+                                                            : std::thread::hardware_concurrency();
+        settings.similarityThreshold = config.GetSimilarityThreshold();
+        settings.scanArchives = config.GetScanArchives();
+        settings.archiveMaxDepth = config.GetArchiveDepth();
+        settings.archiveMaxMembers = config.GetArchiveMembers();
+        settings.archiveMaxExpansion = config.GetArchiveExpansion();
+        settings.maxFileSize = config.GetMaxFileSize();
+        settings.minFileSize = config.GetMinFileSize();
+        settings.includePatterns = config.GetIncludes();
+        settings.excludePatterns = config.GetExcludes();
+        settings.extensions = config.GetExtensions();
+        settings.modifiedSince = config.GetChangedSince();
+        settings.sameFileSystem = config.GetOneFileSystem();
+        settings.dedupeContent = config.GetDedupeContent();
+        settings.digestCachePath = config.GetDigestCachePath();
+        settings.indexPath = config.GetIndexPath();
+        settings.indexCacheSize = config.GetIndexCache();
+        settings.maxBytesInFlight = config.GetMaxInFlight();
+        settings.readOrder = config.GetReadOrder();
+        settings.cacheMode = config.GetCacheMode();
+        settings.maxBytesPerSecond = config.GetMaxRate();
+        settings.maxFilesPerSecond = config.GetMaxFilesRate();
+        settings.background = config.GetBackground();
+        settings.adaptiveConcurrency = config.GetAdaptive();
+        settings.asyncDepth = config.GetAsyncDepth();
+        settings.numaAware = config.GetNuma();
+        settings.checkpointPath = config.GetCheckpointPath();
+        if (config.GetShardCount() != 0) {
+            settings.shardCount = config.GetShardCount();
+            settings.shards = {config.GetShardIndex()};
+        }
+        settings.workerProcesses = config.GetWorkers();
 
         std::cout << "Starting malware scan..." << std::endl;
         std::cout << "Root path: " << settings.rootPath << std::endl;
@@ -42,13 +74,18 @@ int main(int argc, char* argv[])
 
         auto start = std::chrono::steady_clock::now();
         // Scanner::ScanResult result = scanner->ScanWithProgress(settings, progressCallback);
-        Scanner::ScanResult result = scanner->Scan(settings);
+        Scanner::ScanResult result = config.GetResume() ? scanner->Resume(settings) : scanner->Scan(settings);
         auto end = std::chrono::steady_clock::now();
 
         std::cout << "=== SCAN REPORT ===" << std::endl;
         std::cout << "Total files processed: " << result.totalFilesProcessed << std::endl;
         std::cout << "Malware files detected: " << result.malwareFilesDetected << std::endl;
         std::cout << "Errors during analysis: " << result.errorsCount << std::endl;
+        if (result.hardLinkDuplicates != 0 || result.contentDuplicates != 0) {
+            std::cout << "Duplicates read once: " << result.hardLinkDuplicates << " hard links, "
+                      << result.contentDuplicates << " on shared extents ("
+                      << result.duplicateBytesSkipped / (1024 * 1024) << " MB not read)" << std::endl;
+        }
         std::cout << "Execution time: " << result.executionTime.count() << " ms" << std::endl;
 
         // if (result.malwareFilesDetected > 0) {
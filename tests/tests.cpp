@@ -1,10 +1,113 @@
 #include <gtest/gtest.h>
 #include "scannerApi.h"
+#include "checkpoint.h"
+#include "scannerConstants.h"
+#include <atomic>
+#include <cstring>
 #include <fstream>
 #include <filesystem>
+#include <random>
+
+#if defined(__linux__) && defined(__GLIBC__)
+#include <cstdarg>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace fs = std::filesystem;
 
+#if defined(__linux__) && defined(__GLIBC__)
+// Path lookups: open, stat and access are replaced for the whole test binary
+// and counted, from every thread, for paths under countedDir while counting
+// is on. The real functions are found with dlsym(RTLD_NEXT).
+namespace {
+std::atomic<bool> countLookups{false};
+std::string countedDir;
+std::atomic<size_t> pathOpens{0};
+std::atomic<size_t> pathStats{0};
+std::atomic<size_t> pathAccesses{0};
+
+void CountLookup(const char* path, std::atomic<size_t>& counter) {
+    if (countLookups && path != nullptr && std::strncmp(path, countedDir.c_str(), countedDir.size()) == 0) {
+        ++counter;
+    }
+}
+
+template <typename Function>
+Function Next(const char* name) {
+    return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+}
+
+mode_t ModeOf(int flags, va_list args) {
+    return (flags & (O_CREAT | O_TMPFILE)) ? va_arg(args, mode_t) : 0;
+}
+} // namespace
+
+extern "C" {
+int open(const char* path, int flags, ...) {
+    va_list args;
+    va_start(args, flags);
+    const mode_t mode = ModeOf(flags, args);
+    va_end(args);
+    CountLookup(path, pathOpens);
+    static const auto next = Next<int (*)(const char*, int, ...)>("open");
+    return next(path, flags, mode);
+}
+
+int open64(const char* path, int flags, ...) {
+    va_list args;
+    va_start(args, flags);
+    const mode_t mode = ModeOf(flags, args);
+    va_end(args);
+    CountLookup(path, pathOpens);
+    static const auto next = Next<int (*)(const char*, int, ...)>("open64");
+    return next(path, flags, mode);
+}
+
+int openat(int dir, const char* path, int flags, ...) {
+    va_list args;
+    va_start(args, flags);
+    const mode_t mode = ModeOf(flags, args);
+    va_end(args);
+    CountLookup(path, pathOpens);
+    static const auto next = Next<int (*)(int, const char*, int, ...)>("openat");
+    return next(dir, path, flags, mode);
+}
+
+int stat(const char* path, struct stat* info) noexcept {
+    CountLookup(path, pathStats);
+    static const auto next = Next<int (*)(const char*, struct stat*)>("stat");
+    return next(path, info);
+}
+
+int lstat(const char* path, struct stat* info) noexcept {
+    CountLookup(path, pathStats);
+    static const auto next = Next<int (*)(const char*, struct stat*)>("lstat");
+    return next(path, info);
+}
+
+int fstatat(int dir, const char* path, struct stat* info, int flags) noexcept {
+    CountLookup(path, pathStats);
+    static const auto next = Next<int (*)(int, const char*, struct stat*, int)>("fstatat");
+    return next(dir, path, info, flags);
+}
+
+int statx(int dir, const char* path, int flags, unsigned int mask, struct statx* info) noexcept {
+    CountLookup(path, pathStats);
+    static const auto next = Next<int (*)(int, const char*, int, unsigned int, struct statx*)>("statx");
+    return next(dir, path, flags, mask, info);
+}
+
+int access(const char* path, int mode) noexcept {
+    CountLookup(path, pathAccesses);
+    static const auto next = Next<int (*)(const char*, int)>("access");
+    return next(path, mode);
+}
+}
+#endif
+
 class IntegrationTest : public ::testing::Test {
 protected:
     void SetUp() override {
@@ -121,4 +224,693 @@ TEST_F(IntegrationTest, InvalidDatabaseFile) {
     Scanner::ScanResult result = scanner->Scan(settings);
     EXPECT_GT(result.errorsCount, 0);    
     DestroyScanner(scanner.release());
-}
\ No newline at end of file
+}
+
+TEST_F(IntegrationTest, MixedDigestDatabase) {
+    std::ofstream hashDb(hashFile);
+    hashDb << "dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f;Sha256Malware\n";
+    hashDb << "da39a3ee5e6b4b0d3255bfef95601890afd80709;Sha1Malware;type=sha1\n";  // Empty file
+    hashDb.close();
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 3);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    EXPECT_EQ(result.errorsCount, 0);
+    for (const auto& malware : result.detectedMalware) {
+        if (malware.verdict == "Sha256Malware") {
+            EXPECT_EQ(malware.hash.size(), 64);
+        } else {
+            EXPECT_EQ(malware.verdict, "Sha1Malware");
+            EXPECT_EQ(malware.hash.size(), 40);
+        }
+    }
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, SizeAndPrefixFastPath) {
+    CreateTestFile("large_malware.bin", std::string(200000, 'x'));
+    CreateTestFile("large_clean.bin", std::string(200000, 'y'));  // Same size, other prefix
+    
+    std::ofstream hashDb(hashFile);
+    hashDb << "4b98146705d4b0b98b758a78ff6fb73f;LargeMalware;size=200000;prefix=cc7fa4aff814016b4f2eff395e64ff7c\n";
+    hashDb << "65a8e27d8879283831b664bd8b7f0ad4;TestMalware1;size=13;prefix=65a8e27d8879283831b664bd8b7f0ad4\n";
+    hashDb.close();
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 5);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    EXPECT_EQ(result.errorsCount, 0);
+    for (const auto& malware : result.detectedMalware) {
+        EXPECT_TRUE(malware.verdict == "LargeMalware" || malware.verdict == "TestMalware1");
+    }
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, AsyncReadsFindSameFiles) {
+    CreateTestFile("large_malware.bin", std::string(200000, 'x'));
+    CreateTestFile("large_clean.bin", std::string(200000, 'y'));  // Same size, other prefix
+    CreateTestFile("subdir/streamed.bin", std::string(3 << 20, 'z'));  // Several reads
+    
+    std::ofstream hashDb(hashFile);
+    hashDb << "4b98146705d4b0b98b758a78ff6fb73f;LargeMalware;size=200000;prefix=cc7fa4aff814016b4f2eff395e64ff7c\n";
+    hashDb << "65a8e27d8879283831b664bd8b7f0ad4;TestMalware1;size=13;prefix=65a8e27d8879283831b664bd8b7f0ad4\n";
+    hashDb << "688d0fa2ab753f00a52416ba97da0577;StreamedMalware\n";
+    hashDb.close();
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    // Where io_uring is unavailable the scan falls back to blocking reads
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    settings.asyncDepth = 4;
+    
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 6);
+    EXPECT_EQ(result.malwareFilesDetected, 3);
+    EXPECT_EQ(result.errorsCount, 0);
+    for (const auto& malware : result.detectedMalware) {
+        EXPECT_TRUE(malware.verdict == "LargeMalware" || malware.verdict == "TestMalware1" ||
+                    malware.verdict == "StreamedMalware");
+    }
+    
+    // Direct reads bypass the page cache the ring reads through
+    settings.cacheMode = Scanner::CacheMode::Direct;
+    EXPECT_THROW(scanner->Scan(settings), std::exception);
+    DestroyScanner(scanner.release());
+}
+
+#if defined(__linux__) && defined(__GLIBC__)
+TEST_F(IntegrationTest, EachFileIsOpenedOnce) {
+    // A clean size (only sniffed for an archive header), an accepted and a
+    // rejected prefix, full hashes, and a file of several reads
+    CreateTestFile("large_malware.bin", std::string(200000, 'x'));
+    CreateTestFile("large_clean.bin", std::string(200000, 'y'));
+    CreateTestFile("subdir/streamed.bin", std::string(3 << 20, 'z'));
+    
+    std::ofstream hashDb(hashFile);
+    hashDb << "4b98146705d4b0b98b758a78ff6fb73f;LargeMalware;size=200000;prefix=cc7fa4aff814016b4f2eff395e64ff7c\n";
+    hashDb << "65a8e27d8879283831b664bd8b7f0ad4;TestMalware1;size=13;prefix=65a8e27d8879283831b664bd8b7f0ad4\n";
+    hashDb << "d41d8cd98f00b204e9800998ecf8427e;TestMalware2;size=0\n";
+    hashDb << "688d0fa2ab753f00a52416ba97da0577;StreamedMalware;size=3145728\n";
+    hashDb.close();
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    
+    countedDir = scanDir.string() + "/";
+    pathOpens = 0;
+    pathStats = 0;
+    pathAccesses = 0;
+    countLookups = true;
+    Scanner::ScanResult result = scanner->Scan(settings);
+    countLookups = false;
+    EXPECT_EQ(result.totalFilesProcessed, 6);
+    EXPECT_EQ(result.malwareFilesDetected, 4);
+    EXPECT_EQ(result.errorsCount, 0);
+    
+    // The stat while collecting gives the size for scheduling; hashing opens
+    // the file and asks the descriptor
+    EXPECT_EQ(pathOpens, 6u);
+    EXPECT_EQ(pathStats, 6u);
+    EXPECT_EQ(pathAccesses, 0u);
+    
+    // The counters also see lookups made inside the standard library
+    countLookups = true;
+    EXPECT_EQ(fs::file_size(scanDir / "clean.txt"), 18u);
+    countLookups = false;
+    EXPECT_EQ(pathStats, 7u);
+    DestroyScanner(scanner.release());
+}
+#endif
+
+TEST_F(IntegrationTest, SimilarVariantDetected) {
+    // Signature of 100000 bytes from std::mt19937(7); the scanned file is that
+    // data with a 16-byte insertion and two flipped bits, so no exact digest matches
+    std::mt19937 rng(7);
+    std::string variant(100000, '\0');
+    for (auto& c : variant) {
+        c = static_cast<char>(rng() & 0xFF);
+    }
+    variant.insert(50000, "repacked section");
+    variant[1000] ^= 1;
+    variant[90000] ^= 1;
+    CreateTestFile("variant.bin", variant);
+    
+    std::ofstream hashDb(hashFile);
+    hashDb << "65a8e27d8879283831b664bd8b7f0ad4;TestMalware1\n";
+    hashDb << "1536:faDGbUVKXPqA4B4rSHZTg7dXRuEV+Lw+uXVzMebq89rg9zg7b/aSMFWbrgC2P:fOKCdB1HZT8+XyVMeu8q6MFWHy;Family\n";
+    hashDb.close();
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    EXPECT_EQ(result.errorsCount, 0);
+    for (const auto& malware : result.detectedMalware) {
+        if (malware.verdict == "Family") {
+            EXPECT_EQ(malware.similarity, 96);
+            EXPECT_EQ(malware.hash.substr(0, 5), "1536:");
+        } else {
+            EXPECT_EQ(malware.verdict, "TestMalware1");
+            EXPECT_EQ(malware.similarity, 100);
+        }
+    }
+    
+    // Above the variant's score nothing but the exact match remains
+    settings.similarityThreshold = 97;
+    result = scanner->Scan(settings);
+    EXPECT_EQ(result.malwareFilesDetected, 1);
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, ContentSignatureDetected) {
+    // The marker straddles the first 64 KB read, so it is found across two buffers
+    std::mt19937 rng(11);
+    std::string dropper(200000, '\0');
+    for (auto& c : dropper) {
+        c = static_cast<char>(rng() & 0xFF);
+    }
+    const std::string marker = "\xDE\xAD\xBE\xEF" "dropper-stage2";
+    dropper.replace(65536 - 7, marker.size(), marker);
+    CreateTestFile("dropper.bin", dropper);
+    
+    std::ofstream hashDb(hashFile);
+    hashDb << "65a8e27d8879283831b664bd8b7f0ad4;TestMalware1\n";
+    hashDb << "deadbeef64726f707065722d737461676532;Dropper;type=content\n";
+    hashDb.close();
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    EXPECT_EQ(result.errorsCount, 0);
+    bool found = false;
+    for (const auto& malware : result.detectedMalware) {
+        if (malware.verdict == "Dropper") {
+            found = true;
+            EXPECT_NE(malware.filePath.find("dropper.bin"), std::string::npos);
+            EXPECT_EQ(malware.hash.size(), 32);  // Reported under the file's MD5
+        }
+    }
+    EXPECT_TRUE(found);
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, ArchiveMemberDetected) {
+    // Stored zip holding "Hello, World!"; only local headers are needed
+    auto zipEntry = [](const std::string& name, const std::string& data) {
+        std::string out("PK\x03\x04", 4);
+        out += std::string("\x14\0\0\0\0\0\0\0\0\0\0\0\0\0", 14);  // Version, flags, stored, time, date, CRC
+        for (uint32_t field : {static_cast<uint32_t>(data.size()), static_cast<uint32_t>(data.size())}) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                out += static_cast<char>((field >> shift) & 0xFF);
+            }
+        }
+        out += static_cast<char>(name.size());
+        out += std::string(3, '\0');  // Name length high byte, no extra field
+        return out + name + data;
+    };
+    CreateTestFile("bundle.zip", zipEntry("notes.txt", "clean notes") + zipEntry("dir/greeting.txt", "Hello, World!"));
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 4);  // Members are not counted as files
+    EXPECT_EQ(result.malwareFilesDetected, 3);
+    EXPECT_EQ(result.errorsCount, 0);
+    bool found = false;
+    for (const auto& malware : result.detectedMalware) {
+        if (malware.filePath.find("bundle.zip!dir/greeting.txt") != std::string::npos) {
+            found = true;
+            EXPECT_EQ(malware.verdict, "TestMalware1");
+            EXPECT_EQ(malware.hash, "65a8e27d8879283831b664bd8b7f0ad4");
+        }
+    }
+    EXPECT_TRUE(found);
+    
+    settings.scanArchives = false;
+    result = scanner->Scan(settings);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, TreeDigestOfLargeFile) {
+    // 5 MB: hashed as five chunks spread over the pool
+    std::string large(5 << 20, '\0');
+    for (size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<char>(i % 251);
+    }
+    CreateTestFile("large.bin", large);
+    
+    std::ofstream hashDb(hashFile);
+    hashDb << "fe9d2bd9b667639982273969c1417e1c77f522156ded29211110df2d11218b78;LargeTree;type=tree\n";
+    hashDb << "042a7d64a581ef2ee983f21058801cc35663b705e6c55f62fa8e0f18ecc70989;HelloTree;type=tree\n";
+    hashDb.close();
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 3;
+    
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 4);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    EXPECT_EQ(result.errorsCount, 0);
+    
+    // With an MD5 signature too, the same roots come from the single read pass
+    hashDb.open(hashFile, std::ios::app);
+    hashDb << "d41d8cd98f00b204e9800998ecf8427e;Empty\n";
+    hashDb.close();
+    result = scanner->Scan(settings);
+    EXPECT_EQ(result.malwareFilesDetected, 3);
+    for (const auto& malware : result.detectedMalware) {
+        if (malware.verdict == "LargeTree") {
+            EXPECT_NE(malware.filePath.find("large.bin"), std::string::npos);
+            EXPECT_EQ(malware.hash, "fe9d2bd9b667639982273969c1417e1c77f522156ded29211110df2d11218b78");
+        }
+    }
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, LayoutOrderFindsSameFiles) {
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    
+    for (auto order : {Scanner::ReadOrder::Inode, Scanner::ReadOrder::Extent}) {
+        settings.readOrder = order;
+        Scanner::ScanResult result = scanner->Scan(settings);
+        EXPECT_EQ(result.totalFilesProcessed, 3);
+        EXPECT_EQ(result.malwareFilesDetected, 2);
+        EXPECT_EQ(result.errorsCount, 0);
+    }
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, CacheModesFindSameFiles) {
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    
+    for (auto mode : {Scanner::CacheMode::DropBehind, Scanner::CacheMode::Direct}) {
+        settings.cacheMode = mode;
+        Scanner::ScanResult result = scanner->Scan(settings);
+        EXPECT_EQ(result.totalFilesProcessed, 3);
+        EXPECT_EQ(result.malwareFilesDetected, 2);
+        EXPECT_EQ(result.errorsCount, 0);
+    }
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, ThrottledScanFindsSameFiles) {
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    settings.maxFilesPerSecond = 1000;
+    settings.background = true;
+    settings.adaptiveConcurrency = true;
+    
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 3);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    EXPECT_EQ(result.errorsCount, 0);
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, NumaAwareScanFindsSameFiles) {
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 4;
+    settings.numaAware = true;
+    
+    // Twice, so the second scan replaces the node copies of the first
+    for (int i = 0; i < 2; ++i) {
+        Scanner::ScanResult result = scanner->Scan(settings);
+        EXPECT_EQ(result.totalFilesProcessed, 3);
+        EXPECT_EQ(result.malwareFilesDetected, 2);
+        EXPECT_EQ(result.errorsCount, 0);
+    }
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, ResumeSkipsFinishedFiles) {
+    const auto checkpointPath = testDir / "scan.checkpoint";
+    
+    // An earlier run finished malware1.txt and found nothing in it, so a
+    // resumed scan that skips it reports only the other sample
+    {
+        auto checkpoint = Scanner::Checkpoint::Create(checkpointPath.string(), scanDir.string(),
+                                                      Scanner::Checkpoint::Fingerprint(hashFile.string()), false);
+        checkpoint->Commit({Scanner::Checkpoint::FileKey(scanDir / "malware1.txt", 13)}, {}, 1);
+        checkpoint->Flush(std::chrono::milliseconds(5000));
+    }
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    settings.checkpointPath = checkpointPath.string();
+    
+    Scanner::ScanResult result = scanner->Resume(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 3);
+    EXPECT_EQ(result.malwareFilesDetected, 1);
+    EXPECT_EQ(result.errorsCount, 1);
+    EXPECT_GE(result.executionTime.count(), 5000);
+    ASSERT_EQ(result.detectedMalware.size(), 1);
+    EXPECT_EQ(result.detectedMalware[0].verdict, "TestMalware2");
+    // Finished, so there is nothing left to resume
+    EXPECT_FALSE(fs::exists(checkpointPath));
+    
+    // Without a checkpoint, Resume is a full scan
+    result = scanner->Resume(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 3);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    
+    // A checkpoint of another signature base is refused
+    {
+        auto checkpoint = Scanner::Checkpoint::Create(checkpointPath.string(), scanDir.string(), "0:0", false);
+    }
+    EXPECT_THROW(scanner->Resume(settings), std::runtime_error);
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, ShardsPartitionTheTree) {
+    for (int i = 0; i < 20; ++i) {
+        CreateTestFile("clean" + std::to_string(i) + ".txt", "clean file " + std::to_string(i));
+    }
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    settings.shardCount = 3;
+    
+    // Every file falls in exactly one shard
+    size_t files = 0;
+    size_t malware = 0;
+    for (size_t shard = 0; shard < settings.shardCount; ++shard) {
+        settings.shards = {shard};
+        Scanner::ScanResult result = scanner->Scan(settings);
+        EXPECT_LT(result.totalFilesProcessed, 23u);
+        files += result.totalFilesProcessed;
+        malware += result.malwareFilesDetected;
+    }
+    EXPECT_EQ(files, 23);
+    EXPECT_EQ(malware, 2);
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, WorkerProcessesMergeResults) {
+    for (int i = 0; i < 20; ++i) {
+        CreateTestFile("subdir/clean" + std::to_string(i) + ".txt", "clean file " + std::to_string(i));
+    }
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 1;
+    settings.workerProcesses = 3;
+    
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 23);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    EXPECT_EQ(result.errorsCount, 0);
+    EXPECT_EQ(result.detectedMalware.size(), 2);
+    EXPECT_TRUE(fs::exists(logFile.string() + ".worker1"));
+    
+    // A worker's scan that fails fails the whole scan
+    settings.databasePath = (testDir / "broken.csv").string();
+    std::ofstream(testDir / "broken.csv") << "not a signature\n";
+    EXPECT_THROW(scanner->Scan(settings), std::runtime_error);
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, FiltersPruneAndSelect) {
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    
+    settings.excludePatterns = {"subdir/"};
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 2);
+    EXPECT_EQ(result.malwareFilesDetected, 1);
+    
+    settings.excludePatterns = {"clean.*"};
+    settings.minFileSize = 1;  // The empty sample
+    settings.sameFileSystem = true;
+    result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 1);
+    ASSERT_EQ(result.detectedMalware.size(), 1);
+    EXPECT_EQ(result.detectedMalware[0].verdict, "TestMalware1");
+    
+    settings = {};
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.includePatterns = {"**/malware*"};
+    settings.extensions = {"TXT"};
+    result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 2);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    
+    // Nothing was changed after tomorrow
+    settings.modifiedSince = std::chrono::duration_cast<std::chrono::seconds>(
+        (std::chrono::system_clock::now() + std::chrono::hours(24)).time_since_epoch()).count();
+    result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 0);
+    settings.modifiedSince = 1;
+    result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 2);
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, HardLinksAreReadOnce) {
+    fs::create_hard_link(scanDir / "malware1.txt", subDir / "link1.txt");
+    fs::create_hard_link(scanDir / "malware1.txt", scanDir / "link2.txt");
+    // A plain copy shares no extents, so it is read even with dedupeContent
+    std::string large(Scanner::Constants::DEDUPE_MIN_SIZE, 'x');
+    CreateTestFile("large.bin", large);
+    CreateTestFile("subdir/large-copy.bin", large);
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    settings.dedupeContent = true;
+    
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 7);
+    EXPECT_EQ(result.hardLinkDuplicates, 2);
+    EXPECT_EQ(result.contentDuplicates, 0);
+    EXPECT_EQ(result.duplicateBytesSkipped, 26);
+    EXPECT_EQ(result.errorsCount, 0);
+    
+    // The verdict reaches every name of the file
+    EXPECT_EQ(result.malwareFilesDetected, 4);
+    size_t linkedReports = 0;
+    for (const auto& info : result.detectedMalware) {
+        linkedReports += info.verdict == "TestMalware1";
+    }
+    EXPECT_EQ(linkedReports, 3);
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, DigestCacheNeedsVerityDigests) {
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.digestCachePath = (testDir / "digests.txt").string();
+    
+    // Files without fs-verity are hashed as usual and not cached
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 3);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    EXPECT_EQ(result.errorsCount, 0);
+    EXPECT_FALSE(fs::exists(settings.digestCachePath));
+    
+    {
+        std::ofstream other(settings.digestCachePath);
+        other << "not a cache\n";
+    }
+    EXPECT_THROW(scanner->Scan(settings), std::runtime_error);
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, IndexedBaseFindsSameFiles) {
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.indexPath = (testDir / "base.idx").string();
+    settings.indexCacheSize = 4096;
+    
+    // The first scan builds the index, the second opens it
+    for (int run = 0; run < 2; ++run) {
+        Scanner::ScanResult result = scanner->Scan(settings);
+        EXPECT_EQ(result.totalFilesProcessed, 3);
+        EXPECT_EQ(result.malwareFilesDetected, 2);
+        EXPECT_EQ(result.errorsCount, 0);
+        EXPECT_TRUE(fs::exists(settings.indexPath));
+    }
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, ByteRateLimitSlowsTheScan) {
+    for (int i = 0; i < 8; ++i) {
+        CreateTestFile("bulk" + std::to_string(i) + ".bin", std::string(256 * 1024, static_cast<char>('a' + i)));
+    }
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    settings.maxBytesPerSecond = 4 * 1024 * 1024;
+    
+    // 2 MB at 4 MB/s, less the 100 ms burst and the last read, which nobody waits for
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 11);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    EXPECT_GE(result.executionTime.count(), 250);
+    DestroyScanner(scanner.release());
+}
+
+TEST_F(IntegrationTest, LargeFilesAndByteBudget) {
+    // Sparse, so the 101 MB file costs no disk space; once past the old 100 MB cap
+    {
+        std::ofstream create(scanDir / "image.bin", std::ios::binary);
+    }
+    fs::resize_file(scanDir / "image.bin", 101 << 20);
+    CreateTestFile("installer.bin", std::string(3 << 20, 'i'));
+    
+    std::ofstream hashDb(hashFile, std::ios::app);
+    hashDb << "7092f29539399585b4ca1f33a2a432fe;LargeImage\n";
+    hashDb.close();
+    
+    auto scanner = std::unique_ptr<Scanner::IScanner>(CreateScanner());
+    ASSERT_NE(scanner, nullptr);
+    
+    // A 1 MB budget defers both large files until the small ones are done
+    Scanner::ScanSettings settings;
+    settings.rootPath = scanDir.string();
+    settings.databasePath = hashFile.string();
+    settings.logPath = logFile.string();
+    settings.threadCount = 2;
+    settings.maxBytesInFlight = 1 << 20;
+    
+    Scanner::ScanResult result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 5);
+    EXPECT_EQ(result.malwareFilesDetected, 3);
+    EXPECT_EQ(result.errorsCount, 0);
+    
+    // Files above an explicit limit are skipped without counting as errors
+    settings.maxFileSize = 100 << 20;
+    result = scanner->Scan(settings);
+    EXPECT_EQ(result.totalFilesProcessed, 4);
+    EXPECT_EQ(result.malwareFilesDetected, 2);
+    EXPECT_EQ(result.errorsCount, 0);
+    DestroyScanner(scanner.release());
+}
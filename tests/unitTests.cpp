@@ -1,10 +1,49 @@
 #include <gtest/gtest.h>
 #include "settingsValidator.h"
+#include "archiveWalker.h"
+#include "asyncHasher.h"
+#include "byteBudget.h"
+#include "checkpoint.h"
 #include "hashDatabase.h"
+#include "numaTopology.h"
+#include "contentMatcher.h"
+#include "digestCache.h"
+#include "diskLayout.h"
+#include "fileHasher.h"
+#include "fileReader.h"
+#include "fuzzyHash.h"
+#include "fuzzyIndex.h"
+#include "hexCodec.h"
+#include "scanFilter.h"
+#include "scanSchedule.h"
+#include "signatureIndex.h"
+#include "sha256Calc.h"
+#include "throttle.h"
+#include "treeHash.h"
 #include "utils.h"
 #include "scannerConstants.h"
 #include <filesystem>
 #include <fstream>
+#include <algorithm>
+#include <cerrno>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <cctype>
+#include <cstring>
+#include <map>
+#include <random>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(SCANNER_HAVE_ZLIB)
+#include <zlib.h>
+#endif
 
 namespace fs = std::filesystem;
 
@@ -138,6 +177,67 @@ TEST_F(SettingsValidatorTest, LogPathParentDoesNotExist) {
     EXPECT_NE(error->find("parent directory does not exist"), std::string::npos);
 }
 
+TEST_F(SettingsValidatorTest, SimilarityThresholdTooHigh) {
+    Scanner::ScanSettings settings;
+    settings.rootPath = validDir.string();
+    settings.databasePath = validCsv.string();
+    settings.similarityThreshold = 101;
+    
+    auto error = Scanner::SettingsValidator::Validate(settings);
+    ASSERT_TRUE(error.has_value());
+    EXPECT_NE(error->find("Similarity threshold"), std::string::npos);
+}
+
+TEST_F(SettingsValidatorTest, ShardOutOfRange) {
+    Scanner::ScanSettings settings;
+    settings.rootPath = validDir.string();
+    settings.databasePath = validCsv.string();
+    settings.shardCount = 4;
+    settings.shards = {4};
+    
+    auto error = Scanner::SettingsValidator::Validate(settings);
+    ASSERT_TRUE(error.has_value());
+    EXPECT_NE(error->find("out of range"), std::string::npos);
+    
+    // Worker processes hand out shards of their own
+    settings.shards = {1};
+    settings.workerProcesses = 2;
+    EXPECT_TRUE(Scanner::SettingsValidator::Validate(settings).has_value());
+}
+
+TEST_F(SettingsValidatorTest, AsyncReadsNeedThePageCache) {
+    Scanner::ScanSettings settings;
+    settings.rootPath = validDir.string();
+    settings.databasePath = validCsv.string();
+    settings.asyncDepth = Scanner::Constants::MAX_ASYNC_DEPTH + 1;
+    
+    auto error = Scanner::SettingsValidator::Validate(settings);
+    ASSERT_TRUE(error.has_value());
+    EXPECT_NE(error->find("cannot exceed"), std::string::npos);
+    
+    settings.asyncDepth = 64;
+    EXPECT_FALSE(Scanner::SettingsValidator::Validate(settings).has_value());
+    settings.cacheMode = Scanner::CacheMode::DropBehind;
+    EXPECT_TRUE(Scanner::SettingsValidator::Validate(settings).has_value());
+}
+
+TEST_F(SettingsValidatorTest, IndexPathChecks) {
+    Scanner::ScanSettings settings;
+    settings.rootPath = validDir.string();
+    settings.databasePath = validCsv.string();
+    settings.indexPath = (testDir / "base.idx").string();
+    EXPECT_FALSE(Scanner::SettingsValidator::Validate(settings).has_value());
+    
+    settings.indexCacheSize = Scanner::Constants::MAX_INDEX_CACHE_SIZE + 1;
+    EXPECT_TRUE(Scanner::SettingsValidator::Validate(settings).has_value());
+    settings.indexCacheSize = 0;
+    
+    settings.indexPath = validCsv.string();  // Would overwrite the base
+    EXPECT_TRUE(Scanner::SettingsValidator::Validate(settings).has_value());
+    settings.indexPath = (testDir / "missing" / "base.idx").string();
+    EXPECT_TRUE(Scanner::SettingsValidator::Validate(settings).has_value());
+}
+
 // ============================================================================
 // HashDatabase Tests
 // ============================================================================
@@ -263,31 +363,2010 @@ TEST_F(HashDatabaseTest, TrimWhitespace) {
     EXPECT_EQ(verdict, "Trojan");
 }
 
+TEST_F(HashDatabaseTest, IsMaliciousBatchMatchesSingleLookup) {
+    CreateCSV("batch.csv",
+        "abc123def456789012345678901234ab;Trojan\n"
+        "def456abc789012345678901234567cd;Virus\n");
+    
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadFromCSV((testDir / "batch.csv").string()));
+    
+    std::vector<std::string> hashes = {
+        "DEF456ABC789012345678901234567CD",
+        "00000000000000000000000000000000",
+        "not_a_hash",
+        "abc123def456789012345678901234ab",
+    };
+    std::vector<std::string> verdicts;
+    EXPECT_EQ(db.IsMaliciousBatch(hashes, verdicts), 2);
+    ASSERT_EQ(verdicts.size(), hashes.size());
+    EXPECT_EQ(verdicts[0], "Virus");
+    EXPECT_TRUE(verdicts[1].empty());
+    EXPECT_TRUE(verdicts[2].empty());
+    EXPECT_EQ(verdicts[3], "Trojan");
+}
+
+TEST_F(HashDatabaseTest, IsMaliciousBatchLargerThanGroup) {
+    std::string content;
+    std::vector<std::string> hashes;
+    for (int i = 0; i < 100; ++i) {
+        char hash[33];
+        std::snprintf(hash, sizeof(hash), "%032x", i * 7919);
+        hashes.push_back(hash);
+        if (i % 3 == 0) {
+            content += std::string(hash) + ";Sample" + std::to_string(i) + "\n";
+        }
+    }
+    CreateCSV("many.csv", content);
+    
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadFromCSV((testDir / "many.csv").string()));
+    EXPECT_EQ(db.GetSize(), 34);
+    
+    std::vector<std::string> verdicts;
+    EXPECT_EQ(db.IsMaliciousBatch(hashes, verdicts), 34);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(verdicts[i].empty(), i % 3 != 0) << i;
+    }
+}
+
+TEST_F(HashDatabaseTest, DuplicateHashKeepsLastVerdict) {
+    CreateCSV("dup.csv",
+        "abc123def456789012345678901234ab;Old\n"
+        "ABC123DEF456789012345678901234AB;New\n");
+    
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadFromCSV((testDir / "dup.csv").string()));
+    EXPECT_EQ(db.GetSize(), 1);
+    
+    std::string verdict;
+    EXPECT_TRUE(db.IsMalicious("abc123def456789012345678901234ab", verdict));
+    EXPECT_EQ(verdict, "New");
+}
+
+TEST_F(HashDatabaseTest, LoadMixedDigestTypes) {
+    CreateCSV("mixed.csv",
+        "65a8e27d8879283831b664bd8b7f0ad4;Md5Sample\n"
+        "0a0a9f2a6772942557ab5355d76af442f8f65e01;Sha1Sample\n"
+        "dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f;Sha256Sample\n");
+    
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadFromCSV((testDir / "mixed.csv").string()));
+    EXPECT_EQ(db.GetSize(), 3);
+    EXPECT_EQ(db.GetRequiredAlgorithms(),
+              Scanner::MaskOf(Scanner::HashAlgorithm::MD5) |
+              Scanner::MaskOf(Scanner::HashAlgorithm::SHA1) |
+              Scanner::MaskOf(Scanner::HashAlgorithm::SHA256));
+    
+    std::string verdict;
+    EXPECT_TRUE(db.IsMalicious("0A0A9F2A6772942557AB5355D76AF442F8F65E01", verdict));
+    EXPECT_EQ(verdict, "Sha1Sample");
+    EXPECT_TRUE(db.IsMalicious("dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f", verdict));
+    EXPECT_EQ(verdict, "Sha256Sample");
+}
+
+TEST_F(HashDatabaseTest, ExplicitTypeColumn) {
+    CreateCSV("typed.csv",
+        "0a0a9f2a6772942557ab5355d76af442f8f65e01;Sha1Sample;type=sha1\n"
+        "dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f;Wrong;type=md5\n"
+        "abc123def456789012345678901234ab;Unknown;type=crc32\n"
+        "def456abc789012345678901234567cd;Family;Variant\n");
+    
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadFromCSV((testDir / "typed.csv").string()));
+    EXPECT_EQ(db.GetSize(), 2);  // Type/length mismatch and unknown type are skipped
+    
+    std::string verdict;
+    EXPECT_TRUE(db.IsMalicious("0a0a9f2a6772942557ab5355d76af442f8f65e01", verdict));
+    EXPECT_EQ(verdict, "Sha1Sample");
+    EXPECT_TRUE(db.IsMalicious("def456abc789012345678901234567cd", verdict));
+    EXPECT_EQ(verdict, "Family;Variant");  // Non-attribute fields stay in the verdict
+}
+
+TEST_F(HashDatabaseTest, SizeAndPrefixAttributes) {
+    CreateCSV("sized.csv",
+        "65a8e27d8879283831b664bd8b7f0ad4;Hello;size=13;prefix=65a8e27d8879283831b664bd8b7f0ad4\n"
+        "d41d8cd98f00b204e9800998ecf8427e;Empty;size=0\n"
+        "abc123def456789012345678901234ab;NoSize;prefix=65a8e27d8879283831b664bd8b7f0ad4\n"
+        "def456abc789012345678901234567cd;BadSize;size=12k\n");
+    
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadFromCSV((testDir / "sized.csv").string()));
+    EXPECT_EQ(db.GetSize(), 2);  // prefix= without size= and a non-numeric size are skipped
+    
+    using SizeCheck = Scanner::HashDatabase::SizeCheck;
+    EXPECT_EQ(db.CheckSize(13), SizeCheck::CheckPrefix);
+    EXPECT_EQ(db.CheckSize(0), SizeCheck::FullHash);
+    EXPECT_EQ(db.CheckSize(14), SizeCheck::Clean);
+    
+    const unsigned char helloMd5[] = {0x65, 0xa8, 0xe2, 0x7d, 0x88, 0x79, 0x28, 0x38,
+                                      0x31, 0xb6, 0x64, 0xbd, 0x8b, 0x7f, 0x0a, 0xd4};
+    EXPECT_TRUE(db.MatchesPrefix(13, helloMd5));
+    EXPECT_FALSE(db.MatchesPrefix(14, helloMd5));
+    
+    std::string verdict;
+    EXPECT_TRUE(db.IsMalicious("65a8e27d8879283831b664bd8b7f0ad4", verdict));
+    EXPECT_EQ(verdict, "Hello");
+}
+
+TEST_F(HashDatabaseTest, UnsizedSignatureDisablesSizeCheck) {
+    CreateCSV("partial.csv",
+        "65a8e27d8879283831b664bd8b7f0ad4;Hello;size=13;prefix=65a8e27d8879283831b664bd8b7f0ad4\n"
+        "d41d8cd98f00b204e9800998ecf8427e;Empty\n");
+    
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadFromCSV((testDir / "partial.csv").string()));
+    EXPECT_EQ(db.CheckSize(14), Scanner::HashDatabase::SizeCheck::FullHash);
+}
+
+TEST_F(HashDatabaseTest, SimilarityDigests) {
+    CreateCSV("fuzzy.csv",
+        "1536:faDGbUVKXPqA4B4rSHZTg7dXRuEV+Lw+uXVzMebq89rg9zg7b/aSMFWbrgC2P:fOKCdB1HZT8+XyVMeu8q6MFWHy;Family\n"
+        "3:aaX8n:aF;Small;type=ssdeep\n"
+        "3:aaX8n:aF;Mismatch;type=md5\n"
+        "3:aa;X8n:aF;Broken\n");
+    
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadFromCSV((testDir / "fuzzy.csv").string()));
+    EXPECT_EQ(db.GetSize(), 2);
+    EXPECT_TRUE(db.GetRequiredAlgorithms() & Scanner::MaskOf(Scanner::HashAlgorithm::SSDEEP));
+    EXPECT_EQ(db.CheckSize(100000), Scanner::HashDatabase::SizeCheck::FullHash);
+    
+    std::string verdict;
+    int score = 0;
+    EXPECT_TRUE(db.FindSimilar(
+        "1536:faDZbUVKXPqA4B4rSHZTg7dXRuEV+Lw+uXnzMebq89rg9zg7b/aSMEWbrgC2P:fHKCdB1HZT8+XyzMeu8q6MEWHy",
+        80, verdict, score));
+    EXPECT_EQ(verdict, "Family");
+    EXPECT_EQ(score, 96);
+    
+    EXPECT_TRUE(db.FindSimilar("3:aaX8n:aF", 100, verdict, score));  // Too short for a 7-gram
+    EXPECT_EQ(verdict, "Small");
+    EXPECT_FALSE(db.FindSimilar("6144:72I2eeYaKkB50nKd0zBBJgSYfQiHvHDvXaTjGviatWRw1DFruU:72I21YKieQBruQivDvXa2vifqL",
+                                1, verdict, score));
+    EXPECT_FALSE(db.IsMalicious("3:aaX8n:aF", verdict));  // Never an exact-table key
+}
+
+TEST_F(HashDatabaseTest, ContentSignatures) {
+    CreateCSV("content.csv",
+        "4d5a90000300;PE.Stub;type=content\n"
+        "deadBEEF;Marker;type=content\n"
+        "abcdef;TooShort;type=content\n"
+        "4d5a9;OddLength;type=content\n"
+        "4d5a9000xx;NotHex;type=content\n"
+        "4d5a90000300;Sized;type=content;size=6\n"
+        "65a8e27d8879283831b664bd8b7f0ad4;Hello;size=13\n");
+    
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadFromCSV((testDir / "content.csv").string()));
+    EXPECT_EQ(db.GetSize(), 3);
+    EXPECT_TRUE(db.HasContentSignatures());
+    EXPECT_EQ(db.GetRequiredAlgorithms(), Scanner::MaskOf(Scanner::HashAlgorithm::MD5));
+    EXPECT_EQ(db.CheckSize(14), Scanner::HashDatabase::SizeCheck::FullHash);  // A pattern fits any size
+    
+    const std::string data = std::string(100, 'x') + "\xDE\xAD" + std::string(10, 'y') + "\xDE\xAD\xBE\xEF";
+    Scanner::ContentMatcher::State state;
+    db.ScanContent(state, reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    std::string verdict;
+    ASSERT_TRUE(db.ContentVerdict(state, verdict));
+    EXPECT_EQ(verdict, "Marker");
+    
+    Scanner::ContentMatcher::State clean;
+    db.ScanContent(clean, reinterpret_cast<const unsigned char*>(data.data()), 100);
+    EXPECT_FALSE(db.ContentVerdict(clean, verdict));
+}
+
+TEST_F(HashDatabaseTest, TreeDigests) {
+    const std::string tree = "042a7d64a581ef2ee983f21058801cc35663b705e6c55f62fa8e0f18ecc70989";
+    CreateCSV("tree.csv",
+        tree + ";Tree.Hello;type=tree\n" +
+        "65a8e27d8879283831b664bd8b7f0ad4;Tree.TooShort;type=tree\n" +
+        "dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f;Sha.Hello\n");
+    
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadFromCSV((testDir / "tree.csv").string()));
+    EXPECT_EQ(db.GetSize(), 2);
+    EXPECT_EQ(db.GetRequiredAlgorithms(),
+              Scanner::MaskOf(Scanner::HashAlgorithm::SHA256) | Scanner::MaskOf(Scanner::HashAlgorithm::TREE));
+    
+    // Without a declared type a 64-character digest is a SHA-256
+    std::string verdict;
+    EXPECT_FALSE(db.IsMalicious(tree, verdict));
+    
+    std::vector<std::string> verdicts;
+    EXPECT_EQ(db.IsMaliciousBatch({tree, tree}, verdicts,
+                                  {Scanner::HashAlgorithm::TREE, Scanner::HashAlgorithm::SHA256}), 1u);
+    EXPECT_EQ(verdicts[0], "Tree.Hello");
+    EXPECT_TRUE(verdicts[1].empty());
+}
+
 // ============================================================================
-// Utils Tests
+// Signature Index Tests
 // ============================================================================
 
-TEST(UtilsTest, ToLowerConvertsCorrectly) {
-    EXPECT_EQ(Scanner::Utils::ToLower("HELLO"), "hello");
-    EXPECT_EQ(Scanner::Utils::ToLower("HeLLo"), "hello");
-    EXPECT_EQ(Scanner::Utils::ToLower("hello"), "hello");
-    EXPECT_EQ(Scanner::Utils::ToLower("ABC123"), "abc123");
-    EXPECT_EQ(Scanner::Utils::ToLower(""), "");
+class SignatureIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        testDir = fs::temp_directory_path() / "signature_index_test";
+        fs::create_directories(testDir);
+        csvPath = (testDir / "base.csv").string();
+        indexPath = (testDir / "base.idx").string();
+    }
+    
+    void TearDown() override {
+        std::error_code ec;
+        fs::remove_all(testDir, ec);
+    }
+    
+    void CreateCSV(const std::string& content) {
+        std::ofstream(csvPath, std::ios::trunc) << content;
+    }
+    
+    static std::string Md5Hex(uint64_t high, uint64_t low) {
+        char hash[33];
+        std::snprintf(hash, sizeof(hash), "%016llx%016llx", static_cast<unsigned long long>(high),
+                      static_cast<unsigned long long>(low));
+        return hash;
+    }
+    
+    fs::path testDir;
+    std::string csvPath;
+    std::string indexPath;
+};
+
+TEST_F(SignatureIndexTest, IndexedLoadMatchesCsv) {
+    const std::string tree = "042a7d64a581ef2ee983f21058801cc35663b705e6c55f62fa8e0f18ecc70989";
+    CreateCSV(
+        "65a8e27d8879283831b664bd8b7f0ad4;Hello;size=13;prefix=65a8e27d8879283831b664bd8b7f0ad4\n"
+        "0a0a9f2a6772942557ab5355d76af442f8f65e01;Sha1Sample\n"
+        "dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f;Sha256Sample\n" +
+        tree + ";Tree.Hello;type=tree\n"
+        "abc123def456789012345678901234ab;Old\n"
+        "ABC123DEF456789012345678901234AB;New\n"
+        "3:aaX8n:aF;Small;type=ssdeep\n"
+        "deadBEEF;Marker;type=content\n"
+        "not_a_hash;Broken\n");
+    
+    Scanner::HashDatabase memory;
+    Scanner::HashDatabase indexed;
+    ASSERT_TRUE(memory.LoadFromCSV(csvPath));
+    ASSERT_TRUE(indexed.LoadIndexed(csvPath, indexPath));
+    EXPECT_TRUE(indexed.IsIndexed());
+    EXPECT_EQ(indexed.GetSize(), memory.GetSize());
+    EXPECT_EQ(indexed.GetRequiredAlgorithms(), memory.GetRequiredAlgorithms());
+    EXPECT_TRUE(indexed.HasContentSignatures());
+    
+    const std::vector<std::string> hashes = {
+        "65A8E27D8879283831B664BD8B7F0AD4",
+        "0a0a9f2a6772942557ab5355d76af442f8f65e01",
+        "dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f",
+        "abc123def456789012345678901234ab",
+        "00000000000000000000000000000000",
+        "ffffffffffffffffffffffffffffffff",
+        tree,
+    };
+    for (const auto& hash : hashes) {
+        std::string expected;
+        std::string verdict;
+        EXPECT_EQ(indexed.IsMalicious(hash, verdict), memory.IsMalicious(hash, expected)) << hash;
+        EXPECT_EQ(verdict, expected) << hash;
+    }
+    
+    std::vector<Scanner::HashAlgorithm> algorithms(hashes.size(), Scanner::HashAlgorithm::MD5);
+    algorithms[1] = Scanner::HashAlgorithm::SHA1;
+    algorithms[2] = Scanner::HashAlgorithm::SHA256;
+    algorithms[6] = Scanner::HashAlgorithm::TREE;
+    std::vector<std::string> expected;
+    std::vector<std::string> verdicts;
+    EXPECT_EQ(indexed.IsMaliciousBatch(hashes, verdicts, algorithms), 5u);
+    EXPECT_EQ(memory.IsMaliciousBatch(hashes, expected, algorithms), 5u);
+    EXPECT_EQ(verdicts, expected);
+    EXPECT_EQ(verdicts[3], "New");
+    EXPECT_EQ(verdicts[6], "Tree.Hello");
+    
+    std::vector<Scanner::HashDatabase::DigestKey> keys(2);
+    keys[0].algorithm = Scanner::HashAlgorithm::SHA1;
+    ASSERT_TRUE(Scanner::Hex::Decode(hashes[1].c_str(), 20, keys[0].digest.data()));
+    keys[1].algorithm = Scanner::HashAlgorithm::MD5;
+    EXPECT_EQ(indexed.IsMaliciousBatch(keys, verdicts), 1u);
+    EXPECT_EQ(verdicts[0], "Sha1Sample");
+    
+    // ssdeep and byte signatures are still searched in memory
+    std::string verdict;
+    int score = 0;
+    EXPECT_TRUE(indexed.FindSimilar("3:aaX8n:aF", 100, verdict, score));
+    EXPECT_EQ(verdict, "Small");
+    const std::string data = "xx\xDE\xAD\xBE\xEFyy";
+    Scanner::ContentMatcher::State state;
+    indexed.ScanContent(state, reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    EXPECT_TRUE(indexed.ContentVerdict(state, verdict));
+    EXPECT_EQ(verdict, "Marker");
+    
+    // The prefix digest is dropped, the size still rules files out
+    EXPECT_EQ(indexed.CheckSize(13), Scanner::HashDatabase::SizeCheck::FullHash);
 }
 
-TEST(UtilsTest, TrimRemovesWhitespace) {
-    EXPECT_EQ(Scanner::Utils::Trim("  hello  "), "hello");
-    EXPECT_EQ(Scanner::Utils::Trim("hello"), "hello");
-    EXPECT_EQ(Scanner::Utils::Trim("  hello"), "hello");
-    EXPECT_EQ(Scanner::Utils::Trim("hello  "), "hello");
-    EXPECT_EQ(Scanner::Utils::Trim("   "), "");
-    EXPECT_EQ(Scanner::Utils::Trim(""), "");
+TEST_F(SignatureIndexTest, SmallBuildBudgetMergesRuns) {
+    std::string content;
+    for (uint64_t i = 0; i < 20000; ++i) {
+        content += Md5Hex(i * 0x9E3779B97F4A7C15ull, i) + ";Sample" + std::to_string(i % 7) + "\n";
+    }
+    for (uint64_t i = 0; i < 20000; i += 1000) {
+        content += Md5Hex(i * 0x9E3779B97F4A7C15ull, i) + ";Replaced\n";
+    }
+    CreateCSV(content);
+    
+    // About 400 KB of records against a 64 KB budget
+    ASSERT_TRUE(Scanner::HashDatabase::BuildIndex(csvPath, indexPath, 64 * 1024));
+    const auto built = fs::last_write_time(indexPath);
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadIndexed(csvPath, indexPath, 0));
+    EXPECT_EQ(fs::last_write_time(indexPath), built);  // Up to date, not rebuilt
+    EXPECT_EQ(db.GetSize(), 20000u);
+    EXPECT_EQ(std::distance(fs::directory_iterator(testDir), fs::directory_iterator()), 2);  // No runs left
+    
+    std::vector<std::string> hashes;
+    for (uint64_t i = 0; i < 20000; i += 7) {
+        hashes.push_back(Md5Hex(i * 0x9E3779B97F4A7C15ull, i));
+        hashes.push_back(Md5Hex(i * 0x9E3779B97F4A7C15ull, i + 1));
+    }
+    std::vector<std::string> verdicts;
+    EXPECT_EQ(db.IsMaliciousBatch(hashes, verdicts), hashes.size() / 2);
+    for (size_t k = 0; k < hashes.size(); k += 2) {
+        const uint64_t i = k / 2 * 7;
+        EXPECT_EQ(verdicts[k], i % 1000 == 0 ? "Replaced" : "Sample" + std::to_string(i % 7)) << i;
+        EXPECT_TRUE(verdicts[k + 1].empty()) << i;
+    }
+    std::string verdict;
+    EXPECT_TRUE(db.IsMalicious(Md5Hex(19999 * 0x9E3779B97F4A7C15ull, 19999), verdict));
 }
 
-TEST(UtilsTest, TrimHandlesTabs) {
-    EXPECT_EQ(Scanner::Utils::Trim("\thello\t"), "hello");
-    EXPECT_EQ(Scanner::Utils::Trim("\t\thello"), "hello");
+TEST_F(SignatureIndexTest, SharedLeadingBytesAcrossPages) {
+    // 204 MD5 records fill a page, so these span four of them
+    std::string content;
+    std::vector<std::string> hashes;
+    for (uint64_t i = 0; i < 700; ++i) {
+        hashes.push_back(Md5Hex(0x0123456789abcdefull, i * 3));
+        content += hashes.back() + ";Shared" + std::to_string(i) + "\n";
+    }
+    content += Md5Hex(0x0123456789abcdeeull, 0) + ";Before\n";
+    CreateCSV(content);
+    
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadIndexed(csvPath, indexPath, Scanner::Constants::INDEX_PAGE_SIZE));
+    for (uint64_t i = 0; i < 700; i += 50) {
+        std::string verdict;
+        EXPECT_TRUE(db.IsMalicious(hashes[i], verdict)) << i;
+        EXPECT_EQ(verdict, "Shared" + std::to_string(i));
+        EXPECT_FALSE(db.IsMalicious(Md5Hex(0x0123456789abcdefull, i * 3 + 1), verdict)) << i;
+    }
+    std::vector<std::string> verdicts;
+    EXPECT_EQ(db.IsMaliciousBatch(hashes, verdicts), hashes.size());
+    EXPECT_EQ(verdicts[0], "Shared0");
+    EXPECT_EQ(verdicts[699], "Shared699");
+}
+
+TEST_F(SignatureIndexTest, RebuiltWhenStale) {
+    CreateCSV("abc123def456789012345678901234ab;Old\n");
+    Scanner::HashDatabase db;
+    ASSERT_TRUE(db.LoadIndexed(csvPath, indexPath));
+    
+    CreateCSV("abc123def456789012345678901234ab;Newer\n");
+    ASSERT_TRUE(db.LoadIndexed(csvPath, indexPath));
+    std::string verdict;
+    EXPECT_TRUE(db.IsMalicious("abc123def456789012345678901234ab", verdict));
+    EXPECT_EQ(verdict, "Newer");
+    
+    std::ofstream(indexPath, std::ios::trunc) << "not an index";
+    EXPECT_EQ(Scanner::SignatureIndex::Open(indexPath, 1), nullptr);
+    ASSERT_TRUE(db.LoadIndexed(csvPath, indexPath));
+    EXPECT_TRUE(db.IsMalicious("abc123def456789012345678901234ab", verdict));
+    
+    Scanner::HashDatabase missing;
+    EXPECT_FALSE(missing.LoadIndexed((testDir / "missing.csv").string(), indexPath));
+}
+
+// ============================================================================
+// FileHasher Tests
+// ============================================================================
+
+TEST(FileHasherTest, SinglePassComputesAllRequestedDigests) {
+    auto path = fs::temp_directory_path() / "file_hasher_test.bin";
+    std::ofstream(path, std::ios::binary) << "Hello, World!";
+    
+    auto digests = Scanner::FileHasher::CalculateFile(path,
+        Scanner::MaskOf(Scanner::HashAlgorithm::MD5) | Scanner::MaskOf(Scanner::HashAlgorithm::SHA256));
+    EXPECT_EQ(digests.Get(Scanner::HashAlgorithm::MD5), "65a8e27d8879283831b664bd8b7f0ad4");
+    EXPECT_TRUE(digests.Get(Scanner::HashAlgorithm::SHA1).empty());
+    EXPECT_EQ(digests.Get(Scanner::HashAlgorithm::SHA256),
+              "dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f");
+    
+    std::error_code ec;
+    fs::remove(path, ec);
+}
+
+TEST(FileHasherTest, RejectedPrefixSkipsFullHash) {
+    auto path = fs::temp_directory_path() / "file_hasher_prefix_test.bin";
+    std::ofstream(path, std::ios::binary) << std::string(3 * Scanner::Constants::PREFIX_HASH_SIZE, 'x');
+    const auto md5 = Scanner::MaskOf(Scanner::HashAlgorithm::MD5);
+    
+    size_t calls = 0;
+    auto rejected = Scanner::FileHasher::CalculateFile(path, md5, [&calls](const unsigned char*) {
+        ++calls;
+        return false;
+    });
+    EXPECT_FALSE(rejected.has_value());
+    EXPECT_EQ(calls, 1);
+    
+    auto accepted = Scanner::FileHasher::CalculateFile(path, md5, [](const unsigned char*) { return true; });
+    ASSERT_TRUE(accepted.has_value());
+    EXPECT_EQ(accepted->Get(Scanner::HashAlgorithm::MD5),
+              Scanner::FileHasher::CalculateFile(path, md5).Get(Scanner::HashAlgorithm::MD5));
+    
+    std::error_code ec;
+    fs::remove(path, ec);
+}
+
+TEST(FileHasherTest, OpenReaderServesSizeAndHash) {
+    auto path = fs::temp_directory_path() / "file_hasher_reader_test.bin";
+    std::ofstream(path, std::ios::binary) << std::string(3 * Scanner::Constants::PREFIX_HASH_SIZE, 'x');
+    const auto md5 = Scanner::MaskOf(Scanner::HashAlgorithm::MD5);
+    
+    // The observer sees the prefix even when the filter rejects it
+    size_t observed = 0;
+    auto observer = [&observed](const unsigned char*, size_t size) { observed += size; };
+    {
+        Scanner::FileReader file(path, Scanner::CacheMode::Normal);
+        EXPECT_EQ(file.Size(), 3 * Scanner::Constants::PREFIX_HASH_SIZE);
+        EXPECT_FALSE(Scanner::FileHasher::CalculateFile(file, file.Size(), md5,
+            [](const unsigned char*) { return false; }, observer).has_value());
+        EXPECT_EQ(observed, Scanner::Constants::PREFIX_HASH_SIZE);
+    }
+    
+    observed = 0;
+    Scanner::FileReader file(path, Scanner::CacheMode::Normal);
+    auto digests = Scanner::FileHasher::CalculateFile(file, file.Size(), md5,
+        [](const unsigned char*) { return true; }, observer);
+    ASSERT_TRUE(digests.has_value());
+    EXPECT_EQ(observed, 3 * Scanner::Constants::PREFIX_HASH_SIZE);
+    EXPECT_EQ(digests->Get(Scanner::HashAlgorithm::MD5),
+              Scanner::FileHasher::CalculateFile(path, md5).Get(Scanner::HashAlgorithm::MD5));
+    
+    std::error_code ec;
+    fs::remove(path, ec);
+}
+
+TEST(FileHasherTest, SimilarityDigestInSamePass) {
+    auto path = fs::temp_directory_path() / "file_hasher_fuzzy_test.bin";
+    std::ofstream(path, std::ios::binary) << "Hello, World!";
+    
+    auto digests = Scanner::FileHasher::CalculateFile(path,
+        Scanner::MaskOf(Scanner::HashAlgorithm::MD5) | Scanner::MaskOf(Scanner::HashAlgorithm::SSDEEP));
+    EXPECT_EQ(digests.Get(Scanner::HashAlgorithm::MD5), "65a8e27d8879283831b664bd8b7f0ad4");
+    EXPECT_EQ(digests.Get(Scanner::HashAlgorithm::SSDEEP), "3:aaX8n:aF");
+    
+    std::error_code ec;
+    fs::remove(path, ec);
+}
+
+// ============================================================================
+// AsyncHasher Tests
+// ============================================================================
+
+TEST(AsyncHasherTest, MatchesBlockingReads) {
+    auto hasher = Scanner::AsyncHasher::Create(2);
+    if (!hasher) {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+    
+    // More files than slots, of one, several and no buffers
+    const fs::path dir = fs::temp_directory_path() / "async_hasher_test";
+    fs::create_directories(dir);
+    std::vector<fs::path> paths;
+    std::mt19937 random(11);
+    for (size_t size : {13u, 0u, 3u << 20, 40'000u, 5u}) {
+        std::string content(size, '\0');
+        for (auto& byte : content) {
+            byte = static_cast<char>(random());
+        }
+        paths.push_back(dir / ("file" + std::to_string(paths.size())));
+        std::ofstream(paths.back(), std::ios::binary) << content;
+    }
+    paths.push_back(dir / "missing");
+    
+    const auto algorithms = Scanner::MaskOf(Scanner::HashAlgorithm::MD5) | Scanner::MaskOf(Scanner::HashAlgorithm::SHA256);
+    std::vector<Scanner::AsyncHasher::File> files(paths.size());
+    std::vector<size_t> observed(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        files[i].path = &paths[i];
+        files[i].size = i + 1 < paths.size() ? fs::file_size(paths[i]) : 0;
+        files[i].observer = [&observed, i](const unsigned char*, size_t size) { observed[i] += size; };
+    }
+    // A rejected prefix ends the read; a limited file is only observed
+    size_t prefixCalls = 0;
+    files[2].prefixFilter = [&prefixCalls](const unsigned char*) { return ++prefixCalls, false; };
+    files[3].limit = 512;
+    
+    hasher->Run(files, algorithms, {});
+    EXPECT_EQ(prefixCalls, 1u);
+    EXPECT_FALSE(files[2].digests.has_value());
+    EXPECT_EQ(observed[2], Scanner::Constants::PREFIX_HASH_SIZE);
+    EXPECT_FALSE(files[3].digests.has_value());
+    EXPECT_EQ(observed[3], 512u);
+    EXPECT_EQ(files[5].error, ENOENT);
+    for (size_t i : {0u, 1u, 4u}) {
+        ASSERT_TRUE(files[i].digests.has_value()) << i;
+        EXPECT_EQ(files[i].error, 0);
+        EXPECT_EQ(observed[i], fs::file_size(paths[i]));
+        const auto expected = Scanner::FileHasher::CalculateFile(paths[i], algorithms);
+        EXPECT_EQ(files[i].digests->Get(Scanner::HashAlgorithm::MD5), expected.Get(Scanner::HashAlgorithm::MD5));
+        EXPECT_EQ(files[i].digests->Get(Scanner::HashAlgorithm::SHA256), expected.Get(Scanner::HashAlgorithm::SHA256));
+    }
+    
+    // The same hasher takes the next group, with the large file accepted this time
+    std::vector<Scanner::AsyncHasher::File> again(1);
+    again[0].path = &paths[2];
+    again[0].size = 3u << 20;
+    again[0].prefixFilter = [](const unsigned char*) { return true; };
+    hasher->Run(again, algorithms, {});
+    ASSERT_TRUE(again[0].digests.has_value());
+    EXPECT_EQ(again[0].digests->Get(Scanner::HashAlgorithm::MD5),
+              Scanner::FileHasher::CalculateFile(paths[2], algorithms).Get(Scanner::HashAlgorithm::MD5));
+    
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+}
+
+TEST(AsyncHasherTest, OpenOnlyReportsUnreadableFiles) {
+    auto hasher = Scanner::AsyncHasher::Create(2);
+    if (!hasher) {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+    
+    const fs::path dir = fs::temp_directory_path() / "async_hasher_open_test";
+    fs::create_directories(dir);
+    std::vector<fs::path> paths = {dir / "present", dir / "missing"};
+    std::ofstream(paths[0], std::ios::binary) << "Hello, world!";
+    
+    std::vector<Scanner::AsyncHasher::File> files(paths.size());
+    size_t observed = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        files[i].path = &paths[i];
+        files[i].size = 13;
+        files[i].openOnly = true;
+        files[i].observer = [&observed](const unsigned char*, size_t size) { observed += size; };
+    }
+    hasher->Run(files, Scanner::MaskOf(Scanner::HashAlgorithm::MD5), {});
+    EXPECT_EQ(files[0].error, 0);
+    EXPECT_FALSE(files[0].digests.has_value());
+    EXPECT_EQ(files[1].error, ENOENT);
+    EXPECT_EQ(observed, 0u);  // Nothing is read
+    
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+}
+
+TEST(AsyncHasherTest, FailureLeavesNoDescriptors) {
+    auto hasher = Scanner::AsyncHasher::Create(8);
+    if (!hasher || !fs::exists("/proc/self/fd")) {
+        GTEST_SKIP() << "io_uring or /proc is not available";
+    }
+    auto openDescriptors = [] {
+        return std::distance(fs::directory_iterator("/proc/self/fd"), fs::directory_iterator());
+    };
+    
+    const fs::path dir = fs::temp_directory_path() / "async_hasher_failure_test";
+    fs::create_directories(dir);
+    // An empty file frees its slot at once, so the next file's open goes
+    // into the ring with the second reads of the large ones
+    std::vector<fs::path> paths;
+    for (int i = 0; i < 16; ++i) {
+        paths.push_back(dir / ("file" + std::to_string(i)));
+        std::ofstream(paths.back(), std::ios::binary) << std::string(i == 0 ? 0 : 3u << 20, static_cast<char>('a' + i));
+    }
+    std::vector<Scanner::AsyncHasher::File> files(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        files[i].path = &paths[i];
+        files[i].size = fs::file_size(paths[i]);
+    }
+    // Fails on its second buffer, while other requests are still out
+    size_t buffers = 0;
+    files[1].observer = [&buffers](const unsigned char*, size_t) {
+        if (++buffers == 2) {
+            throw std::runtime_error("observer failed");
+        }
+    };
+    
+    const auto before = openDescriptors();
+    EXPECT_THROW(hasher->Run(files, Scanner::MaskOf(Scanner::HashAlgorithm::MD5), {}), std::runtime_error);
+    hasher.reset();
+    EXPECT_EQ(openDescriptors(), before - 1);  // The ring's own descriptor is gone too
+    
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+}
+
+// ============================================================================
+// FuzzyHasher Tests
+// ============================================================================
+
+namespace {
+
+std::string RandomBytes(size_t size, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::string data(size, '\0');
+    for (auto& c : data) {
+        c = static_cast<char>(rng() & 0xFF);
+    }
+    return data;
+}
+
+std::string FuzzyOf(const std::string& data, size_t chunk) {
+    Scanner::FuzzyHasher hasher;
+    for (size_t offset = 0; offset < data.size(); offset += chunk) {
+        hasher.Update(data.data() + offset, std::min(chunk, data.size() - offset));
+    }
+    return hasher.Final();
+}
+
+} // namespace
+
+TEST(FuzzyHasherTest, DigestIndependentOfChunking) {
+    EXPECT_EQ(FuzzyOf("", 1), "3::");
+    EXPECT_EQ(FuzzyOf(std::string(100000, '\0'), 4096), "3::");  // Rolling sum never triggers
+    
+    const auto data = RandomBytes(300000, 1);
+    const auto digest = FuzzyOf(data, Scanner::Constants::HASH_BUFFER_SIZE);
+    EXPECT_EQ(FuzzyOf(data, 1), digest);
+    EXPECT_EQ(FuzzyOf(data, 4093), digest);
+    EXPECT_EQ(digest.substr(0, digest.find(':')), "6144");
+    
+    Scanner::FuzzyHasher sized(data.size());
+    sized.Update(data.data(), data.size());
+    EXPECT_EQ(sized.Final(), digest);
+}
+
+TEST(FuzzyHasherTest, ScoresVariantsAboveUnrelatedData) {
+    const auto original = RandomBytes(200000, 2);
+    auto variant = original;
+    variant.insert(100000, "repacked section");
+    variant[5000] ^= 1;
+    
+    const auto originalDigest = FuzzyOf(original, 65536);
+    EXPECT_EQ(Scanner::FuzzyHasher::Compare(originalDigest, originalDigest), 100);
+    EXPECT_GE(Scanner::FuzzyHasher::Compare(originalDigest, FuzzyOf(variant, 65536)), 80);
+    EXPECT_EQ(Scanner::FuzzyHasher::Compare(originalDigest, FuzzyOf(RandomBytes(200000, 3), 65536)), 0);
+    EXPECT_EQ(Scanner::FuzzyHasher::Compare(originalDigest, "not a digest"), 0);
+}
+
+TEST(FuzzyIndexTest, FindBestMatchesLinearScan) {
+    // Mutated copies of a few originals, so that many entries are related
+    std::mt19937 rng(4);
+    std::vector<std::string> originals;
+    for (unsigned i = 0; i < 8; ++i) {
+        originals.push_back(RandomBytes(50000 + 20000 * i, 10 + i));
+    }
+    
+    std::vector<Scanner::FuzzyIndex::Entry> entries;
+    std::vector<Scanner::FuzzyDigest> digests;
+    for (uint32_t id = 1; id <= 200; ++id) {
+        auto data = originals[rng() % originals.size()];
+        for (int edit = 0; edit < 4; ++edit) {
+            data[rng() % data.size()] ^= 0x55;
+        }
+        auto digest = Scanner::FuzzyDigest::Parse(FuzzyOf(data, 65536));
+        ASSERT_TRUE(digest.has_value());
+        digests.push_back(*digest);
+        entries.push_back({*digest, id});
+    }
+    Scanner::FuzzyIndex index;
+    index.Build(entries);
+    
+    for (const auto& original : originals) {
+        auto query = Scanner::FuzzyDigest::Parse(FuzzyOf(original, 65536));
+        ASSERT_TRUE(query.has_value());
+        
+        int expected = 0;
+        for (const auto& digest : digests) {
+            expected = std::max(expected, Scanner::FuzzyHasher::Compare(*query, digest));
+        }
+        auto match = index.FindBest(*query, 1);
+        EXPECT_EQ(match.score, expected);
+        EXPECT_EQ(match.id != 0, expected > 0);
+    }
+}
+
+// ============================================================================
+// ContentMatcher Tests
+// ============================================================================
+
+namespace {
+
+uint32_t ScanInChunks(const Scanner::ContentMatcher& matcher, const std::string& data, size_t chunk) {
+    Scanner::ContentMatcher::State state;
+    for (size_t offset = 0; offset < data.size(); offset += chunk) {
+        matcher.Scan(state, reinterpret_cast<const unsigned char*>(data.data()) + offset,
+                     std::min(chunk, data.size() - offset));
+    }
+    return state.match;
+}
+
+} // namespace
+
+TEST(ContentMatcherTest, FirstMatchAgreesWithNaiveSearch) {
+    // A four-letter alphabet makes overlapping and nested patterns common
+    std::mt19937 rng(5);
+    auto randomText = [&rng](size_t size) {
+        std::string text(size, 'a');
+        for (auto& c : text) {
+            c = "abcd"[rng() % 4];
+        }
+        return text;
+    };
+    
+    for (int round = 0; round < 20; ++round) {
+        std::vector<Scanner::ContentMatcher::Pattern> patterns;
+        for (uint32_t id = 1; id <= 40; ++id) {
+            patterns.push_back({randomText(8 + rng() % 5), id});
+        }
+        patterns.push_back({"abc", 99});  // Below MIN_PATTERN_SIZE, ignored
+        Scanner::ContentMatcher matcher;
+        matcher.Build(patterns);
+        
+        const std::string data = randomText(20000);
+        
+        // The automaton reports a pattern ending at the earliest possible position
+        size_t firstEnd = std::string::npos;
+        std::vector<uint32_t> candidates;
+        for (const auto& pattern : patterns) {
+            if (pattern.bytes.size() < Scanner::ContentMatcher::MIN_PATTERN_SIZE) {
+                continue;
+            }
+            const size_t position = data.find(pattern.bytes);
+            if (position == std::string::npos) {
+                continue;
+            }
+            const size_t end = position + pattern.bytes.size();
+            if (end < firstEnd) {
+                firstEnd = end;
+                candidates.clear();
+            }
+            if (end == firstEnd) {
+                candidates.push_back(pattern.id);
+            }
+        }
+        
+        for (size_t chunk : {size_t{1}, size_t{7}, size_t{18}, size_t{64}, size_t{4096}, data.size()}) {
+            const uint32_t match = ScanInChunks(matcher, data, chunk);
+            if (candidates.empty()) {
+                EXPECT_EQ(match, 0u) << "chunk " << chunk;
+            } else {
+                EXPECT_NE(std::find(candidates.begin(), candidates.end(), match), candidates.end())
+                    << "chunk " << chunk;
+            }
+        }
+    }
+}
+
+TEST(ContentMatcherTest, FindsBinaryPatternsAcrossBufferBoundaries) {
+    std::vector<Scanner::ContentMatcher::Pattern> patterns;
+    for (uint32_t id = 1; id <= 1000; ++id) {
+        patterns.push_back({RandomBytes(4 + id % 29, id), id});
+    }
+    Scanner::ContentMatcher matcher;
+    matcher.Build(patterns);
+    EXPECT_EQ(matcher.Size(), 1000u);
+    
+    std::string data = RandomBytes(1 << 20, 2024);
+    EXPECT_EQ(ScanInChunks(matcher, data, 65536), 0u);  // 4-byte prefixes collide by chance only rarely
+    
+    // Planted so that it straddles the 64 KB boundary used by FileHasher
+    const auto& planted = patterns[776].bytes;
+    data.replace(65536 - planted.size() / 2, planted.size(), planted);
+    for (size_t chunk : {size_t{65536}, size_t{1000}, size_t{17}}) {
+        EXPECT_EQ(ScanInChunks(matcher, data, chunk), 777u) << "chunk " << chunk;
+    }
+    
+    Scanner::ContentMatcher empty;
+    empty.Build({});
+    EXPECT_TRUE(empty.Empty());
+    EXPECT_EQ(ScanInChunks(empty, data, 65536), 0u);
+}
+
+// ============================================================================
+// ArchiveWalker Tests
+// ============================================================================
+
+namespace {
+
+class StringSource : public Scanner::ByteSource {
+public:
+    explicit StringSource(const std::string& data) : data_(data) {}
+    
+    size_t Read(unsigned char* data, size_t size) override {
+        const size_t count = std::min(size, data_.size() - offset_);
+        std::memcpy(data, data_.data() + offset_, count);
+        offset_ += count;
+        return count;
+    }
+    
+private:
+    const std::string& data_;
+    size_t offset_ = 0;
+};
+
+std::string TarEntry(const std::string& name, const std::string& data, char type = '0') {
+    std::string header(512, '\0');
+    header.replace(0, name.size(), name);
+    std::snprintf(&header[100], 8, "%07o", 0644);
+    std::snprintf(&header[124], 12, "%011llo", static_cast<unsigned long long>(data.size()));
+    header[156] = type;
+    header.replace(257, 6, std::string("ustar\0", 6));
+    header.replace(263, 2, "00");
+    
+    header.replace(148, 8, "        ");
+    unsigned checksum = 0;
+    for (unsigned char c : header) {
+        checksum += c;
+    }
+    std::snprintf(&header[148], 8, "%06o", checksum);
+    
+    std::string padding((512 - data.size() % 512) % 512, '\0');
+    return header + data + padding;
+}
+
+std::string TarEnd() {
+    return std::string(1024, '\0');
+}
+
+void Put16(std::string& out, uint16_t value) {
+    out += static_cast<char>(value & 0xFF);
+    out += static_cast<char>(value >> 8);
+}
+
+void Put32(std::string& out, uint32_t value) {
+    Put16(out, static_cast<uint16_t>(value & 0xFFFF));
+    Put16(out, static_cast<uint16_t>(value >> 16));
+}
+
+// Local header only; the walker never needs the central directory
+std::string ZipEntry(const std::string& name, const std::string& stored, uint16_t method = 0,
+                     uint32_t size = 0) {
+    std::string out;
+    Put32(out, 0x04034b50);
+    Put16(out, 20);
+    Put16(out, 0);
+    Put16(out, method);
+    Put32(out, 0);  // Time and date
+    Put32(out, 0);  // CRC, not checked
+    Put32(out, static_cast<uint32_t>(stored.size()));
+    Put32(out, method == 0 ? static_cast<uint32_t>(stored.size()) : size);
+    Put16(out, static_cast<uint16_t>(name.size()));
+    Put16(out, 0);
+    return out + name + stored;
+}
+
+#if defined(SCANNER_HAVE_ZLIB)
+// windowBits -15 gives the raw stream zip stores, 31 a gzip file
+std::string Deflate(const std::string& data, int windowBits) {
+    z_stream stream{};
+    deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, data.size()) + 64, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+#endif
+
+struct WalkResult {
+    Scanner::ArchiveWalker::Status status;
+    std::map<std::string, std::string> members;  // Path to the bytes its sink received
+};
+
+WalkResult WalkArchive(const std::string& archive, const Scanner::ArchiveWalker::Limits& limits) {
+    class Collector : public Scanner::MemberSink {
+    public:
+        Collector(std::map<std::string, std::string>& members, std::string path)
+            : members_(members), path_(std::move(path)) {}
+        void Update(const unsigned char* data, size_t size) override {
+            bytes_.append(reinterpret_cast<const char*>(data), size);
+        }
+        void Final() override { members_[path_] = bytes_; }
+    private:
+        std::map<std::string, std::string>& members_;
+        std::string path_;
+        std::string bytes_;
+    };
+    
+    WalkResult result;
+    Scanner::ArchiveWalker walker(limits, [&](const std::string& path, std::optional<uint64_t>) {
+        return std::make_unique<Collector>(result.members, path);
+    });
+    StringSource source(archive);
+    result.status = walker.Walk(source, archive.size());
+    return result;
+}
+
+const Scanner::ArchiveWalker::Limits DEFAULT_LIMITS{4, 100, 100};
+
+} // namespace
+
+TEST(ArchiveWalkerTest, DetectsFormats) {
+    using Format = Scanner::ArchiveWalker::Format;
+    auto detect = [](const std::string& data) {
+        return Scanner::ArchiveWalker::DetectFormat(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    };
+    EXPECT_EQ(detect(TarEntry("a.txt", "abc") + TarEnd()), Format::Tar);
+    EXPECT_EQ(detect(ZipEntry("a.txt", "abc")), Format::Zip);
+    EXPECT_EQ(detect(std::string("\x1f\x8b\x08\0", 4)), Format::Gzip);
+    EXPECT_EQ(detect("Hello, World!"), Format::None);
+    
+    std::string badChecksum = TarEntry("a.txt", "abc");
+    badChecksum[0] = 'b';
+    EXPECT_EQ(detect(badChecksum), Format::None);
+}
+
+TEST(ArchiveWalkerTest, WalksTarAndStoredZipMembers) {
+    const std::string tar = TarEntry("dir/", "", '5') + TarEntry("dir/a.txt", "first member") +
+                            TarEntry("b.bin", std::string(1000, 'x')) + TarEnd();
+    auto result = WalkArchive(tar, DEFAULT_LIMITS);
+    EXPECT_EQ(result.status, Scanner::ArchiveWalker::Status::Complete);
+    ASSERT_EQ(result.members.size(), 2u);
+    EXPECT_EQ(result.members["dir/a.txt"], "first member");
+    EXPECT_EQ(result.members["b.bin"], std::string(1000, 'x'));
+    
+    // A tar stored inside a zip is walked while it streams
+    const std::string zip = ZipEntry("readme.txt", "hello") + ZipEntry("inner.tar", tar);
+    result = WalkArchive(zip, DEFAULT_LIMITS);
+    EXPECT_EQ(result.status, Scanner::ArchiveWalker::Status::Complete);
+    EXPECT_EQ(result.members.size(), 4u);
+    EXPECT_EQ(result.members["readme.txt"], "hello");
+    EXPECT_EQ(result.members["inner.tar"], tar);  // The container is hashed as a member too
+    EXPECT_EQ(result.members["inner.tar!dir/a.txt"], "first member");
+}
+
+TEST(ArchiveWalkerTest, EnforcesDepthAndMemberLimits) {
+    const std::string inner = TarEntry("payload", "deep") + TarEnd();
+    const std::string outer = TarEntry("middle.tar", inner) + TarEnd();
+    
+    auto result = WalkArchive(outer, {1, 100, 100});
+    EXPECT_EQ(result.status, Scanner::ArchiveWalker::Status::LimitReached);
+    EXPECT_EQ(result.members.count("middle.tar"), 1u);  // Still hashed, just not opened
+    EXPECT_EQ(result.members.count("middle.tar!payload"), 0u);
+    
+    result = WalkArchive(outer, {2, 100, 100});
+    EXPECT_EQ(result.status, Scanner::ArchiveWalker::Status::Complete);
+    EXPECT_EQ(result.members["middle.tar!payload"], "deep");
+    
+    std::string many;
+    for (int i = 0; i < 10; ++i) {
+        many += TarEntry("file" + std::to_string(i), "x");
+    }
+    result = WalkArchive(many + TarEnd(), {4, 3, 100});
+    EXPECT_EQ(result.status, Scanner::ArchiveWalker::Status::LimitReached);
+    EXPECT_EQ(result.members.size(), 3u);
+}
+
+TEST(ArchiveWalkerTest, ReportsTruncatedArchiveAsCorrupt) {
+    const std::string tar = TarEntry("a.txt", "complete") + TarEntry("b.txt", std::string(4000, 'y')) + TarEnd();
+    auto result = WalkArchive(tar.substr(0, 512 * 3), DEFAULT_LIMITS);
+    EXPECT_EQ(result.status, Scanner::ArchiveWalker::Status::Corrupt);
+    EXPECT_EQ(result.members.size(), 1u);  // The cut member never reaches Final()
+    EXPECT_EQ(result.members["a.txt"], "complete");
+}
+
+#if defined(SCANNER_HAVE_ZLIB)
+TEST(ArchiveWalkerTest, InflatesZipAndGzipMembers) {
+    ASSERT_TRUE(Scanner::ArchiveWalker::HasDeflate());
+    const std::string text = RandomBytes(100000, 5) + std::string(100000, 'a');
+    const std::string tar = TarEntry("nested/file.bin", text) + TarEnd();
+    const std::string tarGz = Deflate(tar, 31);  // No FNAME field, reported as "data"
+    const std::string zip = ZipEntry("text.bin", Deflate(text, -15), 8, static_cast<uint32_t>(text.size())) +
+                            ZipEntry("bundle.tar.gz", tarGz);
+    
+    auto result = WalkArchive(zip, DEFAULT_LIMITS);
+    EXPECT_EQ(result.status, Scanner::ArchiveWalker::Status::Complete);
+    EXPECT_EQ(result.members["text.bin"], text);
+    EXPECT_EQ(result.members["bundle.tar.gz!data"], tar);
+    EXPECT_EQ(result.members["bundle.tar.gz!data!nested/file.bin"], text);
+}
+
+TEST(ArchiveWalkerTest, StopsDecompressionBomb) {
+    // 64 MB of zeros deflate to about 64 KB
+    const std::string zeros(64 << 20, '\0');
+    const std::string zip = ZipEntry("zeros", Deflate(zeros, -15), 8, static_cast<uint32_t>(zeros.size()));
+    
+    auto result = WalkArchive(zip, {4, 100, 8});  // Budget: 8 x 1 MB minimum base
+    EXPECT_EQ(result.status, Scanner::ArchiveWalker::Status::LimitReached);
+    EXPECT_TRUE(result.members.empty());
+    
+    result = WalkArchive(zip, {4, 100, 100});
+    EXPECT_EQ(result.status, Scanner::ArchiveWalker::Status::Complete);
+    EXPECT_EQ(result.members["zeros"].size(), zeros.size());
+}
+#endif
+
+// ============================================================================
+// SHA256Calculator Tests
+// ============================================================================
+
+namespace {
+
+std::string DigestHex(const Scanner::SHA256Calculator::Digest& digest) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (unsigned char byte : digest) {
+        hex += digits[byte >> 4];
+        hex += digits[byte & 0xF];
+    }
+    return hex;
+}
+
+std::vector<Scanner::Sha256Backend> SupportedSha256Backends() {
+    std::vector<Scanner::Sha256Backend> backends;
+    for (auto backend : {Scanner::Sha256Backend::OpenSSL, Scanner::Sha256Backend::ShaNi,
+                         Scanner::Sha256Backend::Avx2MultiBuffer}) {
+        if (Scanner::SHA256Calculator::IsSupported(backend)) {
+            backends.push_back(backend);
+        }
+    }
+    return backends;
+}
+
+} // namespace
+
+TEST(SHA256CalculatorTest, KnownVectorsOnEveryBackend) {
+    const std::string abc = "abc";
+    const std::string twoBlocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    for (auto backend : SupportedSha256Backends()) {
+        SCOPED_TRACE(Scanner::SHA256Calculator::BackendName(backend));
+        EXPECT_EQ(DigestHex(Scanner::SHA256Calculator::Hash("", 0, backend)),
+                  "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+        EXPECT_EQ(DigestHex(Scanner::SHA256Calculator::Hash(abc.data(), abc.size(), backend)),
+                  "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        EXPECT_EQ(DigestHex(Scanner::SHA256Calculator::Hash(twoBlocks.data(), twoBlocks.size(), backend)),
+                  "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    }
+}
+
+TEST(SHA256CalculatorTest, BackendsAgreeOnPaddingBoundaries) {
+    std::string data(200000, '\0');
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>((i * 131) ^ (i >> 7));
+    }
+    
+    for (size_t length : {1, 55, 56, 63, 64, 65, 119, 120, 128, 4097, 200000}) {
+        auto expected = Scanner::SHA256Calculator::Hash(data.data(), length, Scanner::Sha256Backend::OpenSSL);
+        for (auto backend : SupportedSha256Backends()) {
+            SCOPED_TRACE(std::string(Scanner::SHA256Calculator::BackendName(backend)) + " length " + std::to_string(length));
+            EXPECT_EQ(Scanner::SHA256Calculator::Hash(data.data(), length, backend), expected);
+        }
+    }
+}
+
+TEST(SHA256CalculatorTest, StreamingMatchesOneShot) {
+    std::string data(10000, 'x');
+    auto expected = Scanner::SHA256Calculator::Hash(data.data(), data.size(), Scanner::Sha256Backend::OpenSSL);
+    
+    Scanner::SHA256Calculator calculator;
+    size_t offset = 0;
+    for (size_t step = 1; offset < data.size(); step = step * 3 + 1) {
+        size_t take = std::min(step, data.size() - offset);
+        calculator.Update(data.data() + offset, take);
+        offset += take;
+    }
+    EXPECT_EQ(calculator.Final(), expected);
+}
+
+TEST(SHA256CalculatorTest, HashManyMatchesSingleStream) {
+    std::vector<std::string> storage;
+    for (size_t i = 0; i < 19; ++i) {
+        storage.emplace_back(i * 37 + (i % 3) * 64, static_cast<char>('a' + i));
+    }
+    std::vector<std::string_view> messages(storage.begin(), storage.end());
+    
+    for (auto backend : SupportedSha256Backends()) {
+        SCOPED_TRACE(Scanner::SHA256Calculator::BackendName(backend));
+        auto digests = Scanner::SHA256Calculator::HashMany(messages, backend);
+        ASSERT_EQ(digests.size(), messages.size());
+        for (size_t i = 0; i < messages.size(); ++i) {
+            EXPECT_EQ(digests[i], Scanner::SHA256Calculator::Hash(messages[i].data(), messages[i].size(),
+                                                                  Scanner::Sha256Backend::OpenSSL)) << i;
+        }
+    }
+}
+
+// ============================================================================
+// TreeHasher Tests
+// ============================================================================
+
+namespace {
+
+std::string PatternBytes(size_t size) {
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<char>(i % 251);
+    }
+    return data;
+}
+
+std::string TreeHex(const std::string& data, size_t chunk) {
+    Scanner::TreeHasher hasher;
+    for (size_t offset = 0; offset < data.size(); offset += chunk) {
+        hasher.Update(data.data() + offset, std::min(chunk, data.size() - offset));
+    }
+    auto root = hasher.Final();
+    return DigestHex(root);
+}
+
+} // namespace
+
+TEST(TreeHasherTest, KnownRoots) {
+    // Reference values from hashlib: sha256(b"".join(sha256(chunk) for 1 MB chunks))
+    EXPECT_EQ(TreeHex("", 1), "5df6e0e2761359d30a8275058e299fcc0381534545f55cf43e41983f5d4c9456");
+    EXPECT_EQ(TreeHex("Hello, World!", 5), "042a7d64a581ef2ee983f21058801cc35663b705e6c55f62fa8e0f18ecc70989");
+    
+    const std::string data = PatternBytes((5 << 19) + 7);  // Two full chunks and a short one
+    for (size_t chunk : {size_t{65536}, size_t{1000003}, data.size()}) {
+        EXPECT_EQ(TreeHex(data, chunk), "a094010f423ae29408e4a5695ec8f317a84ccaa17b975ac061a28ff706621e68")
+            << "chunk " << chunk;
+    }
+}
+
+TEST(TreeHasherTest, LeavesCombineIntoStreamingRoot) {
+    const std::string data = PatternBytes((5 << 19) + 7);
+    ASSERT_EQ(Scanner::TreeHasher::ChunkCount(data.size()), 3u);
+    EXPECT_EQ(Scanner::TreeHasher::ChunkCount(0), 1u);
+    EXPECT_EQ(Scanner::TreeHasher::ChunkCount(Scanner::TreeHasher::CHUNK_SIZE), 1u);
+    
+    // Out of order, as pool tasks would finish
+    std::vector<Scanner::TreeHasher::Digest> leaves(3);
+    for (size_t i : {size_t{2}, size_t{0}, size_t{1}}) {
+        const size_t offset = i * Scanner::TreeHasher::CHUNK_SIZE;
+        leaves[i] = Scanner::TreeHasher::Leaf(data.data() + offset,
+                                              std::min(Scanner::TreeHasher::CHUNK_SIZE, data.size() - offset));
+    }
+    EXPECT_EQ(DigestHex(Scanner::TreeHasher::Root(leaves)), TreeHex(data, 65536));
+}
+
+// ============================================================================
+// ByteBudget Tests
+// ============================================================================
+
+TEST(ByteBudgetTest, ReservationsShareCapacity) {
+    Scanner::ByteBudget budget(100);
+    auto first = budget.TryReserve(60);
+    ASSERT_TRUE(first);
+    EXPECT_FALSE(budget.TryReserve(50));
+    {
+        auto second = budget.TryReserve(40);
+        ASSERT_TRUE(second);
+        EXPECT_EQ(budget.InUse(), 100u);
+    }
+    EXPECT_EQ(budget.InUse(), 60u);
+    
+    first = Scanner::ByteBudget::Reservation();
+    EXPECT_EQ(budget.InUse(), 0u);
+    
+    // Larger than the capacity: capped, so it can still run alone
+    auto huge = budget.TryReserve(1'000'000);
+    ASSERT_TRUE(huge);
+    EXPECT_EQ(budget.InUse(), 100u);
+    EXPECT_FALSE(budget.TryReserve(1));
+}
+
+TEST(ByteBudgetTest, ReserveWaitsForRelease) {
+    Scanner::ByteBudget budget(100);
+    auto held = budget.TryReserve(100);
+    ASSERT_TRUE(held);
+    
+    std::atomic<bool> acquired{false};
+    std::thread waiter([&] {
+        auto reservation = budget.Reserve(30);
+        acquired = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(acquired);
+    
+    held = Scanner::ByteBudget::Reservation();
+    waiter.join();
+    EXPECT_TRUE(acquired);
+    EXPECT_EQ(budget.InUse(), 0u);
+}
+
+// ============================================================================
+// Throttle Tests
+// ============================================================================
+
+TEST(RateLimiterTest, ReservationsPayOffInOrder) {
+    using std::chrono::milliseconds;
+    Scanner::RateLimiter limiter(1000, 0);
+    
+    // Each caller waits for the units claimed before it, not for its own
+    EXPECT_EQ(limiter.Reserve(100).count(), 0);
+    auto wait = limiter.Reserve(100);
+    EXPECT_GT(wait, milliseconds(90));
+    EXPECT_LE(wait, milliseconds(100));
+    wait = limiter.Reserve(50);
+    EXPECT_GT(wait, milliseconds(190));
+    EXPECT_LE(wait, milliseconds(200));
+}
+
+TEST(RateLimiterTest, RateIsSharedAcrossThreads) {
+    Scanner::RateLimiter limiter(1000, 0);
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&limiter] {
+            for (int i = 0; i < 10; ++i) {
+                limiter.Acquire(5);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    // 200 units at 1000 per second; the last claim starts at 195 ms
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(elapsed, std::chrono::milliseconds(190));
+    EXPECT_LT(elapsed, std::chrono::seconds(2));
+}
+
+TEST(ConcurrencyLimiterTest, ExtraWorkersWaitForASlot) {
+    Scanner::ConcurrencyLimiter limiter(2, false);
+    auto first = std::make_unique<Scanner::ConcurrencyLimiter::Slot>(limiter.Enter());
+    auto second = limiter.Enter();
+    
+    std::atomic<bool> entered{false};
+    std::thread waiter([&] {
+        auto slot = limiter.Enter();
+        entered = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(entered);
+    
+    first.reset();
+    waiter.join();
+    EXPECT_TRUE(entered);
+}
+
+TEST(ConcurrencyLimiterTest, BacksOffWhileLatencyIsHigh) {
+    using std::chrono::milliseconds;
+    Scanner::ConcurrencyLimiter limiter(8, true);
+    auto window = [&limiter](milliseconds latency) {
+        for (size_t i = 0; i < Scanner::Constants::LATENCY_WINDOW; ++i) {
+            limiter.RecordLatency(latency);
+        }
+    };
+    
+    window(milliseconds(1));
+    EXPECT_EQ(limiter.Limit(), 8u);
+    window(milliseconds(10));
+    EXPECT_EQ(limiter.Limit(), 6u);
+    window(milliseconds(20));
+    EXPECT_EQ(limiter.Limit(), 5u);
+    
+    // Fast reads again: one more slot per window
+    window(milliseconds(1));
+    EXPECT_EQ(limiter.Limit(), 6u);
+    for (int i = 0; i < 5; ++i) {
+        window(milliseconds(1));
+    }
+    EXPECT_EQ(limiter.Limit(), 8u);
+    
+    // Without adaptive the limit never moves
+    Scanner::ConcurrencyLimiter fixed(8, false);
+    for (size_t i = 0; i < 4 * Scanner::Constants::LATENCY_WINDOW; ++i) {
+        fixed.RecordLatency(milliseconds(i));
+    }
+    EXPECT_EQ(fixed.Limit(), 8u);
+}
+
+// ============================================================================
+// Checkpoint Tests
+// ============================================================================
+
+TEST(CheckpointTest, CommittedUnitsSurviveATornTail) {
+    const auto path = fs::temp_directory_path() / "checkpoint_test.txt";
+    const std::string root = "/data/scan";
+    {
+        auto checkpoint = Scanner::Checkpoint::Create(path.string(), root, "42:7", false);
+        Scanner::MalwareInfo info;
+        info.filePath = "/data/scan/odd\tname\nwith breaks.exe";
+        info.hash = "65a8e27d8879283831b664bd8b7f0ad4";
+        info.verdict = "Trojan.Test";
+        checkpoint->Commit({1, 2}, {info}, 0);
+        checkpoint->Commit({3}, {}, 2);
+        checkpoint->Flush(std::chrono::milliseconds(1234));
+    }
+    // A crash in the middle of writing a unit
+    {
+        std::ofstream torn(path, std::ios::app | std::ios::binary);
+        torn << "D\t4\nM\t100\tab";
+    }
+    
+    auto state = Scanner::Checkpoint::Load(path.string(), root, "42:7");
+    ASSERT_TRUE(state);
+    EXPECT_EQ(state->done, (std::vector<uint64_t>{1, 2, 3}));
+    EXPECT_EQ(state->errors, 2u);
+    EXPECT_EQ(state->elapsed.count(), 1234);
+    ASSERT_EQ(state->malware.size(), 1u);
+    EXPECT_EQ(state->malware[0].verdict, "Trojan.Test");
+    EXPECT_EQ(state->malware[0].similarity, 100);
+    EXPECT_EQ(state->malware[0].filePath.find('\t'), 14u);
+    EXPECT_NE(state->malware[0].filePath.find('\n'), std::string::npos);
+    
+    // A resumed run appends after the torn unit, which stays dropped
+    {
+        auto checkpoint = Scanner::Checkpoint::Create(path.string(), root, "42:7", true);
+        checkpoint->Commit({5}, {}, 0);
+        checkpoint->Flush(std::chrono::milliseconds(2000));
+    }
+    state = Scanner::Checkpoint::Load(path.string(), root, "42:7");
+    ASSERT_TRUE(state);
+    EXPECT_EQ(state->done, (std::vector<uint64_t>{1, 2, 3, 5}));
+    EXPECT_EQ(state->elapsed.count(), 2000);
+    
+    EXPECT_THROW(Scanner::Checkpoint::Load(path.string(), "/other", "42:7"), std::runtime_error);
+    EXPECT_THROW(Scanner::Checkpoint::Load(path.string(), root, "43:7"), std::runtime_error);
+    fs::remove(path);
+    EXPECT_FALSE(Scanner::Checkpoint::Load(path.string(), root, "42:7"));
+}
+
+TEST(CheckpointTest, FileKeysDependOnPathAndSize) {
+    const auto key = Scanner::Checkpoint::FileKey("/data/a.bin", 100);
+    EXPECT_EQ(key, Scanner::Checkpoint::FileKey("/data/a.bin", 100));
+    EXPECT_NE(key, Scanner::Checkpoint::FileKey("/data/a.bin", 101));
+    EXPECT_NE(key, Scanner::Checkpoint::FileKey("/data/b.bin", 100));
+}
+
+// ============================================================================
+// Digest Cache Tests
+// ============================================================================
+
+TEST(DigestCacheTest, EntriesReachTheNextScanner) {
+    const auto path = fs::temp_directory_path() / "digest_cache_test.txt";
+    fs::remove(path);
+    
+    const unsigned char md5[16] = {0x65, 0xa8, 0xe2, 0x7d};
+    Scanner::DigestCache::Identity package{13, "sha256:" + std::string(64, 'a')};
+    Scanner::DigestCache::Identity layer{4096, "sha512:" + std::string(128, 'b')};
+    Scanner::DigestCache::Entry entry;
+    entry.digests.Set(Scanner::HashAlgorithm::MD5, md5);
+    entry.digests.fuzzy = "3:abc\tdef:xyz";
+    entry.digests.present |= Scanner::MaskOf(Scanner::HashAlgorithm::SSDEEP);
+    {
+        auto cache = Scanner::DigestCache::Open(path.string());
+        EXPECT_EQ(cache->Size(), 0u);
+        cache->Add(package, entry);
+        entry.archive = true;
+        cache->Add(layer, entry);
+        cache->Flush();
+    }
+    // Another scanner that crashed mid-line
+    {
+        std::ofstream torn(path, std::ios::app | std::ios::binary);
+        torn << "V\t1\tsha256:";
+    }
+    {
+        auto cache = Scanner::DigestCache::Open(path.string());
+        EXPECT_EQ(cache->Size(), 2u);
+        cache->Add({7, "sha256:" + std::string(64, 'c')}, entry);
+        cache->Flush();
+    }
+    
+    // A scanner with SHA-256 signatures adds its digest to a known file
+    {
+        auto cache = Scanner::DigestCache::Open(path.string());
+        Scanner::DigestCache::Entry sha256;
+        const unsigned char digest[32] = {0x01};
+        sha256.digests.Set(Scanner::HashAlgorithm::SHA256, digest);
+        cache->Add(package, sha256);
+        cache->Flush();
+    }
+    
+    auto cache = Scanner::DigestCache::Open(path.string());
+    EXPECT_EQ(cache->Size(), 3u);
+    
+    std::vector<std::optional<Scanner::DigestCache::Identity>> identities = {
+        package, std::nullopt, layer, Scanner::DigestCache::Identity{14, package.verity}};
+    std::vector<std::optional<Scanner::DigestCache::Entry>> hits;
+    const auto required = Scanner::MaskOf(Scanner::HashAlgorithm::MD5) | Scanner::MaskOf(Scanner::HashAlgorithm::SSDEEP);
+    cache->Lookup(identities, required, hits);
+    ASSERT_EQ(hits.size(), 4u);
+    ASSERT_TRUE(hits[0]);
+    EXPECT_EQ(hits[0]->digests.Get(Scanner::HashAlgorithm::MD5), "65a8e27d000000000000000000000000");
+    EXPECT_EQ(hits[0]->digests.fuzzy, "3:abc\tdef:xyz");
+    EXPECT_FALSE(hits[0]->archive);
+    EXPECT_FALSE(hits[1]);
+    ASSERT_TRUE(hits[2]);
+    EXPECT_TRUE(hits[2]->archive);
+    EXPECT_FALSE(hits[3]);  // Same digest, other size
+    
+    // An entry without a digest the signatures need is no hit
+    cache->Lookup(identities, required | Scanner::MaskOf(Scanner::HashAlgorithm::SHA256), hits);
+    ASSERT_TRUE(hits[0]);
+    EXPECT_EQ(hits[0]->digests.Get(Scanner::HashAlgorithm::SHA256).substr(0, 4), "0100");
+    EXPECT_FALSE(hits[2]);
+    fs::remove(path);
+}
+
+TEST(DigestCacheTest, OtherFilesAreRejected) {
+    const auto path = fs::temp_directory_path() / "digest_cache_other.txt";
+    {
+        std::ofstream other(path);
+        other << "virus_scanner checkpoint 1\n";
+    }
+    EXPECT_THROW(Scanner::DigestCache::Open(path.string()), std::runtime_error);
+    
+    // A file without fs-verity has no identity to look up
+    EXPECT_FALSE(Scanner::DigestCache::Identify(path, fs::file_size(path)));
+    fs::remove(path);
+}
+
+// ============================================================================
+// NUMA Topology Tests
+// ============================================================================
+
+TEST(NumaTopologyTest, ParsesCpuLists) {
+    using Cpus = std::vector<int>;
+    EXPECT_EQ(Scanner::NumaTopology::ParseCpuList("0-3,8-11\n"), (Cpus{0, 1, 2, 3, 8, 9, 10, 11}));
+    EXPECT_EQ(Scanner::NumaTopology::ParseCpuList("5"), (Cpus{5}));
+    EXPECT_EQ(Scanner::NumaTopology::ParseCpuList("0,2,4-5"), (Cpus{0, 2, 4, 5}));
+    EXPECT_TRUE(Scanner::NumaTopology::ParseCpuList("").empty());
+    EXPECT_EQ(Scanner::NumaTopology::ParseCpuList("x,1-2,3-y"), (Cpus{1, 2}));
+}
+
+TEST(NumaTopologyTest, DetectsAtLeastOneNode) {
+    auto topology = Scanner::NumaTopology::Detect();
+    ASSERT_GE(topology.NodeCount(), 1u);
+#if defined(__linux__)
+    if (!topology.CpusOf(0).empty()) {
+        // Pinned in a thread of its own, so the test runner keeps its affinity
+        bool pinned = false;
+        std::thread([&] { pinned = topology.PinCurrentThread(0); }).join();
+        EXPECT_TRUE(pinned);
+    }
+#endif
+}
+
+// ============================================================================
+// ScanFilter Tests
+// ============================================================================
+
+TEST(ScanFilterTest, GlobMatching) {
+    using Scanner::ScanFilter;
+    EXPECT_TRUE(ScanFilter::Match("*.o", "main.o"));
+    EXPECT_FALSE(ScanFilter::Match("*.o", "src/main.o"));  // '*' stays within a component
+    EXPECT_TRUE(ScanFilter::Match("src/*.c?", "src/a.cc"));
+    EXPECT_TRUE(ScanFilter::Match("build/**/cache", "build/a/b/cache"));
+    EXPECT_TRUE(ScanFilter::Match("build/**/cache", "build/cache"));
+    EXPECT_FALSE(ScanFilter::Match("build/**/cache", "build/a/cache2"));
+    EXPECT_TRUE(ScanFilter::Match("**", "any/depth/at/all"));
+    EXPECT_TRUE(ScanFilter::Match("log[0-9].txt", "log7.txt"));
+    EXPECT_FALSE(ScanFilter::Match("log[!0-9].txt", "log7.txt"));
+    EXPECT_TRUE(ScanFilter::Match("a[b", "a[b"));  // An unclosed bracket is literal
+    EXPECT_TRUE(ScanFilter::Match("**/cache", "cache"));
+    EXPECT_TRUE(ScanFilter::Match("a/**/b/**/c", "a/x/b/y/b/z/c"));
+    EXPECT_TRUE(ScanFilter::Match("tmp/**", "tmp/a/b"));
+    EXPECT_FALSE(ScanFilter::Match("tmp/**", "tmp"));  // A trailing "**" is what is inside
+    EXPECT_FALSE(ScanFilter::Match("a**b", "a/b"));    // '**' inside a component is '*'
+}
+
+TEST(ScanFilterTest, GlobMatchingDoesNotBacktrack) {
+    // Exponential for a recursive matcher; a linear scan per star here
+    const std::string name(4096, 'a');
+    EXPECT_FALSE(Scanner::ScanFilter::Match("*a*a*a*a*a*a*a*a*a*a*b", name));
+    std::string deep;
+    for (int i = 0; i < 256; ++i) {
+        deep += "d/";
+    }
+    EXPECT_FALSE(Scanner::ScanFilter::Match("**/d/**/d/**/d/**/d/**/e", deep + "d"));
+    EXPECT_TRUE(Scanner::ScanFilter::Match("**/d/**/d/**/d/**/d/**/e", deep + "e"));
+}
+
+TEST(ScanFilterTest, RulesFromSettings) {
+    Scanner::ScanSettings settings;
+    settings.excludePatterns = {".git", "build/", "/tmp/**", "*.log"};
+    settings.extensions = {"EXE", ".dll"};
+    Scanner::ScanFilter filter(settings);
+    ASSERT_TRUE(filter.IsActive());
+    
+    const std::filesystem::directory_entry entry(std::filesystem::temp_directory_path());
+    EXPECT_TRUE(filter.PrunesDirectory(entry, "src/.git"));
+    EXPECT_TRUE(filter.PrunesDirectory(entry, "build"));
+    EXPECT_TRUE(filter.PrunesDirectory(entry, "tmp/x"));
+    EXPECT_FALSE(filter.PrunesDirectory(entry, "src/tmp/x"));  // Anchored to the root
+    EXPECT_FALSE(filter.PrunesDirectory(entry, "src"));
+    
+    EXPECT_TRUE(filter.AcceptsFile("bin/app.Exe"));
+    EXPECT_FALSE(filter.AcceptsFile("bin/app.exe.log"));
+    EXPECT_FALSE(filter.AcceptsFile("bin/readme.txt"));
+    EXPECT_FALSE(filter.AcceptsFile("bin/.exe"));
+    
+    settings = {};
+    settings.includePatterns = {"docs/**/*.pdf"};
+    settings.excludePatterns = {"old.pdf", "draft.pdf/"};
+    filter = Scanner::ScanFilter(settings);
+    EXPECT_TRUE(filter.AcceptsFile("docs/2024/a.pdf"));
+    EXPECT_TRUE(filter.AcceptsFile("docs/draft.pdf"));  // A trailing '/' names directories only
+    EXPECT_FALSE(filter.AcceptsFile("docs/2024/old.pdf"));
+    EXPECT_FALSE(filter.AcceptsFile("src/a.pdf"));
+    EXPECT_FALSE(filter.PrunesDirectory(entry, "src"));  // Includes never prune
+}
+
+// ============================================================================
+// Scan Schedule Tests
+// ============================================================================
+
+TEST(ScanScheduleTest, LargestFirstThenSmallBatches) {
+    constexpr uint64_t MB = 1024 * 1024;
+    std::vector<uint64_t> sizes(40, 100);  // Small files in directory order
+    sizes[5] = 2 * MB;
+    sizes[20] = 50 * MB;
+    sizes[39] = 2 * MB;
+    sizes[30] = 3 * MB;  // Large, but also fills a small batch's byte cap on its own
+    
+    const auto batches = Scanner::PlanBatches(sizes);
+    ASSERT_GE(batches.size(), 4u);
+    EXPECT_EQ(batches[0], std::vector<size_t>{20});
+    EXPECT_EQ(batches[1], std::vector<size_t>{30});
+    EXPECT_EQ(batches[2], std::vector<size_t>{5});   // Ties keep collection order
+    EXPECT_EQ(batches[3], std::vector<size_t>{39});
+    
+    std::vector<size_t> seen;
+    for (size_t i = 4; i < batches.size(); ++i) {
+        EXPECT_LE(batches[i].size(), Scanner::Constants::LOOKUP_BATCH_SIZE);
+        seen.insert(seen.end(), batches[i].begin(), batches[i].end());
+    }
+    EXPECT_EQ(seen.size(), 36u);
+    EXPECT_TRUE(std::is_sorted(seen.begin(), seen.end()));
+}
+
+TEST(ScanScheduleTest, SmallBatchesRespectByteCap) {
+    // Just below the large-file threshold, so only the byte cap splits them
+    std::vector<uint64_t> sizes(7, Scanner::Constants::SCHEDULE_LARGE_FILE_SIZE - 1);
+    
+    uint64_t total = 0;
+    for (const auto& batch : Scanner::PlanBatches(sizes)) {
+        uint64_t bytes = 0;
+        for (size_t index : batch) {
+            bytes += sizes[index];
+        }
+        EXPECT_LE(bytes, Scanner::Constants::MAX_BATCH_BYTES);
+        total += bytes;
+    }
+    EXPECT_EQ(total, 7 * sizes[0]);
+    EXPECT_GT(Scanner::PlanBatches(sizes).size(), 1u);
+    EXPECT_TRUE(Scanner::PlanBatches({}).empty());
+}
+
+// ============================================================================
+// Disk Layout Tests
+// ============================================================================
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(DiskLayoutTest, SortKeysFollowInodes) {
+    const fs::path dir = fs::temp_directory_path() / "disk_layout_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::ofstream(dir / "data.bin", std::ios::binary) << std::string(64 * 1024, 'd');
+    fs::create_hard_link(dir / "data.bin", dir / "link.bin");
+    
+    struct stat info;
+    ASSERT_EQ(stat((dir / "data.bin").c_str(), &info), 0);
+    using Scanner::ReadOrder;
+    EXPECT_EQ(Scanner::DiskLayout::SortKey(dir / "data.bin", ReadOrder::Inode), static_cast<uint64_t>(info.st_ino));
+    EXPECT_EQ(Scanner::DiskLayout::SortKey(dir / "data.bin", ReadOrder::Directory), 0u);
+    EXPECT_EQ(Scanner::DiskLayout::SortKey(dir / "missing.bin", ReadOrder::Inode), 0u);
+    
+    // Both names share the data, so either order keeps them together
+    EXPECT_EQ(Scanner::DiskLayout::SortKey(dir / "link.bin", ReadOrder::Extent),
+              Scanner::DiskLayout::SortKey(dir / "data.bin", ReadOrder::Extent));
+    Scanner::DiskLayout::Prefetch(dir / "data.bin", 4096);
+    Scanner::DiskLayout::Prefetch(dir / "missing.bin", 4096);
+    fs::remove_all(dir);
+}
+#endif
+
+namespace {
+
+struct DedupeFile {
+    fs::path path;
+    uint64_t size;
+    std::vector<fs::path> aliases;
+};
+
+} // namespace
+
+TEST(DiskLayoutTest, SharedContentMergesEqualExtents) {
+    constexpr uint64_t big = Scanner::Constants::DEDUPE_MIN_SIZE;
+    constexpr uint64_t small = Scanner::Constants::DEDUPE_MIN_SIZE - 1;
+    const Scanner::DiskLayout::ExtentList blocks = {{0, 4096 * 10, big}};
+    const Scanner::DiskLayout::ExtentList elsewhere = {{0, 4096 * 99, big}};
+    // a: original, b: reflink of a with a hard link, c: same size on other
+    // blocks, d: reflink of a, e: unique size, f and g: too small to probe
+    std::vector<DedupeFile> files = {
+        {"a", big, {}},
+        {"b", big, {"b.link"}},
+        {"c", big, {}},
+        {"d", big, {}},
+        {"e", big + 1, {}},
+        {"f", small, {}},
+        {"g", small, {}},
+    };
+    const std::map<fs::path, Scanner::DiskLayout::ExtentList> extents = {
+        {"a", blocks}, {"b", blocks}, {"c", elsewhere}, {"d", blocks}, {"e", blocks}, {"f", blocks}, {"g", blocks},
+    };
+    
+    std::vector<uint64_t> sizes;
+    for (const auto& file : files) {
+        sizes.push_back(file.size);
+    }
+    std::vector<size_t> probed;
+    const auto firsts = Scanner::DiskLayout::FindSharedContent(sizes, [&](size_t i) {
+        probed.push_back(i);
+        return extents.at(files[i].path);
+    });
+    EXPECT_EQ(probed, (std::vector<size_t>{0, 1, 2, 3}));
+    EXPECT_EQ(firsts, (std::vector<size_t>{0, 0, 2, 0, 4, 5, 6}));
+    
+    const auto merged = Scanner::DiskLayout::MergeSharedContent(files, firsts);
+    EXPECT_EQ(merged.files, 2u);
+    EXPECT_EQ(merged.bytes, 2 * big);
+    ASSERT_EQ(files.size(), 5u);
+    EXPECT_EQ(files[0].path, "a");
+    EXPECT_EQ(files[0].aliases, (std::vector<fs::path>{"b", "b.link", "d"}));
+    EXPECT_EQ(files[1].path, "c");
+    EXPECT_TRUE(files[1].aliases.empty());
+    EXPECT_EQ(files[2].path, "e");
+    EXPECT_EQ(files[3].path, "f");
+    EXPECT_EQ(files[4].path, "g");
+}
+
+TEST(DiskLayoutTest, SharedContentNeedsExtents) {
+    // Files FIEMAP says nothing about are never merged, even at equal sizes
+    constexpr uint64_t big = Scanner::Constants::DEDUPE_MIN_SIZE;
+    std::vector<DedupeFile> files = {{"a", big, {}}, {"b", big, {}}};
+    const auto firsts = Scanner::DiskLayout::FindSharedContent(
+        {big, big}, [](size_t) { return Scanner::DiskLayout::ExtentList(); });
+    EXPECT_EQ(firsts, (std::vector<size_t>{0, 1}));
+    EXPECT_EQ(Scanner::DiskLayout::MergeSharedContent(files, firsts).files, 0u);
+    EXPECT_EQ(files.size(), 2u);
+}
+
+// ============================================================================
+// File Reader Tests
+// ============================================================================
+
+TEST(FileReaderTest, ReadsSameBytesInEveryMode) {
+    const fs::path path = fs::temp_directory_path() / "file_reader_test.bin";
+    std::string content(300'000, '\0');
+    std::mt19937 random(7);
+    for (auto& byte : content) {
+        byte = static_cast<char>(random());
+    }
+    std::ofstream(path, std::ios::binary) << content;
+    
+    Scanner::AlignedBuffer buffer(Scanner::Constants::HASH_BUFFER_SIZE);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.Data()) % Scanner::Constants::DIRECT_IO_ALIGNMENT, 0u);
+    EXPECT_EQ(Scanner::AlignedBuffer(5000).Size(), 2 * Scanner::Constants::DIRECT_IO_ALIGNMENT);
+    
+    using Scanner::CacheMode;
+    for (auto mode : {CacheMode::Normal, CacheMode::DropBehind, CacheMode::Direct}) {
+        std::string read;
+        {
+            Scanner::FileReader reader(path, mode);
+            while (size_t count = reader.Read(buffer.Data(), buffer.Size())) {
+                read.append(reinterpret_cast<const char*>(buffer.Data()), count);
+            }
+        }
+        EXPECT_EQ(read, content);
+        
+        Scanner::FileReader window(path, mode, buffer.Size(), buffer.Size());
+        ASSERT_EQ(window.Read(buffer.Data(), buffer.Size()), buffer.Size());
+        EXPECT_EQ(std::memcmp(buffer.Data(), content.data() + buffer.Size(), buffer.Size()), 0);
+    }
+    EXPECT_THROW(Scanner::FileReader(path.string() + ".missing", CacheMode::Direct), std::runtime_error);
+    fs::remove(path);
+}
+
+#if defined(__linux__)
+namespace {
+// Pages of the file currently in the page cache
+size_t ResidentPages(const fs::path& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    const size_t size = fs::file_size(path);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> pages((size + pageSize - 1) / pageSize);
+    mincore(map, size, pages.data());
+    munmap(map, size);
+    close(fd);
+    return static_cast<size_t>(std::count_if(pages.begin(), pages.end(), [](unsigned char page) { return page & 1; }));
+}
+
+void Evict(const fs::path& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+} // namespace
+
+TEST(FileReaderTest, CacheModesLeaveNoPagesBehind) {
+    const fs::path path = fs::temp_directory_path() / "file_reader_cache_test.bin";
+    std::ofstream(path, std::ios::binary) << std::string(Scanner::Constants::DROP_BEHIND_WINDOW + 300'000, 'c');
+    Evict(path);
+    if (ResidentPages(path) != 0) {
+        fs::remove(path);
+        GTEST_SKIP() << "The filesystem of the temp directory keeps pages cached";
+    }
+    
+    Scanner::AlignedBuffer buffer(Scanner::Constants::HASH_BUFFER_SIZE);
+    for (auto mode : {Scanner::CacheMode::DropBehind, Scanner::CacheMode::Direct}) {
+        Scanner::FileReader reader(path, mode);
+        while (reader.Read(buffer.Data(), buffer.Size())) {
+        }
+        // Whole windows are evicted while the file is still being read
+        EXPECT_LT(ResidentPages(path) * static_cast<size_t>(sysconf(_SC_PAGESIZE)),
+                  Scanner::Constants::DROP_BEHIND_WINDOW);
+    }
+    EXPECT_EQ(ResidentPages(path), 0u);
+    
+    // A file someone else already cached stays cached
+    {
+        Scanner::FileReader reader(path, Scanner::CacheMode::Normal);
+        while (reader.Read(buffer.Data(), buffer.Size())) {
+        }
+    }
+    const size_t cached = ResidentPages(path);
+    {
+        Scanner::FileReader reader(path, Scanner::CacheMode::DropBehind);
+        while (reader.Read(buffer.Data(), buffer.Size())) {
+        }
+    }
+    if (syscall(451, -1, nullptr, nullptr, 0) != -1 || errno != ENOSYS) {
+        EXPECT_EQ(ResidentPages(path), cached);
+    }
+    fs::remove(path);
+}
+#endif
+
+// ============================================================================
+// Allocation Tests
+// ============================================================================
+
+#if defined(__GLIBC__)
+// Counting allocator: malloc and its relatives are replaced for the whole test
+// binary, so operator new and OpenSSL's own allocations are seen as well.
+// Only the thread that turns counting on is counted.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+
+namespace {
+thread_local bool countAllocations = false;
+thread_local size_t allocationCount = 0;
+
+void CountAllocation() {
+    if (countAllocations) {
+        ++allocationCount;
+    }
+}
+} // namespace
+
+extern "C" {
+void* malloc(size_t size) noexcept {
+    CountAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+    CountAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) noexcept {
+    CountAllocation();
+    return __libc_realloc(pointer, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+    CountAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+    CountAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size) noexcept {
+    CountAllocation();
+    *result = __libc_memalign(alignment, size);
+    return *result ? 0 : ENOMEM;
+}
+}
+
+TEST(AllocationTest, CleanFilesAllocateNothingOnceWarm) {
+    const fs::path dir = fs::temp_directory_path() / "allocation_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::vector<fs::path> files;
+    for (size_t size : {0, 100, 5'000, 20'000, 70'000, 300'000, 1'500'000}) {
+        for (char fill : {'a', 'b', 'c'}) {
+            files.push_back(dir / (std::to_string(size) + fill));
+            std::ofstream(files.back(), std::ios::binary) << std::string(size, fill);
+        }
+    }
+    
+    // Every exact digest type, and a byte signature, so every hasher and the matcher run
+    const fs::path csv = dir / "base.csv";
+    std::ofstream(csv) << "00112233445566778899aabbccddeeff;Md5\n"
+                       << "00112233445566778899aabbccddeeff00112233;Sha1\n"
+                       << std::string(64, '1') << ";Sha256\n"
+                       << "deadbeefcafe;Bytes;type=content\n";
+    Scanner::HashDatabase database;
+    ASSERT_TRUE(database.LoadFromCSV(csv.string()));
+    
+    // The per-file steps of ScannerImpl::HashFile() and ReportMatches()
+    std::vector<Scanner::HashDatabase::DigestKey> keys;
+    std::vector<std::string> verdicts;
+    size_t matches = 0;
+    auto scanFile = [&](const fs::path& path, Scanner::HashAlgorithmMask algorithms) {
+        const uint64_t size = fs::file_size(path);
+        Scanner::ContentMatcher::State content;
+        auto digests = Scanner::FileHasher::CalculateFile(path, algorithms,
+            [&database, size](const unsigned char* prefixMd5) {
+                return database.CheckSize(size) != Scanner::HashDatabase::SizeCheck::Clean ||
+                       database.MatchesPrefix(size, prefixMd5);
+            },
+            [&database, &content](const unsigned char* data, size_t count) {
+                database.ScanContent(content, data, count);
+            });
+        ASSERT_TRUE(digests.has_value());
+        keys.clear();
+        for (auto algorithm : {Scanner::HashAlgorithm::MD5, Scanner::HashAlgorithm::SHA1,
+                               Scanner::HashAlgorithm::SHA256}) {
+            keys.push_back({algorithm, digests->bytes[static_cast<size_t>(algorithm)]});
+        }
+        matches += database.IsMaliciousBatch(keys, verdicts);
+        std::string contentVerdict;
+        matches += database.ContentVerdict(content, contentVerdict) ? 1 : 0;
+    };
+    
+    const auto algorithms = database.GetRequiredAlgorithms();
+    for (const auto& path : files) {
+        scanFile(path, algorithms);
+    }
+    
+    countAllocations = true;
+    for (int pass = 0; pass < 3; ++pass) {
+        for (const auto& path : files) {
+            scanFile(path, algorithms);
+        }
+    }
+    countAllocations = false;
+    EXPECT_EQ(allocationCount, 0u);
+    EXPECT_EQ(matches, 0u);
+    
+    // The counter does see allocations: new algorithms rebuild the hasher
+    allocationCount = 0;
+    countAllocations = true;
+    scanFile(files.front(), Scanner::MaskOf(Scanner::HashAlgorithm::MD5));
+    countAllocations = false;
+    EXPECT_GT(allocationCount, 0u);
+    fs::remove_all(dir);
+}
+#endif
+
+// ============================================================================
+// Hex Codec Tests
+// ============================================================================
+
+TEST(HexCodecTest, EncodesKnownDigest) {
+    const unsigned char md5[] = {0x65, 0xa8, 0xe2, 0x7d, 0x88, 0x79, 0x28, 0x38,
+                                 0x31, 0xb6, 0x64, 0xbd, 0x8b, 0x7f, 0x0a, 0xd4};
+    EXPECT_EQ(Scanner::Hex::Encode(md5, sizeof(md5)), "65a8e27d8879283831b664bd8b7f0ad4");
+    EXPECT_EQ(Scanner::Hex::Encode(md5, 0), "");
+}
+
+// Sizes around the 16-byte encode and 8-byte decode blocks cover both the
+// vector path and the scalar tail
+TEST(HexCodecTest, RoundTripsEverySize) {
+    for (size_t size = 0; size <= 40; ++size) {
+        std::vector<unsigned char> bytes(size);
+        for (size_t i = 0; i < size; ++i) {
+            bytes[i] = static_cast<unsigned char>(i * 37 + size);
+        }
+        const std::string hex = Scanner::Hex::Encode(bytes.data(), size);
+        ASSERT_EQ(hex.size(), 2 * size);
+        for (size_t i = 0; i < size; ++i) {
+            const char expected[] = {"0123456789abcdef"[bytes[i] >> 4], "0123456789abcdef"[bytes[i] & 0x0F]};
+            ASSERT_EQ(hex.compare(2 * i, 2, expected, 2), 0) << "size " << size << " byte " << i;
+        }
+
+        std::vector<unsigned char> decoded(size, 0xEE);
+        ASSERT_TRUE(Scanner::Hex::Decode(hex.data(), size, decoded.data())) << "size " << size;
+        EXPECT_EQ(decoded, bytes) << "size " << size;
+    }
+}
+
+TEST(HexCodecTest, DecodesEitherCase) {
+    const std::string lower = "00ff10abcdef9a7b00ff10abcdef9a7b00ff10abcdef9a7b00ff10abcdef9a7b";
+    std::string upper = lower;
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](char c) { return static_cast<char>(std::toupper(c)); });
+    std::string mixed = lower;
+    for (size_t i = 0; i < mixed.size(); i += 3) {
+        mixed[i] = upper[i];
+    }
+
+    unsigned char fromLower[32], fromUpper[32], fromMixed[32];
+    ASSERT_TRUE(Scanner::Hex::Decode(lower.data(), 32, fromLower));
+    ASSERT_TRUE(Scanner::Hex::Decode(upper.data(), 32, fromUpper));
+    ASSERT_TRUE(Scanner::Hex::Decode(mixed.data(), 32, fromMixed));
+    EXPECT_EQ(fromLower[1], 0xFF);
+    EXPECT_EQ(fromLower[3], 0xAB);
+    EXPECT_EQ(std::memcmp(fromLower, fromUpper, 32), 0);
+    EXPECT_EQ(std::memcmp(fromLower, fromMixed, 32), 0);
+}
+
+// Neighbours of every hex range, at every position of a block and of the tail
+TEST(HexCodecTest, RejectsNonHexAnywhere) {
+    const char invalid[] = {'/', ':', '@', 'G', '`', 'g', ' ', '\0', 'x', '\x80', '\xC1', '\xE6', '\xFF'};
+    const std::string valid(2 * 20, 'a');
+    for (char c : invalid) {
+        for (size_t position = 0; position < valid.size(); ++position) {
+            std::string hex = valid;
+            hex[position] = c;
+            unsigned char bytes[20];
+            EXPECT_FALSE(Scanner::Hex::Decode(hex.data(), 20, bytes))
+                << "character " << static_cast<int>(static_cast<unsigned char>(c)) << " at " << position;
+        }
+    }
+}
+
+// ============================================================================
+// Utils Tests
+// ============================================================================
+
+TEST(UtilsTest, ToLowerConvertsCorrectly) {
+    EXPECT_EQ(Scanner::Utils::ToLower("HELLO"), "hello");
+    EXPECT_EQ(Scanner::Utils::ToLower("HeLLo"), "hello");
+    EXPECT_EQ(Scanner::Utils::ToLower("hello"), "hello");
+    EXPECT_EQ(Scanner::Utils::ToLower("ABC123"), "abc123");
+    EXPECT_EQ(Scanner::Utils::ToLower(""), "");
+}
+
+TEST(UtilsTest, TrimRemovesWhitespace) {
+    EXPECT_EQ(Scanner::Utils::Trim("  hello  "), "hello");
+    EXPECT_EQ(Scanner::Utils::Trim("hello"), "hello");
+    EXPECT_EQ(Scanner::Utils::Trim("  hello"), "hello");
+    EXPECT_EQ(Scanner::Utils::Trim("hello  "), "hello");
+    EXPECT_EQ(Scanner::Utils::Trim("   "), "");
+    EXPECT_EQ(Scanner::Utils::Trim(""), "");
+}
+
+TEST(UtilsTest, TrimHandlesTabs) {
+    EXPECT_EQ(Scanner::Utils::Trim("\thello\t"), "hello");
+    EXPECT_EQ(Scanner::Utils::Trim("\t\thello"), "hello");
+}
+
+#if defined(__linux__)
+TEST(UtilsTest, GetPageCacheSize) {
+    EXPECT_TRUE(Scanner::Utils::GetPageCacheSize().has_value());
 }
+#endif
 
 TEST(UtilsTest, GetHardwareConcurrency) {
     size_t cores = Scanner::Utils::GetHardwareConcurrency();
@@ -300,7 +2379,7 @@ TEST(UtilsTest, GetHardwareConcurrency) {
 // ============================================================================
 
 TEST(ConstantsTest, ValidValues) {
-    EXPECT_GT(Scanner::Constants::MAX_FILE_SIZE, 0);
+    EXPECT_GE(Scanner::Constants::DEFAULT_BYTES_IN_FLIGHT, Scanner::Constants::HASH_BUFFER_SIZE);
     EXPECT_GT(Scanner::Constants::MAX_PATH_DEPTH, 0);
     EXPECT_GT(Scanner::Constants::MIN_THREAD_COUNT, 0);
     EXPECT_GT(Scanner::Constants::MAX_THREAD_COUNT, Scanner::Constants::MIN_THREAD_COUNT);